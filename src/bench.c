@@ -0,0 +1,526 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "bitgrid.h"
+#include "sparse.h"
+#include "ensemble.h"
+#include "pool.h"
+#include "rule.h"
+#include "timer.h"
+#include "bool.h"
+
+#define BENCH_MAX_LIST_ITEMS     (16)
+#define BENCH_MAX_ITEM_CHARS     (32)
+
+#define BENCH_DEFAULT_SIZES      "100,1000,4000,16000"
+#define BENCH_DEFAULT_DENSITIES  "0.1,0.25,0.5"
+#define BENCH_DEFAULT_RULES      "B3/S234,B2/S34"
+#define BENCH_DEFAULT_KERNELS    "byte,byte-mt,bit"
+#define BENCH_DEFAULT_REPS       (5)
+#define BENCH_DEFAULT_WARMUP     (1)
+#define BENCH_MAX_REPS           (64)
+
+/* Each repetition steps enough generations, or repeats a grid operation
+ * often enough, to cover about this many cells */
+#define BENCH_DEFAULT_CELLS_PER_REP  (1e8)
+
+/* Soup every repetition starts from, ensemble members take the seeds after
+ * BENCH_SEED * members */
+#define BENCH_SEED  (1)
+
+/* Memory traffic models per cell, the byte kernel reads p_disp and writes
+ * p_next, the bit kernel does the same on two bit-planes. Reset writes each
+ * cell once, hashing and counting as it goes, while clear and fill write it
+ * and then read it twice more in Grid_syncDisp for the hash and stats. */
+#define BENCH_BYTE_KERNEL_BYTES_PER_CELL  (2.0)
+#define BENCH_BIT_KERNEL_BYTES_PER_CELL   (0.5)
+#define BENCH_RESET_BYTES_PER_CELL        (1.0)
+#define BENCH_FILL_BYTES_PER_CELL         (3.0)
+
+/* The ensemble kernels step this many soups at once, fewer on grids so large
+ * that they would not fit in BENCH_ENSEMBLE_MAX_CELLS */
+#define BENCH_ENSEMBLE_MEMBERS    (1024)
+#define BENCH_ENSEMBLE_MAX_CELLS  (1 << 28)
+
+
+typedef struct Bench_list_struct {
+    char items[BENCH_MAX_LIST_ITEMS][BENCH_MAX_ITEM_CHARS];
+    int numItems;
+} Bench_list;
+
+
+typedef struct Bench_result_struct {
+    const char *p_kernel;
+    int width_cells;
+    int height_cells;
+    double density;
+    const char *p_rule;
+    long generations;
+    /* Grids stepped together, more than one for the ensemble kernels */
+    int members;
+    int reps;
+    double min_s;
+    double median_s;
+    double bytesPerGen;
+} Bench_result;
+
+
+static void printUsage(char *progName)
+{
+    printf("Usage: %s [options]\n", progName);
+    printf("  -s <list>      square grid sizes (default %s)\n", BENCH_DEFAULT_SIZES);
+    printf("  -d <list>      initial densities (default %s)\n", BENCH_DEFAULT_DENSITIES);
+    printf("  -r <list>      rules (default %s)\n", BENCH_DEFAULT_RULES);
+    printf("  -k <list>      kernels among byte, byte-mt, bit, sparse, ensemble,\n");
+    printf("                 ensemble-mt, reset, reset-mt, clear, fill (default %s)\n", BENCH_DEFAULT_KERNELS);
+    printf("  -n <reps>      timed repetitions, at most %d (default %d)\n", BENCH_MAX_REPS, BENCH_DEFAULT_REPS);
+    printf("  -W <reps>      warm-up repetitions (default %d)\n", BENCH_DEFAULT_WARMUP);
+    printf("  -c <cells>     cells to step or touch per repetition (default %.0e)\n", BENCH_DEFAULT_CELLS_PER_REP);
+    printf("  -t <threads>   threads for the -mt kernels, 0 for one per core\n");
+    printf("                 (default 0)\n");
+    printf("  -o <file>      write the results as JSON\n");
+}
+
+
+static int parseList(char *p_string, Bench_list *p_list)
+{
+    char *p_start = p_string;
+    char *p_comma;
+    int itemLen;
+
+    p_list->numItems = 0;
+    while (*p_start != '\0')
+    {
+        p_comma = strchr(p_start, ',');
+        itemLen = (p_comma != NULL) ? (int) (p_comma - p_start) : (int) strlen(p_start);
+        if (itemLen <= 0 || itemLen >= BENCH_MAX_ITEM_CHARS || p_list->numItems >= BENCH_MAX_LIST_ITEMS)
+        {
+            printf("[ERR] Invalid list %s\n", p_string);
+            return FALSE;
+        }
+
+        memcpy(p_list->items[p_list->numItems], p_start, itemLen);
+        p_list->items[p_list->numItems][itemLen] = '\0';
+        p_list->numItems++;
+
+        p_start += itemLen;
+        if (*p_start == ',')
+        {
+            p_start++;
+        }
+    }
+
+    return p_list->numItems > 0;
+}
+
+
+static int compareDoubles(const void *p_a, const void *p_b)
+{
+    double a = *(const double *) p_a;
+    double b = *(const double *) p_b;
+
+    return (a > b) - (a < b);
+}
+
+
+/* Times one kernel on one configuration. Every repetition starts again from
+ * the same seeded grid so the results do not drift as the soup settles. */
+static int runCase
+   (const char *p_kernel, int size, double density, const char *p_ruleString,
+    int warmup, int reps, double cellsPerRep, Pool *p_pool, Bench_result *p_result)
+{
+    Grid grid;
+    BitGrid bitGrid;
+    Sparse sparse;
+    Ensemble ensemble;
+    Rule rule;
+    double times_s[BENCH_MAX_REPS];
+    long iGen;
+    int iRep;
+    int useBit = (strcmp(p_kernel, "bit") == 0);
+    int useSparse = (strcmp(p_kernel, "sparse") == 0);
+    int useEnsemble = (strncmp(p_kernel, "ensemble", 8) == 0);
+    int iMember;
+    int isStationary;
+    int isFill = (strncmp(p_kernel, "reset", 5) == 0 || strcmp(p_kernel, "clear") == 0 || strcmp(p_kernel, "fill") == 0);
+    double activeFraction = 0.0;
+    uint64_t start_ns;
+
+    if (Rule_parse(p_ruleString, &rule) != TRUE)
+    {
+        return FALSE;
+    }
+    /* Otherwise only the error path would be timed */
+    if (useSparse && (rule.createMask & 1))
+    {
+        printf("[ERR] The sparse universe cannot run rules with B0\n");
+        return FALSE;
+    }
+
+    grid = Grid_create(size, size);
+    if (grid.p_data1 == NULL || grid.p_data2 == NULL)
+    {
+        Grid_destroy(&grid);
+        return FALSE;
+    }
+
+    p_result->p_kernel = p_kernel;
+    p_result->width_cells = size;
+    p_result->height_cells = size;
+    p_result->density = density;
+    p_result->p_rule = p_ruleString;
+    p_result->reps = reps;
+    p_result->members = 1;
+    if (useEnsemble)
+    {
+        p_result->members = BENCH_ENSEMBLE_MEMBERS;
+        while (p_result->members > ENSEMBLE_BLOCK_MEMBERS && (double) size * size * p_result->members > BENCH_ENSEMBLE_MAX_CELLS)
+        {
+            p_result->members /= 2;
+        }
+        if ((double) size * size * p_result->members > BENCH_ENSEMBLE_MAX_CELLS)
+        {
+            Grid_destroy(&grid);
+            return FALSE;
+        }
+    }
+    /* For the grid operations this counts operations rather than generations */
+    p_result->generations = (long) (cellsPerRep / ((double) size * size * p_result->members));
+    if (p_result->generations < 1)
+    {
+        p_result->generations = 1;
+    }
+    if (isFill)
+    {
+        p_result->density = 0.0;
+        p_result->p_rule = "-";
+    }
+
+    for (iRep = -warmup; iRep < reps; iRep++)
+    {
+        Grid_resetGrid(&grid, BENCH_SEED, density);
+        if (useBit)
+        {
+            bitGrid = BitGrid_create(size, size);
+            if (bitGrid.p_data1 == NULL || bitGrid.p_data2 == NULL || bitGrid.p_scratch == NULL)
+            {
+                BitGrid_destroy(&bitGrid);
+                Grid_destroy(&grid);
+                return FALSE;
+            }
+            BitGrid_fromGrid(&bitGrid, &grid);
+        }
+        else if (useSparse)
+        {
+            sparse = Sparse_create();
+            Sparse_fromGrid(&sparse, &grid);
+        }
+        else if (useEnsemble)
+        {
+            /* Every member gets its own soup */
+            ensemble = Ensemble_create(size, size, p_result->members);
+            if (ensemble.p_data1 == NULL)
+            {
+                Grid_destroy(&grid);
+                return FALSE;
+            }
+            for (iMember = 0; iMember < p_result->members; iMember++)
+            {
+                Grid_resetGrid(&grid, (uint64_t) BENCH_SEED * p_result->members + iMember, density);
+                Ensemble_setMember(&ensemble, iMember, &grid);
+            }
+        }
+
+        start_ns = Timer_nowNs();
+        for (iGen = 0; iGen < p_result->generations; iGen++)
+        {
+            if (useBit)
+            {
+                BitGrid_hexGridNextWithRule(&bitGrid, &rule);
+            }
+            else if (useSparse)
+            {
+                if (Sparse_hexGridNextWithRule(&sparse, &rule, &isStationary) != TRUE)
+                {
+                    Sparse_destroy(&sparse);
+                    Grid_destroy(&grid);
+                    return FALSE;
+                }
+            }
+            else if (strcmp(p_kernel, "ensemble") == 0)
+            {
+                Ensemble_hexGridNextWithRule(&ensemble, &rule);
+            }
+            else if (strcmp(p_kernel, "ensemble-mt") == 0)
+            {
+                Ensemble_hexGridNextWithRuleParallel(&ensemble, p_pool, &rule);
+            }
+            else if (strcmp(p_kernel, "byte-mt") == 0)
+            {
+                Grid_hexGridNextWithRuleParallel(&grid, p_pool, &rule);
+                activeFraction += (double) grid.active_tiles / (grid.tiles_x * grid.tiles_y);
+            }
+            else if (strcmp(p_kernel, "byte") == 0)
+            {
+                Grid_hexGridNextWithRule(&grid, &rule);
+                activeFraction += (double) grid.active_tiles / (grid.tiles_x * grid.tiles_y);
+            }
+            else if (strcmp(p_kernel, "reset") == 0)
+            {
+                Grid_resetGrid(&grid, iGen, GRID_DEFAULT_DENSITY);
+            }
+            else if (strcmp(p_kernel, "reset-mt") == 0)
+            {
+                Grid_resetGridParallel(&grid, p_pool, iGen, GRID_DEFAULT_DENSITY);
+            }
+            else if (strcmp(p_kernel, "clear") == 0)
+            {
+                Grid_clearGrid(&grid);
+            }
+            else
+            {
+                Grid_fillGrid(&grid);
+            }
+        }
+        if (iRep >= 0)
+        {
+            times_s[iRep] = Timer_secondsSince(start_ns);
+        }
+
+        if (useBit)
+        {
+            BitGrid_destroy(&bitGrid);
+        }
+        else if (useSparse)
+        {
+            Sparse_destroy(&sparse);
+        }
+        else if (useEnsemble)
+        {
+            Ensemble_destroy(&ensemble);
+        }
+    }
+
+    Grid_destroy(&grid);
+
+    qsort(times_s, reps, sizeof(double), compareDoubles);
+    p_result->min_s = times_s[0];
+    p_result->median_s = times_s[reps / 2];
+
+    /* Bytes touched per generation, modelled from the storage layout */
+    if (useBit || useEnsemble)
+    {
+        p_result->bytesPerGen = BENCH_BIT_KERNEL_BYTES_PER_CELL * size * size * p_result->members;
+    }
+    else if (strncmp(p_kernel, "reset", 5) == 0)
+    {
+        p_result->bytesPerGen = BENCH_RESET_BYTES_PER_CELL * size * size;
+    }
+    else if (isFill)
+    {
+        p_result->bytesPerGen = BENCH_FILL_BYTES_PER_CELL * size * size;
+    }
+    else if (useSparse)
+    {
+        p_result->bytesPerGen = 0.0;
+    }
+    else
+    {
+        activeFraction /= (double) (warmup + reps) * p_result->generations;
+        p_result->bytesPerGen = BENCH_BYTE_KERNEL_BYTES_PER_CELL * activeFraction * size * size;
+    }
+
+    return TRUE;
+}
+
+
+static double cellsPerSecond(Bench_result *p_result)
+{
+    return (double) p_result->generations * p_result->width_cells * p_result->height_cells * p_result->members / p_result->median_s;
+}
+
+
+static void writeJson(FILE *p_file, Bench_result *p_results, int numResults)
+{
+    int iResult;
+    Bench_result *p_result;
+
+    fprintf(p_file, "[\n");
+    for (iResult = 0; iResult < numResults; iResult++)
+    {
+        p_result = &p_results[iResult];
+        fprintf(p_file,
+                "  {\"kernel\": \"%s\", \"width\": %d, \"height\": %d, \"density\": %g, \"rule\": \"%s\", "
+                "\"generations\": %ld, \"members\": %d, \"reps\": %d, \"min_s\": %.9f, \"median_s\": %.9f, "
+                "\"cells_per_s\": %.6e, \"ns_per_cell\": %.6f, \"bytes_per_gen\": %.0f}%s\n",
+                p_result->p_kernel, p_result->width_cells, p_result->height_cells,
+                p_result->density, p_result->p_rule, p_result->generations, p_result->members, p_result->reps,
+                p_result->min_s, p_result->median_s,
+                cellsPerSecond(p_result), 1e9 / cellsPerSecond(p_result), p_result->bytesPerGen,
+                (iResult + 1 < numResults) ? "," : "");
+    }
+    fprintf(p_file, "]\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    char sizesArg[] = BENCH_DEFAULT_SIZES;
+    char densitiesArg[] = BENCH_DEFAULT_DENSITIES;
+    char rulesArg[] = BENCH_DEFAULT_RULES;
+    char kernelsArg[] = BENCH_DEFAULT_KERNELS;
+    char *p_sizesArg = sizesArg;
+    char *p_densitiesArg = densitiesArg;
+    char *p_rulesArg = rulesArg;
+    char *p_kernelsArg = kernelsArg;
+    char *p_jsonPath = NULL;
+    int reps = BENCH_DEFAULT_REPS;
+    int warmup = BENCH_DEFAULT_WARMUP;
+    double cellsPerRep = BENCH_DEFAULT_CELLS_PER_REP;
+    int numThreads = 0;
+
+    Bench_list sizes, densities, rules, kernels;
+    Bench_result *p_results;
+    Bench_result *p_result;
+    int numResults = 0;
+    int maxResults;
+    int iSize, iDensity, iRule, iKernel;
+    int iArg;
+    int isStep;
+    Pool *p_pool;
+    FILE *p_file = NULL;
+    int isFailed = FALSE;
+
+    /* ------ ARGUMENTS ------ */
+    for (iArg = 1; iArg < argc; iArg++)
+    {
+        if (iArg + 1 >= argc || argv[iArg][0] != '-' || argv[iArg][1] == '\0' || argv[iArg][2] != '\0')
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        switch (argv[iArg][1])
+        {
+            case 's':
+                p_sizesArg = argv[++iArg];
+                break;
+            case 'd':
+                p_densitiesArg = argv[++iArg];
+                break;
+            case 'r':
+                p_rulesArg = argv[++iArg];
+                break;
+            case 'k':
+                p_kernelsArg = argv[++iArg];
+                break;
+            case 'n':
+                reps = atoi(argv[++iArg]);
+                break;
+            case 'W':
+                warmup = atoi(argv[++iArg]);
+                break;
+            case 'c':
+                cellsPerRep = atof(argv[++iArg]);
+                break;
+            case 't':
+                numThreads = atoi(argv[++iArg]);
+                break;
+            case 'o':
+                p_jsonPath = argv[++iArg];
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (parseList(p_sizesArg, &sizes) != TRUE || parseList(p_densitiesArg, &densities) != TRUE
+     || parseList(p_rulesArg, &rules) != TRUE || parseList(p_kernelsArg, &kernels) != TRUE
+     || reps <= 0 || reps > BENCH_MAX_REPS || warmup < 0 || cellsPerRep <= 0.0)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    /* Before the runs, so a bad path does not waste them */
+    if (p_jsonPath != NULL)
+    {
+        p_file = fopen(p_jsonPath, "w");
+        if (p_file == NULL)
+        {
+            printf("[ERR] Could not open %s\n", p_jsonPath);
+            return 1;
+        }
+    }
+
+    maxResults = sizes.numItems * densities.numItems * rules.numItems * kernels.numItems;
+    p_results = malloc(maxResults * sizeof(Bench_result));
+    p_pool = Pool_create(numThreads);
+    if (p_results == NULL || p_pool == NULL)
+    {
+        return 1;
+    }
+
+    /* ------ BENCHMARKS ------ */
+    printf("%-8s %6s %6s %-8s %5s %12s %10s %12s\n",
+           "kernel", "size", "dens", "rule", "gens", "cells/s", "ns/cell", "bytes/gen");
+
+    for (iKernel = 0; iKernel < kernels.numItems; iKernel++)
+    {
+        isStep = (strncmp(kernels.items[iKernel], "reset", 5) != 0
+               && strcmp(kernels.items[iKernel], "clear") != 0
+               && strcmp(kernels.items[iKernel], "fill") != 0);
+
+        for (iSize = 0; iSize < sizes.numItems; iSize++)
+        {
+            for (iDensity = 0; iDensity < densities.numItems; iDensity++)
+            {
+                for (iRule = 0; iRule < rules.numItems; iRule++)
+                {
+                    /* Grid operations do not depend on the rule or density */
+                    if (isStep == FALSE && (iRule > 0 || iDensity > 0))
+                    {
+                        continue;
+                    }
+
+                    p_result = &p_results[numResults];
+                    if (runCase(kernels.items[iKernel], atoi(sizes.items[iSize]),
+                                atof(densities.items[iDensity]), rules.items[iRule],
+                                warmup, reps, cellsPerRep, p_pool, p_result) != TRUE)
+                    {
+                        printf("[ERR] %s failed on %sx%s\n", kernels.items[iKernel], sizes.items[iSize], sizes.items[iSize]);
+                        continue;
+                    }
+                    numResults++;
+
+                    printf("%-8s %6d %6.2f %-8s %5ld %12.4e %10.4f %12.0f\n",
+                           p_result->p_kernel, p_result->width_cells, p_result->density,
+                           p_result->p_rule, p_result->generations,
+                           cellsPerSecond(p_result), 1e9 / cellsPerSecond(p_result),
+                           p_result->bytesPerGen);
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+
+    /* ------ REPORT ------ */
+    if (p_file != NULL)
+    {
+        writeJson(p_file, p_results, numResults);
+        if (ferror(p_file) || fclose(p_file) != 0)
+        {
+            printf("[ERR] Could not write %s\n", p_jsonPath);
+            isFailed = TRUE;
+        }
+    }
+
+    Pool_destroy(p_pool);
+    free(p_results);
+
+    return isFailed == TRUE ? 1 : 0;
+}
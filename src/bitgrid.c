@@ -0,0 +1,540 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The AVX2 kernel is compiled for x86 whatever the build flags, and only
+ * used when the CPU running it has AVX2 */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BITGRID_HAS_AVX2  (1)
+#include <immintrin.h>
+#define BITGRID_AVX2  __attribute__((target("avx2")))
+#endif
+
+#include "bitgrid.h"
+#include "profile.h"
+
+
+#define BITGRID_WORD_BITS  (64)
+
+/* Columns 0, 2, 4... are even, which holds for every word as 64 is even */
+#define BITGRID_EVEN_COLS  (0x5555555555555555ULL)
+#define BITGRID_ODD_COLS   (0xAAAAAAAAAAAAAAAAULL)
+
+/* Scratch holds three rows (up, mid, down) of two planes (occupied, sick),
+ * each with a guard word on either side for the wrap-around columns */
+#define BITGRID_SCRATCH_ROWS  (6)
+
+
+typedef struct BitGrid_rowSlot_struct {
+    uint64_t *p_occ;
+    uint64_t *p_sick;
+} BitGrid_rowSlot;
+
+
+static uint64_t *getLoRow(BitGrid *p_bitGrid, uint64_t *p_data, int row)
+{
+    return p_data + (size_t) row * p_bitGrid->words_per_row;
+}
+
+
+static uint64_t *getHiRow(BitGrid *p_bitGrid, uint64_t *p_data, int row)
+{
+    return p_data + ((size_t) p_bitGrid->height_cells + row) * p_bitGrid->words_per_row;
+}
+
+
+static uint64_t getLastWordMask(BitGrid *p_bitGrid)
+{
+    int usedBits = p_bitGrid->width_cells % BITGRID_WORD_BITS;
+
+    if (usedBits == 0)
+    {
+        return ~0ULL;
+    }
+
+    return (1ULL << usedBits) - 1;
+}
+
+
+BitGrid BitGrid_create(int width_cells, int height_cells)
+{
+    BitGrid bitGrid;
+    size_t planeWords;
+
+    bitGrid.width_cells = width_cells;
+    bitGrid.height_cells = height_cells;
+    bitGrid.words_per_row = (width_cells + BITGRID_WORD_BITS - 1) / BITGRID_WORD_BITS;
+
+    planeWords = (size_t) bitGrid.words_per_row * height_cells;
+
+    bitGrid.p_data1 = calloc(2 * planeWords, sizeof(uint64_t));
+    bitGrid.p_data2 = calloc(2 * planeWords, sizeof(uint64_t));
+    bitGrid.p_scratch = calloc(BITGRID_SCRATCH_ROWS * (bitGrid.words_per_row + 2), sizeof(uint64_t));
+    if (bitGrid.p_data1 == NULL || bitGrid.p_data2 == NULL || bitGrid.p_scratch == NULL)
+    {
+        printf("[ERR] Could not create bit grid\n");
+    }
+
+    bitGrid.p_disp = bitGrid.p_data1;
+    bitGrid.p_next = bitGrid.p_data2;
+
+    return bitGrid;
+}
+
+
+void BitGrid_fromGrid(BitGrid *p_bitGrid, Grid *p_grid)
+{
+    int iRow, iCol;
+    uint8_t value;
+    uint64_t *p_lo, *p_hi;
+
+    memset(p_bitGrid->p_disp, 0, 2 * (size_t) p_bitGrid->words_per_row * p_bitGrid->height_cells * sizeof(uint64_t));
+
+    for (iRow = 0; iRow < p_bitGrid->height_cells; iRow++)
+    {
+        p_lo = getLoRow(p_bitGrid, p_bitGrid->p_disp, iRow);
+        p_hi = getHiRow(p_bitGrid, p_bitGrid->p_disp, iRow);
+
+        for (iCol = 0; iCol < p_bitGrid->width_cells; iCol++)
+        {
+            value = Grid_getDispValue(p_grid, iRow, iCol);
+            p_lo[iCol / BITGRID_WORD_BITS] |= (uint64_t) (value & 1) << (iCol % BITGRID_WORD_BITS);
+            p_hi[iCol / BITGRID_WORD_BITS] |= (uint64_t) (value >> 1) << (iCol % BITGRID_WORD_BITS);
+        }
+    }
+}
+
+
+void BitGrid_toGrid(BitGrid *p_bitGrid, Grid *p_grid)
+{
+    int iRow, iCol;
+
+    for (iRow = 0; iRow < p_bitGrid->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_bitGrid->width_cells; iCol++)
+        {
+            Grid_setDispValue(p_grid, iRow, iCol, BitGrid_getDispValue(p_bitGrid, iRow, iCol));
+        }
+    }
+}
+
+
+/* Loads one row of the displayed grid into a scratch slot as occupied and
+ * sick planes. Column width - 1 is copied in front of column 0 and column 0
+ * right after column width - 1 so the shifts below wrap around the torus. */
+static void loadRowSlot(BitGrid *p_bitGrid, int row, BitGrid_rowSlot *p_slot)
+{
+    int iWord;
+    int numWords = p_bitGrid->words_per_row;
+    int lastCol = p_bitGrid->width_cells - 1;
+    int wrapBit = p_bitGrid->width_cells % BITGRID_WORD_BITS;
+    uint64_t *p_lo = getLoRow(p_bitGrid, p_bitGrid->p_disp, row);
+    uint64_t *p_hi = getHiRow(p_bitGrid, p_bitGrid->p_disp, row);
+
+    for (iWord = 0; iWord < numWords; iWord++)
+    {
+        p_slot->p_occ[iWord + 1] = p_lo[iWord] | p_hi[iWord];
+        p_slot->p_sick[iWord + 1] = p_hi[iWord] & ~p_lo[iWord];
+    }
+
+    p_slot->p_occ[0] = ((p_slot->p_occ[lastCol / BITGRID_WORD_BITS + 1] >> (lastCol % BITGRID_WORD_BITS)) & 1) << 63;
+    p_slot->p_sick[0] = ((p_slot->p_sick[lastCol / BITGRID_WORD_BITS + 1] >> (lastCol % BITGRID_WORD_BITS)) & 1) << 63;
+
+    p_slot->p_occ[numWords + 1] = 0;
+    p_slot->p_sick[numWords + 1] = 0;
+    if (wrapBit == 0)
+    {
+        p_slot->p_occ[numWords + 1] = p_slot->p_occ[1] & 1;
+        p_slot->p_sick[numWords + 1] = p_slot->p_sick[1] & 1;
+    }
+    else
+    {
+        p_slot->p_occ[numWords] |= (p_slot->p_occ[1] & 1) << wrapBit;
+        p_slot->p_sick[numWords] |= (p_slot->p_sick[1] & 1) << wrapBit;
+    }
+}
+
+
+/* Value at column c - 1 and c + 1 for every bit of word iWord */
+static inline uint64_t shiftWest(uint64_t *p_row, int iWord)
+{
+    return (p_row[iWord] << 1) | (p_row[iWord - 1] >> 63);
+}
+
+
+static inline uint64_t shiftEast(uint64_t *p_row, int iWord)
+{
+    return (p_row[iWord] >> 1) | (p_row[iWord + 1] << 63);
+}
+
+
+/* Picks p_table[count] for every bit, where count is given bit-sliced */
+static inline uint64_t selectByCount(uint64_t bit0, uint64_t bit1, uint64_t bit2, const uint64_t *p_table)
+{
+    uint64_t sel01 = (bit0 & p_table[1]) | (~bit0 & p_table[0]);
+    uint64_t sel23 = (bit0 & p_table[3]) | (~bit0 & p_table[2]);
+    uint64_t sel45 = (bit0 & p_table[5]) | (~bit0 & p_table[4]);
+    uint64_t sel67 = (bit0 & p_table[7]) | (~bit0 & p_table[6]);
+    uint64_t sel03 = (bit1 & sel23) | (~bit1 & sel01);
+    uint64_t sel47 = (bit1 & sel67) | (~bit1 & sel45);
+
+    return (bit2 & sel47) | (~bit2 & sel03);
+}
+
+
+/* Steps the 64 cells of word iWord (1-based in the slots) and returns the
+ * mask of cells that were born or died */
+static inline uint64_t stepWord
+   (BitGrid_rowSlot *p_up, BitGrid_rowSlot *p_mid, BitGrid_rowSlot *p_down, int iWord,
+    uint64_t lo, uint64_t hi, const uint64_t *p_survive, const uint64_t *p_create,
+    uint64_t *p_nextLo, uint64_t *p_nextHi)
+{
+    uint64_t n0, n1, n2, n3, n4, n5;
+    uint64_t sum0, carry0, sum1, carry1, carry2;
+    uint64_t bit0, bit1, bit2;
+    uint64_t anySick;
+    uint64_t survive, create;
+    uint64_t live, born, fixed;
+
+    /* Occupied neighbours */
+    n0 = shiftWest(p_mid->p_occ, iWord);
+    n1 = shiftEast(p_mid->p_occ, iWord);
+    n2 = p_up->p_occ[iWord];
+    n3 = p_down->p_occ[iWord];
+    n4 = (BITGRID_EVEN_COLS & shiftWest(p_down->p_occ, iWord)) | (BITGRID_ODD_COLS & shiftWest(p_up->p_occ, iWord));
+    n5 = (BITGRID_EVEN_COLS & shiftEast(p_down->p_occ, iWord)) | (BITGRID_ODD_COLS & shiftEast(p_up->p_occ, iWord));
+
+    /* Bit-sliced adder, two full adders then one on the carries */
+    sum0 = n0 ^ n1 ^ n2;
+    carry0 = (n0 & n1) | (n2 & (n0 ^ n1));
+    sum1 = n3 ^ n4 ^ n5;
+    carry1 = (n3 & n4) | (n5 & (n3 ^ n4));
+    bit0 = sum0 ^ sum1;
+    carry2 = sum0 & sum1;
+    bit1 = carry0 ^ carry1 ^ carry2;
+    bit2 = (carry0 & carry1) | (carry2 & (carry0 ^ carry1));
+
+    /* Sick neighbours */
+    anySick = shiftWest(p_mid->p_sick, iWord) | shiftEast(p_mid->p_sick, iWord)
+            | p_up->p_sick[iWord] | p_down->p_sick[iWord]
+            | (BITGRID_EVEN_COLS & (shiftWest(p_down->p_sick, iWord) | shiftEast(p_down->p_sick, iWord)))
+            | (BITGRID_ODD_COLS & (shiftWest(p_up->p_sick, iWord) | shiftEast(p_up->p_sick, iWord)));
+
+    survive = selectByCount(bit0, bit1, bit2, p_survive);
+    create = selectByCount(bit0, bit1, bit2, p_create);
+
+    live = lo ^ hi;
+    fixed = lo & hi;
+    born = ~(lo | hi) & create;
+
+    *p_nextLo = fixed | (lo & live & survive) | (born & ~anySick);
+    *p_nextHi = fixed | (hi & live & survive) | (born & anySick);
+
+    return born | (live & ~survive);
+}
+
+
+#ifdef BITGRID_HAS_AVX2
+BITGRID_AVX2 static inline __m256i shiftWest4(uint64_t *p_row, int iWord)
+{
+    __m256i curr = _mm256_loadu_si256((const __m256i *) (p_row + iWord));
+    __m256i prev = _mm256_loadu_si256((const __m256i *) (p_row + iWord - 1));
+
+    return _mm256_or_si256(_mm256_slli_epi64(curr, 1), _mm256_srli_epi64(prev, 63));
+}
+
+
+BITGRID_AVX2 static inline __m256i shiftEast4(uint64_t *p_row, int iWord)
+{
+    __m256i curr = _mm256_loadu_si256((const __m256i *) (p_row + iWord));
+    __m256i next = _mm256_loadu_si256((const __m256i *) (p_row + iWord + 1));
+
+    return _mm256_or_si256(_mm256_srli_epi64(curr, 1), _mm256_slli_epi64(next, 63));
+}
+
+
+BITGRID_AVX2 static inline __m256i select4(__m256i sel, __m256i ifSet, __m256i ifClear)
+{
+    return _mm256_or_si256(_mm256_and_si256(sel, ifSet), _mm256_andnot_si256(sel, ifClear));
+}
+
+
+BITGRID_AVX2 static inline __m256i selectByCount4(__m256i bit0, __m256i bit1, __m256i bit2, const __m256i *p_table)
+{
+    __m256i sel01 = select4(bit0, p_table[1], p_table[0]);
+    __m256i sel23 = select4(bit0, p_table[3], p_table[2]);
+    __m256i sel45 = select4(bit0, p_table[5], p_table[4]);
+    __m256i sel67 = select4(bit0, p_table[7], p_table[6]);
+
+    return select4(bit2, select4(bit1, sel67, sel45), select4(bit1, sel23, sel01));
+}
+
+
+/* Same as stepWord for four consecutive words */
+BITGRID_AVX2 static inline __m256i stepWord4
+   (BitGrid_rowSlot *p_up, BitGrid_rowSlot *p_mid, BitGrid_rowSlot *p_down, int iWord,
+    uint64_t *p_lo, uint64_t *p_hi, const __m256i *p_survive, const __m256i *p_create,
+    uint64_t *p_nextLo, uint64_t *p_nextHi)
+{
+    const __m256i evenCols = _mm256_set1_epi64x((long long) BITGRID_EVEN_COLS);
+    const __m256i oddCols = _mm256_set1_epi64x((long long) BITGRID_ODD_COLS);
+
+    __m256i n0, n1, n2, n3, n4, n5;
+    __m256i sum0, carry0, sum1, carry1, carry2;
+    __m256i bit0, bit1, bit2;
+    __m256i anySick;
+    __m256i survive, create;
+    __m256i lo, hi, live, born, fixed;
+
+    n0 = shiftWest4(p_mid->p_occ, iWord);
+    n1 = shiftEast4(p_mid->p_occ, iWord);
+    n2 = _mm256_loadu_si256((const __m256i *) (p_up->p_occ + iWord));
+    n3 = _mm256_loadu_si256((const __m256i *) (p_down->p_occ + iWord));
+    n4 = select4(evenCols, shiftWest4(p_down->p_occ, iWord), shiftWest4(p_up->p_occ, iWord));
+    n5 = select4(evenCols, shiftEast4(p_down->p_occ, iWord), shiftEast4(p_up->p_occ, iWord));
+
+    sum0 = _mm256_xor_si256(_mm256_xor_si256(n0, n1), n2);
+    carry0 = _mm256_or_si256(_mm256_and_si256(n0, n1), _mm256_and_si256(n2, _mm256_xor_si256(n0, n1)));
+    sum1 = _mm256_xor_si256(_mm256_xor_si256(n3, n4), n5);
+    carry1 = _mm256_or_si256(_mm256_and_si256(n3, n4), _mm256_and_si256(n5, _mm256_xor_si256(n3, n4)));
+    bit0 = _mm256_xor_si256(sum0, sum1);
+    carry2 = _mm256_and_si256(sum0, sum1);
+    bit1 = _mm256_xor_si256(_mm256_xor_si256(carry0, carry1), carry2);
+    bit2 = _mm256_or_si256(_mm256_and_si256(carry0, carry1), _mm256_and_si256(carry2, _mm256_xor_si256(carry0, carry1)));
+
+    anySick = _mm256_or_si256(shiftWest4(p_mid->p_sick, iWord), shiftEast4(p_mid->p_sick, iWord));
+    anySick = _mm256_or_si256(anySick, _mm256_loadu_si256((const __m256i *) (p_up->p_sick + iWord)));
+    anySick = _mm256_or_si256(anySick, _mm256_loadu_si256((const __m256i *) (p_down->p_sick + iWord)));
+    anySick = _mm256_or_si256(anySick, _mm256_and_si256(evenCols,
+        _mm256_or_si256(shiftWest4(p_down->p_sick, iWord), shiftEast4(p_down->p_sick, iWord))));
+    anySick = _mm256_or_si256(anySick, _mm256_and_si256(oddCols,
+        _mm256_or_si256(shiftWest4(p_up->p_sick, iWord), shiftEast4(p_up->p_sick, iWord))));
+
+    survive = selectByCount4(bit0, bit1, bit2, p_survive);
+    create = selectByCount4(bit0, bit1, bit2, p_create);
+
+    lo = _mm256_loadu_si256((const __m256i *) p_lo);
+    hi = _mm256_loadu_si256((const __m256i *) p_hi);
+    live = _mm256_xor_si256(lo, hi);
+    fixed = _mm256_and_si256(lo, hi);
+    born = _mm256_andnot_si256(_mm256_or_si256(lo, hi), create);
+    survive = _mm256_and_si256(live, survive);
+
+    _mm256_storeu_si256((__m256i *) p_nextLo, _mm256_or_si256(_mm256_or_si256(fixed,
+        _mm256_and_si256(lo, survive)), _mm256_andnot_si256(anySick, born)));
+    _mm256_storeu_si256((__m256i *) p_nextHi, _mm256_or_si256(_mm256_or_si256(fixed,
+        _mm256_and_si256(hi, survive)), _mm256_and_si256(anySick, born)));
+
+    return _mm256_or_si256(born, _mm256_andnot_si256(survive, live));
+}
+
+
+/* Steps whole groups of four words of a row, leaving at least the last word
+ * for the scalar loop. Returns how many words it did and ORs whether any
+ * cell changed into *p_changed. */
+BITGRID_AVX2 static int stepRowAvx2
+   (BitGrid_rowSlot *p_up, BitGrid_rowSlot *p_mid, BitGrid_rowSlot *p_down, int numWords,
+    uint64_t *p_lo, uint64_t *p_hi, const uint64_t *p_surviveTable, const uint64_t *p_createTable,
+    uint64_t *p_nextLo, uint64_t *p_nextHi, uint64_t *p_changed)
+{
+    __m256i surviveTable4[8];
+    __m256i createTable4[8];
+    __m256i changed4 = _mm256_setzero_si256();
+    int iWord, iCount;
+
+    for (iCount = 0; iCount < 8; iCount++)
+    {
+        surviveTable4[iCount] = _mm256_set1_epi64x((long long) p_surviveTable[iCount]);
+        createTable4[iCount] = _mm256_set1_epi64x((long long) p_createTable[iCount]);
+    }
+
+    for (iWord = 0; iWord + 4 < numWords; iWord += 4)
+    {
+        changed4 = _mm256_or_si256(changed4, stepWord4
+           (p_up, p_mid, p_down, iWord + 1,
+            p_lo + iWord, p_hi + iWord, surviveTable4, createTable4,
+            p_nextLo + iWord, p_nextHi + iWord));
+    }
+
+    if (_mm256_testz_si256(changed4, changed4) == 0)
+    {
+        *p_changed = 1;
+    }
+
+    return iWord;
+}
+
+
+static int hasAvx2(void)
+{
+    static int cpuHasAvx2 = -1;
+
+    /* Racing threads all store the same answer */
+    if (cpuHasAvx2 < 0)
+    {
+        __builtin_cpu_init();
+        cpuHasAvx2 = __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+    }
+
+    return cpuHasAvx2;
+}
+#endif
+
+
+int BitGrid_hexGridNextWithRule(BitGrid *p_bitGrid, const Rule *p_rule)
+{
+    int iRow, iWord, iCount;
+    int numWords = p_bitGrid->words_per_row;
+    int slotWords = numWords + 2;
+    uint64_t lastWordMask = getLastWordMask(p_bitGrid);
+
+    uint64_t surviveTable[8];
+    uint64_t createTable[8];
+    BitGrid_rowSlot slots[3];
+    BitGrid_rowSlot *p_up, *p_mid, *p_down, *p_swap;
+
+    uint64_t *p_lo, *p_hi, *p_nextLo, *p_nextHi;
+    uint64_t nextLo, nextHi;
+    uint64_t changed = 0;
+    uint64_t profile_ns = Profile_begin();
+#ifdef BITGRID_HAS_AVX2
+    int useAvx2 = hasAvx2();
+#endif
+
+    /* All ones where the rule holds for that many alive neighbours */
+    for (iCount = 0; iCount < 8; iCount++)
+    {
+        surviveTable[iCount] = (p_rule->surviveMask & (1 << iCount)) ? ~0ULL : 0;
+        createTable[iCount] = (p_rule->createMask & (1 << iCount)) ? ~0ULL : 0;
+    }
+
+    for (iRow = 0; iRow < 3; iRow++)
+    {
+        slots[iRow].p_occ = p_bitGrid->p_scratch + (2 * iRow) * slotWords;
+        slots[iRow].p_sick = p_bitGrid->p_scratch + (2 * iRow + 1) * slotWords;
+    }
+    p_up = &slots[0];
+    p_mid = &slots[1];
+    p_down = &slots[2];
+
+    loadRowSlot(p_bitGrid, p_bitGrid->height_cells - 1, p_up);
+    loadRowSlot(p_bitGrid, 0, p_mid);
+
+    for (iRow = 0; iRow < p_bitGrid->height_cells; iRow++)
+    {
+        loadRowSlot(p_bitGrid, (iRow + 1) % p_bitGrid->height_cells, p_down);
+
+        p_lo = getLoRow(p_bitGrid, p_bitGrid->p_disp, iRow);
+        p_hi = getHiRow(p_bitGrid, p_bitGrid->p_disp, iRow);
+        p_nextLo = getLoRow(p_bitGrid, p_bitGrid->p_next, iRow);
+        p_nextHi = getHiRow(p_bitGrid, p_bitGrid->p_next, iRow);
+
+        /* The last word is always done on its own so it can be masked */
+        iWord = 0;
+#ifdef BITGRID_HAS_AVX2
+        if (useAvx2 == TRUE)
+        {
+            iWord = stepRowAvx2
+               (p_up, p_mid, p_down, numWords,
+                p_lo, p_hi, surviveTable, createTable,
+                p_nextLo, p_nextHi, &changed);
+        }
+#endif
+        for (; iWord < numWords - 1; iWord++)
+        {
+            changed |= stepWord
+               (p_up, p_mid, p_down, iWord + 1,
+                p_lo[iWord], p_hi[iWord], surviveTable, createTable,
+                &p_nextLo[iWord], &p_nextHi[iWord]);
+        }
+        changed |= lastWordMask & stepWord
+           (p_up, p_mid, p_down, iWord + 1,
+            p_lo[iWord], p_hi[iWord], surviveTable, createTable,
+            &nextLo, &nextHi);
+        p_nextLo[iWord] = nextLo & lastWordMask;
+        p_nextHi[iWord] = nextHi & lastWordMask;
+
+        /* Roll the row window down */
+        p_swap = p_up;
+        p_up = p_mid;
+        p_mid = p_down;
+        p_down = p_swap;
+    }
+
+    if (p_bitGrid->p_disp == p_bitGrid->p_data1)
+    {
+        p_bitGrid->p_disp = p_bitGrid->p_data2;
+        p_bitGrid->p_next = p_bitGrid->p_data1;
+    }
+    else
+    {
+        p_bitGrid->p_disp = p_bitGrid->p_data1;
+        p_bitGrid->p_next = p_bitGrid->p_data2;
+    }
+    Profile_end(PROFILE_ZONE_STEP, profile_ns);
+
+    return changed == 0 ? TRUE : FALSE;
+}
+
+
+int BitGrid_hexGridNextWithRange(BitGrid *p_bitGrid, int minAlive, int maxAlive, int minCreate, int maxCreate)
+{
+    Rule rule = Rule_fromRange(minAlive, maxAlive, minCreate, maxCreate);
+
+    return BitGrid_hexGridNextWithRule(p_bitGrid, &rule);
+}
+
+
+int BitGrid_countPopulation(BitGrid *p_bitGrid)
+{
+    size_t iWord;
+    size_t planeWords = (size_t) p_bitGrid->words_per_row * p_bitGrid->height_cells;
+    uint64_t *p_hi = p_bitGrid->p_disp + planeWords;
+    int population = 0;
+
+    for (iWord = 0; iWord < planeWords; iWord++)
+    {
+        population += __builtin_popcountll(p_bitGrid->p_disp[iWord] | p_hi[iWord]);
+    }
+
+    return population;
+}
+
+
+uint8_t BitGrid_getDispValue(BitGrid *p_bitGrid, int row, int col)
+{
+    uint64_t lo = getLoRow(p_bitGrid, p_bitGrid->p_disp, row)[col / BITGRID_WORD_BITS];
+    uint64_t hi = getHiRow(p_bitGrid, p_bitGrid->p_disp, row)[col / BITGRID_WORD_BITS];
+    int bit = col % BITGRID_WORD_BITS;
+
+    return (uint8_t) (((lo >> bit) & 1) | (((hi >> bit) & 1) << 1));
+}
+
+
+void BitGrid_setDispValue(BitGrid *p_bitGrid, int row, int col, uint8_t value)
+{
+    uint64_t *p_lo = &getLoRow(p_bitGrid, p_bitGrid->p_disp, row)[col / BITGRID_WORD_BITS];
+    uint64_t *p_hi = &getHiRow(p_bitGrid, p_bitGrid->p_disp, row)[col / BITGRID_WORD_BITS];
+    uint64_t bitMask = 1ULL << (col % BITGRID_WORD_BITS);
+
+    *p_lo = (value & 1) ? (*p_lo | bitMask) : (*p_lo & ~bitMask);
+    *p_hi = (value & 2) ? (*p_hi | bitMask) : (*p_hi & ~bitMask);
+}
+
+
+void BitGrid_destroy(BitGrid *p_bitGrid)
+{
+    free(p_bitGrid->p_data1);
+    free(p_bitGrid->p_data2);
+    free(p_bitGrid->p_scratch);
+
+    p_bitGrid->p_data1 = NULL;
+    p_bitGrid->p_data2 = NULL;
+    p_bitGrid->p_scratch = NULL;
+    p_bitGrid->p_disp = NULL;
+    p_bitGrid->p_next = NULL;
+
+    p_bitGrid->width_cells = 0;
+    p_bitGrid->height_cells = 0;
+    p_bitGrid->words_per_row = 0;
+}
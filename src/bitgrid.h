@@ -0,0 +1,52 @@
+#ifndef H_HEXLIFE_BITGRID_H
+#define H_HEXLIFE_BITGRID_H
+
+
+#include <stdint.h>
+
+#include "grid.h"
+#include "bool.h"
+
+
+/* Bit-packed grid. Each generation is stored as two bit-planes holding bit 0
+ * (lo) and bit 1 (hi) of the cell state, so GRID_DEAD..GRID_FIXED map onto
+ * the four combinations. Bit j of word w in a row is column w * 64 + j. */
+typedef struct BitGrid_struct {
+    /* Main memory buffers, lo plane rows followed by hi plane rows */
+    uint64_t *p_data1;
+    uint64_t *p_data2;
+
+    /* Pointers to the data to be displayed */
+    uint64_t *p_disp;
+    uint64_t *p_next;
+
+    /* Row scratch used by the step kernel */
+    uint64_t *p_scratch;
+
+    /* Size for the grid */
+    int width_cells;
+    int height_cells;
+    int words_per_row;
+} BitGrid;
+
+
+extern BitGrid BitGrid_create(int width_cells, int height_cells);
+
+extern void BitGrid_fromGrid(BitGrid *p_bitGrid, Grid *p_grid);
+
+extern void BitGrid_toGrid(BitGrid *p_bitGrid, Grid *p_grid);
+
+extern int BitGrid_hexGridNextWithRule(BitGrid *p_bitGrid, const Rule *p_rule);
+
+extern int BitGrid_hexGridNextWithRange(BitGrid *p_bitGrid, int minAlive, int maxAlive, int minCreate, int maxCreate);
+
+extern int BitGrid_countPopulation(BitGrid *p_bitGrid);
+
+extern uint8_t BitGrid_getDispValue(BitGrid *p_bitGrid, int row, int col);
+
+extern void BitGrid_setDispValue(BitGrid *p_bitGrid, int row, int col, uint8_t value);
+
+extern void BitGrid_destroy(BitGrid *p_bitGrid);
+
+
+#endif /* H_HEXLIFE_BITGRID_H */
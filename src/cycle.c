@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cycle.h"
+
+
+static int tableSlot(Cycle *p_cycle, uint64_t hash)
+{
+    /* Grid hashes are already well mixed, the low bits will do */
+    int iSlot = (int) (hash & (uint64_t) p_cycle->table_mask);
+
+    while (p_cycle->p_used[iSlot] == TRUE && p_cycle->p_keys[iSlot] != hash)
+    {
+        iSlot = (iSlot + 1) & p_cycle->table_mask;
+    }
+
+    return iSlot;
+}
+
+
+/* Backward shift deletion, keeps probe chains intact without tombstones */
+static void tableRemove(Cycle *p_cycle, uint64_t hash)
+{
+    int iSlot = tableSlot(p_cycle, hash);
+    int iNext;
+    int iHome;
+
+    if (p_cycle->p_used[iSlot] == FALSE)
+    {
+        return;
+    }
+
+    iNext = (iSlot + 1) & p_cycle->table_mask;
+    while (p_cycle->p_used[iNext] == TRUE)
+    {
+        iHome = (int) (p_cycle->p_keys[iNext] & (uint64_t) p_cycle->table_mask);
+
+        /* Move the entry back if its home is not inside (iSlot, iNext] */
+        if (((iNext - iHome) & p_cycle->table_mask) >= ((iNext - iSlot) & p_cycle->table_mask))
+        {
+            p_cycle->p_keys[iSlot] = p_cycle->p_keys[iNext];
+            p_cycle->p_generations[iSlot] = p_cycle->p_generations[iNext];
+            iSlot = iNext;
+        }
+        iNext = (iNext + 1) & p_cycle->table_mask;
+    }
+
+    p_cycle->p_used[iSlot] = FALSE;
+}
+
+
+/* Width cells a row, as the row padding is not part of the state */
+static int keepCandidate(Cycle *p_cycle, const Grid *p_grid)
+{
+    size_t numBytes = (size_t) p_grid->width_cells * p_grid->height_cells;
+    uint8_t *p_cells;
+    int iRow;
+
+    if (numBytes > p_cycle->candidate_bytes)
+    {
+        p_cells = realloc(p_cycle->p_candidate, numBytes);
+        if (p_cells == NULL)
+        {
+            printf("[ERR] Failed to allocate the cells of a candidate cycle\n");
+            return FALSE;
+        }
+        p_cycle->p_candidate = p_cells;
+        p_cycle->candidate_bytes = numBytes;
+    }
+
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        memcpy(p_cycle->p_candidate + (size_t) iRow * p_grid->width_cells,
+               p_grid->p_disp + (size_t) iRow * p_grid->stride_cells, p_grid->width_cells);
+    }
+
+    return TRUE;
+}
+
+
+static int isCandidateRepeated(Cycle *p_cycle, const Grid *p_grid)
+{
+    int iRow;
+
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        if (memcmp(p_cycle->p_candidate + (size_t) iRow * p_grid->width_cells,
+                   p_grid->p_disp + (size_t) iRow * p_grid->stride_cells, p_grid->width_cells) != 0)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+Cycle Cycle_create(int maxPeriod)
+{
+    Cycle cycle;
+    int tableSize = 1;
+
+    memset(&cycle, 0, sizeof(Cycle));
+
+    if (maxPeriod <= 0)
+    {
+        maxPeriod = CYCLE_DEFAULT_MAX_PERIOD;
+    }
+
+    /* Keep the load factor at or under one half */
+    while (tableSize < 2 * maxPeriod)
+    {
+        tableSize <<= 1;
+    }
+
+    cycle.max_period = maxPeriod;
+    cycle.table_mask = tableSize - 1;
+    cycle.p_ring = malloc(maxPeriod * sizeof(uint64_t));
+    cycle.p_keys = malloc(tableSize * sizeof(uint64_t));
+    cycle.p_generations = malloc(tableSize * sizeof(uint64_t));
+    cycle.p_used = calloc(tableSize, sizeof(uint8_t));
+
+    if (cycle.p_ring == NULL || cycle.p_keys == NULL || cycle.p_generations == NULL || cycle.p_used == NULL)
+    {
+        printf("[ERR] Failed to allocate the cycle history for %d generations\n", maxPeriod);
+        Cycle_destroy(&cycle);
+    }
+
+    return cycle;
+}
+
+
+int Cycle_update(Cycle *p_cycle, const Grid *p_grid)
+{
+    uint64_t hash = p_grid->hash;
+    uint64_t generation = p_grid->generation;
+    int iSlot;
+
+    /* A repeat is real if the state comes round again a period later, and
+     * otherwise the hashes collided and the search carries on */
+    if (p_cycle->isCandidate == TRUE && generation >= p_cycle->confirm_generation)
+    {
+        p_cycle->isCandidate = FALSE;
+        if (generation == p_cycle->confirm_generation && isCandidateRepeated(p_cycle, p_grid) == TRUE)
+        {
+            p_cycle->period = p_cycle->candidate_period;
+            p_cycle->start_generation = p_cycle->candidate_start;
+
+            return TRUE;
+        }
+    }
+
+    iSlot = tableSlot(p_cycle, hash);
+    if (p_cycle->p_used[iSlot] == TRUE)
+    {
+        if (p_cycle->isCandidate == FALSE && keepCandidate(p_cycle, p_grid) == TRUE)
+        {
+            p_cycle->candidate_period = (int) (generation - p_cycle->p_generations[iSlot]);
+            p_cycle->candidate_start = p_cycle->p_generations[iSlot];
+            p_cycle->confirm_generation = generation + p_cycle->candidate_period;
+            p_cycle->isCandidate = TRUE;
+        }
+
+        return FALSE;
+    }
+
+    /* Forget the oldest generation once the window is full */
+    if (p_cycle->ring_count == p_cycle->max_period)
+    {
+        tableRemove(p_cycle, p_cycle->p_ring[p_cycle->ring_head]);
+        p_cycle->ring_head = (p_cycle->ring_head + 1) % p_cycle->max_period;
+        p_cycle->ring_count--;
+        iSlot = tableSlot(p_cycle, hash);
+    }
+
+    p_cycle->p_ring[(p_cycle->ring_head + p_cycle->ring_count) % p_cycle->max_period] = hash;
+    p_cycle->ring_count++;
+
+    p_cycle->p_keys[iSlot] = hash;
+    p_cycle->p_generations[iSlot] = generation;
+    p_cycle->p_used[iSlot] = TRUE;
+
+    return FALSE;
+}
+
+
+void Cycle_reset(Cycle *p_cycle)
+{
+    memset(p_cycle->p_used, FALSE, (p_cycle->table_mask + 1) * sizeof(uint8_t));
+    p_cycle->ring_count = 0;
+    p_cycle->ring_head = 0;
+    p_cycle->isCandidate = FALSE;
+    p_cycle->period = 0;
+    p_cycle->start_generation = 0;
+}
+
+
+void Cycle_destroy(Cycle *p_cycle)
+{
+    free(p_cycle->p_ring);
+    free(p_cycle->p_keys);
+    free(p_cycle->p_generations);
+    free(p_cycle->p_used);
+    free(p_cycle->p_candidate);
+
+    p_cycle->p_ring = NULL;
+    p_cycle->p_keys = NULL;
+    p_cycle->p_generations = NULL;
+    p_cycle->p_used = NULL;
+    p_cycle->p_candidate = NULL;
+    p_cycle->candidate_bytes = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef H_HEXLIFE_CYCLE_H
+#define H_HEXLIFE_CYCLE_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "grid.h"
+#include "bool.h"
+
+
+#define CYCLE_DEFAULT_MAX_PERIOD  (1024)
+
+
+/* Remembers the grid hashes of the last max_period generations and spots the
+ * first one that comes back. A stationary grid shows up as period 1. As two
+ * states can share a hash, a repeat found at generation g with period p is
+ * only a candidate until the cells at g + p match the ones kept from g. */
+typedef struct Cycle_struct {
+    /* Ring of recent hashes, oldest first from ring_head */
+    uint64_t *p_ring;
+    int ring_count;
+    int ring_head;
+    int max_period;
+
+    /* Open addressing index from hash to generation over the ring */
+    uint64_t *p_keys;
+    uint64_t *p_generations;
+    uint8_t *p_used;
+    int table_mask;
+
+    /* Cells of the candidate repeat, width_cells a row, and when to check them */
+    uint8_t *p_candidate;
+    size_t candidate_bytes;
+    int isCandidate;
+    int candidate_period;
+    uint64_t candidate_start;
+    uint64_t confirm_generation;
+
+    /* Set once a repeat has been confirmed */
+    int period;
+    uint64_t start_generation;
+} Cycle;
+
+
+extern Cycle Cycle_create(int maxPeriod);
+
+/* Records the grid's hash at its generation. Returns TRUE once a state seen
+ * within max_period generations has been confirmed to repeat, one period
+ * after it came back, in which case period and start_generation describe the
+ * cycle. Must be called every generation. */
+extern int Cycle_update(Cycle *p_cycle, const Grid *p_grid);
+
+extern void Cycle_reset(Cycle *p_cycle);
+
+extern void Cycle_destroy(Cycle *p_cycle);
+
+
+#endif /* H_HEXLIFE_CYCLE_H */
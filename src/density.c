@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "density.h"
+
+
+static int blocksAt(int numCells, int level)
+{
+    return (int) (((int64_t) numCells + ((int64_t) 1 << level) - 1) >> level);
+}
+
+
+/* Recomputes the blocks in rows [rowStart, rowEnd) and columns
+ * [colStart, colEnd) of a level from the one below. Blocks hanging off the
+ * edge of the grid count what is missing as dead. */
+static void computeRect
+   (Density *p_density, const Grid *p_grid, int level,
+    int rowStart, int rowEnd, int colStart, int colEnd)
+{
+    const uint8_t *p_below = p_density->p_levels[level - 1];
+    const uint8_t *p_row;
+    uint8_t *p_out;
+    int widthBelow = p_density->width_blocks[level - 1];
+    int heightBelow = p_density->height_blocks[level - 1];
+    int iRow, iCol;
+    int sum, below;
+
+    for (iRow = rowStart; iRow < rowEnd; iRow++)
+    {
+        p_out = p_density->p_levels[level] + (size_t) iRow * p_density->width_blocks[level];
+
+        for (iCol = colStart; iCol < colEnd; iCol++)
+        {
+            if (level == 1)
+            {
+                /* Cells past width_cells are row padding and already dead */
+                p_row = p_grid->p_disp + (size_t) 2 * iRow * p_grid->stride_cells;
+                below = (p_row[2 * iCol] != GRID_DEAD) + (p_row[2 * iCol + 1] != GRID_DEAD);
+                if (2 * iRow + 1 < p_grid->height_cells)
+                {
+                    p_row += p_grid->stride_cells;
+                    below += (p_row[2 * iCol] != GRID_DEAD) + (p_row[2 * iCol + 1] != GRID_DEAD);
+                }
+                sum = below * DENSITY_FULL;
+            }
+            else
+            {
+                p_row = p_below + (size_t) 2 * iRow * widthBelow;
+                sum = p_row[2 * iCol];
+                if (2 * iCol + 1 < widthBelow)
+                {
+                    sum += p_row[2 * iCol + 1];
+                }
+                if (2 * iRow + 1 < heightBelow)
+                {
+                    p_row += widthBelow;
+                    sum += p_row[2 * iCol];
+                    if (2 * iCol + 1 < widthBelow)
+                    {
+                        sum += p_row[2 * iCol + 1];
+                    }
+                }
+            }
+
+            p_out[iCol] = (uint8_t) ((sum + 2) / 4);
+        }
+    }
+}
+
+
+Density Density_create(int width_cells, int height_cells)
+{
+    Density density;
+    int level;
+    int numTiles;
+    size_t offset;
+
+    memset(&density, 0, sizeof(Density));
+
+    density.num_levels = 1;
+    while (density.num_levels < DENSITY_MAX_LEVELS
+        && (blocksAt(width_cells, density.num_levels) > 1 || blocksAt(height_cells, density.num_levels) > 1))
+    {
+        density.num_levels++;
+    }
+    while (((int64_t) 1 << density.tile_level) < GRID_TILE_SIZE_CELLS)
+    {
+        density.tile_level++;
+    }
+
+    density.width_blocks[0] = width_cells;
+    density.height_blocks[0] = height_cells;
+    for (level = 1; level <= density.num_levels; level++)
+    {
+        density.width_blocks[level] = blocksAt(width_cells, level);
+        density.height_blocks[level] = blocksAt(height_cells, level);
+        density.data_bytes += (size_t) density.width_blocks[level] * density.height_blocks[level];
+    }
+
+    density.tiles_x = (width_cells + GRID_TILE_SIZE_CELLS - 1) / GRID_TILE_SIZE_CELLS;
+    density.tiles_y = (height_cells + GRID_TILE_SIZE_CELLS - 1) / GRID_TILE_SIZE_CELLS;
+    numTiles = density.tiles_x * density.tiles_y;
+
+    density.p_data = calloc(density.data_bytes, sizeof(uint8_t));
+    density.p_dirtyTiles = malloc(numTiles * sizeof(uint8_t));
+    density.p_dirtyScratch = malloc(numTiles * sizeof(uint8_t));
+    if (density.p_data == NULL || density.p_dirtyTiles == NULL || density.p_dirtyScratch == NULL)
+    {
+        printf("[ERR] Could not create a density pyramid of %lu bytes\n", (unsigned long) density.data_bytes);
+        Density_destroy(&density);
+        return density;
+    }
+
+    offset = 0;
+    for (level = 1; level <= density.num_levels; level++)
+    {
+        density.p_levels[level] = density.p_data + offset;
+        offset += (size_t) density.width_blocks[level] * density.height_blocks[level];
+    }
+
+    Density_markAll(&density);
+
+    return density;
+}
+
+
+void Density_markChanged(Density *p_density, const Grid *p_grid)
+{
+    int iTile;
+
+    for (iTile = 0; iTile < p_density->tiles_x * p_density->tiles_y; iTile++)
+    {
+        p_density->p_dirtyTiles[iTile] |= p_grid->p_tileChanged[iTile];
+    }
+}
+
+
+void Density_markAll(Density *p_density)
+{
+    memset(p_density->p_dirtyTiles, TRUE, p_density->tiles_x * p_density->tiles_y);
+}
+
+
+void Density_update(Density *p_density, const Grid *p_grid)
+{
+    uint8_t *p_dirty = p_density->p_dirtyScratch;
+    int dirtyWidth = p_density->tiles_x;
+    int dirtyHeight = p_density->tiles_y;
+    int nextWidth, nextHeight;
+    int level;
+    int iRow, iCol;
+    int shift;
+
+    memcpy(p_dirty, p_density->p_dirtyTiles, dirtyWidth * dirtyHeight);
+    memset(p_density->p_dirtyTiles, FALSE, dirtyWidth * dirtyHeight);
+
+    for (level = 1; level <= p_density->num_levels; level++)
+    {
+        /* Coarser than a tile, the dirty map is halved in place to one flag
+         * per block. Each flag is written at or before the ones it is read
+         * from, so nothing is overwritten before it is read. */
+        if (level > p_density->tile_level)
+        {
+            nextWidth = (dirtyWidth + 1) / 2;
+            nextHeight = (dirtyHeight + 1) / 2;
+            for (iRow = 0; iRow < nextHeight; iRow++)
+            {
+                for (iCol = 0; iCol < nextWidth; iCol++)
+                {
+                    p_dirty[iRow * nextWidth + iCol] =
+                        p_dirty[2 * iRow * dirtyWidth + 2 * iCol]
+                        | (2 * iCol + 1 < dirtyWidth ? p_dirty[2 * iRow * dirtyWidth + 2 * iCol + 1] : FALSE)
+                        | (2 * iRow + 1 < dirtyHeight ? p_dirty[(2 * iRow + 1) * dirtyWidth + 2 * iCol] : FALSE)
+                        | (2 * iRow + 1 < dirtyHeight && 2 * iCol + 1 < dirtyWidth
+                           ? p_dirty[(2 * iRow + 1) * dirtyWidth + 2 * iCol + 1] : FALSE);
+                }
+            }
+            dirtyWidth = nextWidth;
+            dirtyHeight = nextHeight;
+        }
+
+        /* Blocks a dirty flag covers, several per tile at the finer levels */
+        shift = p_density->tile_level - level;
+        for (iRow = 0; iRow < dirtyHeight; iRow++)
+        {
+            for (iCol = 0; iCol < dirtyWidth; iCol++)
+            {
+                if (p_dirty[iRow * dirtyWidth + iCol] != TRUE)
+                {
+                    continue;
+                }
+
+                if (shift > 0)
+                {
+                    computeRect
+                       (p_density, p_grid, level,
+                        iRow << shift,
+                        (iRow + 1) << shift < p_density->height_blocks[level] ? (iRow + 1) << shift : p_density->height_blocks[level],
+                        iCol << shift,
+                        (iCol + 1) << shift < p_density->width_blocks[level] ? (iCol + 1) << shift : p_density->width_blocks[level]);
+                }
+                else
+                {
+                    computeRect(p_density, p_grid, level, iRow, iRow + 1, iCol, iCol + 1);
+                }
+            }
+        }
+    }
+}
+
+
+void Density_copy(Density *p_dst, const Density *p_src)
+{
+    memcpy(p_dst->p_data, p_src->p_data, p_src->data_bytes);
+}
+
+
+uint8_t Density_value(const Density *p_density, int level, int row, int col)
+{
+    return p_density->p_levels[level][(size_t) row * p_density->width_blocks[level] + col];
+}
+
+
+void Density_destroy(Density *p_density)
+{
+    free(p_density->p_data);
+    free(p_density->p_dirtyTiles);
+    free(p_density->p_dirtyScratch);
+
+    p_density->p_data = NULL;
+    p_density->p_dirtyTiles = NULL;
+    p_density->p_dirtyScratch = NULL;
+    p_density->num_levels = 0;
+    p_density->data_bytes = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef H_HEXLIFE_DENSITY_H
+#define H_HEXLIFE_DENSITY_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "grid.h"
+#include "bool.h"
+
+
+/* Enough for the widest grid an int can index */
+#define DENSITY_MAX_LEVELS  (31)
+
+#define DENSITY_EMPTY  (0)
+#define DENSITY_FULL   (255)
+
+
+/* Pyramid of how crowded the grid is, for drawing it zoomed out. Level k
+ * holds one value per 2^k x 2^k block of cells, from DENSITY_EMPTY when all
+ * are dead to DENSITY_FULL when none are. Level 0 is the grid itself and is
+ * not stored, the top level is a single block. */
+typedef struct Density_struct {
+    int num_levels;
+    int width_blocks[DENSITY_MAX_LEVELS + 1];
+    int height_blocks[DENSITY_MAX_LEVELS + 1];
+    uint8_t *p_levels[DENSITY_MAX_LEVELS + 1];
+
+    /* Every level in one buffer */
+    uint8_t *p_data;
+    size_t data_bytes;
+
+    /* Grid tiles changed since the last update, only their blocks and those
+     * above them are recomputed */
+    uint8_t *p_dirtyTiles;
+    uint8_t *p_dirtyScratch;
+    int tiles_x;
+    int tiles_y;
+    int tile_level;
+} Density;
+
+
+/* p_data is left NULL on failure. Starts with every tile dirty. */
+extern Density Density_create(int width_cells, int height_cells);
+
+/* Adds the tiles the grid flags as changed to the dirty set. Call after
+ * every step and before stepping over edits, since a step replaces the flags. */
+extern void Density_markChanged(Density *p_density, const Grid *p_grid);
+
+extern void Density_markAll(Density *p_density);
+
+/* Brings every level up to date with the displayed cells of the grid */
+extern void Density_update(Density *p_density, const Grid *p_grid);
+
+/* Copies the levels of one pyramid into another made for the same size */
+extern void Density_copy(Density *p_dst, const Density *p_src);
+
+/* Level 1 to num_levels */
+extern uint8_t Density_value(const Density *p_density, int level, int row, int col);
+
+extern void Density_destroy(Density *p_density);
+
+
+#endif /* H_HEXLIFE_DENSITY_H */
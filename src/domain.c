@@ -0,0 +1,986 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "domain.h"
+
+
+/* How long a shared memory wait sleeps before checking its peers are alive */
+#define DOMAIN_LIVENESS_CHECK_NS  (100 * 1000 * 1000L)
+
+
+/* Process shared barrier on a futex, so waits can wake up now and then to
+ * check that the other processes are still there. Once a peer is found gone
+ * the barrier stays broken and every wait on it fails. */
+typedef struct Domain_barrier_struct {
+    uint32_t numParties;
+    uint32_t numArrived;
+    /* Bumped by the last party to arrive, which is what the others wait on */
+    uint32_t round;
+    uint32_t isBroken;
+} Domain_barrier;
+
+
+/* Start of the shared mapping. The first and last row of every slab follow
+ * it, then the cells of the whole grid for gathering, neither padded. */
+typedef struct Domain_shared_struct {
+    /* The coordinator and every worker, and the workers alone */
+    Domain_barrier allBarrier;
+    Domain_barrier workerBarrier;
+
+    int command;
+    Domain_result results[DOMAIN_MAX_WORKERS];
+} Domain_shared;
+
+
+/* One side of a socket halo exchange */
+typedef struct Domain_link_struct {
+    int fd;
+    const uint8_t *p_send;
+    uint8_t *p_receive;
+    size_t sentBytes;
+    size_t receivedBytes;
+} Domain_link;
+
+
+static int wrapsRows(const Domain *p_domain)
+{
+    return p_domain->p_grid->boundary == GRID_BOUNDARY_TORUS;
+}
+
+
+/* Whether link iLink, below slab iLink, exists. The last one only does when
+ * the grid wraps from its bottom row to its top. */
+static int hasLink(const Domain *p_domain, int iLink)
+{
+    return iLink < p_domain->num_workers - 1 || wrapsRows(p_domain);
+}
+
+
+/* ------ SHARED MEMORY ------ */
+
+/* Whether a process this one waits with has gone. The coordinator looks for
+ * workers that exited without reaping them, which Domain_destroy still does,
+ * and a worker whose coordinator died is inherited by another process. */
+static int isPeerLost(Domain *p_domain)
+{
+    siginfo_t info;
+    int iWorker;
+
+    if (getpid() != p_domain->coordinator_pid)
+    {
+        return getppid() != p_domain->coordinator_pid;
+    }
+
+    for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+    {
+        info.si_pid = 0;
+        if (waitid(P_PID, p_domain->pids[iWorker], &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid != 0)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+static void futexWake(uint32_t *p_word)
+{
+    syscall(SYS_futex, p_word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+
+/* Breaks both barriers, so whoever waits on either gives up too */
+static void breakBarriers(Domain *p_domain)
+{
+    Domain_shared *p_shared = p_domain->p_shared;
+
+    __atomic_store_n(&p_shared->allBarrier.isBroken, TRUE, __ATOMIC_RELEASE);
+    __atomic_store_n(&p_shared->workerBarrier.isBroken, TRUE, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&p_shared->allBarrier.round, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&p_shared->workerBarrier.round, 1, __ATOMIC_RELEASE);
+    futexWake(&p_shared->allBarrier.round);
+    futexWake(&p_shared->workerBarrier.round);
+}
+
+
+/* Returns FALSE once a peer is lost */
+static int barrierWait(Domain *p_domain, Domain_barrier *p_barrier)
+{
+    struct timespec timeout = { 0, DOMAIN_LIVENESS_CHECK_NS };
+    uint32_t round = __atomic_load_n(&p_barrier->round, __ATOMIC_ACQUIRE);
+
+    if (__atomic_load_n(&p_barrier->isBroken, __ATOMIC_ACQUIRE) == TRUE)
+    {
+        return FALSE;
+    }
+
+    /* Nobody can leave this round before the last arrival, so the count can
+     * be reset ahead of the round that releases them */
+    if (__atomic_add_fetch(&p_barrier->numArrived, 1, __ATOMIC_ACQ_REL) == p_barrier->numParties)
+    {
+        __atomic_store_n(&p_barrier->numArrived, 0, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&p_barrier->round, 1, __ATOMIC_RELEASE);
+        futexWake(&p_barrier->round);
+        return TRUE;
+    }
+
+    while (__atomic_load_n(&p_barrier->round, __ATOMIC_ACQUIRE) == round)
+    {
+        if (syscall(SYS_futex, &p_barrier->round, FUTEX_WAIT, round, &timeout, NULL, 0) != 0
+         && errno == ETIMEDOUT && isPeerLost(p_domain) == TRUE)
+        {
+            breakBarriers(p_domain);
+        }
+    }
+
+    return __atomic_load_n(&p_barrier->isBroken, __ATOMIC_ACQUIRE) == FALSE;
+}
+
+static uint8_t *sharedEdgeRow(Domain *p_domain, int iWorker, int isLast)
+{
+    return (uint8_t *) p_domain->p_shared + sizeof(Domain_shared)
+         + ((size_t) iWorker * 2 + isLast) * p_domain->width_cells;
+}
+
+
+static uint8_t *sharedCells(Domain *p_domain)
+{
+    return sharedEdgeRow(p_domain, p_domain->num_workers, 0);
+}
+
+
+static int shmOpen(Domain *p_domain)
+{
+    Domain_shared *p_shared;
+
+    p_domain->shared_bytes = sizeof(Domain_shared)
+                           + (size_t) p_domain->num_workers * 2 * p_domain->width_cells
+                           + (size_t) p_domain->width_cells * p_domain->height_cells;
+    p_domain->p_shared = mmap(NULL, p_domain->shared_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p_domain->p_shared == MAP_FAILED)
+    {
+        p_domain->p_shared = NULL;
+        printf("[ERR] Could not map %lu shared bytes\n", (unsigned long) p_domain->shared_bytes);
+        return FALSE;
+    }
+    /* Fresh anonymous mappings are zeroed */
+    p_shared = p_domain->p_shared;
+    p_shared->allBarrier.numParties = p_domain->num_workers + 1;
+    p_shared->workerBarrier.numParties = p_domain->num_workers;
+
+    return TRUE;
+}
+
+
+static void shmEnterCoordinator(Domain *p_domain)
+{
+    (void) p_domain;
+}
+
+
+static void shmEnterWorker(Domain *p_domain, int iWorker)
+{
+    (void) p_domain;
+    (void) iWorker;
+}
+
+
+static int shmSendCommand(Domain *p_domain, int command)
+{
+    Domain_shared *p_shared = p_domain->p_shared;
+
+    p_shared->command = command;
+
+    return barrierWait(p_domain, &p_shared->allBarrier);
+}
+
+
+static int shmReceiveCommand(Domain *p_domain, int iWorker, int *p_command)
+{
+    Domain_shared *p_shared = p_domain->p_shared;
+
+    (void) iWorker;
+    if (barrierWait(p_domain, &p_shared->allBarrier) != TRUE)
+    {
+        return FALSE;
+    }
+    *p_command = p_shared->command;
+
+    return TRUE;
+}
+
+
+/* Each slab's edge rows have one slot, which is safe to reuse as nobody
+ * writes it again before the results barrier, and everyone has read it by
+ * then */
+static int shmExchangeHalos
+   (Domain *p_domain, int iWorker,
+    const uint8_t *p_firstRow, const uint8_t *p_lastRow,
+    uint8_t *p_above, uint8_t *p_below)
+{
+    Domain_shared *p_shared = p_domain->p_shared;
+    int numWorkers = p_domain->num_workers;
+
+    memcpy(sharedEdgeRow(p_domain, iWorker, FALSE), p_firstRow, p_domain->width_cells);
+    memcpy(sharedEdgeRow(p_domain, iWorker, TRUE), p_lastRow, p_domain->width_cells);
+    if (barrierWait(p_domain, &p_shared->workerBarrier) != TRUE)
+    {
+        return FALSE;
+    }
+
+    if (p_above != NULL)
+    {
+        memcpy(p_above, sharedEdgeRow(p_domain, (iWorker + numWorkers - 1) % numWorkers, TRUE), p_domain->width_cells);
+    }
+    if (p_below != NULL)
+    {
+        memcpy(p_below, sharedEdgeRow(p_domain, (iWorker + 1) % numWorkers, FALSE), p_domain->width_cells);
+    }
+
+    return TRUE;
+}
+
+
+static int shmSendResult(Domain *p_domain, int iWorker, const Domain_result *p_result)
+{
+    Domain_shared *p_shared = p_domain->p_shared;
+
+    p_shared->results[iWorker] = *p_result;
+
+    return barrierWait(p_domain, &p_shared->allBarrier);
+}
+
+
+static int shmReceiveResults(Domain *p_domain, Domain_result *p_results)
+{
+    Domain_shared *p_shared = p_domain->p_shared;
+
+    if (barrierWait(p_domain, &p_shared->allBarrier) != TRUE)
+    {
+        return FALSE;
+    }
+    memcpy(p_results, p_shared->results, p_domain->num_workers * sizeof(Domain_result));
+
+    return TRUE;
+}
+
+
+static int shmSendSlab(Domain *p_domain, int iWorker, const Grid *p_slab)
+{
+    Domain_shared *p_shared = p_domain->p_shared;
+    uint8_t *p_cells = sharedCells(p_domain)
+                     + (size_t) Domain_slabStart(p_domain->height_cells, p_domain->num_workers, iWorker) * p_domain->width_cells;
+    int iRow;
+
+    for (iRow = 0; iRow < p_slab->height_cells; iRow++)
+    {
+        memcpy(p_cells + (size_t) iRow * p_domain->width_cells,
+               p_slab->p_disp + (size_t) iRow * p_slab->stride_cells,
+               p_domain->width_cells);
+    }
+
+    return barrierWait(p_domain, &p_shared->allBarrier);
+}
+
+
+static int shmReceiveSlabs(Domain *p_domain, Grid *p_grid)
+{
+    Domain_shared *p_shared = p_domain->p_shared;
+    int iRow;
+
+    if (barrierWait(p_domain, &p_shared->allBarrier) != TRUE)
+    {
+        return FALSE;
+    }
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        memcpy(p_grid->p_disp + (size_t) iRow * p_grid->stride_cells,
+               sharedCells(p_domain) + (size_t) iRow * p_domain->width_cells,
+               p_domain->width_cells);
+    }
+
+    return TRUE;
+}
+
+
+static void shmClose(Domain *p_domain)
+{
+    if (p_domain->p_shared == NULL)
+    {
+        return;
+    }
+    munmap(p_domain->p_shared, p_domain->shared_bytes);
+    p_domain->p_shared = NULL;
+}
+
+
+static const Domain_transport shmTransport =
+    { shmOpen, shmEnterWorker, shmEnterCoordinator,
+      shmSendCommand, shmReceiveCommand, shmExchangeHalos,
+      shmSendResult, shmReceiveResults, shmSendSlab, shmReceiveSlabs,
+      shmClose };
+
+
+/* ------ SOCKETS ------ */
+
+/* Writes to a peer that died fail with EPIPE rather than raising SIGPIPE */
+static int sendAll(int fd, const void *p_data, size_t numBytes)
+{
+    const uint8_t *p_bytes = p_data;
+    ssize_t sent;
+
+    while (numBytes > 0)
+    {
+        sent = send(fd, p_bytes, numBytes, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return FALSE;
+        }
+        p_bytes += sent;
+        numBytes -= sent;
+    }
+
+    return TRUE;
+}
+
+
+static int receiveAll(int fd, void *p_data, size_t numBytes)
+{
+    uint8_t *p_bytes = p_data;
+    ssize_t received;
+
+    while (numBytes > 0)
+    {
+        received = recv(fd, p_bytes, numBytes, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return FALSE;
+        }
+        p_bytes += received;
+        numBytes -= received;
+    }
+
+    return TRUE;
+}
+
+
+static void closeFd(int *p_fd)
+{
+    if (*p_fd >= 0)
+    {
+        close(*p_fd);
+        *p_fd = -1;
+    }
+}
+
+
+static int socketOpen(Domain *p_domain)
+{
+    int iWorker;
+
+    for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+    {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, p_domain->commandFds[iWorker]) != 0
+         || (hasLink(p_domain, iWorker) == TRUE && socketpair(AF_UNIX, SOCK_STREAM, 0, p_domain->haloFds[iWorker]) != 0))
+        {
+            printf("[ERR] Could not create sockets for %d workers\n", p_domain->num_workers);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+/* A worker keeps its end of its command socket and of the links above and
+ * below its slab, so a peer exiting shows up as end of file */
+static void socketEnterWorker(Domain *p_domain, int iWorker)
+{
+    int iAbove = (iWorker + p_domain->num_workers - 1) % p_domain->num_workers;
+    int iOther;
+
+    for (iOther = 0; iOther < p_domain->num_workers; iOther++)
+    {
+        closeFd(&p_domain->commandFds[iOther][0]);
+        if (iOther != iWorker)
+        {
+            closeFd(&p_domain->commandFds[iOther][1]);
+            closeFd(&p_domain->haloFds[iOther][0]);
+        }
+        if (iOther != iAbove)
+        {
+            closeFd(&p_domain->haloFds[iOther][1]);
+        }
+    }
+}
+
+
+static void socketEnterCoordinator(Domain *p_domain)
+{
+    int iWorker;
+
+    for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+    {
+        closeFd(&p_domain->commandFds[iWorker][1]);
+        closeFd(&p_domain->haloFds[iWorker][0]);
+        closeFd(&p_domain->haloFds[iWorker][1]);
+    }
+}
+
+
+static int socketSendCommand(Domain *p_domain, int command)
+{
+    int iWorker;
+    int isSent = TRUE;
+
+    for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+    {
+        isSent = sendAll(p_domain->commandFds[iWorker][0], &command, sizeof(command)) && isSent;
+    }
+
+    return isSent;
+}
+
+
+static int socketReceiveCommand(Domain *p_domain, int iWorker, int *p_command)
+{
+    return receiveAll(p_domain->commandFds[iWorker][1], p_command, sizeof(*p_command));
+}
+
+
+/* Both neighbours send at once, so rows longer than the socket buffers are
+ * sent and received a piece at a time as each side is ready */
+static int socketExchangeHalos
+   (Domain *p_domain, int iWorker,
+    const uint8_t *p_firstRow, const uint8_t *p_lastRow,
+    uint8_t *p_above, uint8_t *p_below)
+{
+    Domain_link links[2];
+    struct pollfd pollFds[2];
+    size_t rowBytes = p_domain->width_cells;
+    int numLinks = 0;
+    int numPending;
+    int iLink;
+    ssize_t numBytes;
+
+    if (p_above != NULL)
+    {
+        links[numLinks].fd = p_domain->haloFds[(iWorker + p_domain->num_workers - 1) % p_domain->num_workers][1];
+        links[numLinks].p_send = p_firstRow;
+        links[numLinks].p_receive = p_above;
+        numLinks++;
+    }
+    if (p_below != NULL)
+    {
+        links[numLinks].fd = p_domain->haloFds[iWorker][0];
+        links[numLinks].p_send = p_lastRow;
+        links[numLinks].p_receive = p_below;
+        numLinks++;
+    }
+    for (iLink = 0; iLink < numLinks; iLink++)
+    {
+        links[iLink].sentBytes = 0;
+        links[iLink].receivedBytes = 0;
+    }
+
+    while (TRUE)
+    {
+        numPending = 0;
+        for (iLink = 0; iLink < numLinks; iLink++)
+        {
+            pollFds[iLink].fd = links[iLink].fd;
+            pollFds[iLink].events = (links[iLink].sentBytes < rowBytes ? POLLOUT : 0)
+                                  | (links[iLink].receivedBytes < rowBytes ? POLLIN : 0);
+            pollFds[iLink].revents = 0;
+            numPending += pollFds[iLink].events != 0;
+        }
+        if (numPending == 0)
+        {
+            return TRUE;
+        }
+        if (poll(pollFds, numLinks, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return FALSE;
+        }
+
+        for (iLink = 0; iLink < numLinks; iLink++)
+        {
+            if ((pollFds[iLink].revents & POLLOUT) != 0)
+            {
+                numBytes = send(links[iLink].fd, links[iLink].p_send + links[iLink].sentBytes,
+                                rowBytes - links[iLink].sentBytes, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (numBytes < 0 && errno != EAGAIN && errno != EINTR)
+                {
+                    return FALSE;
+                }
+                links[iLink].sentBytes += numBytes > 0 ? numBytes : 0;
+            }
+            if ((pollFds[iLink].revents & (POLLIN | POLLHUP | POLLERR)) != 0
+             && links[iLink].receivedBytes < rowBytes)
+            {
+                numBytes = recv(links[iLink].fd, links[iLink].p_receive + links[iLink].receivedBytes,
+                                rowBytes - links[iLink].receivedBytes, MSG_DONTWAIT);
+                if (numBytes == 0 || (numBytes < 0 && errno != EAGAIN && errno != EINTR))
+                {
+                    return FALSE;
+                }
+                links[iLink].receivedBytes += numBytes > 0 ? numBytes : 0;
+            }
+        }
+    }
+}
+
+
+static int socketSendResult(Domain *p_domain, int iWorker, const Domain_result *p_result)
+{
+    return sendAll(p_domain->commandFds[iWorker][1], p_result, sizeof(Domain_result));
+}
+
+
+static int socketReceiveResults(Domain *p_domain, Domain_result *p_results)
+{
+    int iWorker;
+
+    for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+    {
+        if (receiveAll(p_domain->commandFds[iWorker][0], &p_results[iWorker], sizeof(Domain_result)) != TRUE)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+static int socketSendSlab(Domain *p_domain, int iWorker, const Grid *p_slab)
+{
+    int iRow;
+
+    for (iRow = 0; iRow < p_slab->height_cells; iRow++)
+    {
+        if (sendAll(p_domain->commandFds[iWorker][1], p_slab->p_disp + (size_t) iRow * p_slab->stride_cells, p_slab->width_cells) != TRUE)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+static int socketReceiveSlabs(Domain *p_domain, Grid *p_grid)
+{
+    int iWorker, iRow;
+
+    for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+    {
+        for (iRow = Domain_slabStart(p_domain->height_cells, p_domain->num_workers, iWorker);
+             iRow < Domain_slabStart(p_domain->height_cells, p_domain->num_workers, iWorker + 1); iRow++)
+        {
+            if (receiveAll(p_domain->commandFds[iWorker][0], p_grid->p_disp + (size_t) iRow * p_grid->stride_cells, p_grid->width_cells) != TRUE)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+
+static void socketClose(Domain *p_domain)
+{
+    int iWorker;
+
+    for (iWorker = 0; iWorker < DOMAIN_MAX_WORKERS; iWorker++)
+    {
+        closeFd(&p_domain->commandFds[iWorker][0]);
+        closeFd(&p_domain->commandFds[iWorker][1]);
+        closeFd(&p_domain->haloFds[iWorker][0]);
+        closeFd(&p_domain->haloFds[iWorker][1]);
+    }
+}
+
+
+static const Domain_transport socketTransport =
+    { socketOpen, socketEnterWorker, socketEnterCoordinator,
+      socketSendCommand, socketReceiveCommand, socketExchangeHalos,
+      socketSendResult, socketReceiveResults, socketSendSlab, socketReceiveSlabs,
+      socketClose };
+
+
+/* ------ WORKERS ------ */
+
+static void fillResult(Domain_result *p_result, const Grid *p_slab, int rowStart, int isStationary)
+{
+    p_result->isStationary = isStationary;
+    p_result->activeTiles = p_slab->active_tiles;
+    p_result->numTiles = p_slab->tiles_x * p_slab->tiles_y;
+    p_result->stats = p_slab->stats;
+    if (p_result->stats.min_row <= p_result->stats.max_row)
+    {
+        p_result->stats.min_row += rowStart;
+        p_result->stats.max_row += rowStart;
+    }
+}
+
+
+/* Steps one slab until told to quit. The slab starts as a copy of the
+ * coordinator's rows, inherited through fork. Returns FALSE on failure. */
+static int workerMain(Domain *p_domain, int iWorker)
+{
+    const Domain_transport *p_transport = p_domain->p_transport;
+    const Grid *p_full = p_domain->p_grid;
+    int rowStart = Domain_slabStart(p_domain->height_cells, p_domain->num_workers, iWorker);
+    int rowEnd = Domain_slabStart(p_domain->height_cells, p_domain->num_workers, iWorker + 1);
+    int hasAbove = hasLink(p_domain, (iWorker + p_domain->num_workers - 1) % p_domain->num_workers);
+    int hasBelow = hasLink(p_domain, iWorker);
+    Grid slab;
+    size_t haloBytes;
+    uint8_t *p_haloRows;
+    uint8_t *p_lastAbove = NULL;
+    uint8_t *p_lastBelow = NULL;
+    Domain_result result;
+    int command;
+    int isOk;
+    int isStationary;
+    int iRow;
+
+    memset(&result, 0, sizeof(result));
+    slab = Grid_create(p_domain->width_cells, rowEnd - rowStart);
+    haloBytes = (size_t) slab.stride_cells + 2 * GRID_HALO_CELLS;
+    p_haloRows = calloc(2 * haloBytes + 2 * (size_t) p_domain->width_cells, sizeof(uint8_t));
+    if (slab.p_data1 == NULL || slab.p_data2 == NULL || p_haloRows == NULL)
+    {
+        result.isFailed = TRUE;
+    }
+    else
+    {
+        for (iRow = rowStart; iRow < rowEnd; iRow++)
+        {
+            memcpy(slab.p_disp + (size_t) (iRow - rowStart) * slab.stride_cells,
+                   p_full->p_disp + (size_t) iRow * p_full->stride_cells,
+                   p_domain->width_cells);
+        }
+        slab.generation = p_full->generation;
+        Grid_setBoundary(&slab, p_full->boundary);
+        Grid_syncDisp(&slab);
+
+        /* Rows beyond a grid that does not wrap follow its boundary */
+        slab.p_haloAbove = hasAbove == TRUE ? p_haloRows + GRID_HALO_CELLS : NULL;
+        slab.p_haloBelow = hasBelow == TRUE ? p_haloRows + haloBytes + GRID_HALO_CELLS : NULL;
+        /* The rows each halo held last step */
+        p_lastAbove = p_haloRows + 2 * haloBytes;
+        p_lastBelow = p_lastAbove + p_domain->width_cells;
+        fillResult(&result, &slab, rowStart, FALSE);
+    }
+
+    isOk = p_transport->sendResultFn(p_domain, iWorker, &result);
+    while (isOk == TRUE && p_transport->receiveCommandFn(p_domain, iWorker, &command) == TRUE && command != DOMAIN_CMD_QUIT)
+    {
+        /* The coordinator quits straight away when starting failed */
+        if (result.isFailed == TRUE)
+        {
+            continue;
+        }
+        if (command == DOMAIN_CMD_GATHER)
+        {
+            isOk = p_transport->sendSlabFn(p_domain, iWorker, &slab);
+            continue;
+        }
+
+        isOk = p_transport->exchangeHalosFn
+                  (p_domain, iWorker,
+                   slab.p_disp, slab.p_disp + (size_t) (slab.height_cells - 1) * slab.stride_cells,
+                   slab.p_haloAbove, slab.p_haloBelow);
+        if (isOk != TRUE)
+        {
+            break;
+        }
+
+        /* Tiles along an edge only need stepping when the row beyond it changed */
+        if (slab.p_haloAbove != NULL && memcmp(slab.p_haloAbove, p_lastAbove, p_domain->width_cells) != 0)
+        {
+            memcpy(p_lastAbove, slab.p_haloAbove, p_domain->width_cells);
+            Grid_markRowChanged(&slab, 0);
+        }
+        if (slab.p_haloBelow != NULL && memcmp(slab.p_haloBelow, p_lastBelow, p_domain->width_cells) != 0)
+        {
+            memcpy(p_lastBelow, slab.p_haloBelow, p_domain->width_cells);
+            Grid_markRowChanged(&slab, slab.height_cells - 1);
+        }
+
+        isStationary = Grid_hexGridNextWithRule(&slab, &p_domain->rule);
+        fillResult(&result, &slab, rowStart, isStationary);
+        isOk = p_transport->sendResultFn(p_domain, iWorker, &result);
+    }
+
+    Grid_destroy(&slab);
+    free(p_haloRows);
+
+    return isOk == TRUE && result.isFailed == FALSE;
+}
+
+
+/* ------ COORDINATOR ------ */
+
+const char *Domain_transportName(int transport)
+{
+    return transport == DOMAIN_TRANSPORT_SOCKET ? "socket" : "shm";
+}
+
+
+int Domain_parseTransport(const char *p_name, int *p_transport)
+{
+    int transport;
+
+    for (transport = 0; transport < DOMAIN_NUM_TRANSPORTS; transport++)
+    {
+        if (strcmp(p_name, Domain_transportName(transport)) == 0)
+        {
+            *p_transport = transport;
+            return TRUE;
+        }
+    }
+
+    printf("[ERR] Unknown transport %s\n", p_name);
+
+    return FALSE;
+}
+
+
+int Domain_slabStart(int heightCells, int numWorkers, int iWorker)
+{
+    return (int) ((int64_t) heightCells * iWorker / numWorkers);
+}
+
+
+/* Kills and reaps workers that may be stuck waiting for the rest */
+static void killWorkers(Domain *p_domain, int numWorkers)
+{
+    int iWorker;
+
+    for (iWorker = 0; iWorker < numWorkers; iWorker++)
+    {
+        kill(p_domain->pids[iWorker], SIGKILL);
+        waitpid(p_domain->pids[iWorker], NULL, 0);
+    }
+}
+
+
+Domain *Domain_create(Grid *p_grid, const Rule *p_rule, int numWorkers, int transport)
+{
+    Domain *p_domain;
+    int iWorker;
+    int isStarted = TRUE;
+    pid_t pid;
+
+    if (numWorkers <= 0 || numWorkers > DOMAIN_MAX_WORKERS || numWorkers > p_grid->height_cells)
+    {
+        printf("[ERR] Could not split %d rows between %d workers, at most %d with a row each\n",
+               p_grid->height_cells, numWorkers, DOMAIN_MAX_WORKERS);
+        return NULL;
+    }
+
+    p_domain = calloc(1, sizeof(Domain));
+    if (p_domain == NULL)
+    {
+        printf("[ERR] Could not create domain\n");
+        return NULL;
+    }
+    p_domain->transport = transport;
+    p_domain->p_transport = transport == DOMAIN_TRANSPORT_SOCKET ? &socketTransport : &shmTransport;
+    p_domain->num_workers = numWorkers;
+    p_domain->p_grid = p_grid;
+    p_domain->width_cells = p_grid->width_cells;
+    p_domain->height_cells = p_grid->height_cells;
+    p_domain->rule = *p_rule;
+    p_domain->coordinator_pid = getpid();
+    memset(p_domain->commandFds, -1, sizeof(p_domain->commandFds));
+    memset(p_domain->haloFds, -1, sizeof(p_domain->haloFds));
+
+    if (p_domain->p_transport->openFn(p_domain) != TRUE)
+    {
+        p_domain->p_transport->closeFn(p_domain);
+        free(p_domain);
+        return NULL;
+    }
+
+    /* Or anything buffered would be written again by every worker */
+    fflush(stdout);
+    fflush(stderr);
+    for (iWorker = 0; iWorker < numWorkers; iWorker++)
+    {
+        pid = fork();
+        if (pid < 0)
+        {
+            printf("[ERR] Could not start worker %d of %d\n", iWorker, numWorkers);
+            killWorkers(p_domain, iWorker);
+            p_domain->p_transport->closeFn(p_domain);
+            free(p_domain);
+            return NULL;
+        }
+        if (pid == 0)
+        {
+            /* Workers outliving the coordinator would step for nobody */
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (getppid() != p_domain->coordinator_pid)
+            {
+                _exit(1);
+            }
+            p_domain->p_transport->enterWorkerFn(p_domain, iWorker);
+            _exit(workerMain(p_domain, iWorker) == TRUE ? 0 : 1);
+        }
+        p_domain->pids[iWorker] = pid;
+    }
+    p_domain->p_transport->enterCoordinatorFn(p_domain);
+
+    /* Every worker reports once its slab is set up */
+    if (p_domain->p_transport->receiveResultsFn(p_domain, p_domain->results) != TRUE)
+    {
+        isStarted = FALSE;
+    }
+    for (iWorker = 0; iWorker < numWorkers && isStarted == TRUE; iWorker++)
+    {
+        isStarted = p_domain->results[iWorker].isFailed == FALSE;
+    }
+    if (isStarted == FALSE)
+    {
+        printf("[ERR] Could not start %d workers, out of memory\n", numWorkers);
+        Domain_destroy(p_domain);
+        return NULL;
+    }
+
+    return p_domain;
+}
+
+
+int Domain_step(Domain *p_domain, int *p_isStationary)
+{
+    const Domain_transport *p_transport = p_domain->p_transport;
+    Grid *p_grid = p_domain->p_grid;
+    const Domain_result *p_result;
+    Grid_stats *p_stats = &p_grid->stats;
+    int isStationary = TRUE;
+    int activeTiles = 0;
+    int numTiles = 0;
+    int iWorker, iState;
+
+    if (p_transport->sendCommandFn(p_domain, DOMAIN_CMD_STEP) != TRUE
+     || p_transport->receiveResultsFn(p_domain, p_domain->results) != TRUE)
+    {
+        printf("[ERR] Lost a worker stepping generation %llu\n", (unsigned long long) p_grid->generation + 1);
+        return FALSE;
+    }
+
+    memset(p_stats, 0, sizeof(Grid_stats));
+    p_stats->min_row = INT_MAX;
+    p_stats->max_row = -1;
+    p_stats->min_col = INT_MAX;
+    p_stats->max_col = -1;
+    for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+    {
+        p_result = &p_domain->results[iWorker];
+        isStationary = isStationary && p_result->isStationary;
+        activeTiles += p_result->activeTiles;
+        numTiles += p_result->numTiles;
+
+        for (iState = 0; iState < RULE_NUM_STATES; iState++)
+        {
+            p_stats->counts[iState] += p_result->stats.counts[iState];
+        }
+        p_stats->births += p_result->stats.births;
+        p_stats->deaths += p_result->stats.deaths;
+        p_stats->infections += p_result->stats.infections;
+        if (p_result->stats.min_row <= p_result->stats.max_row)
+        {
+            p_stats->min_row = p_result->stats.min_row < p_stats->min_row ? p_result->stats.min_row : p_stats->min_row;
+            p_stats->max_row = p_result->stats.max_row > p_stats->max_row ? p_result->stats.max_row : p_stats->max_row;
+            p_stats->min_col = p_result->stats.min_col < p_stats->min_col ? p_result->stats.min_col : p_stats->min_col;
+            p_stats->max_col = p_result->stats.max_col > p_stats->max_col ? p_result->stats.max_col : p_stats->max_col;
+        }
+    }
+
+    p_grid->active_tiles = activeTiles;
+    p_grid->skipped_tiles = numTiles - activeTiles;
+    p_grid->generation++;
+    *p_isStationary = isStationary;
+
+    return TRUE;
+}
+
+
+int Domain_gather(Domain *p_domain)
+{
+    const Domain_transport *p_transport = p_domain->p_transport;
+
+    if (p_transport->sendCommandFn(p_domain, DOMAIN_CMD_GATHER) != TRUE
+     || p_transport->receiveSlabsFn(p_domain, p_domain->p_grid) != TRUE)
+    {
+        printf("[ERR] Lost a worker gathering the grid\n");
+        return FALSE;
+    }
+
+    /* The coordinator's grid never steps itself, so only needs its hash */
+    p_domain->p_grid->hash = Grid_computeHash(p_domain->p_grid);
+    Grid_markAllTilesChanged(p_domain->p_grid);
+
+    return TRUE;
+}
+
+
+int Domain_destroy(Domain *p_domain)
+{
+    int iWorker;
+    int status;
+    int isClean = TRUE;
+
+    /* Workers that cannot be told to quit may be stuck waiting for a lost one */
+    if (p_domain->p_transport->sendCommandFn(p_domain, DOMAIN_CMD_QUIT) != TRUE)
+    {
+        isClean = FALSE;
+        for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+        {
+            kill(p_domain->pids[iWorker], SIGKILL);
+        }
+    }
+    for (iWorker = 0; iWorker < p_domain->num_workers; iWorker++)
+    {
+        if (waitpid(p_domain->pids[iWorker], &status, 0) != p_domain->pids[iWorker]
+         || WIFEXITED(status) == 0 || WEXITSTATUS(status) != 0)
+        {
+            isClean = FALSE;
+        }
+    }
+    p_domain->p_transport->closeFn(p_domain);
+    free(p_domain);
+
+    return isClean;
+}
@@ -0,0 +1,125 @@
+#ifndef H_HEXLIFE_DOMAIN_H
+#define H_HEXLIFE_DOMAIN_H
+
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "grid.h"
+#include "rule.h"
+#include "bool.h"
+
+
+#define DOMAIN_MAX_WORKERS  (64)
+
+/* How the workers swap halo rows and talk to the coordinator */
+#define DOMAIN_TRANSPORT_SHM     (0)  /* one shared mapping and futex barriers */
+#define DOMAIN_TRANSPORT_SOCKET  (1)  /* Unix socket pairs, the model for other machines */
+#define DOMAIN_NUM_TRANSPORTS    (2)
+
+#define DOMAIN_CMD_STEP    (0)
+#define DOMAIN_CMD_GATHER  (1)
+#define DOMAIN_CMD_QUIT    (2)
+
+
+/* What a worker reports after starting and after each step */
+typedef struct Domain_result_struct {
+    int isFailed;
+    int isStationary;
+    int activeTiles;
+    int numTiles;
+    /* Of the slab, with the box in rows of the whole grid */
+    Grid_stats stats;
+} Domain_result;
+
+
+typedef struct Domain_struct Domain;
+
+/* One way of moving rows and results between processes. The coordinator
+ * calls sendCommand, receiveResults and receiveSlabs, each worker the
+ * matching receiveCommand, sendResult and sendSlab, and exchangeHalos among
+ * themselves. Every call returns FALSE when the other side is gone. */
+typedef struct Domain_transport_struct {
+    /* Before the workers are forked, and in each process once they are */
+    int (*openFn)(Domain *p_domain);
+    void (*enterWorkerFn)(Domain *p_domain, int iWorker);
+    void (*enterCoordinatorFn)(Domain *p_domain);
+
+    int (*sendCommandFn)(Domain *p_domain, int command);
+    int (*receiveCommandFn)(Domain *p_domain, int iWorker, int *p_command);
+
+    /* Sends the slab's first and last rows to the workers above and below
+     * and receives their last and first rows in p_above and p_below. A NULL
+     * row is not exchanged, as at the top and bottom of a grid that does not
+     * wrap. */
+    int (*exchangeHalosFn)
+       (Domain *p_domain, int iWorker,
+        const uint8_t *p_firstRow, const uint8_t *p_lastRow,
+        uint8_t *p_above, uint8_t *p_below);
+
+    int (*sendResultFn)(Domain *p_domain, int iWorker, const Domain_result *p_result);
+    int (*receiveResultsFn)(Domain *p_domain, Domain_result *p_results);
+
+    /* Every row of the worker's slab, into p_grid->p_disp */
+    int (*sendSlabFn)(Domain *p_domain, int iWorker, const Grid *p_slab);
+    int (*receiveSlabsFn)(Domain *p_domain, Grid *p_grid);
+
+    void (*closeFn)(Domain *p_domain);
+} Domain_transport;
+
+
+/* Steps a grid split into slabs of whole rows, each owned by a worker
+ * process running the byte kernel. After every generation the workers swap
+ * one row halos and the coordinator adds up what they report. */
+struct Domain_struct {
+    const Domain_transport *p_transport;
+    int transport;
+    int num_workers;
+    pid_t pids[DOMAIN_MAX_WORKERS];
+    pid_t coordinator_pid;
+
+    /* The coordinator's grid. Its stats and generation follow every step,
+     * its cells only Domain_gather. */
+    Grid *p_grid;
+    int width_cells;
+    int height_cells;
+    Rule rule;
+
+    Domain_result results[DOMAIN_MAX_WORKERS];
+
+    /* Shared memory transport */
+    void *p_shared;
+    size_t shared_bytes;
+
+    /* Socket transport. Worker i talks to the coordinator over
+     * commandFds[i], and link i joins the bottom of slab i, end 0, to the top
+     * of the slab below it, end 1. */
+    int commandFds[DOMAIN_MAX_WORKERS][2];
+    int haloFds[DOMAIN_MAX_WORKERS][2];
+};
+
+
+extern const char *Domain_transportName(int transport);
+
+/* Accepts the names Domain_transportName gives */
+extern int Domain_parseTransport(const char *p_name, int *p_transport);
+
+/* First row of worker iWorker's slab, or the height for iWorker == numWorkers */
+extern int Domain_slabStart(int heightCells, int numWorkers, int iWorker);
+
+/* Forks the workers, each taking its slab of p_grid with the grid's
+ * boundary. Returns NULL on failure, after printing why. */
+extern Domain *Domain_create(Grid *p_grid, const Rule *p_rule, int numWorkers, int transport);
+
+/* One generation on every slab, setting *p_isStationary when none of them
+ * changed. Returns FALSE when a worker is lost. */
+extern int Domain_step(Domain *p_domain, int *p_isStationary);
+
+/* Copies every slab back into the coordinator's grid */
+extern int Domain_gather(Domain *p_domain);
+
+/* Stops and reaps the workers. Returns FALSE if any of them failed. */
+extern int Domain_destroy(Domain *p_domain);
+
+
+#endif /* H_HEXLIFE_DOMAIN_H */
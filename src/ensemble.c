@@ -0,0 +1,444 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ensemble.h"
+#include "profile.h"
+
+
+#define ENSEMBLE_WORD_BITS  (64)
+
+
+typedef struct Ensemble_job_struct {
+    Ensemble *p_ensemble;
+    const uint64_t *p_survive;
+    const uint64_t *p_create;
+} Ensemble_job;
+
+
+static size_t wordIndex(Ensemble *p_ensemble, int member, int cell)
+{
+    int block = member / ENSEMBLE_BLOCK_MEMBERS;
+    int word = (member % ENSEMBLE_BLOCK_MEMBERS) / ENSEMBLE_WORD_BITS;
+
+    return ((size_t) block * p_ensemble->num_cells + cell) * ENSEMBLE_BLOCK_WORDS + word;
+}
+
+
+Ensemble Ensemble_create(int width_cells, int height_cells, int numMembers)
+{
+    Ensemble ensemble;
+    int numWords;
+    int member;
+
+    memset(&ensemble, 0, sizeof(Ensemble));
+    if (width_cells <= 0 || height_cells <= 0 || numMembers <= 0)
+    {
+        printf("[ERR] Could not create an ensemble of %d %dx%d grids\n", numMembers, width_cells, height_cells);
+        return ensemble;
+    }
+
+    ensemble.width_cells = width_cells;
+    ensemble.height_cells = height_cells;
+    ensemble.num_cells = width_cells * height_cells;
+    ensemble.num_members = numMembers;
+    ensemble.num_blocks = (numMembers + ENSEMBLE_BLOCK_MEMBERS - 1) / ENSEMBLE_BLOCK_MEMBERS;
+    ensemble.plane_words = (size_t) ensemble.num_blocks * ensemble.num_cells * ENSEMBLE_BLOCK_WORDS;
+    numWords = ensemble.num_blocks * ENSEMBLE_BLOCK_WORDS;
+
+    ensemble.p_data1 = calloc(2 * ensemble.plane_words, sizeof(uint64_t));
+    ensemble.p_data2 = calloc(2 * ensemble.plane_words, sizeof(uint64_t));
+    ensemble.p_retired = calloc(numWords, sizeof(uint64_t));
+    ensemble.p_changed = calloc(numWords, sizeof(uint64_t));
+    ensemble.p_changedTwo = calloc(numWords, sizeof(uint64_t));
+    ensemble.p_outcomes = calloc(numMembers, sizeof(uint8_t));
+    ensemble.p_settledGenerations = calloc(numMembers, sizeof(uint64_t));
+    if (ensemble.p_data1 == NULL || ensemble.p_data2 == NULL || ensemble.p_retired == NULL
+     || ensemble.p_changed == NULL || ensemble.p_changedTwo == NULL
+     || ensemble.p_outcomes == NULL || ensemble.p_settledGenerations == NULL)
+    {
+        printf("[ERR] Could not create an ensemble of %d %dx%d grids\n", numMembers, width_cells, height_cells);
+        Ensemble_destroy(&ensemble);
+        return ensemble;
+    }
+
+    /* Lanes past the last member are dead and never run */
+    for (member = numMembers; member < numWords * ENSEMBLE_WORD_BITS; member++)
+    {
+        ensemble.p_retired[member / ENSEMBLE_WORD_BITS] |= 1ULL << (member % ENSEMBLE_WORD_BITS);
+    }
+    ensemble.num_active = numMembers;
+
+    ensemble.p_disp = ensemble.p_data1;
+    ensemble.p_next = ensemble.p_data2;
+
+    return ensemble;
+}
+
+
+void Ensemble_setMember(Ensemble *p_ensemble, int member, Grid *p_grid)
+{
+    uint64_t bit = 1ULL << (member % ENSEMBLE_WORD_BITS);
+    uint64_t *p_retired = &p_ensemble->p_retired[member / ENSEMBLE_WORD_BITS];
+    size_t iWord;
+    int iRow, iCol;
+    uint8_t value;
+
+    for (iRow = 0; iRow < p_ensemble->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_ensemble->width_cells; iCol++)
+        {
+            value = Grid_getDispValue(p_grid, iRow, iCol);
+            iWord = wordIndex(p_ensemble, member, iRow * p_ensemble->width_cells + iCol);
+
+            /* Both buffers, so the first step cannot look like period two */
+            p_ensemble->p_data1[iWord] = (p_ensemble->p_data1[iWord] & ~bit) | ((value & 1) ? bit : 0);
+            p_ensemble->p_data2[iWord] = (p_ensemble->p_data2[iWord] & ~bit) | ((value & 1) ? bit : 0);
+            iWord += p_ensemble->plane_words;
+            p_ensemble->p_data1[iWord] = (p_ensemble->p_data1[iWord] & ~bit) | ((value >> 1) ? bit : 0);
+            p_ensemble->p_data2[iWord] = (p_ensemble->p_data2[iWord] & ~bit) | ((value >> 1) ? bit : 0);
+        }
+    }
+
+    if ((*p_retired & bit) != 0)
+    {
+        *p_retired &= ~bit;
+        p_ensemble->num_active++;
+    }
+    p_ensemble->p_outcomes[member] = ENSEMBLE_RUNNING;
+    p_ensemble->p_settledGenerations[member] = 0;
+    p_ensemble->generation = 0;
+}
+
+
+uint8_t Ensemble_getDispValue(Ensemble *p_ensemble, int member, int row, int col)
+{
+    size_t iWord = wordIndex(p_ensemble, member, row * p_ensemble->width_cells + col);
+    int shift = member % ENSEMBLE_WORD_BITS;
+
+    return (uint8_t) (((p_ensemble->p_disp[iWord] >> shift) & 1)
+                    | (((p_ensemble->p_disp[iWord + p_ensemble->plane_words] >> shift) & 1) << 1));
+}
+
+
+void Ensemble_getMember(Ensemble *p_ensemble, int member, Grid *p_grid)
+{
+    int iRow, iCol;
+
+    for (iRow = 0; iRow < p_ensemble->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_ensemble->width_cells; iCol++)
+        {
+            Grid_setDispValue(p_grid, iRow, iCol, Ensemble_getDispValue(p_ensemble, member, iRow, iCol));
+        }
+    }
+}
+
+
+int Ensemble_countState(Ensemble *p_ensemble, int member, uint8_t state)
+{
+    int count = 0;
+    int iRow, iCol;
+
+    for (iRow = 0; iRow < p_ensemble->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_ensemble->width_cells; iCol++)
+        {
+            count += Ensemble_getDispValue(p_ensemble, member, iRow, iCol) == state;
+        }
+    }
+
+    return count;
+}
+
+
+/* Picks p_table[count] for every bit, where count is given bit-sliced */
+static inline uint64_t selectByCount(uint64_t bit0, uint64_t bit1, uint64_t bit2, const uint64_t *p_table)
+{
+    uint64_t sel01 = (bit0 & p_table[1]) | (~bit0 & p_table[0]);
+    uint64_t sel23 = (bit0 & p_table[3]) | (~bit0 & p_table[2]);
+    uint64_t sel45 = (bit0 & p_table[5]) | (~bit0 & p_table[4]);
+    uint64_t sel67 = (bit0 & p_table[7]) | (~bit0 & p_table[6]);
+    uint64_t sel03 = (bit1 & sel23) | (~bit1 & sel01);
+    uint64_t sel47 = (bit1 & sel67) | (~bit1 & sel45);
+
+    return (bit2 & sel47) | (~bit2 & sel03);
+}
+
+
+/* Steps every member of one block. Neighbours are found once per cell and
+ * the same arithmetic as the bit-packed kernel runs across the block's
+ * words, which the compiler turns into vector operations. Retired members
+ * keep the state they settled in, and words past the last member, which
+ * stay dead in both buffers, are not stepped at all. */
+static void stepBlock(Ensemble *p_ensemble, int iBlock, const uint64_t *p_survive, const uint64_t *p_create)
+{
+    int width = p_ensemble->width_cells;
+    int height = p_ensemble->height_cells;
+    size_t planeWords = p_ensemble->plane_words;
+    const uint64_t *p_lo = p_ensemble->p_disp + (size_t) iBlock * p_ensemble->num_cells * ENSEMBLE_BLOCK_WORDS;
+    const uint64_t *p_hi = p_lo + planeWords;
+    uint64_t *p_nextLo = p_ensemble->p_next + (size_t) iBlock * p_ensemble->num_cells * ENSEMBLE_BLOCK_WORDS;
+    uint64_t *p_nextHi = p_nextLo + planeWords;
+
+    const uint64_t *p_n[GRID_HEX_NUM_NEIGHBOURS];
+    const uint64_t *p_retired = p_ensemble->p_retired + iBlock * ENSEMBLE_BLOCK_WORDS;
+    uint64_t changed[ENSEMBLE_BLOCK_WORDS] = { 0 };
+    uint64_t changedTwo[ENSEMBLE_BLOCK_WORDS] = { 0 };
+    int numWords = (p_ensemble->num_members - iBlock * ENSEMBLE_BLOCK_MEMBERS + ENSEMBLE_WORD_BITS - 1) / ENSEMBLE_WORD_BITS;
+    int iRow, iCol, iWord, iNeigh;
+    int prevCol, nextCol;
+    size_t row, prevRow, nextRow, diagRow;
+    size_t cell;
+
+    uint64_t occ[GRID_HEX_NUM_NEIGHBOURS];
+    uint64_t sum0, carry0, sum1, carry1, carry2;
+    uint64_t bit0, bit1, bit2;
+    uint64_t anySick;
+    uint64_t survive, create;
+    uint64_t lo, hi, live, born, fixed;
+    uint64_t nextLo, nextHi;
+
+    if (numWords > ENSEMBLE_BLOCK_WORDS)
+    {
+        numWords = ENSEMBLE_BLOCK_WORDS;
+    }
+
+    /* Wrapped rows are found once per row and wrapped columns once per
+     * column, keeping the division out of the loop over cells */
+    for (iRow = 0; iRow < height; iRow++)
+    {
+        row = (size_t) iRow * width;
+        prevRow = (size_t) (iRow == 0 ? height - 1 : iRow - 1) * width;
+        nextRow = (size_t) (iRow == height - 1 ? 0 : iRow + 1) * width;
+
+        for (iCol = 0; iCol < width; iCol++)
+        {
+            prevCol = (iCol == 0) ? width - 1 : iCol - 1;
+            nextCol = (iCol == width - 1) ? 0 : iCol + 1;
+
+            /* Even columns reach down to their diagonal neighbours, odd ones up */
+            diagRow = ((iCol & 1) == 0) ? nextRow : prevRow;
+            p_n[0] = p_lo + (row + prevCol) * ENSEMBLE_BLOCK_WORDS;
+            p_n[1] = p_lo + (row + nextCol) * ENSEMBLE_BLOCK_WORDS;
+            p_n[2] = p_lo + (prevRow + iCol) * ENSEMBLE_BLOCK_WORDS;
+            p_n[3] = p_lo + (nextRow + iCol) * ENSEMBLE_BLOCK_WORDS;
+            p_n[4] = p_lo + (diagRow + prevCol) * ENSEMBLE_BLOCK_WORDS;
+            p_n[5] = p_lo + (diagRow + nextCol) * ENSEMBLE_BLOCK_WORDS;
+            cell = (row + iCol) * ENSEMBLE_BLOCK_WORDS;
+
+            for (iWord = 0; iWord < numWords; iWord++)
+            {
+                anySick = 0;
+                for (iNeigh = 0; iNeigh < GRID_HEX_NUM_NEIGHBOURS; iNeigh++)
+                {
+                    occ[iNeigh] = p_n[iNeigh][iWord] | p_n[iNeigh][iWord + planeWords];
+                    anySick |= p_n[iNeigh][iWord + planeWords] & ~p_n[iNeigh][iWord];
+                }
+
+                /* Bit-sliced adder, two full adders then one on the carries */
+                sum0 = occ[0] ^ occ[1] ^ occ[2];
+                carry0 = (occ[0] & occ[1]) | (occ[2] & (occ[0] ^ occ[1]));
+                sum1 = occ[3] ^ occ[4] ^ occ[5];
+                carry1 = (occ[3] & occ[4]) | (occ[5] & (occ[3] ^ occ[4]));
+                bit0 = sum0 ^ sum1;
+                carry2 = sum0 & sum1;
+                bit1 = carry0 ^ carry1 ^ carry2;
+                bit2 = (carry0 & carry1) | (carry2 & (carry0 ^ carry1));
+
+                survive = selectByCount(bit0, bit1, bit2, p_survive);
+                create = selectByCount(bit0, bit1, bit2, p_create);
+
+                lo = p_lo[cell + iWord];
+                hi = p_hi[cell + iWord];
+                live = lo ^ hi;
+                fixed = lo & hi;
+                born = ~(lo | hi) & create;
+
+                nextLo = fixed | (lo & live & survive) | (born & ~anySick);
+                nextHi = fixed | (hi & live & survive) | (born & anySick);
+                nextLo = (nextLo & ~p_retired[iWord]) | (lo & p_retired[iWord]);
+                nextHi = (nextHi & ~p_retired[iWord]) | (hi & p_retired[iWord]);
+
+                /* p_next still holds the generation before this one */
+                changed[iWord] |= (nextLo ^ lo) | (nextHi ^ hi);
+                changedTwo[iWord] |= (nextLo ^ p_nextLo[cell + iWord]) | (nextHi ^ p_nextHi[cell + iWord]);
+
+                p_nextLo[cell + iWord] = nextLo;
+                p_nextHi[cell + iWord] = nextHi;
+            }
+        }
+    }
+
+    memcpy(p_ensemble->p_changed + iBlock * ENSEMBLE_BLOCK_WORDS, changed, sizeof(changed));
+    memcpy(p_ensemble->p_changedTwo + iBlock * ENSEMBLE_BLOCK_WORDS, changedTwo, sizeof(changedTwo));
+}
+
+
+static int isBlockRetired(Ensemble *p_ensemble, int iBlock)
+{
+    int iWord;
+
+    for (iWord = 0; iWord < ENSEMBLE_BLOCK_WORDS; iWord++)
+    {
+        if (p_ensemble->p_retired[iBlock * ENSEMBLE_BLOCK_WORDS + iWord] != ~0ULL)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+static void stepBlockTask(void *p_ctx, int iBlock)
+{
+    Ensemble_job *p_job = p_ctx;
+
+    if (isBlockRetired(p_job->p_ensemble, iBlock) == FALSE)
+    {
+        stepBlock(p_job->p_ensemble, iBlock, p_job->p_survive, p_job->p_create);
+    }
+}
+
+
+static void retire(Ensemble *p_ensemble, int iWord, uint64_t members, int outcome, uint64_t settledGeneration)
+{
+    int member;
+
+    p_ensemble->p_retired[iWord] |= members;
+    while (members != 0)
+    {
+        member = iWord * ENSEMBLE_WORD_BITS + __builtin_ctzll(members);
+        p_ensemble->p_outcomes[member] = (uint8_t) outcome;
+        p_ensemble->p_settledGenerations[member] = settledGeneration;
+        p_ensemble->num_active--;
+        members &= members - 1;
+    }
+}
+
+
+/* Retires what settled in the last step and swaps the buffers */
+static int finishStep(Ensemble *p_ensemble)
+{
+    uint64_t *p_swap;
+    uint64_t active;
+    size_t blockWords = (size_t) p_ensemble->num_cells * ENSEMBLE_BLOCK_WORDS;
+    size_t offset;
+    int iBlock, iWord, i;
+
+    for (iBlock = 0; iBlock < p_ensemble->num_blocks; iBlock++)
+    {
+        if (isBlockRetired(p_ensemble, iBlock) == TRUE)
+        {
+            continue;
+        }
+        for (i = 0; i < ENSEMBLE_BLOCK_WORDS; i++)
+        {
+            iWord = iBlock * ENSEMBLE_BLOCK_WORDS + i;
+            active = ~p_ensemble->p_retired[iWord];
+
+            /* Nothing changed, the state at this generation is final */
+            retire(p_ensemble, iWord, active & ~p_ensemble->p_changed[iWord],
+                   ENSEMBLE_STATIONARY, p_ensemble->generation);
+            /* Back where it was a generation ago */
+            retire(p_ensemble, iWord, active & p_ensemble->p_changed[iWord] & ~p_ensemble->p_changedTwo[iWord],
+                   ENSEMBLE_PERIOD_TWO, p_ensemble->generation - 1);
+        }
+
+        /* Blocks are not stepped once all their members are retired, so
+         * both buffers are left holding the new generation */
+        if (isBlockRetired(p_ensemble, iBlock) == TRUE)
+        {
+            offset = (size_t) iBlock * blockWords;
+            memcpy(p_ensemble->p_disp + offset, p_ensemble->p_next + offset, blockWords * sizeof(uint64_t));
+            offset += p_ensemble->plane_words;
+            memcpy(p_ensemble->p_disp + offset, p_ensemble->p_next + offset, blockWords * sizeof(uint64_t));
+        }
+    }
+
+    p_ensemble->generation++;
+    p_swap = p_ensemble->p_disp;
+    p_ensemble->p_disp = p_ensemble->p_next;
+    p_ensemble->p_next = p_swap;
+
+    return p_ensemble->num_active;
+}
+
+
+static void buildTables(const Rule *p_rule, uint64_t *p_survive, uint64_t *p_create)
+{
+    int iCount;
+
+    /* All ones where the rule holds for that many alive neighbours */
+    for (iCount = 0; iCount < 8; iCount++)
+    {
+        p_survive[iCount] = (p_rule->surviveMask & (1 << iCount)) ? ~0ULL : 0;
+        p_create[iCount] = (p_rule->createMask & (1 << iCount)) ? ~0ULL : 0;
+    }
+}
+
+
+int Ensemble_hexGridNextWithRule(Ensemble *p_ensemble, const Rule *p_rule)
+{
+    uint64_t surviveTable[8];
+    uint64_t createTable[8];
+    uint64_t profile_ns = Profile_begin();
+    int iBlock;
+    int numActive;
+
+    buildTables(p_rule, surviveTable, createTable);
+    for (iBlock = 0; iBlock < p_ensemble->num_blocks; iBlock++)
+    {
+        if (isBlockRetired(p_ensemble, iBlock) == FALSE)
+        {
+            stepBlock(p_ensemble, iBlock, surviveTable, createTable);
+        }
+    }
+    numActive = finishStep(p_ensemble);
+    Profile_end(PROFILE_ZONE_STEP, profile_ns);
+
+    return numActive;
+}
+
+
+int Ensemble_hexGridNextWithRuleParallel(Ensemble *p_ensemble, Pool *p_pool, const Rule *p_rule)
+{
+    uint64_t surviveTable[8];
+    uint64_t createTable[8];
+    uint64_t profile_ns = Profile_begin();
+    Ensemble_job job;
+    int numActive;
+
+    buildTables(p_rule, surviveTable, createTable);
+    job.p_ensemble = p_ensemble;
+    job.p_survive = surviveTable;
+    job.p_create = createTable;
+    Pool_run(p_pool, stepBlockTask, &job, p_ensemble->num_blocks);
+    numActive = finishStep(p_ensemble);
+    Profile_end(PROFILE_ZONE_STEP, profile_ns);
+
+    return numActive;
+}
+
+
+void Ensemble_destroy(Ensemble *p_ensemble)
+{
+    free(p_ensemble->p_data1);
+    free(p_ensemble->p_data2);
+    free(p_ensemble->p_retired);
+    free(p_ensemble->p_changed);
+    free(p_ensemble->p_changedTwo);
+    free(p_ensemble->p_outcomes);
+    free(p_ensemble->p_settledGenerations);
+
+    p_ensemble->p_data1 = NULL;
+    p_ensemble->p_data2 = NULL;
+    p_ensemble->p_disp = NULL;
+    p_ensemble->p_next = NULL;
+    p_ensemble->p_retired = NULL;
+    p_ensemble->p_changed = NULL;
+    p_ensemble->p_changedTwo = NULL;
+    p_ensemble->p_outcomes = NULL;
+    p_ensemble->p_settledGenerations = NULL;
+}
@@ -0,0 +1,82 @@
+#ifndef H_HEXLIFE_ENSEMBLE_H
+#define H_HEXLIFE_ENSEMBLE_H
+
+
+#include <stdint.h>
+
+#include "grid.h"
+#include "pool.h"
+#include "bool.h"
+
+
+/* Members are stepped in blocks of this many 64 bit words, 256 members */
+#define ENSEMBLE_BLOCK_WORDS    (4)
+#define ENSEMBLE_BLOCK_MEMBERS  (ENSEMBLE_BLOCK_WORDS * 64)
+
+/* Why a member was retired */
+#define ENSEMBLE_RUNNING     (0)
+#define ENSEMBLE_STATIONARY  (1)
+#define ENSEMBLE_PERIOD_TWO  (2)
+
+
+/* Many grids of the same size stepped in lockstep. Each cell is stored
+ * bit-sliced across members, bit m of a word belonging to member m, so one
+ * word operation steps the same cell of 64 members. As in BitGrid the state
+ * is split into lo and hi planes. Word w of cell i in block b of a plane is at
+ * (b * num_cells + i) * ENSEMBLE_BLOCK_WORDS + w. */
+typedef struct Ensemble_struct {
+    /* Lo plane followed by hi plane */
+    uint64_t *p_data1;
+    uint64_t *p_data2;
+
+    uint64_t *p_disp;
+    uint64_t *p_next;
+
+    int width_cells;
+    int height_cells;
+    int num_cells;
+    int num_members;
+    int num_blocks;
+    size_t plane_words;
+
+    uint64_t generation;
+
+    /* A member is retired once it is stationary or flips between two states,
+     * and keeps the state it was in then. Blocks whose members are all
+     * retired are no longer stepped. */
+    uint64_t *p_retired;
+    uint8_t *p_outcomes;
+    uint64_t *p_settledGenerations;
+    int num_active;
+
+    /* Cells that changed in each block's members during the last step, and
+     * those that differ from two generations back */
+    uint64_t *p_changed;
+    uint64_t *p_changedTwo;
+} Ensemble;
+
+
+/* Every member starts dead. Pointers are left NULL on failure. */
+extern Ensemble Ensemble_create(int width_cells, int height_cells, int numMembers);
+
+/* Copies a grid of the ensemble's size into a member and puts it back in the
+ * running, restarting the ensemble's generation count */
+extern void Ensemble_setMember(Ensemble *p_ensemble, int member, Grid *p_grid);
+
+extern void Ensemble_getMember(Ensemble *p_ensemble, int member, Grid *p_grid);
+
+extern uint8_t Ensemble_getDispValue(Ensemble *p_ensemble, int member, int row, int col);
+
+extern int Ensemble_countState(Ensemble *p_ensemble, int member, uint8_t state);
+
+/* Steps every block with an active member one generation and retires the
+ * members that settled. Returns how many are still active. */
+extern int Ensemble_hexGridNextWithRule(Ensemble *p_ensemble, const Rule *p_rule);
+
+/* Same, with the blocks shared out over the pool */
+extern int Ensemble_hexGridNextWithRuleParallel(Ensemble *p_ensemble, Pool *p_pool, const Rule *p_rule);
+
+extern void Ensemble_destroy(Ensemble *p_ensemble);
+
+
+#endif /* H_HEXLIFE_ENSEMBLE_H */
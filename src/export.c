@@ -0,0 +1,809 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "export.h"
+#include "profile.h"
+#include "timer.h"
+
+
+#define EXPORT_NUM_COLOURS  (4)
+
+/* GIF LZW codes are at most 12 bits */
+#define EXPORT_LZW_MAX_CODES  (4096)
+#define EXPORT_GIF_BLOCK_BYTES  (255)
+
+/* Deflate matches are 3 to 258 bytes long */
+#define EXPORT_DEFLATE_MIN_MATCH  (3)
+#define EXPORT_DEFLATE_MAX_MATCH  (258)
+
+
+/* The viewer's layer colours, in cell state order */
+static const uint8_t palette[EXPORT_NUM_COLOURS][3] =
+    { { 0x0D, 0x0D, 0x0D },
+      { 0xF7, 0xF7, 0xF7 },
+      { 0xD8, 0x6A, 0x4A },
+      { 0x5A, 0x8C, 0xD8 } };
+
+static uint32_t crcTable[256];
+
+
+/* Bits packed least significant first, as both GIF and deflate want them.
+ * GIF output goes out in sub-blocks through p_file, deflate output into
+ * p_buffer. */
+typedef struct Export_bits_struct {
+    FILE *p_file;
+    uint8_t block[EXPORT_GIF_BLOCK_BYTES];
+    int blockBytes;
+
+    uint8_t *p_buffer;
+    size_t numBytes;
+
+    uint32_t bits;
+    int numBits;
+    int failed;
+} Export_bits;
+
+
+static void putU16(uint8_t *p_bytes, uint16_t value)
+{
+    p_bytes[0] = (uint8_t) value;
+    p_bytes[1] = (uint8_t) (value >> 8);
+}
+
+
+static void putU32BigEndian(uint8_t *p_bytes, uint32_t value)
+{
+    p_bytes[0] = (uint8_t) (value >> 24);
+    p_bytes[1] = (uint8_t) (value >> 16);
+    p_bytes[2] = (uint8_t) (value >> 8);
+    p_bytes[3] = (uint8_t) value;
+}
+
+
+static int formatFor(const char *p_path)
+{
+    size_t length = strlen(p_path);
+
+    if (p_path[0] == '|')
+    {
+        return EXPORT_FORMAT_RAW;
+    }
+    if (length >= 4 && strcmp(p_path + length - 4, ".gif") == 0)
+    {
+        return EXPORT_FORMAT_GIF;
+    }
+    if (length >= 4 && strcmp(p_path + length - 4, ".png") == 0)
+    {
+        return EXPORT_FORMAT_PNG;
+    }
+
+    return EXPORT_FORMAT_RAW;
+}
+
+
+/* The path is used as a format, so it may only hold one %d, with an
+ * optional zero padded width, and no other conversion */
+static int isFramePattern(const char *p_path)
+{
+    const char *p_percent = strchr(p_path, '%');
+    const char *p_char;
+
+    if (p_percent == NULL)
+    {
+        return FALSE;
+    }
+    for (p_char = p_percent + 1; *p_char >= '0' && *p_char <= '9'; p_char++)
+    {
+    }
+
+    return *p_char == 'd' && strchr(p_char, '%') == NULL;
+}
+
+
+static void initCrcTable(void)
+{
+    uint32_t crc;
+    int iByte, iBit;
+
+    for (iByte = 0; iByte < 256; iByte++)
+    {
+        crc = (uint32_t) iByte;
+        for (iBit = 0; iBit < 8; iBit++)
+        {
+            crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+        crcTable[iByte] = crc;
+    }
+}
+
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *p_bytes, size_t numBytes)
+{
+    size_t iByte;
+
+    for (iByte = 0; iByte < numBytes; iByte++)
+    {
+        crc = crcTable[(crc ^ p_bytes[iByte]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+
+/* Palette index of every pixel. Every cell is drawn, dead ones included, so
+ * only the half cell gaps above odd and below even columns are never
+ * written and stay the dead colour from creation. */
+static void drawFrame(Export *p_export, const uint8_t *p_cells)
+{
+    int cellPx = p_export->cell_px;
+    int iRow, iCol, iLine;
+    uint8_t *p_pixel;
+    uint8_t state;
+
+    for (iRow = 0; iRow < p_export->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_export->width_cells; iCol++)
+        {
+            state = p_cells[iRow * p_export->width_cells + iCol];
+            p_pixel = p_export->p_indexed
+                    + ((size_t) iRow * cellPx + (iCol % 2 == 0 ? cellPx / 2 : 0)) * p_export->width_px
+                    + (size_t) iCol * cellPx;
+            for (iLine = 0; iLine < cellPx; iLine++)
+            {
+                memset(p_pixel, state, cellPx);
+                p_pixel += p_export->width_px;
+            }
+        }
+    }
+}
+
+
+static int writeRaw(Export *p_export)
+{
+    uint8_t *p_rgb = p_export->p_scratch;
+    const uint8_t *p_line;
+    int iLine, iPixel;
+
+    for (iLine = 0; iLine < p_export->height_px; iLine++)
+    {
+        p_line = p_export->p_indexed + (size_t) iLine * p_export->width_px;
+        for (iPixel = 0; iPixel < p_export->width_px; iPixel++)
+        {
+            memcpy(p_rgb + 3 * iPixel, palette[p_line[iPixel]], 3);
+        }
+        if (fwrite(p_rgb, 3, p_export->width_px, p_export->p_file) != (size_t) p_export->width_px)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+/* ------ GIF ------ */
+
+static void flushGifBlock(Export_bits *p_bits)
+{
+    if (p_bits->blockBytes == 0)
+    {
+        return;
+    }
+    if (fputc(p_bits->blockBytes, p_bits->p_file) == EOF
+     || fwrite(p_bits->block, 1, p_bits->blockBytes, p_bits->p_file) != (size_t) p_bits->blockBytes)
+    {
+        p_bits->failed = TRUE;
+    }
+    p_bits->blockBytes = 0;
+}
+
+
+static void putGifCode(Export_bits *p_bits, uint32_t code, int numBits)
+{
+    p_bits->bits |= code << p_bits->numBits;
+    p_bits->numBits += numBits;
+    while (p_bits->numBits >= 8)
+    {
+        p_bits->block[p_bits->blockBytes++] = (uint8_t) p_bits->bits;
+        p_bits->bits >>= 8;
+        p_bits->numBits -= 8;
+        if (p_bits->blockBytes == EXPORT_GIF_BLOCK_BYTES)
+        {
+            flushGifBlock(p_bits);
+        }
+    }
+}
+
+
+static int writeGifHeader(Export *p_export)
+{
+    uint8_t header[13];
+    static const uint8_t loop[19] =
+        { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+
+    memcpy(header, "GIF89a", 6);
+    putU16(header + 6, (uint16_t) p_export->width_px);
+    putU16(header + 8, (uint16_t) p_export->height_px);
+    /* Global colour table of 2^(1 + 1) entries */
+    header[10] = 0xF1;
+    header[11] = 0;
+    header[12] = 0;
+
+    return fwrite(header, 1, sizeof(header), p_export->p_file) == sizeof(header)
+        && fwrite(palette, 1, sizeof(palette), p_export->p_file) == sizeof(palette)
+        && fwrite(loop, 1, sizeof(loop), p_export->p_file) == sizeof(loop);
+}
+
+
+/* LZW over the palette indices with a 2 bit minimum code size. The table is
+ * a trie, child[code * 4 + index] being the code for that string plus one
+ * more index, or 0 while there is none. */
+static int writeGifFrame(Export *p_export)
+{
+    /* Graphic control extension with the delay at 4, then the image
+     * descriptor: left and top at 9 and 11, width and height at 13 and 15
+     * and no local colour table */
+    uint8_t frameHeader[18] =
+        { 0x21, 0xF9, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+          0x2C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    uint16_t *p_child = (uint16_t *) p_export->p_scratch;
+    const int clearCode = EXPORT_NUM_COLOURS;
+    const int minCodeBits = 2;
+    Export_bits bits;
+    size_t numPixels = (size_t) p_export->width_px * p_export->height_px;
+    size_t iPixel;
+    int codeBits = minCodeBits + 1;
+    int maxCode = clearCode + 1;
+    int prefix;
+    uint8_t index;
+
+    /* Delay in hundredths of a second */
+    putU16(frameHeader + 4, (uint16_t) (100 / p_export->fps));
+    putU16(frameHeader + 13, (uint16_t) p_export->width_px);
+    putU16(frameHeader + 15, (uint16_t) p_export->height_px);
+    if (fwrite(frameHeader, 1, sizeof(frameHeader), p_export->p_file) != sizeof(frameHeader)
+     || fputc(minCodeBits, p_export->p_file) == EOF)
+    {
+        return FALSE;
+    }
+
+    memset(&bits, 0, sizeof(bits));
+    bits.p_file = p_export->p_file;
+    memset(p_child, 0, EXPORT_LZW_MAX_CODES * EXPORT_NUM_COLOURS * sizeof(uint16_t));
+
+    putGifCode(&bits, clearCode, codeBits);
+    prefix = p_export->p_indexed[0];
+    for (iPixel = 1; iPixel < numPixels; iPixel++)
+    {
+        index = p_export->p_indexed[iPixel];
+        if (p_child[prefix * EXPORT_NUM_COLOURS + index] != 0)
+        {
+            prefix = p_child[prefix * EXPORT_NUM_COLOURS + index];
+            continue;
+        }
+
+        putGifCode(&bits, prefix, codeBits);
+        p_child[prefix * EXPORT_NUM_COLOURS + index] = ++maxCode;
+        if (maxCode >= (1 << codeBits))
+        {
+            codeBits++;
+        }
+        /* A full table starts again */
+        if (maxCode == EXPORT_LZW_MAX_CODES - 1)
+        {
+            putGifCode(&bits, clearCode, codeBits);
+            memset(p_child, 0, EXPORT_LZW_MAX_CODES * EXPORT_NUM_COLOURS * sizeof(uint16_t));
+            codeBits = minCodeBits + 1;
+            maxCode = clearCode + 1;
+        }
+        prefix = index;
+    }
+    putGifCode(&bits, prefix, codeBits);
+    putGifCode(&bits, clearCode + 1, codeBits);
+    if (bits.numBits > 0)
+    {
+        putGifCode(&bits, 0, 8 - bits.numBits);
+    }
+    flushGifBlock(&bits);
+
+    return bits.failed == FALSE && fputc(0, p_export->p_file) != EOF;
+}
+
+
+/* ------ PNG ------ */
+
+static void putDeflateBits(Export_bits *p_bits, uint32_t value, int numBits)
+{
+    p_bits->bits |= value << p_bits->numBits;
+    p_bits->numBits += numBits;
+    while (p_bits->numBits >= 8)
+    {
+        p_bits->p_buffer[p_bits->numBytes++] = (uint8_t) p_bits->bits;
+        p_bits->bits >>= 8;
+        p_bits->numBits -= 8;
+    }
+}
+
+
+/* Huffman codes go out most significant bit first */
+static void putHuffman(Export_bits *p_bits, uint32_t code, int numBits)
+{
+    uint32_t reversed = 0;
+    int iBit;
+
+    for (iBit = 0; iBit < numBits; iBit++)
+    {
+        reversed = (reversed << 1) | ((code >> iBit) & 1);
+    }
+    putDeflateBits(p_bits, reversed, numBits);
+}
+
+
+/* Symbol from the fixed literal/length code */
+static void putFixedSymbol(Export_bits *p_bits, int symbol)
+{
+    if (symbol < 144)
+    {
+        putHuffman(p_bits, 0x30 + symbol, 8);
+    }
+    else if (symbol < 256)
+    {
+        putHuffman(p_bits, 0x190 + symbol - 144, 9);
+    }
+    else if (symbol < 280)
+    {
+        putHuffman(p_bits, symbol - 256, 7);
+    }
+    else
+    {
+        putHuffman(p_bits, 0xC0 + symbol - 280, 8);
+    }
+}
+
+
+static void putMatch(Export_bits *p_bits, int length)
+{
+    static const uint16_t lengthBase[29] =
+        { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t lengthExtraBits[29] =
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+          3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    int iCode = 28;
+
+    while (lengthBase[iCode] > length)
+    {
+        iCode--;
+    }
+    putFixedSymbol(p_bits, 257 + iCode);
+    putDeflateBits(p_bits, length - lengthBase[iCode], lengthExtraBits[iCode]);
+    /* Distance code 0, one byte back */
+    putHuffman(p_bits, 0, 5);
+}
+
+
+/* A zlib stream of one fixed Huffman block. The only matches are runs of
+ * the byte before, which is where cell images repeat most. */
+static size_t deflateRuns(const uint8_t *p_data, size_t numBytes, uint8_t *p_out)
+{
+    Export_bits bits;
+    size_t iByte = 0;
+    size_t runLength;
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t iAdler;
+
+    memset(&bits, 0, sizeof(bits));
+    bits.p_buffer = p_out;
+
+    /* Deflate, no preset dictionary, fastest */
+    bits.p_buffer[bits.numBytes++] = 0x78;
+    bits.p_buffer[bits.numBytes++] = 0x01;
+
+    /* Final block, fixed codes */
+    putDeflateBits(&bits, 1, 1);
+    putDeflateBits(&bits, 1, 2);
+    while (iByte < numBytes)
+    {
+        runLength = 0;
+        if (iByte > 0)
+        {
+            while (iByte + runLength < numBytes && runLength < EXPORT_DEFLATE_MAX_MATCH
+                && p_data[iByte + runLength] == p_data[iByte - 1])
+            {
+                runLength++;
+            }
+        }
+
+        if (runLength >= EXPORT_DEFLATE_MIN_MATCH)
+        {
+            putMatch(&bits, (int) runLength);
+            iByte += runLength;
+        }
+        else
+        {
+            putFixedSymbol(&bits, p_data[iByte]);
+            iByte++;
+        }
+    }
+    putFixedSymbol(&bits, 256);
+    if (bits.numBits > 0)
+    {
+        putDeflateBits(&bits, 0, 8 - bits.numBits);
+    }
+
+    /* Adler-32, reduced often enough not to overflow */
+    for (iAdler = 0; iAdler < numBytes; iAdler++)
+    {
+        adlerA += p_data[iAdler];
+        adlerB += adlerA;
+        if ((iAdler & 4095) == 4095)
+        {
+            adlerA %= 65521;
+            adlerB %= 65521;
+        }
+    }
+    adlerA %= 65521;
+    adlerB %= 65521;
+    putU32BigEndian(bits.p_buffer + bits.numBytes, (adlerB << 16) | adlerA);
+
+    return bits.numBytes + 4;
+}
+
+
+static int writeChunk(FILE *p_file, const char *p_type, const uint8_t *p_data, size_t numBytes)
+{
+    uint8_t field[4];
+    uint32_t crc;
+
+    crc = crc32Update(0xFFFFFFFFu, (const uint8_t *) p_type, 4);
+    crc = crc32Update(crc, p_data, numBytes) ^ 0xFFFFFFFFu;
+
+    putU32BigEndian(field, (uint32_t) numBytes);
+    if (fwrite(field, 1, 4, p_file) != 4 || fwrite(p_type, 1, 4, p_file) != 4
+     || (numBytes > 0 && fwrite(p_data, 1, numBytes, p_file) != numBytes))
+    {
+        return FALSE;
+    }
+    putU32BigEndian(field, crc);
+
+    return fwrite(field, 1, 4, p_file) == 4;
+}
+
+
+/* 8 bit indexed, every line filtered with None. The filter bytes are put in
+ * front of each line in the scratch buffer, which the stream follows. */
+static int writePng(Export *p_export, int iFrame)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    char path[EXPORT_MAX_PATH_CHARS];
+    uint8_t header[13];
+    size_t lineBytes = (size_t) p_export->width_px + 1;
+    size_t rawBytes = lineBytes * p_export->height_px;
+    uint8_t *p_raw = p_export->p_scratch;
+    size_t streamBytes;
+    FILE *p_file;
+    int iLine;
+    int isWritten;
+
+    for (iLine = 0; iLine < p_export->height_px; iLine++)
+    {
+        p_raw[iLine * lineBytes] = 0;
+        memcpy(p_raw + iLine * lineBytes + 1, p_export->p_indexed + (size_t) iLine * p_export->width_px, p_export->width_px);
+    }
+    streamBytes = deflateRuns(p_raw, rawBytes, p_raw + rawBytes);
+
+    putU32BigEndian(header, (uint32_t) p_export->width_px);
+    putU32BigEndian(header + 4, (uint32_t) p_export->height_px);
+    header[8] = 8;
+    header[9] = 3;
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+
+    snprintf(path, sizeof(path), p_export->path, iFrame);
+    p_file = fopen(path, "wb");
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", path);
+        return FALSE;
+    }
+    isWritten = fwrite(signature, 1, sizeof(signature), p_file) == sizeof(signature)
+             && writeChunk(p_file, "IHDR", header, sizeof(header))
+             && writeChunk(p_file, "PLTE", &palette[0][0], sizeof(palette))
+             && writeChunk(p_file, "IDAT", p_raw + rawBytes, streamBytes)
+             && writeChunk(p_file, "IEND", NULL, 0);
+    if (fclose(p_file) != 0)
+    {
+        isWritten = FALSE;
+    }
+
+    return isWritten;
+}
+
+
+/* ------ THREAD ------ */
+
+static int encodeFrame(Export *p_export, const uint8_t *p_cells)
+{
+    drawFrame(p_export, p_cells);
+
+    switch (p_export->format)
+    {
+        case EXPORT_FORMAT_GIF:
+            return writeGifFrame(p_export);
+
+        case EXPORT_FORMAT_PNG:
+            return writePng(p_export, p_export->num_written);
+    }
+
+    return writeRaw(p_export);
+}
+
+
+static void *exportMain(void *p_arg)
+{
+    Export *p_export = p_arg;
+    size_t slotCells = (size_t) p_export->width_cells * p_export->height_cells;
+    const uint8_t *p_cells;
+    int isWritten;
+    uint64_t profile_ns;
+
+    Profile_nameThread("export");
+
+    pthread_mutex_lock(&p_export->lock);
+    while (TRUE)
+    {
+        while (p_export->count == 0 && p_export->quit == FALSE)
+        {
+            pthread_cond_wait(&p_export->notEmpty, &p_export->lock);
+        }
+        if (p_export->count == 0)
+        {
+            break;
+        }
+        p_cells = p_export->p_slots + p_export->head * slotCells;
+        pthread_mutex_unlock(&p_export->lock);
+
+        /* After a failure frames are only drained, so the producer never waits */
+        isWritten = TRUE;
+        if (p_export->failed == FALSE)
+        {
+            profile_ns = Profile_begin();
+            isWritten = encodeFrame(p_export, p_cells);
+            Profile_end(PROFILE_ZONE_EXPORT, profile_ns);
+        }
+
+        pthread_mutex_lock(&p_export->lock);
+        if (isWritten == TRUE)
+        {
+            p_export->num_written++;
+        }
+        else
+        {
+            p_export->failed = TRUE;
+        }
+        p_export->head = (p_export->head + 1) % EXPORT_QUEUE_FRAMES;
+        p_export->count--;
+        pthread_cond_signal(&p_export->notFull);
+    }
+    pthread_mutex_unlock(&p_export->lock);
+
+    return NULL;
+}
+
+
+static void freeExport(Export *p_export)
+{
+    if (p_export->p_file != NULL)
+    {
+        if (p_export->isPipe == TRUE)
+        {
+            pclose(p_export->p_file);
+        }
+        else
+        {
+            fclose(p_export->p_file);
+        }
+    }
+    free(p_export->p_slots);
+    free(p_export->p_indexed);
+    free(p_export->p_scratch);
+    free(p_export);
+}
+
+
+Export *Export_create(const char *p_path, int widthCells, int heightCells, int cellPx, int fps)
+{
+    Export *p_export;
+    size_t numPixels;
+    size_t rawBytes;
+
+    if (cellPx <= 0 || fps <= 0
+     || (int64_t) widthCells * cellPx > EXPORT_MAX_SIDE_PX
+     || (int64_t) heightCells * cellPx + cellPx / 2 > EXPORT_MAX_SIDE_PX)
+    {
+        printf("[ERR] Frames of %dx%d cells at %d px per cell are too big, the most is %d px a side\n",
+               widthCells, heightCells, cellPx, EXPORT_MAX_SIDE_PX);
+        return NULL;
+    }
+    if (strlen(p_path) >= EXPORT_MAX_PATH_CHARS)
+    {
+        printf("[ERR] Export path %s is too long\n", p_path);
+        return NULL;
+    }
+    if (formatFor(p_path) == EXPORT_FORMAT_PNG && isFramePattern(p_path) == FALSE)
+    {
+        printf("[ERR] %s needs one %%d for the frame number, e.g. frames/%%05d.png\n", p_path);
+        return NULL;
+    }
+
+    p_export = calloc(1, sizeof(Export));
+    if (p_export == NULL)
+    {
+        printf("[ERR] Could not create export\n");
+        return NULL;
+    }
+
+    p_export->format = formatFor(p_path);
+    snprintf(p_export->path, EXPORT_MAX_PATH_CHARS, "%s", p_path);
+    p_export->width_cells = widthCells;
+    p_export->height_cells = heightCells;
+    p_export->cell_px = cellPx;
+    p_export->fps = fps;
+    p_export->width_px = widthCells * cellPx;
+    p_export->height_px = heightCells * cellPx + cellPx / 2;
+
+    numPixels = (size_t) p_export->width_px * p_export->height_px;
+    switch (p_export->format)
+    {
+        case EXPORT_FORMAT_GIF:
+            p_export->scratch_bytes = EXPORT_LZW_MAX_CODES * EXPORT_NUM_COLOURS * sizeof(uint16_t);
+            break;
+
+        case EXPORT_FORMAT_PNG:
+            /* Lines with their filter bytes, then a stream of at most 9 bits a byte */
+            rawBytes = numPixels + p_export->height_px;
+            p_export->scratch_bytes = rawBytes + rawBytes + rawBytes / 8 + 64;
+            break;
+
+        default:
+            p_export->scratch_bytes = (size_t) 3 * p_export->width_px;
+            break;
+    }
+
+    p_export->p_slots = malloc((size_t) EXPORT_QUEUE_FRAMES * widthCells * heightCells);
+    p_export->p_indexed = calloc(numPixels, sizeof(uint8_t));
+    p_export->p_scratch = malloc(p_export->scratch_bytes);
+    if (p_export->p_slots == NULL || p_export->p_indexed == NULL || p_export->p_scratch == NULL)
+    {
+        printf("[ERR] Could not create export, out of memory\n");
+        freeExport(p_export);
+        return NULL;
+    }
+
+    if (p_path[0] == '|')
+    {
+        /* A command that exits early should fail the writes, not kill us */
+        signal(SIGPIPE, SIG_IGN);
+        p_export->p_file = popen(p_path + 1, "w");
+        p_export->isPipe = TRUE;
+    }
+    else if (p_export->format != EXPORT_FORMAT_PNG)
+    {
+        p_export->p_file = fopen(p_path, "wb");
+    }
+    if (p_export->format != EXPORT_FORMAT_PNG && p_export->p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", p_path);
+        freeExport(p_export);
+        return NULL;
+    }
+    if (p_export->format == EXPORT_FORMAT_GIF && writeGifHeader(p_export) == FALSE)
+    {
+        printf("[ERR] Could not write %s\n", p_path);
+        freeExport(p_export);
+        return NULL;
+    }
+
+    initCrcTable();
+    pthread_mutex_init(&p_export->lock, NULL);
+    pthread_cond_init(&p_export->notEmpty, NULL);
+    pthread_cond_init(&p_export->notFull, NULL);
+    if (pthread_create(&p_export->thread, NULL, exportMain, p_export) != 0)
+    {
+        printf("[ERR] Could not start export thread\n");
+        pthread_mutex_destroy(&p_export->lock);
+        pthread_cond_destroy(&p_export->notEmpty);
+        pthread_cond_destroy(&p_export->notFull);
+        freeExport(p_export);
+        return NULL;
+    }
+
+    return p_export;
+}
+
+
+int Export_pushFrame(Export *p_export, Grid *p_grid)
+{
+    uint8_t *p_slot;
+    uint64_t start_ns = 0;
+    int iRow;
+
+    pthread_mutex_lock(&p_export->lock);
+    if (p_export->count == EXPORT_QUEUE_FRAMES)
+    {
+        start_ns = Timer_nowNs();
+        while (p_export->count == EXPORT_QUEUE_FRAMES)
+        {
+            pthread_cond_wait(&p_export->notFull, &p_export->lock);
+        }
+        p_export->wait_ns += Timer_nowNs() - start_ns;
+    }
+    if (p_export->failed == TRUE)
+    {
+        pthread_mutex_unlock(&p_export->lock);
+        return FALSE;
+    }
+    p_slot = p_export->p_slots
+           + (size_t) ((p_export->head + p_export->count) % EXPORT_QUEUE_FRAMES) * p_export->width_cells * p_export->height_cells;
+    pthread_mutex_unlock(&p_export->lock);
+
+    /* The export thread does not touch a slot until it is counted */
+    for (iRow = 0; iRow < p_export->height_cells; iRow++)
+    {
+        memcpy(p_slot + (size_t) iRow * p_export->width_cells,
+               p_grid->p_disp + (size_t) iRow * p_grid->stride_cells,
+               p_export->width_cells);
+    }
+
+    pthread_mutex_lock(&p_export->lock);
+    p_export->count++;
+    p_export->num_pushed++;
+    pthread_cond_signal(&p_export->notEmpty);
+    pthread_mutex_unlock(&p_export->lock);
+
+    return TRUE;
+}
+
+
+int Export_destroy(Export *p_export)
+{
+    int isWritten;
+
+    pthread_mutex_lock(&p_export->lock);
+    p_export->quit = TRUE;
+    pthread_cond_signal(&p_export->notEmpty);
+    pthread_mutex_unlock(&p_export->lock);
+    pthread_join(p_export->thread, NULL);
+
+    isWritten = p_export->failed == FALSE;
+    if (p_export->format == EXPORT_FORMAT_GIF && isWritten == TRUE)
+    {
+        isWritten = fputc(0x3B, p_export->p_file) != EOF;
+    }
+    if (p_export->p_file != NULL)
+    {
+        if (p_export->isPipe == TRUE)
+        {
+            isWritten = pclose(p_export->p_file) == 0 && isWritten;
+        }
+        else
+        {
+            isWritten = fclose(p_export->p_file) == 0 && isWritten;
+        }
+        p_export->p_file = NULL;
+    }
+    if (isWritten == FALSE)
+    {
+        printf("[ERR] Could not write every frame to %s\n", p_export->path);
+    }
+
+    pthread_mutex_destroy(&p_export->lock);
+    pthread_cond_destroy(&p_export->notEmpty);
+    pthread_cond_destroy(&p_export->notFull);
+    freeExport(p_export);
+
+    return isWritten;
+}
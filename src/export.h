@@ -0,0 +1,85 @@
+#ifndef H_HEXLIFE_EXPORT_H
+#define H_HEXLIFE_EXPORT_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "grid.h"
+#include "bool.h"
+
+
+/* Chosen from the path: "|command" pipes raw video into the command, *.gif
+ * is an animated GIF, *.png a numbered sequence and anything else raw video */
+#define EXPORT_FORMAT_RAW  (0)  /* RGB24 frames one after another */
+#define EXPORT_FORMAT_GIF  (1)
+#define EXPORT_FORMAT_PNG  (2)  /* one file per frame, the path holds a %d */
+
+#define EXPORT_DEFAULT_CELL_PX  (2)
+#define EXPORT_DEFAULT_FPS      (30)
+
+/* Grid copies waiting for the export thread */
+#define EXPORT_QUEUE_FRAMES  (8)
+
+/* GIF stores sizes in 16 bits */
+#define EXPORT_MAX_SIDE_PX    (65535)
+#define EXPORT_MAX_PATH_CHARS (1024)
+
+
+/* Draws grids into frames and encodes them on its own thread. Cells are
+ * cell_px square, with even columns half a cell lower as in the viewer. */
+typedef struct Export_struct {
+    int format;
+    char path[EXPORT_MAX_PATH_CHARS];
+    FILE *p_file;
+    int isPipe;
+
+    int width_cells;
+    int height_cells;
+    int cell_px;
+    int width_px;
+    int height_px;
+    int fps;
+
+    /* Ring of EXPORT_QUEUE_FRAMES grids, width_cells * height_cells cells
+     * each with no padding. The producer fills the slot after the last
+     * queued one, the export thread drains from head. */
+    uint8_t *p_slots;
+    int head;
+    int count;
+    int quit;
+    int failed;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+
+    /* Export thread only: one palette index per pixel, and encoder scratch */
+    uint8_t *p_indexed;
+    uint8_t *p_scratch;
+    size_t scratch_bytes;
+    int num_written;
+
+    /* Producer only */
+    int num_pushed;
+    uint64_t wait_ns;
+} Export;
+
+
+/* Opens the output and starts the export thread. Returns NULL on failure,
+ * after printing why. */
+extern Export *Export_create(const char *p_path, int widthCells, int heightCells, int cellPx, int fps);
+
+/* Queues the displayed cells of a grid of the export's size as the next
+ * frame. Only waits when the queue is full. Returns FALSE once writing has
+ * failed. */
+extern int Export_pushFrame(Export *p_export, Grid *p_grid);
+
+/* Encodes every queued frame, closes the output and frees the export.
+ * Returns FALSE if any frame could not be written. */
+extern int Export_destroy(Export *p_export);
+
+
+#endif /* H_HEXLIFE_EXPORT_H */
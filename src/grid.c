@@ -1,184 +1,784 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
 
 #include "grid.h"
+#include "profile.h"
 
 
-Grid Grid_create(int width_cells, int height_cells)
+#define GRID_MAX_BANDS  (256)
+
+/* Each random draw covers this many cells with 16 bits apiece */
+#define GRID_SEED_GROUP_CELLS  (4)
+#define GRID_SEED_SCALE        (65536)
+
+/* First row, last row, first column and last column of a tile's box */
+#define GRID_TILE_BOX_BYTES  (4)
+
+
+typedef struct Grid_bandResult_struct {
+    int isStationary;
+    int activeTiles;
+    uint64_t hashDelta;
+
+    /* Changes to the counts, and the box of the band's tiles */
+    Grid_stats stats;
+} Grid_bandResult;
+
+
+typedef struct Grid_bandJob_struct {
+    Grid *p_grid;
+    const Rule *p_rule;
+
+    int numBands;
+    Grid_bandResult *p_bandResults;
+} Grid_bandJob;
+
+
+typedef struct Grid_seedJob_struct {
+    Grid *p_grid;
+    uint64_t key;
+    uint32_t threshold;
+
+    int numBands;
+    uint64_t bandHashes[GRID_MAX_BANDS];
+    Grid_stats bandStats[GRID_MAX_BANDS];
+} Grid_seedJob;
+
+
+int Grid_strideFor(int width_cells)
+{
+    int minStride = width_cells + 2 * GRID_HALO_CELLS;
+
+    return (minStride + GRID_ROW_ALIGN_CELLS - 1) / GRID_ROW_ALIGN_CELLS * GRID_ROW_ALIGN_CELLS;
+}
+
+
+static void initEmpty(Grid *p_grid)
+{
+    memset(p_grid, 0, sizeof(Grid));
+}
+
+
+/* No cells counted and an empty box */
+static void clearStats(Grid_stats *p_stats)
+{
+    memset(p_stats, 0, sizeof(Grid_stats));
+    p_stats->min_row = INT_MAX;
+    p_stats->max_row = -1;
+    p_stats->min_col = INT_MAX;
+    p_stats->max_col = -1;
+}
+
+
+static void growBox(Grid_stats *p_stats, int minRow, int maxRow, int minCol, int maxCol)
+{
+    if (minRow < p_stats->min_row)
+    {
+        p_stats->min_row = minRow;
+    }
+    if (maxRow > p_stats->max_row)
+    {
+        p_stats->max_row = maxRow;
+    }
+    if (minCol < p_stats->min_col)
+    {
+        p_stats->min_col = minCol;
+    }
+    if (maxCol > p_stats->max_col)
+    {
+        p_stats->max_col = maxCol;
+    }
+}
+
+
+/* Adds up two partial results, as from two bands */
+static void mergeStats(Grid_stats *p_into, const Grid_stats *p_from)
+{
+    int iState;
+
+    for (iState = 0; iState < RULE_NUM_STATES; iState++)
+    {
+        p_into->counts[iState] += p_from->counts[iState];
+    }
+    p_into->births += p_from->births;
+    p_into->deaths += p_from->deaths;
+    p_into->infections += p_from->infections;
+
+    growBox(p_into, p_from->min_row, p_from->max_row, p_from->min_col, p_from->max_col);
+}
+
+
+/* Counts in p_delta are changes, the rest replaces what the grid had */
+static void applyStepStats(Grid *p_grid, const Grid_stats *p_delta)
+{
+    Grid_stats stats = *p_delta;
+    int iState;
+
+    for (iState = 0; iState < RULE_NUM_STATES; iState++)
+    {
+        stats.counts[iState] += p_grid->stats.counts[iState];
+    }
+
+    p_grid->stats = stats;
+}
+
+
+/* Both buffers share one page aligned arena, each starting on its own page.
+ * When p_cells is given it becomes p_data1 and the arena only holds p_data2.
+ * The arena starts with a spare page for the halo cell before the first
+ * buffer, a mapped p_data1 has the snapshot header there instead. */
+static Grid createGrid(int width_cells, int height_cells, uint8_t *p_cells)
 {
     Grid grid;
+    size_t bufferBytes;
+    size_t arenaBytes;
+    int numTiles;
+    int iTile;
+
+    initEmpty(&grid);
+
+    if (width_cells <= 0 || height_cells <= 0)
+    {
+        printf("[ERR] Could not create a %dx%d grid, both sides must be positive\n", width_cells, height_cells);
+        return grid;
+    }
+
+    /* Cells are indexed with ints */
+    grid.stride_cells = Grid_strideFor(width_cells);
+    if (grid.stride_cells <= 0 || (size_t) grid.stride_cells * height_cells > (size_t) INT_MAX)
+    {
+        printf("[ERR] Could not create a %dx%d grid, it has too many cells\n", width_cells, height_cells);
+        initEmpty(&grid);
+        return grid;
+    }
+
+    bufferBytes = (size_t) grid.stride_cells * height_cells * sizeof(uint8_t);
+    bufferBytes = (bufferBytes + GRID_ARENA_ALIGN_BYTES - 1) / GRID_ARENA_ALIGN_BYTES * GRID_ARENA_ALIGN_BYTES;
+    arenaBytes = GRID_ARENA_ALIGN_BYTES + (p_cells != NULL ? bufferBytes : 2 * bufferBytes);
 
-    grid.p_data1 = NULL;
-    grid.p_data2 = NULL;
+    grid.tiles_x = (width_cells + GRID_TILE_SIZE_CELLS - 1) / GRID_TILE_SIZE_CELLS;
+    grid.tiles_y = (height_cells + GRID_TILE_SIZE_CELLS - 1) / GRID_TILE_SIZE_CELLS;
+    numTiles = grid.tiles_x * grid.tiles_y;
+
+    if (posix_memalign((void **) &grid.p_arena, GRID_ARENA_ALIGN_BYTES, arenaBytes) != 0)
+    {
+        grid.p_arena = NULL;
+    }
+    grid.p_tileChanged = malloc(numTiles * sizeof(uint8_t));
+    grid.p_tileChangedNext = malloc(numTiles * sizeof(uint8_t));
+    grid.p_tileBoxes = malloc((size_t) numTiles * GRID_TILE_BOX_BYTES * sizeof(uint8_t));
+    grid.p_deadRow = calloc((size_t) grid.stride_cells + 2 * GRID_HALO_CELLS, sizeof(uint8_t));
+    if (grid.p_arena == NULL || grid.p_tileChanged == NULL || grid.p_tileChangedNext == NULL
+     || grid.p_tileBoxes == NULL || grid.p_deadRow == NULL)
+    {
+        printf("[ERR] Could not create a %dx%d grid, out of memory for %lu bytes\n",
+               width_cells, height_cells, (unsigned long) arenaBytes);
+        free(grid.p_arena);
+        free(grid.p_tileChanged);
+        free(grid.p_tileChangedNext);
+        free(grid.p_tileBoxes);
+        free(grid.p_deadRow);
+        initEmpty(&grid);
+        return grid;
+    }
 
-    grid.p_data1 = malloc(width_cells * height_cells * sizeof(uint8_t));
-    grid.p_data2 = malloc(width_cells * height_cells * sizeof(uint8_t));
-    if (grid.p_data1 == NULL || grid.p_data2 == NULL)
+    /* The padding at the end of each row stays dead */
+    memset(grid.p_arena, GRID_DEAD, arenaBytes);
+    memset(grid.p_tileChanged, TRUE, numTiles);
+    for (iTile = 0; iTile < numTiles; iTile++)
     {
-        printf("[ERR] Could not create grid\n");
+        grid.p_tileBoxes[iTile * GRID_TILE_BOX_BYTES + 0] = GRID_TILE_SIZE_CELLS;
+        grid.p_tileBoxes[iTile * GRID_TILE_BOX_BYTES + 1] = 0;
+        grid.p_tileBoxes[iTile * GRID_TILE_BOX_BYTES + 2] = GRID_TILE_SIZE_CELLS;
+        grid.p_tileBoxes[iTile * GRID_TILE_BOX_BYTES + 3] = 0;
     }
 
+    if (p_cells != NULL)
+    {
+        grid.p_data1 = p_cells;
+        grid.p_data2 = grid.p_arena + GRID_ARENA_ALIGN_BYTES;
+    }
+    else
+    {
+        grid.p_data1 = grid.p_arena + GRID_ARENA_ALIGN_BYTES;
+        grid.p_data2 = grid.p_data1 + bufferBytes;
+    }
+    grid.p_deadRow += GRID_HALO_CELLS;
+    grid.boundary = GRID_BOUNDARY_TORUS;
+
     grid.width_cells = width_cells;
     grid.height_cells = height_cells;
 
     grid.p_disp = grid.p_data1;
     grid.p_next = grid.p_data2;
 
+    /* Callers filling p_cells sync it, which recounts these */
+    clearStats(&grid.stats);
+    grid.stats.counts[GRID_DEAD] = width_cells * height_cells;
+
     return grid;
 }
 
 
-void Grid_resetGrid(Grid *p_grid)
+Grid Grid_create(int width_cells, int height_cells)
 {
-    int iRow, iCol;
+    return createGrid(width_cells, height_cells, NULL);
+}
 
-    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+
+Grid Grid_createMapped(int width_cells, int height_cells, uint8_t *p_cells, void *p_mapping, size_t mappingBytes)
+{
+    Grid grid = createGrid(width_cells, height_cells, p_cells);
+
+    grid.p_mapping = p_mapping;
+    grid.mapping_bytes = mappingBytes;
+
+    return grid;
+}
+
+
+/* splitmix64 finaliser */
+static uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+
+/* A cell is alive when its 16 bits fall under this */
+static uint32_t seedThreshold(double density)
+{
+    if (density <= 0.0)
     {
-        for (iCol = 0; iCol < p_grid->width_cells; iCol++)
+        return 0;
+    }
+    if (density >= 1.0)
+    {
+        return GRID_SEED_SCALE;
+    }
+
+    return (uint32_t) (density * GRID_SEED_SCALE + 0.5);
+}
+
+
+/* Fills rows [rowStart, rowEnd) of p_data1 and returns their share of the
+ * hash, adding their live cells to p_stats. Group g of row r draws
+ * mix64(key + (r * groupsPerRow + g) * golden ratio), the splitmix64 stream
+ * read at that position. */
+static uint64_t seedRows(Grid *p_grid, uint64_t key, uint32_t threshold, int rowStart, int rowEnd, Grid_stats *p_stats)
+{
+    int groupsPerRow = (p_grid->width_cells + GRID_SEED_GROUP_CELLS - 1) / GRID_SEED_GROUP_CELLS;
+    uint64_t hash = 0;
+    uint64_t bits;
+    uint8_t *p_row;
+    int iRow, iGroup, iCol, endCol;
+    int iCell;
+    int numAlive = 0;
+    int minCol, maxCol;
+
+    for (iRow = rowStart; iRow < rowEnd; iRow++)
+    {
+        p_row = p_grid->p_data1 + (size_t) iRow * p_grid->stride_cells;
+        for (iGroup = 0; iGroup < groupsPerRow; iGroup++)
         {
-            if (rand() % 4 == 0)
+            bits = mix64(key + ((uint64_t) iRow * groupsPerRow + iGroup) * 0x9E3779B97F4A7C15ULL);
+            iCol = iGroup * GRID_SEED_GROUP_CELLS;
+            endCol = iCol + GRID_SEED_GROUP_CELLS < p_grid->width_cells ? iCol + GRID_SEED_GROUP_CELLS : p_grid->width_cells;
+            for (; iCol < endCol; iCol++)
             {
-                p_grid->p_data1[iRow * p_grid->width_cells + iCol] = GRID_ALIVE;
+                p_row[iCol] = (bits & (GRID_SEED_SCALE - 1)) < threshold ? GRID_ALIVE : GRID_DEAD;
+                bits >>= 16;
             }
-            else
+        }
+
+        /* Hashing and counting in the same pass saves reading the grid again */
+        iCell = iRow * p_grid->width_cells;
+        minCol = INT_MAX;
+        maxCol = -1;
+        for (iCol = 0; iCol < p_grid->width_cells; iCol++)
+        {
+            if (p_row[iCol] != GRID_DEAD)
             {
-                p_grid->p_data1[iRow * p_grid->width_cells + iCol] = GRID_DEAD;
+                hash ^= Grid_cellHash(iCell + iCol, GRID_ALIVE);
+                numAlive++;
+                if (minCol == INT_MAX)
+                {
+                    minCol = iCol;
+                }
+                maxCol = iCol;
             }
         }
+        if (maxCol >= 0)
+        {
+            growBox(p_stats, iRow, iRow, minCol, maxCol);
+        }
     }
 
+    p_stats->counts[GRID_ALIVE] += numAlive;
+    p_stats->counts[GRID_DEAD] += (rowEnd - rowStart) * p_grid->width_cells - numAlive;
+
+    return hash;
+}
+
+
+static void finishReset(Grid *p_grid, uint64_t hash, const Grid_stats *p_stats)
+{
     p_grid->p_disp = p_grid->p_data1;
     p_grid->p_next = p_grid->p_data2;
+    p_grid->generation = 0;
+    p_grid->hash = hash;
+    p_grid->stats = *p_stats;
+
+    Grid_markAllTilesChanged(p_grid);
+}
+
+
+void Grid_resetGrid(Grid *p_grid, uint64_t seed, double density)
+{
+    Grid_stats stats;
+    uint64_t hash;
+
+    clearStats(&stats);
+    hash = seedRows(p_grid, mix64(seed), seedThreshold(density), 0, p_grid->height_cells, &stats);
+
+    finishReset(p_grid, hash, &stats);
+}
+
+
+static void seedBandTask(void *p_ctx, int iBand)
+{
+    Grid_seedJob *p_job = p_ctx;
+    int height = p_job->p_grid->height_cells;
+
+    clearStats(&p_job->bandStats[iBand]);
+    p_job->bandHashes[iBand] = seedRows
+       (p_job->p_grid, p_job->key, p_job->threshold,
+        (int) ((int64_t) height * iBand / p_job->numBands),
+        (int) ((int64_t) height * (iBand + 1) / p_job->numBands),
+        &p_job->bandStats[iBand]);
+}
+
+
+void Grid_resetGridParallel(Grid *p_grid, Pool *p_pool, uint64_t seed, double density)
+{
+    Grid_seedJob job;
+    Grid_stats stats;
+    uint64_t hash = 0;
+    int iBand;
+
+    job.p_grid = p_grid;
+    job.key = mix64(seed);
+    job.threshold = seedThreshold(density);
+
+    /* A few bands per thread so a slow one does not hold up the rest */
+    job.numBands = 4 * p_pool->num_threads;
+    if (job.numBands > GRID_MAX_BANDS)
+    {
+        job.numBands = GRID_MAX_BANDS;
+    }
+    if (job.numBands > p_grid->height_cells)
+    {
+        job.numBands = p_grid->height_cells;
+    }
+
+    Pool_run(p_pool, seedBandTask, &job, job.numBands);
+
+    /* Neither XOR nor the sums care how the rows were split */
+    clearStats(&stats);
+    for (iBand = 0; iBand < job.numBands; iBand++)
+    {
+        hash ^= job.bandHashes[iBand];
+        mergeStats(&stats, &job.bandStats[iBand]);
+    }
+
+    finishReset(p_grid, hash, &stats);
+}
+
+
+void Grid_setBoundary(Grid *p_grid, int boundary)
+{
+    p_grid->boundary = boundary;
+    Grid_markAllTilesChanged(p_grid);
+}
+
+
+const char *Grid_boundaryName(int boundary)
+{
+    switch (boundary)
+    {
+        case GRID_BOUNDARY_DEAD:
+            return "dead";
+
+        case GRID_BOUNDARY_REFLECT:
+            return "reflect";
+    }
+
+    return "torus";
+}
+
+
+int Grid_parseBoundary(const char *p_name, int *p_boundary)
+{
+    int boundary;
+
+    for (boundary = 0; boundary < GRID_NUM_BOUNDARIES; boundary++)
+    {
+        if (strcmp(p_name, Grid_boundaryName(boundary)) == 0)
+        {
+            *p_boundary = boundary;
+            return TRUE;
+        }
+    }
+
+    printf("[ERR] Unknown boundary %s\n", p_name);
+
+    return FALSE;
 }
 
 
 void Grid_clearGrid(Grid *p_grid)
 {
-    int iCell;
+    int iRow;
 
-    for (iCell = 0; iCell < p_grid->width_cells * p_grid->height_cells; iCell++)
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
     {
-        p_grid->p_data1[iCell] = GRID_DEAD;
+        memset(p_grid->p_data1 + iRow * p_grid->stride_cells, GRID_DEAD, p_grid->width_cells);
     }
 
     p_grid->p_disp = p_grid->p_data1;
     p_grid->p_next = p_grid->p_data2;
+    p_grid->generation = 0;
+
+    Grid_syncDisp(p_grid);
 }
 
 void Grid_fillGrid(Grid *p_grid)
 {
-    int iCell;
+    int iRow;
 
-    for (iCell = 0; iCell < p_grid->width_cells * p_grid->height_cells; iCell++)
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
     {
-        p_grid->p_data1[iCell] = GRID_ALIVE;
+        memset(p_grid->p_data1 + iRow * p_grid->stride_cells, GRID_ALIVE, p_grid->width_cells);
     }
 
     p_grid->p_disp = p_grid->p_data1;
     p_grid->p_next = p_grid->p_data2;
+    p_grid->generation = 0;
+
+    Grid_syncDisp(p_grid);
 }
 
 
-int Grid_hexGridNextWithRange(Grid *p_grid, int minAlive, int maxAlive, int minCreate, int maxCreate)
+/* Puts the ghost copies of the cells beyond the left and right edges of a
+ * row into its padding */
+static void fillRowHalo(Grid *p_grid, uint8_t *p_row)
 {
-    int iRow, iCol, iNeigh;
-    int prevRow, nextRow;
-    int prevCol, nextCol;
+    int last = p_grid->width_cells - 1;
+
+    switch (p_grid->boundary)
+    {
+        case GRID_BOUNDARY_DEAD:
+            p_row[-1] = GRID_DEAD;
+            p_row[last + 1] = GRID_DEAD;
+            break;
 
-    int neighbourLocations[GRID_HEX_NUM_NEIGHBOURS];
-    int aliveNeighbours;
-    int anySick;
+        case GRID_BOUNDARY_REFLECT:
+            p_row[-1] = p_row[0];
+            p_row[last + 1] = p_row[last];
+            break;
+
+        default:
+            p_row[-1] = p_row[last];
+            p_row[last + 1] = p_row[0];
+            break;
+    }
+}
 
-    int isStationary = TRUE;
+
+/* Ghost cells for every row of p_disp and the halo rows above and below */
+static void fillHalo(Grid *p_grid)
+{
+    int iRow;
 
     for (iRow = 0; iRow < p_grid->height_cells; iRow++)
     {
-        prevRow = iRow - 1;
-        if (prevRow < 0)
+        fillRowHalo(p_grid, p_grid->p_disp + (size_t) iRow * p_grid->stride_cells);
+    }
+    if (p_grid->p_haloAbove != NULL)
+    {
+        fillRowHalo(p_grid, p_grid->p_haloAbove);
+    }
+    if (p_grid->p_haloBelow != NULL)
+    {
+        fillRowHalo(p_grid, p_grid->p_haloBelow);
+    }
+}
+
+
+/* Back to dead padding once the step is done with p_disp */
+static void clearHalo(Grid *p_grid)
+{
+    int iRow;
+    uint8_t *p_row;
+
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        p_row = p_grid->p_disp + (size_t) iRow * p_grid->stride_cells;
+        p_row[-1] = GRID_DEAD;
+        p_row[p_grid->width_cells] = GRID_DEAD;
+    }
+}
+
+
+/* The row of p_disp, halo included, that stands in for row iRow, which may
+ * be one beyond either edge */
+static const uint8_t *haloRow(Grid *p_grid, int iRow)
+{
+    if (iRow < 0 && p_grid->p_haloAbove != NULL)
+    {
+        return p_grid->p_haloAbove;
+    }
+    if (iRow >= p_grid->height_cells && p_grid->p_haloBelow != NULL)
+    {
+        return p_grid->p_haloBelow;
+    }
+    if (iRow < 0 || iRow >= p_grid->height_cells)
+    {
+        switch (p_grid->boundary)
         {
-            prevRow += p_grid->height_cells;
+            case GRID_BOUNDARY_DEAD:
+                return p_grid->p_deadRow;
+
+            case GRID_BOUNDARY_REFLECT:
+                iRow = iRow < 0 ? 0 : p_grid->height_cells - 1;
+                break;
+
+            default:
+                iRow = iRow < 0 ? p_grid->height_cells - 1 : 0;
+                break;
         }
-        nextRow = iRow + 1;
-        if (nextRow >= p_grid->height_cells)
+    }
+
+    return p_grid->p_disp + (size_t) iRow * p_grid->stride_cells;
+}
+
+
+/* Changes made by one rectangle. Lives in registers once stepCell is
+ * inlined, which matters as the cell stores may alias anything. */
+typedef struct Grid_rectTally_struct {
+    uint64_t hashDelta;
+    int countDeltas[RULE_NUM_STATES];
+    int births;
+    int deaths;
+    int infections;
+    uint8_t changed;
+
+    /* OR of the row's new cells, and bit n set when column n of the tile has
+     * a non-dead cell */
+    uint8_t rowAlive;
+    uint32_t colMask;
+} Grid_rectTally;
+
+
+static inline void stepCell
+   (const Rule *p_rule, Grid_rectTally *p_tally,
+    uint8_t currValue, int neighbourSum, uint8_t *p_nextCell, int iCell, int tileCol)
+{
+    uint8_t nextValue = p_rule->table[currValue * RULE_NUM_SUMS + neighbourSum];
+
+    *p_nextCell = nextValue;
+    p_tally->changed |= currValue ^ nextValue;
+    if (currValue != nextValue)
+    {
+        p_tally->hashDelta ^= Grid_cellHash(iCell, currValue) ^ Grid_cellHash(iCell, nextValue);
+        p_tally->countDeltas[currValue]--;
+        p_tally->countDeltas[nextValue]++;
+        p_tally->births += currValue == GRID_DEAD;
+        p_tally->deaths += nextValue == GRID_DEAD;
+        p_tally->infections += currValue == GRID_DEAD && nextValue == GRID_SICK;
+    }
+
+    p_tally->colMask |= (uint32_t) (nextValue != GRID_DEAD) << tileCol;
+    p_tally->rowAlive |= nextValue;
+}
+
+
+/* Computes the cells in rows [rowStart, rowEnd) and columns [colStart, colEnd)
+ * of p_next from p_disp, adding the changes to p_result and writing the box
+ * of the new cells relative to the corner to p_box. Cells only read p_disp,
+ * so disjoint rectangles can be stepped concurrently. colStart must be even.
+ *
+ * The halo means every cell finds its neighbours at the same offsets, so
+ * columns are taken in even and odd pairs with no wrapping or bounds checks.
+ * Even columns sit half a cell lower than odd ones: an even cell's other
+ * neighbours are the one above it and three in the row below, an odd cell's
+ * three in the row above and the one below it. */
+static int stepRect
+   (Grid *p_grid, const Rule *p_rule,
+    int rowStart, int rowEnd, int colStart, int colEnd,
+    Grid_bandResult *p_result, uint8_t *p_box)
+{
+    const uint8_t *p_weight = Rule_neighbourWeight;
+    const uint8_t *p_above, *p_row, *p_below;
+    uint8_t *p_nextRow;
+    int iRow, iCol, iState;
+    int iCellRow;
+    int neighbourSum;
+    uint32_t rowMask = 0;
+    Grid_rectTally tally;
+
+    memset(&tally, 0, sizeof(tally));
+
+    for (iRow = rowStart; iRow < rowEnd; iRow++)
+    {
+        p_above = haloRow(p_grid, iRow - 1);
+        p_row = haloRow(p_grid, iRow);
+        p_below = haloRow(p_grid, iRow + 1);
+        p_nextRow = p_grid->p_next + (size_t) iRow * p_grid->stride_cells;
+        iCellRow = iRow * p_grid->width_cells;
+        tally.rowAlive = GRID_DEAD;
+
+        for (iCol = colStart; iCol + 1 < colEnd; iCol += 2)
+        {
+            neighbourSum = p_weight[p_row[iCol - 1]] + p_weight[p_above[iCol]] + p_weight[p_row[iCol + 1]]
+                         + p_weight[p_below[iCol - 1]] + p_weight[p_below[iCol]] + p_weight[p_below[iCol + 1]];
+            stepCell(p_rule, &tally, p_row[iCol], neighbourSum, &p_nextRow[iCol], iCellRow + iCol, iCol - colStart);
+
+            neighbourSum = p_weight[p_above[iCol]] + p_weight[p_above[iCol + 1]] + p_weight[p_above[iCol + 2]]
+                         + p_weight[p_row[iCol]] + p_weight[p_below[iCol + 1]] + p_weight[p_row[iCol + 2]];
+            stepCell(p_rule, &tally, p_row[iCol + 1], neighbourSum, &p_nextRow[iCol + 1], iCellRow + iCol + 1, iCol + 1 - colStart);
+        }
+        /* An odd width leaves one even column at the right edge */
+        if (iCol < colEnd)
         {
-            nextRow -= p_grid->height_cells;
+            neighbourSum = p_weight[p_row[iCol - 1]] + p_weight[p_above[iCol]] + p_weight[p_row[iCol + 1]]
+                         + p_weight[p_below[iCol - 1]] + p_weight[p_below[iCol]] + p_weight[p_below[iCol + 1]];
+            stepCell(p_rule, &tally, p_row[iCol], neighbourSum, &p_nextRow[iCol], iCellRow + iCol, iCol - colStart);
         }
 
-        for (iCol = 0; iCol < p_grid->width_cells; iCol++)
+        rowMask |= (uint32_t) (tally.rowAlive != GRID_DEAD) << (iRow - rowStart);
+    }
+
+    p_result->hashDelta ^= tally.hashDelta;
+    for (iState = 0; iState < RULE_NUM_STATES; iState++)
+    {
+        p_result->stats.counts[iState] += tally.countDeltas[iState];
+    }
+    p_result->stats.births += tally.births;
+    p_result->stats.deaths += tally.deaths;
+    p_result->stats.infections += tally.infections;
+
+    /* Tiles are 32 cells across, one bit per row or column */
+    if (rowMask == 0)
+    {
+        p_box[0] = GRID_TILE_SIZE_CELLS;
+        p_box[1] = 0;
+        p_box[2] = GRID_TILE_SIZE_CELLS;
+        p_box[3] = 0;
+    }
+    else
+    {
+        p_box[0] = (uint8_t) __builtin_ctz(rowMask);
+        p_box[1] = (uint8_t) (31 - __builtin_clz(rowMask));
+        p_box[2] = (uint8_t) __builtin_ctz(tally.colMask);
+        p_box[3] = (uint8_t) (31 - __builtin_clz(tally.colMask));
+    }
+
+    return tally.changed == 0 ? TRUE : FALSE;
+}
+
+
+/* A tile only needs stepping if it or one of the eight tiles around it
+ * changed last generation. Otherwise both buffers already hold the same
+ * cells for it and p_next can be left untouched. */
+static int isTileActive(Grid *p_grid, int tileRow, int tileCol)
+{
+    int iRowOffset, iColOffset;
+    int row, col;
+
+    for (iRowOffset = -1; iRowOffset <= 1; iRowOffset++)
+    {
+        row = (tileRow + iRowOffset + p_grid->tiles_y) % p_grid->tiles_y;
+        for (iColOffset = -1; iColOffset <= 1; iColOffset++)
         {
-            prevCol = iCol - 1;
-            if (prevCol < 0)
-            {
-                prevCol += p_grid->width_cells;
-            }
-            nextCol = iCol + 1;
-            if (nextCol >= p_grid->width_cells)
+            col = (tileCol + iColOffset + p_grid->tiles_x) % p_grid->tiles_x;
+            if (p_grid->p_tileChanged[row * p_grid->tiles_x + col] == TRUE)
             {
-                nextCol -= p_grid->width_cells;
+                return TRUE;
             }
+        }
+    }
 
-            /* Count alive neighbours */
-            if (iCol % 2 == 0)
-            {
-                neighbourLocations[0] = iRow    * p_grid->width_cells + prevCol;
-                neighbourLocations[1] = prevRow * p_grid->width_cells + iCol;
-                neighbourLocations[2] = iRow    * p_grid->width_cells + nextCol;
-                neighbourLocations[3] = nextRow * p_grid->width_cells + prevCol;
-                neighbourLocations[4] = nextRow * p_grid->width_cells + iCol;
-                neighbourLocations[5] = nextRow * p_grid->width_cells + nextCol;
-            }
-            else
-            {
-                neighbourLocations[0] = prevRow * p_grid->width_cells + prevCol;
-                neighbourLocations[1] = prevRow * p_grid->width_cells + iCol;
-                neighbourLocations[2] = prevRow * p_grid->width_cells + nextCol;
-                neighbourLocations[3] = iRow    * p_grid->width_cells + prevCol;
-                neighbourLocations[4] = nextRow * p_grid->width_cells + iCol;
-                neighbourLocations[5] = iRow    * p_grid->width_cells + nextCol;
-            }
+    return FALSE;
+}
+
+
+static void stepTileRows
+   (Grid *p_grid, const Rule *p_rule,
+    int tileRowStart, int tileRowEnd, Grid_bandResult *p_result)
+{
+    int iTileRow, iTileCol;
+    int rowStart, rowEnd, colStart, colEnd;
+    int tileStationary;
+    uint8_t *p_changed;
+    uint8_t *p_box;
+
+    p_result->isStationary = TRUE;
+    p_result->activeTiles = 0;
+    p_result->hashDelta = 0;
+    clearStats(&p_result->stats);
+
+    for (iTileRow = tileRowStart; iTileRow < tileRowEnd; iTileRow++)
+    {
+        rowStart = iTileRow * GRID_TILE_SIZE_CELLS;
+        rowEnd = rowStart + GRID_TILE_SIZE_CELLS;
+        if (rowEnd > p_grid->height_cells)
+        {
+            rowEnd = p_grid->height_cells;
+        }
 
-            aliveNeighbours = 0;
-            anySick = FALSE;
-            for (iNeigh = 0; iNeigh < GRID_HEX_NUM_NEIGHBOURS; iNeigh++)
+        for (iTileCol = 0; iTileCol < p_grid->tiles_x; iTileCol++)
+        {
+            p_changed = &p_grid->p_tileChangedNext[iTileRow * p_grid->tiles_x + iTileCol];
+            *p_changed = FALSE;
+            p_box = &p_grid->p_tileBoxes[(iTileRow * p_grid->tiles_x + iTileCol) * GRID_TILE_BOX_BYTES];
+
+            colStart = iTileCol * GRID_TILE_SIZE_CELLS;
+            colEnd = colStart + GRID_TILE_SIZE_CELLS;
+            if (colEnd > p_grid->width_cells)
             {
-                if (p_grid->p_disp[neighbourLocations[iNeigh]] != GRID_DEAD)
-                {
-                    aliveNeighbours++;
-                    if (p_grid->p_disp[neighbourLocations[iNeigh]] == GRID_SICK)
-                    {
-                        anySick = TRUE;
-                    }
-                }
+                colEnd = p_grid->width_cells;
             }
 
-            /* Update next grid */
-            Grid_setNextValue(p_grid, iRow, iCol, Grid_getDispValue(p_grid, iRow, iCol));
-            if (Grid_getDispValue(p_grid, iRow, iCol) == GRID_ALIVE
-             || Grid_getDispValue(p_grid, iRow, iCol) == GRID_SICK)
+            /* A skipped tile keeps the box it had */
+            if (isTileActive(p_grid, iTileRow, iTileCol) == TRUE)
             {
-                if (aliveNeighbours < minAlive || aliveNeighbours > maxAlive)
+                tileStationary = stepRect(p_grid, p_rule, rowStart, rowEnd, colStart, colEnd, p_result, p_box);
+                if (tileStationary == FALSE)
                 {
-                    Grid_setNextValue(p_grid, iRow, iCol, GRID_DEAD);
-                    isStationary = FALSE;
+                    *p_changed = TRUE;
+                    p_result->isStationary = FALSE;
                 }
+                p_result->activeTiles++;
             }
-            else if (Grid_getDispValue(p_grid, iRow, iCol) == GRID_DEAD)
+
+            if (p_box[0] <= p_box[1])
             {
-                if (aliveNeighbours >= minCreate && aliveNeighbours <= maxCreate)
-                {
-                    isStationary = FALSE;
-                    if (anySick == TRUE)
-                    {
-                        Grid_setNextValue(p_grid, iRow, iCol, GRID_SICK);
-                    }
-                    else
-                    {
-                        Grid_setNextValue(p_grid, iRow, iCol, GRID_ALIVE);
-                    }
-                }
+                growBox(&p_result->stats, rowStart + p_box[0], rowStart + p_box[1], colStart + p_box[2], colStart + p_box[3]);
             }
         }
     }
+}
+
+
+static void swapBuffers(Grid *p_grid)
+{
+    uint8_t *p_swap;
 
     if (p_grid->p_disp == p_grid->p_data1)
     {
@@ -191,78 +791,391 @@ int Grid_hexGridNextWithRange(Grid *p_grid, int minAlive, int maxAlive, int minC
         p_grid->p_next = p_grid->p_data2;
     }
 
+    p_swap = p_grid->p_tileChanged;
+    p_grid->p_tileChanged = p_grid->p_tileChangedNext;
+    p_grid->p_tileChangedNext = p_swap;
+}
+
+
+int Grid_hexGridNextWithRule(Grid *p_grid, const Rule *p_rule)
+{
+    Grid_bandResult result;
+    uint64_t profile_ns = Profile_begin();
+
+    fillHalo(p_grid);
+    stepTileRows(p_grid, p_rule, 0, p_grid->tiles_y, &result);
+    clearHalo(p_grid);
+
+    p_grid->active_tiles = result.activeTiles;
+    p_grid->skipped_tiles = p_grid->tiles_x * p_grid->tiles_y - result.activeTiles;
+    p_grid->hash ^= result.hashDelta;
+    p_grid->generation++;
+    applyStepStats(p_grid, &result.stats);
+
+    swapBuffers(p_grid);
+    Profile_end(PROFILE_ZONE_STEP, profile_ns);
+
+    return result.isStationary;
+}
+
+
+int Grid_hexGridNextWithRange(Grid *p_grid, int minAlive, int maxAlive, int minCreate, int maxCreate)
+{
+    Rule rule = Rule_fromRange(minAlive, maxAlive, minCreate, maxCreate);
+
+    return Grid_hexGridNextWithRule(p_grid, &rule);
+}
+
+
+static void stepBandTask(void *p_ctx, int iBand)
+{
+    Grid_bandJob *p_job = p_ctx;
+    int tiles_y = p_job->p_grid->tiles_y;
+    uint64_t profile_ns = Profile_begin();
+
+    stepTileRows
+       (p_job->p_grid, p_job->p_rule,
+        tiles_y * iBand / p_job->numBands,
+        tiles_y * (iBand + 1) / p_job->numBands,
+        &p_job->p_bandResults[iBand]);
+    Profile_end(PROFILE_ZONE_STEP_BAND, profile_ns);
+}
+
+
+int Grid_hexGridNextWithRuleParallel(Grid *p_grid, Pool *p_pool, const Rule *p_rule)
+{
+    Grid_bandJob job;
+    Grid_bandResult bandResults[GRID_MAX_BANDS];
+    int iBand;
+    int isStationary = TRUE;
+    int activeTiles = 0;
+    uint64_t hashDelta = 0;
+    Grid_stats stats;
+    uint64_t profile_ns = Profile_begin();
+
+    job.p_grid = p_grid;
+    job.p_rule = p_rule;
+    job.p_bandResults = bandResults;
+
+    /* One band of tile rows per thread, each band writes its result once */
+    job.numBands = p_pool->num_threads;
+    if (job.numBands > GRID_MAX_BANDS)
+    {
+        job.numBands = GRID_MAX_BANDS;
+    }
+    if (job.numBands > p_grid->tiles_y)
+    {
+        job.numBands = p_grid->tiles_y;
+    }
+
+    fillHalo(p_grid);
+    Pool_run(p_pool, stepBandTask, &job, job.numBands);
+    clearHalo(p_grid);
+
+    clearStats(&stats);
+    for (iBand = 0; iBand < job.numBands; iBand++)
+    {
+        isStationary = isStationary && bandResults[iBand].isStationary;
+        activeTiles += bandResults[iBand].activeTiles;
+        hashDelta ^= bandResults[iBand].hashDelta;
+        mergeStats(&stats, &bandResults[iBand].stats);
+    }
+
+    p_grid->active_tiles = activeTiles;
+    p_grid->skipped_tiles = p_grid->tiles_x * p_grid->tiles_y - activeTiles;
+    p_grid->hash ^= hashDelta;
+    p_grid->generation++;
+    applyStepStats(p_grid, &stats);
+
+    swapBuffers(p_grid);
+    Profile_end(PROFILE_ZONE_STEP, profile_ns);
+
     return isStationary;
 }
 
 
-void Grid_changeCell(Grid *p_grid, int mouse_xpos_px, int mouse_ypos_px, int cellState)
+int Grid_hexGridNextWithRangeParallel(Grid *p_grid, Pool *p_pool, int minAlive, int maxAlive, int minCreate, int maxCreate)
 {
-    int rowCell, colCell;
-    colCell = (mouse_xpos_px - (GRID_CELL_WIDTH - GRID_X_STEP_PX) / 2  - GRID_X_POSITION_PX) / GRID_X_STEP_PX + GRID_X_RENDER_OFFSET_CELLS;
+    Rule rule = Rule_fromRange(minAlive, maxAlive, minCreate, maxCreate);
 
-    if (colCell % 2 == 0)
+    return Grid_hexGridNextWithRuleParallel(p_grid, p_pool, &rule);
+}
+
+
+void Grid_markAllTilesChanged(Grid *p_grid)
+{
+    memset(p_grid->p_tileChanged, TRUE, p_grid->tiles_x * p_grid->tiles_y);
+}
+
+
+void Grid_markRowChanged(Grid *p_grid, int iRow)
+{
+    memset(p_grid->p_tileChanged + (iRow / GRID_TILE_SIZE_CELLS) * p_grid->tiles_x, TRUE, p_grid->tiles_x);
+}
+
+
+uint64_t Grid_cellHash(int iCell, uint8_t value)
+{
+    /* Dead cells hash to 0 so an empty grid hashes to 0 whatever its size */
+    if (value == GRID_DEAD)
     {
-        rowCell = (mouse_ypos_px - GRID_CELL_HEIGHT / 2 - GRID_Y_POSITION_PX) / GRID_Y_STEP_PX + GRID_Y_RENDER_OFFSET_CELLS;
+        return 0;
     }
-    else
+
+    return mix64(((uint64_t) iCell << 2) | value);
+}
+
+
+uint64_t Grid_computeHash(Grid *p_grid)
+{
+    int iRow, iCol;
+    uint64_t hash = 0;
+
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_grid->width_cells; iCol++)
+        {
+            hash ^= Grid_cellHash(iRow * p_grid->width_cells + iCol, Grid_getDispValue(p_grid, iRow, iCol));
+        }
+    }
+
+    return hash;
+}
+
+
+void Grid_syncDisp(Grid *p_grid)
+{
+    Grid_markAllTilesChanged(p_grid);
+    p_grid->hash = Grid_computeHash(p_grid);
+    Grid_computeStats(p_grid);
+}
+
+
+void Grid_computeStats(Grid *p_grid)
+{
+    int iRow, iCol;
+    int minCol, maxCol;
+    uint8_t *p_row;
+    uint8_t value;
+
+    clearStats(&p_grid->stats);
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        p_row = p_grid->p_disp + (size_t) iRow * p_grid->stride_cells;
+        minCol = INT_MAX;
+        maxCol = -1;
+        for (iCol = 0; iCol < p_grid->width_cells; iCol++)
+        {
+            value = p_row[iCol];
+            p_grid->stats.counts[value]++;
+            if (value != GRID_DEAD)
+            {
+                if (minCol == INT_MAX)
+                {
+                    minCol = iCol;
+                }
+                maxCol = iCol;
+            }
+        }
+        if (maxCol >= 0)
+        {
+            growBox(&p_grid->stats, iRow, iRow, minCol, maxCol);
+        }
+    }
+}
+
+
+int Grid_countPopulation(Grid *p_grid)
+{
+    return p_grid->width_cells * p_grid->height_cells - p_grid->stats.counts[GRID_DEAD];
+}
+
+
+Grid_view Grid_viewFor(int width_cells, int height_cells)
+{
+    Grid_view view;
+    int numCols = width_cells < GRID_X_RENDER_MAX_CELLS ? width_cells : GRID_X_RENDER_MAX_CELLS;
+    int numRows = height_cells < GRID_Y_RENDER_MAX_CELLS ? height_cells : GRID_Y_RENDER_MAX_CELLS;
+    int firstCol = (width_cells - numCols) / 2;
+    int firstRow = (height_cells - numRows) / 2;
+
+    /* The first column drawn sits at the top left of the viewport */
+    view.zoom = 1.0;
+    view.origin_x_px = GRID_X_POSITION_PX - firstCol * GRID_X_STEP_PX;
+    view.origin_y_px = GRID_Y_POSITION_PX - firstRow * GRID_Y_STEP_PX - (firstCol % 2 == 0 ? GRID_Y_OFFSET_ROW_PX : 0);
+
+    return view;
+}
+
+
+static double fitZoom(int width_cells, int height_cells)
+{
+    double zoomX = (double) GRID_VIEWPORT_WIDTH_PX / ((double) width_cells * GRID_X_STEP_PX + GRID_CELL_WIDTH - GRID_X_STEP_PX);
+    double zoomY = (double) GRID_VIEWPORT_HEIGHT_PX / ((double) height_cells * GRID_Y_STEP_PX + GRID_Y_OFFSET_ROW_PX);
+
+    return zoomX < zoomY ? zoomX : zoomY;
+}
+
+
+Grid_view Grid_viewFit(int width_cells, int height_cells)
+{
+    Grid_view view;
+
+    view.zoom = fitZoom(width_cells, height_cells);
+    if (view.zoom > GRID_MAX_ZOOM)
     {
-        rowCell = (mouse_ypos_px + GRID_Y_OFFSET_ROW_PX - GRID_CELL_HEIGHT / 2 - GRID_Y_POSITION_PX) / GRID_Y_STEP_PX + GRID_Y_RENDER_OFFSET_CELLS;
+        view.zoom = GRID_MAX_ZOOM;
     }
+    view.origin_x_px = GRID_X_POSITION_PX
+        + (GRID_VIEWPORT_WIDTH_PX - view.zoom * ((double) width_cells * GRID_X_STEP_PX + GRID_CELL_WIDTH - GRID_X_STEP_PX)) / 2;
+    view.origin_y_px = GRID_Y_POSITION_PX
+        + (GRID_VIEWPORT_HEIGHT_PX - view.zoom * ((double) height_cells * GRID_Y_STEP_PX + GRID_Y_OFFSET_ROW_PX)) / 2;
 
-    Grid_setDispValue(p_grid, rowCell, colCell, cellState);
+    return view;
 }
 
 
-uint8_t Grid_getDispValueFromMouse(Grid *p_grid, int mouse_xpos_px, int mouse_ypos_px)
+void Grid_zoomView(Grid_view *p_view, int width_cells, int height_cells, double factor, double x_px, double y_px)
 {
+    double minZoom = fitZoom(width_cells, height_cells) / 2;
+    double zoom = p_view->zoom * factor;
+
+    if (minZoom > 1.0)
+    {
+        minZoom = 1.0;
+    }
+    if (zoom < minZoom)
+    {
+        zoom = minZoom;
+    }
+    if (zoom > GRID_MAX_ZOOM)
+    {
+        zoom = GRID_MAX_ZOOM;
+    }
+
+    p_view->origin_x_px = x_px - (x_px - p_view->origin_x_px) * zoom / p_view->zoom;
+    p_view->origin_y_px = y_px - (y_px - p_view->origin_y_px) * zoom / p_view->zoom;
+    p_view->zoom = zoom;
+}
+
+
+/* Rounds down rather than towards zero, for points left of or above the grid */
+static int floorToInt(double value)
+{
+    int truncated = (int) value;
+
+    return (double) truncated > value ? truncated - 1 : truncated;
+}
+
+
+void Grid_mouseToCell(const Grid_view *p_view, int mouse_xpos_px, int mouse_ypos_px, int *p_row, int *p_col)
+{
+    double world_x_px = (mouse_xpos_px - p_view->origin_x_px) / p_view->zoom;
+    double world_y_px = (mouse_ypos_px - p_view->origin_y_px) / p_view->zoom;
     int rowCell, colCell;
-    colCell = (mouse_xpos_px - (GRID_CELL_WIDTH - GRID_X_STEP_PX) / 2  - GRID_X_POSITION_PX) / GRID_X_STEP_PX + GRID_X_RENDER_OFFSET_CELLS;
+
+    /* Neighbouring columns overlap, split the overlap between them */
+    colCell = floorToInt((world_x_px - (GRID_CELL_WIDTH - GRID_X_STEP_PX) / 2) / GRID_X_STEP_PX);
 
     if (colCell % 2 == 0)
     {
-        rowCell = (mouse_ypos_px - GRID_CELL_HEIGHT / 2 - GRID_Y_POSITION_PX) / GRID_Y_STEP_PX + GRID_Y_RENDER_OFFSET_CELLS;
+        world_y_px -= GRID_Y_OFFSET_ROW_PX;
     }
-    else
+    rowCell = floorToInt((world_y_px + GRID_Y_OFFSET_ROW_PX - GRID_CELL_HEIGHT / 2) / GRID_Y_STEP_PX);
+
+    *p_row = rowCell;
+    *p_col = colCell;
+}
+
+
+void Grid_changeCell(Grid *p_grid, const Grid_view *p_view, int mouse_xpos_px, int mouse_ypos_px, int cellState)
+{
+    int rowCell, colCell;
+
+    Grid_mouseToCell(p_view, mouse_xpos_px, mouse_ypos_px, &rowCell, &colCell);
+    if (rowCell >= 0 && rowCell < p_grid->height_cells && colCell >= 0 && colCell < p_grid->width_cells)
     {
-        rowCell = (mouse_ypos_px + GRID_Y_OFFSET_ROW_PX - GRID_CELL_HEIGHT / 2 - GRID_Y_POSITION_PX) / GRID_Y_STEP_PX + GRID_Y_RENDER_OFFSET_CELLS;
+        Grid_setDispValue(p_grid, rowCell, colCell, cellState);
     }
+}
 
+
+uint8_t Grid_getDispValueFromMouse(Grid *p_grid, const Grid_view *p_view, int mouse_xpos_px, int mouse_ypos_px)
+{
+    int rowCell, colCell;
+
+    Grid_mouseToCell(p_view, mouse_xpos_px, mouse_ypos_px, &rowCell, &colCell);
+    if (rowCell < 0 || rowCell >= p_grid->height_cells || colCell < 0 || colCell >= p_grid->width_cells)
+    {
+        return GRID_DEAD;
+    }
     return Grid_getDispValue(p_grid, rowCell, colCell);
 }
 
 
 uint8_t Grid_getDispValue(Grid *p_grid, int row, int col)
 {
-    return p_grid->p_disp[row * p_grid->width_cells + col];
+    return p_grid->p_disp[row * p_grid->stride_cells + col];
 }
 
 
 uint8_t Grid_getNextValue(Grid *p_grid, int row, int col)
 {
-    return p_grid->p_next[row * p_grid->width_cells + col];
+    return p_grid->p_next[row * p_grid->stride_cells + col];
 }
 
 
 void Grid_setDispValue(Grid *p_grid, int row, int col, uint8_t value)
 {
-    p_grid->p_disp[row * p_grid->width_cells + col] = value;
+    int iCell = row * p_grid->width_cells + col;
+    uint8_t *p_cell = &p_grid->p_disp[row * p_grid->stride_cells + col];
+
+    p_grid->hash ^= Grid_cellHash(iCell, *p_cell) ^ Grid_cellHash(iCell, value);
+    p_grid->stats.counts[*p_cell]--;
+    p_grid->stats.counts[value]++;
+    if (value != GRID_DEAD)
+    {
+        growBox(&p_grid->stats, row, row, col, col);
+    }
+    *p_cell = value;
+    p_grid->p_tileChanged[(row / GRID_TILE_SIZE_CELLS) * p_grid->tiles_x + col / GRID_TILE_SIZE_CELLS] = TRUE;
 }
 
 
 void Grid_setNextValue(Grid *p_grid, int row, int col, uint8_t value)
 {
-    p_grid->p_next[row * p_grid->width_cells + col] = value;
+    p_grid->p_next[row * p_grid->stride_cells + col] = value;
 }
 
 
 void Grid_destroy(Grid *p_grid)
 {
-    free(p_grid->p_data1);
-    free(p_grid->p_data2);
+    if (p_grid->p_mapping != NULL)
+    {
+        munmap(p_grid->p_mapping, p_grid->mapping_bytes);
+    }
+    free(p_grid->p_arena);
+    free(p_grid->p_tileChanged);
+    free(p_grid->p_tileChangedNext);
+    free(p_grid->p_tileBoxes);
+    if (p_grid->p_deadRow != NULL)
+    {
+        free(p_grid->p_deadRow - GRID_HALO_CELLS);
+    }
 
+    p_grid->p_tileChanged = NULL;
+    p_grid->p_tileChangedNext = NULL;
+    p_grid->p_tileBoxes = NULL;
+    p_grid->p_deadRow = NULL;
     p_grid->p_disp = NULL;
     p_grid->p_next = NULL;
+    p_grid->p_data1 = NULL;
+    p_grid->p_data2 = NULL;
+    p_grid->p_arena = NULL;
+    p_grid->p_mapping = NULL;
+    p_grid->mapping_bytes = 0;
 
     p_grid->width_cells = 0;
     p_grid->height_cells = 0;
+    p_grid->stride_cells = 0;
 }
\ No newline at end of file
@@ -3,8 +3,11 @@
 
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include "bool.h"
+#include "pool.h"
+#include "rule.h"
 
 
 #define GRID_DEAD  (0)
@@ -14,49 +17,210 @@
 
 #define GRID_HEX_NUM_NEIGHBOURS (6)
 
+#define GRID_TILE_SIZE_CELLS  (32)
+
+/* Fraction of cells Grid_resetGrid makes alive unless told otherwise */
+#define GRID_DEFAULT_DENSITY  (0.25)
+
+/* Rows are padded to a whole number of cache lines so vector kernels can load
+ * any row without a scalar tail, and the buffers start on a page */
+#define GRID_ROW_ALIGN_CELLS    (64)
+#define GRID_ARENA_ALIGN_BYTES  (4096)
+
+/* While stepping, the padding holds a ghost copy of the cell beyond each end
+ * of the row: column width_cells after it, and column -1 in the last padding
+ * cell of the row before, so rows are padded by at least two cells */
+#define GRID_HALO_CELLS  (1)
+
+/* What the cells beyond the edges of the grid hold */
+#define GRID_BOUNDARY_TORUS    (0)  /* the opposite edge, wrapping around */
+#define GRID_BOUNDARY_DEAD     (1)  /* dead cells */
+#define GRID_BOUNDARY_REFLECT  (2)  /* the edge cell next to them */
+#define GRID_NUM_BOUNDARIES    (3)
+
 #define GRID_CELL_WIDTH       (24)
 #define GRID_CELL_HEIGHT      (23)
 #define GRID_X_STEP_PX        (19)
 #define GRID_Y_STEP_PX        (24)
 #define GRID_Y_OFFSET_ROW_PX  (12)
 
-#define GRID_X_POSITION_PX          (64)
-#define GRID_Y_POSITION_PX          (64)
-#define GRID_X_RENDER_OFFSET_CELLS  (27)
-#define GRID_Y_RENDER_OFFSET_CELLS  (32)
-#define GRID_X_RENDER_NUM_CELLS     (46)
-#define GRID_Y_RENDER_NUM_CELLS     (36)
+/* Screen area the grid is drawn in, GRID_*_RENDER_MAX_CELLS at full size */
+#define GRID_X_POSITION_PX       (64)
+#define GRID_Y_POSITION_PX       (64)
+#define GRID_X_RENDER_MAX_CELLS  (46)
+#define GRID_Y_RENDER_MAX_CELLS  (36)
+#define GRID_VIEWPORT_WIDTH_PX   (GRID_X_RENDER_MAX_CELLS * GRID_X_STEP_PX + GRID_CELL_WIDTH - GRID_X_STEP_PX)
+#define GRID_VIEWPORT_HEIGHT_PX  (GRID_Y_RENDER_MAX_CELLS * GRID_Y_STEP_PX + GRID_Y_OFFSET_ROW_PX)
+
+#define GRID_MAX_ZOOM  (4.0)
+
+
+/* Telemetry for the grid as it stands, gathered by the step itself from the
+ * cells it writes */
+typedef struct Grid_stats_struct {
+    /* Cells in each state */
+    int counts[RULE_NUM_STATES];
 
+    /* Changes made by the last step. A birth is a dead cell coming to life,
+     * an infection is a birth of a sick cell. */
+    int births;
+    int deaths;
+    int infections;
+
+    /* Smallest rectangle holding every non-dead cell, min_row > max_row when
+     * there are none. Edits can only grow it until the next step. */
+    int min_row;
+    int max_row;
+    int min_col;
+    int max_col;
+} Grid_stats;
 
 
 typedef struct Grid_struct {
-    /* Main memory buffers */
+    /* Main memory buffers, both inside p_arena unless p_data1 is mapped */
     uint8_t *p_data1;
     uint8_t *p_data2;
+    uint8_t *p_arena;
+
+    /* Set when p_data1 lives in a file mapping rather than on the heap */
+    void *p_mapping;
+    size_t mapping_bytes;
 
     /* Pointers to the data to be displayed */
     uint8_t *p_disp;
     uint8_t *p_next;
 
-    /* Size for the grid */
+    /* Size for the grid. Cell (row, col) is at row * stride_cells + col and
+     * the cells past width_cells in each row are dead outside of a step. */
     int width_cells;
     int height_cells;
+    int stride_cells;
+
+    /* One of GRID_BOUNDARY_*, and a dead row with its halo to stand in for
+     * the rows beyond the edges when they are dead */
+    int boundary;
+    uint8_t *p_deadRow;
+
+    /* Rows standing in for the ones beyond the top and bottom edges instead
+     * of the boundary, as for a slab of a larger grid. Each is stride_cells
+     * long with a cell of halo before it, owned by whoever sets it, and NULL
+     * unless set. */
+    uint8_t *p_haloAbove;
+    uint8_t *p_haloBelow;
+
+    /* Tiles that changed in the last step, only those and their neighbours
+     * are stepped next time */
+    uint8_t *p_tileChanged;
+    uint8_t *p_tileChangedNext;
+    int tiles_x;
+    int tiles_y;
+
+    /* Tiles stepped and skipped in the last step */
+    int active_tiles;
+    int skipped_tiles;
+
+    /* Rows then columns, first and last, of the non-dead cells in each tile
+     * relative to its corner. Only tiles that are stepped change. */
+    uint8_t *p_tileBoxes;
+
+    Grid_stats stats;
+
+    /* XOR of Grid_cellHash over p_disp, kept up to date by every step */
+    uint64_t hash;
+    uint64_t generation;
 } Grid;
 
 
+/* Camera over the grid. The top left of cell (row, col) is drawn at
+ *   x = origin_x_px + zoom * col * GRID_X_STEP_PX
+ *   y = origin_y_px + zoom * (row * GRID_Y_STEP_PX + GRID_Y_OFFSET_ROW_PX if col is even)
+ * and the cell is zoom times its sprite size. */
+typedef struct Grid_view_struct {
+    double origin_x_px;
+    double origin_y_px;
+    double zoom;
+} Grid_view;
+
+
+/* Every pointer is left NULL on failure, after printing why */
 extern Grid Grid_create(int width_cells, int height_cells);
 
-extern void Grid_resetGrid(Grid *p_grid);
+/* Uses p_cells, which lies inside a mapping of mappingBytes bytes at
+ * p_mapping, as p_data1 instead of allocating it. Grid_destroy unmaps it. */
+extern Grid Grid_createMapped(int width_cells, int height_cells, uint8_t *p_cells, void *p_mapping, size_t mappingBytes);
+
+/* Row length in cells, padding included, of a grid width_cells wide */
+extern int Grid_strideFor(int width_cells);
+
+/* Grids start as a torus. Changing the boundary marks every tile changed. */
+extern void Grid_setBoundary(Grid *p_grid, int boundary);
+
+extern const char *Grid_boundaryName(int boundary);
+
+/* Accepts the names Grid_boundaryName gives */
+extern int Grid_parseBoundary(const char *p_name, int *p_boundary);
+
+/* Random soup with the given fraction of cells alive. Each group of four
+ * cells draws from a counter based generator keyed on the seed and the
+ * group's position, so a seed always gives the same grid. */
+extern void Grid_resetGrid(Grid *p_grid, uint64_t seed, double density);
+
+/* Same grid as Grid_resetGrid, with the rows split over the pool */
+extern void Grid_resetGridParallel(Grid *p_grid, Pool *p_pool, uint64_t seed, double density);
 
 extern void Grid_clearGrid(Grid *p_grid);
 
 extern void Grid_fillGrid(Grid *p_grid);
 
+extern int Grid_hexGridNextWithRule(Grid *p_grid, const Rule *p_rule);
+
 extern int Grid_hexGridNextWithRange(Grid *p_grid, int minAlive, int maxAlive, int minCreate, int maxCreate);
 
-extern void Grid_changeCell(Grid *p_grid, int mouse_xpos_px, int mouse_ypos_px, int cellState);
+/* Same result as Grid_hexGridNextWithRule, with the rows split into one band
+ * per pool thread */
+extern int Grid_hexGridNextWithRuleParallel(Grid *p_grid, Pool *p_pool, const Rule *p_rule);
+
+extern int Grid_hexGridNextWithRangeParallel(Grid *p_grid, Pool *p_pool, int minAlive, int maxAlive, int minCreate, int maxCreate);
+
+/* Forces every tile to be stepped next time */
+extern void Grid_markAllTilesChanged(Grid *p_grid);
+
+/* Forces the tiles holding row iRow, and those next to them, to be stepped
+ * next time, as when the halo row beside them changes */
+extern void Grid_markRowChanged(Grid *p_grid, int iRow);
+
+/* Zobrist style hash of one cell, 0 for dead cells */
+extern uint64_t Grid_cellHash(int iCell, uint8_t value);
+
+extern uint64_t Grid_computeHash(Grid *p_grid);
+
+/* Needed after writing p_disp directly instead of through Grid_setDispValue,
+ * marks every tile changed and recomputes the hash and stats */
+extern void Grid_syncDisp(Grid *p_grid);
+
+/* Recounts the stats from p_disp, with no births or deaths */
+extern void Grid_computeStats(Grid *p_grid);
+
+/* Non-dead cells, from the stats */
+extern int Grid_countPopulation(Grid *p_grid);
+
+/* Full size view of the middle of the grid */
+extern Grid_view Grid_viewFor(int width_cells, int height_cells);
+
+/* Whole grid centred in the viewport */
+extern Grid_view Grid_viewFit(int width_cells, int height_cells);
+
+/* Scales the zoom by factor, keeping the point under (x_px, y_px) still.
+ * The zoom stays between GRID_MAX_ZOOM and half what fits the whole grid. */
+extern void Grid_zoomView(Grid_view *p_view, int width_cells, int height_cells, double factor, double x_px, double y_px);
+
+/* Row and column of the rendered cell under a point, which may be off the grid */
+extern void Grid_mouseToCell(const Grid_view *p_view, int mouse_xpos_px, int mouse_ypos_px, int *p_row, int *p_col);
+
+extern void Grid_changeCell(Grid *p_grid, const Grid_view *p_view, int mouse_xpos_px, int mouse_ypos_px, int cellState);
 
-extern uint8_t Grid_getDispValueFromMouse(Grid *p_grid, int mouse_xpos_px, int mouse_ypos_px);
+/* GRID_DEAD off the grid */
+extern uint8_t Grid_getDispValueFromMouse(Grid *p_grid, const Grid_view *p_view, int mouse_xpos_px, int mouse_ypos_px);
 
 extern uint8_t Grid_getDispValue(Grid *p_grid, int row, int col);
 
@@ -0,0 +1,750 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashlife.h"
+
+
+#define HASHLIFE_BLOCK_NODES         (16384)
+#define HASHLIFE_INITIAL_TABLE_SIZE  (1 << 16)
+
+/* Smallest node whose result can be computed directly, 4x4 cells */
+#define HASHLIFE_BASE_LEVEL  (2)
+
+/* Marks a node whose p_result points at its copy during garbage collection */
+#define HASHLIFE_FORWARDED   (-2)
+#define HASHLIFE_NO_RESULT   (-1)
+
+
+struct HashLife_node_struct {
+    /* Children, all NULL for leaves */
+    HashLife_node *p_nw;
+    HashLife_node *p_ne;
+    HashLife_node *p_sw;
+    HashLife_node *p_se;
+
+    /* Memoised centre after 2^resultLog2Step generations */
+    HashLife_node *p_result;
+    int resultLog2Step;
+
+    HashLife_node *p_hashNext;
+
+    uint64_t population;
+    int level;
+    uint8_t state;
+};
+
+
+struct HashLife_block_struct {
+    HashLife_block *p_next;
+    int used;
+    HashLife_node nodes[HASHLIFE_BLOCK_NODES];
+};
+
+
+/* Offsets (dx, dy) of the six neighbours on the skewed lattice */
+static const int neighbourOffsets[GRID_HEX_NUM_NEIGHBOURS][2] =
+{
+    { -1,  0 }, { 1,  0 },
+    {  0, -1 }, { 0,  1 },
+    {  1, -1 }, { -1, 1 }
+};
+
+
+static HashLife_node *allocNode(HashLife *p_hashLife)
+{
+    HashLife_block *p_block = p_hashLife->p_blocks;
+
+    if (p_block == NULL || p_block->used == HASHLIFE_BLOCK_NODES)
+    {
+        /* Callers report the failure once it has unwound */
+        p_block = malloc(sizeof(HashLife_block));
+        if (p_block == NULL)
+        {
+            return NULL;
+        }
+        p_block->used = 0;
+        p_block->p_next = p_hashLife->p_blocks;
+        p_hashLife->p_blocks = p_block;
+    }
+
+    return &p_block->nodes[p_block->used++];
+}
+
+
+static size_t hashChildren(HashLife_node *p_nw, HashLife_node *p_ne, HashLife_node *p_sw, HashLife_node *p_se)
+{
+    uint64_t hash;
+
+    hash = (uint64_t) (uintptr_t) p_nw;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (uint64_t) (uintptr_t) p_ne;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (uint64_t) (uintptr_t) p_sw;
+    hash = hash * 0x9E3779B97F4A7C15ULL + (uint64_t) (uintptr_t) p_se;
+
+    return (size_t) (hash ^ (hash >> 29));
+}
+
+
+static void growTable(HashLife *p_hashLife)
+{
+    HashLife_node **p_newTable;
+    HashLife_node *p_node, *p_next;
+    size_t newSize = p_hashLife->table_size * 2;
+    size_t iSlot, newSlot;
+
+    p_newTable = calloc(newSize, sizeof(HashLife_node *));
+    if (p_newTable == NULL)
+    {
+        /* Longer chains, still correct */
+        return;
+    }
+
+    for (iSlot = 0; iSlot < p_hashLife->table_size; iSlot++)
+    {
+        for (p_node = p_hashLife->p_table[iSlot]; p_node != NULL; p_node = p_next)
+        {
+            p_next = p_node->p_hashNext;
+            newSlot = hashChildren(p_node->p_nw, p_node->p_ne, p_node->p_sw, p_node->p_se) & (newSize - 1);
+            p_node->p_hashNext = p_newTable[newSlot];
+            p_newTable[newSlot] = p_node;
+        }
+    }
+
+    free(p_hashLife->p_table);
+    p_hashLife->p_table = p_newTable;
+    p_hashLife->table_size = newSize;
+}
+
+
+/* Returns the unique node with these four children, or NULL when out of memory */
+static HashLife_node *join(HashLife *p_hashLife, HashLife_node *p_nw, HashLife_node *p_ne, HashLife_node *p_sw, HashLife_node *p_se)
+{
+    size_t slot = hashChildren(p_nw, p_ne, p_sw, p_se) & (p_hashLife->table_size - 1);
+    HashLife_node *p_node;
+
+    for (p_node = p_hashLife->p_table[slot]; p_node != NULL; p_node = p_node->p_hashNext)
+    {
+        if (p_node->p_nw == p_nw && p_node->p_ne == p_ne && p_node->p_sw == p_sw && p_node->p_se == p_se)
+        {
+            return p_node;
+        }
+    }
+
+    p_node = allocNode(p_hashLife);
+    if (p_node == NULL)
+    {
+        return NULL;
+    }
+
+    p_node->p_nw = p_nw;
+    p_node->p_ne = p_ne;
+    p_node->p_sw = p_sw;
+    p_node->p_se = p_se;
+    p_node->p_result = NULL;
+    p_node->resultLog2Step = HASHLIFE_NO_RESULT;
+    p_node->population = p_nw->population + p_ne->population + p_sw->population + p_se->population;
+    p_node->level = p_nw->level + 1;
+    p_node->state = GRID_DEAD;
+
+    p_node->p_hashNext = p_hashLife->p_table[slot];
+    p_hashLife->p_table[slot] = p_node;
+    p_hashLife->num_nodes++;
+
+    if (p_hashLife->num_nodes > p_hashLife->table_size / 4 * 3)
+    {
+        growTable(p_hashLife);
+    }
+
+    return p_node;
+}
+
+
+static HashLife_node *getEmpty(HashLife *p_hashLife, int level)
+{
+    HashLife_node *p_child;
+
+    if (p_hashLife->p_empty[level] == NULL)
+    {
+        p_child = getEmpty(p_hashLife, level - 1);
+        if (p_child == NULL)
+        {
+            return NULL;
+        }
+        p_hashLife->p_empty[level] = join(p_hashLife, p_child, p_child, p_child, p_child);
+    }
+
+    return p_hashLife->p_empty[level];
+}
+
+
+/* Sub-nodes one level down centred on a node or on the seam between two */
+static HashLife_node *centre(HashLife *p_hashLife, HashLife_node *p_node)
+{
+    return join(p_hashLife, p_node->p_nw->p_se, p_node->p_ne->p_sw, p_node->p_sw->p_ne, p_node->p_se->p_nw);
+}
+
+
+static HashLife_node *centreHorizontal(HashLife *p_hashLife, HashLife_node *p_west, HashLife_node *p_east)
+{
+    return join(p_hashLife, p_west->p_ne, p_east->p_nw, p_west->p_se, p_east->p_sw);
+}
+
+
+static HashLife_node *centreVertical(HashLife *p_hashLife, HashLife_node *p_north, HashLife_node *p_south)
+{
+    return join(p_hashLife, p_north->p_sw, p_north->p_se, p_south->p_nw, p_south->p_ne);
+}
+
+
+static uint8_t getBaseCell(HashLife_node *p_node, int x, int y)
+{
+    HashLife_node *p_quad;
+
+    if (y < 2)
+    {
+        p_quad = (x < 2) ? p_node->p_nw : p_node->p_ne;
+    }
+    else
+    {
+        p_quad = (x < 2) ? p_node->p_sw : p_node->p_se;
+    }
+
+    x &= 1;
+    y &= 1;
+    if (y == 0)
+    {
+        return (x == 0) ? p_quad->p_nw->state : p_quad->p_ne->state;
+    }
+
+    return (x == 0) ? p_quad->p_sw->state : p_quad->p_se->state;
+}
+
+
+/* Centre 2x2 of a 4x4 node one generation on */
+static HashLife_node *stepBase(HashLife *p_hashLife, HashLife_node *p_node)
+{
+    uint8_t next[2][2];
+    int x, y, iNeigh;
+    int neighbourSum;
+
+    for (y = 1; y <= 2; y++)
+    {
+        for (x = 1; x <= 2; x++)
+        {
+            neighbourSum = 0;
+            for (iNeigh = 0; iNeigh < GRID_HEX_NUM_NEIGHBOURS; iNeigh++)
+            {
+                neighbourSum += Rule_neighbourWeight[getBaseCell(p_node, x + neighbourOffsets[iNeigh][0], y + neighbourOffsets[iNeigh][1])];
+            }
+            next[y - 1][x - 1] = p_hashLife->rule.table[getBaseCell(p_node, x, y) * RULE_NUM_SUMS + neighbourSum];
+        }
+    }
+
+    return join(p_hashLife,
+                p_hashLife->p_leaves[next[0][0]], p_hashLife->p_leaves[next[0][1]],
+                p_hashLife->p_leaves[next[1][0]], p_hashLife->p_leaves[next[1][1]]);
+}
+
+
+static HashLife_node *getResult(HashLife *p_hashLife, HashLife_node *p_node, int log2Step);
+
+
+/* Result of the node joining four sub-nodes */
+static HashLife_node *getQuarterResult(HashLife *p_hashLife, HashLife_node *p_nw, HashLife_node *p_ne, HashLife_node *p_sw, HashLife_node *p_se, int log2Step)
+{
+    HashLife_node *p_node = join(p_hashLife, p_nw, p_ne, p_sw, p_se);
+
+    if (p_node == NULL)
+    {
+        return NULL;
+    }
+
+    return getResult(p_hashLife, p_node, log2Step);
+}
+
+
+/* Centre of a level k node after 2^log2Step generations, log2Step <= k - 2.
+ * NULL when out of memory, nothing is memoised on the way out. */
+static HashLife_node *getResult(HashLife *p_hashLife, HashLife_node *p_node, int log2Step)
+{
+    HashLife_node *p_sub[3][3];
+    HashLife_node *p_nw, *p_ne, *p_sw, *p_se;
+    HashLife_node *p_result;
+    int iRow, iCol;
+    int fullSpeed = (log2Step == p_node->level - 2);
+
+    if (p_node->population == 0)
+    {
+        return getEmpty(p_hashLife, p_node->level - 1);
+    }
+    if (p_node->p_result != NULL && p_node->resultLog2Step == log2Step)
+    {
+        return p_node->p_result;
+    }
+
+    if (p_node->level == HASHLIFE_BASE_LEVEL)
+    {
+        p_result = stepBase(p_hashLife, p_node);
+        if (p_result == NULL)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        /* Nine overlapping sub-nodes one level down */
+        p_sub[0][0] = p_node->p_nw;
+        p_sub[0][1] = centreHorizontal(p_hashLife, p_node->p_nw, p_node->p_ne);
+        p_sub[0][2] = p_node->p_ne;
+        p_sub[1][0] = centreVertical(p_hashLife, p_node->p_nw, p_node->p_sw);
+        p_sub[1][1] = centre(p_hashLife, p_node);
+        p_sub[1][2] = centreVertical(p_hashLife, p_node->p_ne, p_node->p_se);
+        p_sub[2][0] = p_node->p_sw;
+        p_sub[2][1] = centreHorizontal(p_hashLife, p_node->p_sw, p_node->p_se);
+        p_sub[2][2] = p_node->p_se;
+
+        /* At full speed both halves advance, otherwise only the second */
+        for (iRow = 0; iRow < 3; iRow++)
+        {
+            for (iCol = 0; iCol < 3; iCol++)
+            {
+                if (p_sub[iRow][iCol] == NULL)
+                {
+                    return NULL;
+                }
+                if (fullSpeed)
+                {
+                    p_sub[iRow][iCol] = getResult(p_hashLife, p_sub[iRow][iCol], p_node->level - 3);
+                }
+                else
+                {
+                    p_sub[iRow][iCol] = centre(p_hashLife, p_sub[iRow][iCol]);
+                }
+                if (p_sub[iRow][iCol] == NULL)
+                {
+                    return NULL;
+                }
+            }
+        }
+
+        if (fullSpeed)
+        {
+            log2Step = p_node->level - 3;
+        }
+
+        p_nw = getQuarterResult(p_hashLife, p_sub[0][0], p_sub[0][1], p_sub[1][0], p_sub[1][1], log2Step);
+        p_ne = getQuarterResult(p_hashLife, p_sub[0][1], p_sub[0][2], p_sub[1][1], p_sub[1][2], log2Step);
+        p_sw = getQuarterResult(p_hashLife, p_sub[1][0], p_sub[1][1], p_sub[2][0], p_sub[2][1], log2Step);
+        p_se = getQuarterResult(p_hashLife, p_sub[1][1], p_sub[1][2], p_sub[2][1], p_sub[2][2], log2Step);
+        if (p_nw == NULL || p_ne == NULL || p_sw == NULL || p_se == NULL)
+        {
+            return NULL;
+        }
+
+        p_result = join(p_hashLife, p_nw, p_ne, p_sw, p_se);
+        if (p_result == NULL)
+        {
+            return NULL;
+        }
+
+        if (fullSpeed)
+        {
+            log2Step = p_node->level - 2;
+        }
+    }
+
+    p_node->p_result = p_result;
+    p_node->resultLog2Step = log2Step;
+
+    return p_result;
+}
+
+
+static int initTables(HashLife *p_hashLife)
+{
+    HashLife_node *p_leaf;
+    int iState;
+
+    p_hashLife->table_size = HASHLIFE_INITIAL_TABLE_SIZE;
+    p_hashLife->num_nodes = 0;
+    p_hashLife->p_blocks = NULL;
+    p_hashLife->p_table = calloc(p_hashLife->table_size, sizeof(HashLife_node *));
+    if (p_hashLife->p_table == NULL)
+    {
+        printf("[ERR] Could not create hashlife table\n");
+        return FALSE;
+    }
+
+    for (iState = 0; iState < RULE_NUM_STATES; iState++)
+    {
+        p_leaf = allocNode(p_hashLife);
+        if (p_leaf == NULL)
+        {
+            printf("[ERR] Could not allocate hashlife nodes\n");
+            return FALSE;
+        }
+        memset(p_leaf, 0, sizeof(HashLife_node));
+        p_leaf->resultLog2Step = HASHLIFE_NO_RESULT;
+        p_leaf->state = iState;
+        p_leaf->population = (iState != GRID_DEAD);
+        p_hashLife->p_leaves[iState] = p_leaf;
+    }
+
+    memset(p_hashLife->p_empty, 0, sizeof(p_hashLife->p_empty));
+    p_hashLife->p_empty[0] = p_hashLife->p_leaves[GRID_DEAD];
+
+    return TRUE;
+}
+
+
+static void freeTables(HashLife *p_hashLife)
+{
+    HashLife_block *p_block, *p_next;
+
+    for (p_block = p_hashLife->p_blocks; p_block != NULL; p_block = p_next)
+    {
+        p_next = p_block->p_next;
+        free(p_block);
+    }
+    free(p_hashLife->p_table);
+
+    p_hashLife->p_blocks = NULL;
+    p_hashLife->p_table = NULL;
+    p_hashLife->table_size = 0;
+    p_hashLife->num_nodes = 0;
+}
+
+
+HashLife HashLife_create(const Rule *p_rule)
+{
+    HashLife hashLife;
+
+    memset(&hashLife, 0, sizeof(HashLife));
+    hashLife.rule = *p_rule;
+    hashLife.max_nodes = HASHLIFE_DEFAULT_MAX_NODES;
+
+    /* Birth on zero neighbours would fill the infinite plane */
+    if (p_rule->createMask & 1)
+    {
+        printf("[ERR] Hashlife cannot run rules with B0\n");
+        return hashLife;
+    }
+
+    if (initTables(&hashLife) != TRUE)
+    {
+        freeTables(&hashLife);
+        return hashLife;
+    }
+
+    hashLife.p_root = getEmpty(&hashLife, HASHLIFE_BASE_LEVEL + 1);
+    if (hashLife.p_root == NULL)
+    {
+        printf("[ERR] Could not allocate hashlife nodes\n");
+        freeTables(&hashLife);
+    }
+
+    return hashLife;
+}
+
+
+/* Builds the node of the given level whose top left cell is at (x, y) */
+static HashLife_node *buildFromGrid(HashLife *p_hashLife, Grid *p_grid, int level, int64_t x, int64_t y)
+{
+    HashLife_node *p_nw, *p_ne, *p_sw, *p_se;
+    int64_t half;
+    int64_t row;
+
+    if (x >= p_grid->width_cells || x + ((int64_t) 1 << level) <= 0)
+    {
+        return getEmpty(p_hashLife, level);
+    }
+
+    if (level == 0)
+    {
+        row = y + (x + 1) / 2;
+        if (row < 0 || row >= p_grid->height_cells)
+        {
+            return p_hashLife->p_leaves[GRID_DEAD];
+        }
+        return p_hashLife->p_leaves[Grid_getDispValue(p_grid, (int) row, (int) x)];
+    }
+
+    half = (int64_t) 1 << (level - 1);
+    p_nw = buildFromGrid(p_hashLife, p_grid, level - 1, x, y);
+    p_ne = buildFromGrid(p_hashLife, p_grid, level - 1, x + half, y);
+    p_sw = buildFromGrid(p_hashLife, p_grid, level - 1, x, y + half);
+    p_se = buildFromGrid(p_hashLife, p_grid, level - 1, x + half, y + half);
+    if (p_nw == NULL || p_ne == NULL || p_sw == NULL || p_se == NULL)
+    {
+        return NULL;
+    }
+
+    return join(p_hashLife, p_nw, p_ne, p_sw, p_se);
+}
+
+
+int HashLife_fromGrid(HashLife *p_hashLife, Grid *p_grid)
+{
+    HashLife_node *p_root;
+    int64_t extent;
+    int level = HASHLIFE_BASE_LEVEL + 1;
+
+    /* Skewing shears the grid, rows move up by half the column index */
+    extent = p_grid->height_cells + p_grid->width_cells / 2;
+    if (extent < p_grid->width_cells)
+    {
+        extent = p_grid->width_cells;
+    }
+    while (((int64_t) 1 << level) < extent)
+    {
+        level++;
+    }
+
+    p_root = buildFromGrid(p_hashLife, p_grid, level, 0, -(p_grid->width_cells / 2));
+    if (p_root == NULL)
+    {
+        printf("[ERR] Could not build the hashlife universe\n");
+        return FALSE;
+    }
+
+    p_hashLife->p_root = p_root;
+    p_hashLife->origin_x = 0;
+    p_hashLife->origin_y = -(p_grid->width_cells / 2);
+    p_hashLife->generation = 0;
+
+    return TRUE;
+}
+
+
+static void writeToGrid(HashLife_node *p_node, Grid *p_grid, int64_t x, int64_t y)
+{
+    int64_t half;
+    int64_t row;
+
+    if (p_node->population == 0 || x >= p_grid->width_cells || x + ((int64_t) 1 << p_node->level) <= 0)
+    {
+        return;
+    }
+
+    if (p_node->level == 0)
+    {
+        row = y + (x + 1) / 2;
+        if (row >= 0 && row < p_grid->height_cells)
+        {
+            Grid_setDispValue(p_grid, (int) row, (int) x, p_node->state);
+        }
+        return;
+    }
+
+    half = (int64_t) 1 << (p_node->level - 1);
+    writeToGrid(p_node->p_nw, p_grid, x, y);
+    writeToGrid(p_node->p_ne, p_grid, x + half, y);
+    writeToGrid(p_node->p_sw, p_grid, x, y + half);
+    writeToGrid(p_node->p_se, p_grid, x + half, y + half);
+}
+
+
+void HashLife_toGrid(HashLife *p_hashLife, Grid *p_grid)
+{
+    Grid_clearGrid(p_grid);
+    writeToGrid(p_hashLife->p_root, p_grid, p_hashLife->origin_x, p_hashLife->origin_y);
+}
+
+
+/* Wraps the root in a node twice its size, keeping it in the centre.
+ * Returns FALSE, with the root untouched, when out of memory. */
+static int expandRoot(HashLife *p_hashLife)
+{
+    HashLife_node *p_root = p_hashLife->p_root;
+    HashLife_node *p_empty = getEmpty(p_hashLife, p_root->level - 1);
+    HashLife_node *p_nw, *p_ne, *p_sw, *p_se;
+    HashLife_node *p_expanded;
+    int64_t half = (int64_t) 1 << (p_root->level - 1);
+
+    if (p_empty == NULL)
+    {
+        return FALSE;
+    }
+
+    p_nw = join(p_hashLife, p_empty, p_empty, p_empty, p_root->p_nw);
+    p_ne = join(p_hashLife, p_empty, p_empty, p_root->p_ne, p_empty);
+    p_sw = join(p_hashLife, p_empty, p_root->p_sw, p_empty, p_empty);
+    p_se = join(p_hashLife, p_root->p_se, p_empty, p_empty, p_empty);
+    if (p_nw == NULL || p_ne == NULL || p_sw == NULL || p_se == NULL)
+    {
+        return FALSE;
+    }
+
+    p_expanded = join(p_hashLife, p_nw, p_ne, p_sw, p_se);
+    if (p_expanded == NULL)
+    {
+        return FALSE;
+    }
+
+    p_hashLife->p_root = p_expanded;
+    p_hashLife->origin_x -= half;
+    p_hashLife->origin_y -= half;
+
+    return TRUE;
+}
+
+
+static HashLife_node *copyNode(HashLife *p_dest, HashLife_node *p_node)
+{
+    HashLife_node *p_nw, *p_ne, *p_sw, *p_se;
+    HashLife_node *p_copy;
+
+    if (p_node->level == 0)
+    {
+        return p_dest->p_leaves[p_node->state];
+    }
+    if (p_node->resultLog2Step == HASHLIFE_FORWARDED)
+    {
+        return p_node->p_result;
+    }
+
+    p_nw = copyNode(p_dest, p_node->p_nw);
+    p_ne = copyNode(p_dest, p_node->p_ne);
+    p_sw = copyNode(p_dest, p_node->p_sw);
+    p_se = copyNode(p_dest, p_node->p_se);
+    if (p_nw == NULL || p_ne == NULL || p_sw == NULL || p_se == NULL)
+    {
+        return NULL;
+    }
+
+    p_copy = join(p_dest, p_nw, p_ne, p_sw, p_se);
+    if (p_copy == NULL)
+    {
+        return NULL;
+    }
+
+    p_node->p_result = p_copy;
+    p_node->resultLog2Step = HASHLIFE_FORWARDED;
+
+    return p_copy;
+}
+
+
+/* Keeps only the nodes reachable from the root, dropping all memoised
+ * results. Returns FALSE, with the old nodes kept, when out of memory. */
+static int collectGarbage(HashLife *p_hashLife)
+{
+    HashLife fresh = *p_hashLife;
+    HashLife_block *p_block;
+    int iNode;
+
+    if (initTables(&fresh) != TRUE)
+    {
+        freeTables(&fresh);
+        return FALSE;
+    }
+
+    fresh.p_root = copyNode(&fresh, p_hashLife->p_root);
+    if (fresh.p_root == NULL)
+    {
+        /* The forwarding pointers would dangle once the copies are freed */
+        for (p_block = p_hashLife->p_blocks; p_block != NULL; p_block = p_block->p_next)
+        {
+            for (iNode = 0; iNode < p_block->used; iNode++)
+            {
+                if (p_block->nodes[iNode].resultLog2Step == HASHLIFE_FORWARDED)
+                {
+                    p_block->nodes[iNode].p_result = NULL;
+                    p_block->nodes[iNode].resultLog2Step = HASHLIFE_NO_RESULT;
+                }
+            }
+        }
+        freeTables(&fresh);
+        return FALSE;
+    }
+
+    freeTables(p_hashLife);
+    *p_hashLife = fresh;
+
+    return TRUE;
+}
+
+
+int HashLife_step(HashLife *p_hashLife, int log2Gens)
+{
+    HashLife_node *p_root;
+    HashLife_node *p_centre;
+    HashLife_node *p_result;
+
+    if (log2Gens < 0 || log2Gens + 3 > HASHLIFE_MAX_LEVEL)
+    {
+        printf("[ERR] Cannot step 2^%d generations\n", log2Gens);
+        return FALSE;
+    }
+
+    /* The pattern must sit in the middle quarter and the step must not be
+     * longer than an eighth of the root, so nothing can reach the edge */
+    for (;;)
+    {
+        if (p_hashLife->p_root->level >= log2Gens + 3)
+        {
+            p_centre = centre(p_hashLife, p_hashLife->p_root);
+            if (p_centre != NULL)
+            {
+                p_centre = centre(p_hashLife, p_centre);
+            }
+            if (p_centre == NULL)
+            {
+                printf("[ERR] Hashlife ran out of memory\n");
+                return FALSE;
+            }
+            if (p_centre->population == p_hashLife->p_root->population)
+            {
+                break;
+            }
+        }
+        if (p_hashLife->p_root->level >= HASHLIFE_MAX_LEVEL)
+        {
+            printf("[ERR] Hashlife universe too large\n");
+            return FALSE;
+        }
+        if (expandRoot(p_hashLife) != TRUE)
+        {
+            printf("[ERR] Hashlife ran out of memory\n");
+            return FALSE;
+        }
+    }
+
+    p_root = p_hashLife->p_root;
+    p_result = getResult(p_hashLife, p_root, log2Gens);
+    if (p_result == NULL)
+    {
+        printf("[ERR] Hashlife ran out of memory\n");
+        return FALSE;
+    }
+
+    p_hashLife->p_root = p_result;
+    p_hashLife->origin_x += (int64_t) 1 << (p_root->level - 2);
+    p_hashLife->origin_y += (int64_t) 1 << (p_root->level - 2);
+    p_hashLife->generation += (uint64_t) 1 << log2Gens;
+
+    /* The step stands even if the collection fails */
+    if (p_hashLife->num_nodes > p_hashLife->max_nodes && collectGarbage(p_hashLife) != TRUE)
+    {
+        printf("[ERR] Hashlife ran out of memory collecting garbage\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+uint64_t HashLife_countPopulation(HashLife *p_hashLife)
+{
+    return p_hashLife->p_root->population;
+}
+
+
+void HashLife_destroy(HashLife *p_hashLife)
+{
+    freeTables(p_hashLife);
+
+    p_hashLife->p_root = NULL;
+    memset(p_hashLife->p_leaves, 0, sizeof(p_hashLife->p_leaves));
+    memset(p_hashLife->p_empty, 0, sizeof(p_hashLife->p_empty));
+}
@@ -0,0 +1,72 @@
+#ifndef H_HEXLIFE_HASHLIFE_H
+#define H_HEXLIFE_HASHLIFE_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "grid.h"
+#include "rule.h"
+#include "bool.h"
+
+
+/* Cells are kept on a skewed square lattice where grid cell (row, col) sits at
+ * x = col, y = row - (col + 1) / 2. There the six hex neighbours are the 3x3
+ * square minus the (-1, -1) and (+1, +1) corners, so the quadtree only has to
+ * deal with a radius 1 neighbourhood.
+ *
+ * Unlike Grid the universe is an unbounded plane rather than a torus, so both
+ * engines only agree while the pattern stays clear of the grid edges. */
+#define HASHLIFE_DEFAULT_MAX_NODES  (1 << 22)
+
+#define HASHLIFE_MAX_LEVEL  (60)
+
+
+typedef struct HashLife_node_struct HashLife_node;
+
+typedef struct HashLife_block_struct HashLife_block;
+
+
+typedef struct HashLife_struct {
+    Rule rule;
+
+    /* Hash-consed nodes, allocated in blocks */
+    HashLife_node **p_table;
+    size_t table_size;
+    size_t num_nodes;
+    HashLife_block *p_blocks;
+
+    /* Leaves per state and empty node per level */
+    HashLife_node *p_leaves[RULE_NUM_STATES];
+    HashLife_node *p_empty[HASHLIFE_MAX_LEVEL + 1];
+
+    /* Universe, with the skewed coordinates of its top left corner */
+    HashLife_node *p_root;
+    int64_t origin_x;
+    int64_t origin_y;
+    uint64_t generation;
+
+    /* Memoised results are dropped once the table holds this many nodes */
+    size_t max_nodes;
+} HashLife;
+
+
+/* The table is NULL on failure */
+extern HashLife HashLife_create(const Rule *p_rule);
+
+/* Returns FALSE when out of memory, leaving the universe as it was */
+extern int HashLife_fromGrid(HashLife *p_hashLife, Grid *p_grid);
+
+/* Writes the cells inside the grid window, anything outside it is dropped */
+extern void HashLife_toGrid(HashLife *p_hashLife, Grid *p_grid);
+
+/* Advances the universe 2^log2Gens generations at once. Returns FALSE when
+ * out of memory or when the universe would outgrow HASHLIFE_MAX_LEVEL. */
+extern int HashLife_step(HashLife *p_hashLife, int log2Gens);
+
+extern uint64_t HashLife_countPopulation(HashLife *p_hashLife);
+
+extern void HashLife_destroy(HashLife *p_hashLife);
+
+
+#endif /* H_HEXLIFE_HASHLIFE_H */
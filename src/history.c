@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "history.h"
+
+
+#define HISTORY_INITIAL_CAPACITY  (256)
+
+/* Longest (zero run, value) pair, a 64 bit varint and a byte */
+#define HISTORY_MAX_PAIR_BYTES  (11)
+
+
+static History_entry *entryAt(History *p_history, int iEntry)
+{
+    return &p_history->p_entries[(p_history->head + iEntry) % p_history->capacity];
+}
+
+
+static size_t packedBytes(int numCells)
+{
+    return ((size_t) numCells + 3) / 4;
+}
+
+
+/* Encodes p_new XOR p_old, or p_new alone when p_old is NULL. Sparse unless
+ * that would not beat packing four cells to a byte. */
+static size_t encodeCells(const uint8_t *p_new, const uint8_t *p_old, int numCells, uint8_t *p_out, int *p_encoding)
+{
+    size_t limit = packedBytes(numCells);
+    size_t numBytes = 0;
+    uint64_t run = 0;
+    uint8_t value;
+    int iCell;
+
+    for (iCell = 0; iCell < numCells; iCell++)
+    {
+        value = p_old != NULL ? p_new[iCell] ^ p_old[iCell] : p_new[iCell];
+        if (value == 0)
+        {
+            run++;
+            continue;
+        }
+
+        if (numBytes + HISTORY_MAX_PAIR_BYTES > limit)
+        {
+            break;
+        }
+        while (run >= 0x80)
+        {
+            p_out[numBytes++] = (uint8_t) (run | 0x80);
+            run >>= 7;
+        }
+        p_out[numBytes++] = (uint8_t) run;
+        p_out[numBytes++] = value;
+        run = 0;
+    }
+
+    if (iCell == numCells)
+    {
+        *p_encoding = HISTORY_ENCODING_SPARSE;
+        return numBytes;
+    }
+
+    memset(p_out, 0, limit);
+    for (iCell = 0; iCell < numCells; iCell++)
+    {
+        value = p_old != NULL ? p_new[iCell] ^ p_old[iCell] : p_new[iCell];
+        p_out[iCell / 4] |= (uint8_t) ((value & 0x03) << (2 * (iCell % 4)));
+    }
+    *p_encoding = HISTORY_ENCODING_PACKED;
+
+    return limit;
+}
+
+
+/* XORs encoded cells into p_cells */
+static void applyCells(uint8_t *p_cells, int numCells, const uint8_t *p_data, size_t numBytes, int encoding)
+{
+    size_t iByte = 0;
+    uint64_t iCell = 0;
+    uint64_t run;
+    int shift;
+    int iPacked;
+
+    if (encoding == HISTORY_ENCODING_PACKED)
+    {
+        for (iPacked = 0; iPacked < numCells; iPacked++)
+        {
+            p_cells[iPacked] ^= (p_data[iPacked / 4] >> (2 * (iPacked % 4))) & 0x03;
+        }
+        return;
+    }
+
+    while (iByte < numBytes)
+    {
+        run = 0;
+        shift = 0;
+        while (p_data[iByte] & 0x80)
+        {
+            run |= (uint64_t) (p_data[iByte++] & 0x7F) << shift;
+            shift += 7;
+        }
+        run |= (uint64_t) p_data[iByte++] << shift;
+
+        iCell += run;
+        p_cells[iCell] ^= p_data[iByte++];
+        iCell++;
+    }
+}
+
+
+/* Moves p_cells, holding entry iFrom, to entry iTo one delta at a time */
+static void walkDeltas(History *p_history, uint8_t *p_cells, int iFrom, int iTo)
+{
+    History_entry *p_entry;
+    int iEntry;
+
+    for (iEntry = iFrom + 1; iEntry <= iTo; iEntry++)
+    {
+        p_entry = entryAt(p_history, iEntry);
+        applyCells(p_cells, p_history->num_cells, p_entry->p_delta, p_entry->delta_bytes, p_entry->delta_encoding);
+    }
+    for (iEntry = iFrom; iEntry > iTo; iEntry--)
+    {
+        p_entry = entryAt(p_history, iEntry);
+        applyCells(p_cells, p_history->num_cells, p_entry->p_delta, p_entry->delta_bytes, p_entry->delta_encoding);
+    }
+}
+
+
+static void freeEntry(History *p_history, History_entry *p_entry)
+{
+    p_history->used_bytes -= sizeof(History_entry) + p_entry->delta_bytes + p_entry->keyframe_bytes;
+
+    free(p_entry->p_delta);
+    free(p_entry->p_keyframe);
+    memset(p_entry, 0, sizeof(History_entry));
+}
+
+
+static void dropOldest(History *p_history)
+{
+    History_entry *p_oldest;
+
+    freeEntry(p_history, entryAt(p_history, 0));
+    p_history->head = (p_history->head + 1) % p_history->capacity;
+    p_history->count--;
+
+    /* Nothing is left to undo the new oldest entry's delta back to */
+    if (p_history->count > 0)
+    {
+        p_oldest = entryAt(p_history, 0);
+        p_history->used_bytes -= p_oldest->delta_bytes;
+        free(p_oldest->p_delta);
+        p_oldest->p_delta = NULL;
+        p_oldest->delta_bytes = 0;
+        p_oldest->delta_encoding = HISTORY_ENCODING_SPARSE;
+    }
+}
+
+
+static int grow(History *p_history)
+{
+    History_entry *p_entries;
+    int iEntry;
+    int capacity = p_history->capacity * 2;
+
+    p_entries = malloc(capacity * sizeof(History_entry));
+    if (p_entries == NULL)
+    {
+        return FALSE;
+    }
+
+    for (iEntry = 0; iEntry < p_history->count; iEntry++)
+    {
+        p_entries[iEntry] = *entryAt(p_history, iEntry);
+    }
+
+    free(p_history->p_entries);
+    p_history->p_entries = p_entries;
+    p_history->capacity = capacity;
+    p_history->head = 0;
+
+    return TRUE;
+}
+
+
+static uint8_t *copyBytes(const uint8_t *p_bytes, size_t numBytes)
+{
+    uint8_t *p_copy = malloc(numBytes > 0 ? numBytes : 1);
+
+    if (p_copy != NULL)
+    {
+        memcpy(p_copy, p_bytes, numBytes);
+    }
+
+    return p_copy;
+}
+
+
+History History_create(int width_cells, int height_cells, size_t maxBytes, int keyframeInterval)
+{
+    History history;
+
+    memset(&history, 0, sizeof(History));
+
+    /* Row padding is included, it is always dead so costs nothing once encoded */
+    history.num_cells = Grid_strideFor(width_cells) * height_cells;
+    history.max_bytes = maxBytes;
+    history.keyframe_interval = keyframeInterval > 0 ? keyframeInterval : 1;
+    history.capacity = HISTORY_INITIAL_CAPACITY;
+
+    history.p_entries = calloc(history.capacity, sizeof(History_entry));
+    history.p_tip = malloc(history.num_cells * sizeof(uint8_t));
+    history.p_scratch = malloc(packedBytes(history.num_cells));
+    if (history.p_entries == NULL || history.p_tip == NULL || history.p_scratch == NULL)
+    {
+        printf("[ERR] Could not create history\n");
+        History_destroy(&history);
+    }
+
+    return history;
+}
+
+
+int History_record(History *p_history, Grid *p_grid)
+{
+    History_entry entry;
+    size_t numBytes;
+    int isKeyframe;
+
+    memset(&entry, 0, sizeof(History_entry));
+    entry.generation = p_grid->generation;
+    entry.hash = p_grid->hash;
+
+    if (p_history->count > 0)
+    {
+        numBytes = encodeCells(p_grid->p_disp, p_history->p_tip, p_history->num_cells, p_history->p_scratch, &entry.delta_encoding);
+        entry.p_delta = copyBytes(p_history->p_scratch, numBytes);
+        entry.delta_bytes = numBytes;
+        if (entry.p_delta == NULL)
+        {
+            return FALSE;
+        }
+    }
+
+    isKeyframe = p_history->count == 0 || p_history->since_keyframe + 1 >= p_history->keyframe_interval;
+    if (isKeyframe)
+    {
+        numBytes = encodeCells(p_grid->p_disp, NULL, p_history->num_cells, p_history->p_scratch, &entry.keyframe_encoding);
+        entry.p_keyframe = copyBytes(p_history->p_scratch, numBytes);
+        entry.keyframe_bytes = numBytes;
+        if (entry.p_keyframe == NULL)
+        {
+            free(entry.p_delta);
+            return FALSE;
+        }
+    }
+
+    /* The newest entry always stays, even on its own over the limit */
+    while (p_history->count > 0
+        && p_history->used_bytes + sizeof(History_entry) + entry.delta_bytes + entry.keyframe_bytes > p_history->max_bytes)
+    {
+        dropOldest(p_history);
+    }
+    if (p_history->count == 0 && entry.p_delta != NULL)
+    {
+        free(entry.p_delta);
+        entry.p_delta = NULL;
+        entry.delta_bytes = 0;
+        entry.delta_encoding = HISTORY_ENCODING_SPARSE;
+    }
+
+    if (p_history->count == p_history->capacity && grow(p_history) != TRUE)
+    {
+        free(entry.p_delta);
+        free(entry.p_keyframe);
+        return FALSE;
+    }
+
+    *entryAt(p_history, p_history->count) = entry;
+    p_history->count++;
+    p_history->used_bytes += sizeof(History_entry) + entry.delta_bytes + entry.keyframe_bytes;
+    p_history->since_keyframe = isKeyframe ? 0 : p_history->since_keyframe + 1;
+    memcpy(p_history->p_tip, p_grid->p_disp, p_history->num_cells * sizeof(uint8_t));
+
+    return TRUE;
+}
+
+
+void History_truncate(History *p_history, int iEntry)
+{
+    int iLast;
+
+    if (iEntry < 0 || iEntry >= p_history->count - 1)
+    {
+        return;
+    }
+
+    walkDeltas(p_history, p_history->p_tip, p_history->count - 1, iEntry);
+    for (iLast = p_history->count - 1; iLast > iEntry; iLast--)
+    {
+        freeEntry(p_history, entryAt(p_history, iLast));
+    }
+    p_history->count = iEntry + 1;
+
+    p_history->since_keyframe = 0;
+    while (iEntry >= 0 && entryAt(p_history, iEntry)->p_keyframe == NULL)
+    {
+        p_history->since_keyframe++;
+        iEntry--;
+    }
+}
+
+
+int History_seek(History *p_history, Grid *p_grid, int iFrom, int iTo)
+{
+    History_entry *p_entry;
+    int bestCost;
+    int bestKeyframe = -1;
+    int iEntry;
+    int useFrom = FALSE;
+
+    if (iTo < 0 || iTo >= p_history->count)
+    {
+        return FALSE;
+    }
+
+    /* Walking back from the newest entry always works */
+    bestCost = p_history->count - 1 - iTo;
+
+    if (iFrom >= 0 && iFrom < p_history->count && abs(iTo - iFrom) <= bestCost)
+    {
+        bestCost = abs(iTo - iFrom);
+        useFrom = TRUE;
+    }
+
+    /* A keyframe costs one decode on top of its distance */
+    for (iEntry = 0; iEntry < p_history->count; iEntry++)
+    {
+        if (entryAt(p_history, iEntry)->p_keyframe != NULL && abs(iTo - iEntry) + 1 < bestCost)
+        {
+            bestCost = abs(iTo - iEntry) + 1;
+            bestKeyframe = iEntry;
+            useFrom = FALSE;
+        }
+    }
+
+    if (bestKeyframe >= 0)
+    {
+        p_entry = entryAt(p_history, bestKeyframe);
+        memset(p_grid->p_disp, 0, p_history->num_cells * sizeof(uint8_t));
+        applyCells(p_grid->p_disp, p_history->num_cells, p_entry->p_keyframe, p_entry->keyframe_bytes, p_entry->keyframe_encoding);
+        walkDeltas(p_history, p_grid->p_disp, bestKeyframe, iTo);
+    }
+    else if (useFrom == TRUE)
+    {
+        walkDeltas(p_history, p_grid->p_disp, iFrom, iTo);
+    }
+    else
+    {
+        memcpy(p_grid->p_disp, p_history->p_tip, p_history->num_cells * sizeof(uint8_t));
+        walkDeltas(p_history, p_grid->p_disp, p_history->count - 1, iTo);
+    }
+
+    p_entry = entryAt(p_history, iTo);
+    p_grid->generation = p_entry->generation;
+    p_grid->hash = p_entry->hash;
+    Grid_markAllTilesChanged(p_grid);
+    Grid_computeStats(p_grid);
+
+    return TRUE;
+}
+
+
+uint64_t History_generation(History *p_history, int iEntry)
+{
+    return entryAt(p_history, iEntry)->generation;
+}
+
+
+void History_clear(History *p_history)
+{
+    while (p_history->count > 0)
+    {
+        dropOldest(p_history);
+    }
+    p_history->head = 0;
+    p_history->since_keyframe = 0;
+}
+
+
+void History_destroy(History *p_history)
+{
+    if (p_history->p_entries != NULL)
+    {
+        History_clear(p_history);
+    }
+
+    free(p_history->p_entries);
+    free(p_history->p_tip);
+    free(p_history->p_scratch);
+
+    p_history->p_entries = NULL;
+    p_history->p_tip = NULL;
+    p_history->p_scratch = NULL;
+    p_history->capacity = 0;
+}
@@ -0,0 +1,83 @@
+#ifndef H_HEXLIFE_HISTORY_H
+#define H_HEXLIFE_HISTORY_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "grid.h"
+#include "bool.h"
+
+
+#define HISTORY_DEFAULT_MAX_BYTES          (64 * 1024 * 1024)
+#define HISTORY_DEFAULT_KEYFRAME_INTERVAL  (64)
+
+/* Cells stored as (zero run, non-zero value) pairs, the run as a varint */
+#define HISTORY_ENCODING_SPARSE  (0)
+/* Four cells per byte, used when sparse would come out bigger */
+#define HISTORY_ENCODING_PACKED  (1)
+
+
+/* One recorded grid state. delta is its XOR with the entry before it, so it
+ * takes the grid either way between the two. Every keyframe_interval entries
+ * the cells are also kept whole, for seeking without walking every delta. */
+typedef struct History_entry_struct {
+    uint64_t generation;
+    uint64_t hash;
+
+    uint8_t *p_delta;
+    size_t delta_bytes;
+    int delta_encoding;
+
+    /* NULL unless a keyframe */
+    uint8_t *p_keyframe;
+    size_t keyframe_bytes;
+    int keyframe_encoding;
+} History_entry;
+
+
+/* Bounded list of recent grid states, oldest dropped first once max_bytes
+ * would be exceeded. Entries are numbered 0 (oldest) to count - 1. */
+typedef struct History_struct {
+    History_entry *p_entries;
+    int capacity;
+    int head;
+    int count;
+
+    size_t used_bytes;
+    size_t max_bytes;
+    int keyframe_interval;
+    /* Entries recorded since the last keyframe */
+    int since_keyframe;
+
+    /* Whole grid buffer, stride_cells * height_cells */
+    int num_cells;
+    /* Cells of the newest entry */
+    uint8_t *p_tip;
+    /* Worst case encoding of one grid */
+    uint8_t *p_scratch;
+} History;
+
+
+/* p_tip is left NULL on failure */
+extern History History_create(int width_cells, int height_cells, size_t maxBytes, int keyframeInterval);
+
+/* Appends the displayed cells of the grid as the newest entry */
+extern int History_record(History *p_history, Grid *p_grid);
+
+/* Drops every entry after iEntry */
+extern void History_truncate(History *p_history, int iEntry);
+
+/* Sets the grid to entry iTo. When iFrom is a valid entry the grid must hold
+ * it already, which lets short hops walk a few deltas instead of starting
+ * from a keyframe. Pass -1 otherwise. */
+extern int History_seek(History *p_history, Grid *p_grid, int iFrom, int iTo);
+
+extern uint64_t History_generation(History *p_history, int iEntry);
+
+extern void History_clear(History *p_history);
+
+extern void History_destroy(History *p_history);
+
+
+#endif /* H_HEXLIFE_HISTORY_H */
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "hud.h"
+
+
+static SDL_Texture *renderText(Hud *p_hud, SDL_Renderer *p_renderer, const char *p_text, int *p_width, int *p_height)
+{
+    SDL_Surface *p_surf;
+    SDL_Texture *p_tex;
+
+    p_surf = TTF_RenderText_Blended(p_hud->p_font, p_text, p_hud->color);
+    if (p_surf == NULL)
+    {
+        printf("Could not render \"%s\"\n", p_text);
+        return NULL;
+    }
+
+    p_tex = SDL_CreateTextureFromSurface(p_renderer, p_surf);
+    if (p_tex == NULL)
+    {
+        printf("Could not convert \"%s\" into texture\n", p_text);
+    }
+    *p_width = p_surf->w;
+    *p_height = p_surf->h;
+    SDL_FreeSurface(p_surf);
+
+    return p_tex;
+}
+
+
+static void destroyLabel(Hud_label *p_label)
+{
+    if (p_label->p_tex != NULL)
+    {
+        SDL_DestroyTexture(p_label->p_tex);
+    }
+    p_label->p_tex = NULL;
+    p_label->text[0] = '\0';
+}
+
+
+Hud Hud_create(SDL_Renderer *p_renderer, TTF_Font *p_font, SDL_Color color)
+{
+    Hud hud;
+    char glyphs[HUD_NUM_GLYPHS + 1];
+    char saved;
+    int iGlyph;
+    int width_px;
+
+    memset(&hud, 0, sizeof(Hud));
+    hud.p_font = p_font;
+    hud.color = color;
+
+    for (iGlyph = 0; iGlyph < HUD_NUM_GLYPHS; iGlyph++)
+    {
+        glyphs[iGlyph] = (char) (HUD_FIRST_GLYPH + iGlyph);
+    }
+    glyphs[HUD_NUM_GLYPHS] = '\0';
+
+    /* Glyph edges come from the width of each prefix, which also works for
+     * proportional fonts as long as they do not kern */
+    hud.glyph_x_px[0] = 0;
+    for (iGlyph = 1; iGlyph <= HUD_NUM_GLYPHS; iGlyph++)
+    {
+        saved = glyphs[iGlyph];
+        glyphs[iGlyph] = '\0';
+        TTF_SizeText(p_font, glyphs, &width_px, NULL);
+        hud.glyph_x_px[iGlyph] = width_px;
+        glyphs[iGlyph] = saved;
+    }
+
+    hud.p_glyphs = renderText(&hud, p_renderer, glyphs, &width_px, &hud.glyph_height_px);
+
+    return hud;
+}
+
+
+void Hud_setLabel(Hud *p_hud, Hud_label *p_label, SDL_Renderer *p_renderer, const char *p_text)
+{
+    if (p_label->p_tex != NULL && strncmp(p_label->text, p_text, HUD_MAX_TEXT_CHARS) == 0)
+    {
+        return;
+    }
+
+    destroyLabel(p_label);
+    snprintf(p_label->text, HUD_MAX_TEXT_CHARS, "%s", p_text);
+    p_label->p_tex = renderText(p_hud, p_renderer, p_label->text, &p_label->width_px, &p_label->height_px);
+}
+
+
+void Hud_drawLabel(Hud_label *p_label, SDL_Renderer *p_renderer, int x_px, int y_px)
+{
+    SDL_Rect dstRect = { x_px, y_px, p_label->width_px, p_label->height_px };
+
+    if (p_label->p_tex != NULL)
+    {
+        SDL_RenderCopy(p_renderer, p_label->p_tex, NULL, &dstRect);
+    }
+}
+
+
+void Hud_drawText(Hud *p_hud, SDL_Renderer *p_renderer, const char *p_text, int x_px, int y_px)
+{
+    SDL_Rect srcRect;
+    SDL_Rect dstRect;
+    int iGlyph;
+
+    if (p_hud->p_glyphs == NULL)
+    {
+        return;
+    }
+
+    srcRect.y = 0;
+    srcRect.h = p_hud->glyph_height_px;
+    dstRect.x = x_px;
+    dstRect.y = y_px;
+    dstRect.h = p_hud->glyph_height_px;
+
+    for (; *p_text != '\0'; p_text++)
+    {
+        iGlyph = *p_text - HUD_FIRST_GLYPH;
+        if (iGlyph < 0 || iGlyph >= HUD_NUM_GLYPHS)
+        {
+            iGlyph = '?' - HUD_FIRST_GLYPH;
+        }
+
+        srcRect.x = p_hud->glyph_x_px[iGlyph];
+        srcRect.w = p_hud->glyph_x_px[iGlyph + 1] - p_hud->glyph_x_px[iGlyph];
+        dstRect.w = srcRect.w;
+        SDL_RenderCopy(p_renderer, p_hud->p_glyphs, &srcRect, &dstRect);
+        dstRect.x += dstRect.w;
+    }
+}
+
+
+void Hud_drawMetrics(Hud *p_hud, SDL_Renderer *p_renderer, const Hud_metrics *p_metrics, int x_px, int y_px)
+{
+    char line[HUD_MAX_TEXT_CHARS];
+
+    snprintf(line, HUD_MAX_TEXT_CHARS, "Gen/s  %8.1f", p_metrics->gens_per_s);
+    Hud_drawText(p_hud, p_renderer, line, x_px, y_px);
+    y_px += p_hud->glyph_height_px;
+
+    snprintf(line, HUD_MAX_TEXT_CHARS, "Step   %8.3f ms", p_metrics->step_ms);
+    Hud_drawText(p_hud, p_renderer, line, x_px, y_px);
+    y_px += p_hud->glyph_height_px;
+
+    snprintf(line, HUD_MAX_TEXT_CHARS, "Render %8.3f ms", p_metrics->render_ms);
+    Hud_drawText(p_hud, p_renderer, line, x_px, y_px);
+    y_px += p_hud->glyph_height_px;
+
+    snprintf(line, HUD_MAX_TEXT_CHARS, "Frame  %8.3f ms", p_metrics->frame_ms);
+    Hud_drawText(p_hud, p_renderer, line, x_px, y_px);
+    y_px += p_hud->glyph_height_px;
+
+    snprintf(line, HUD_MAX_TEXT_CHARS, "Pop    %8d", p_metrics->population);
+    Hud_drawText(p_hud, p_renderer, line, x_px, y_px);
+}
+
+
+void Hud_smooth(double *p_average, double sample)
+{
+    *p_average += HUD_SMOOTHING * (sample - *p_average);
+}
+
+
+void Hud_destroy(Hud *p_hud)
+{
+    destroyLabel(&p_hud->status);
+    destroyLabel(&p_hud->rule);
+
+    if (p_hud->p_glyphs != NULL)
+    {
+        SDL_DestroyTexture(p_hud->p_glyphs);
+    }
+    p_hud->p_glyphs = NULL;
+}
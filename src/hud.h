@@ -0,0 +1,71 @@
+#ifndef H_HEXLIFE_HUD_H
+#define H_HEXLIFE_HUD_H
+
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include "bool.h"
+
+
+#define HUD_MAX_TEXT_CHARS  (64)
+
+/* Printable ASCII, rasterised once into a strip for text that changes often */
+#define HUD_FIRST_GLYPH  (' ')
+#define HUD_LAST_GLYPH   ('~')
+#define HUD_NUM_GLYPHS   (HUD_LAST_GLYPH - HUD_FIRST_GLYPH + 1)
+
+/* Weight of the newest sample in the smoothed metrics */
+#define HUD_SMOOTHING  (0.1)
+
+
+/* Text rendered to its own texture, only rasterised again when it changes */
+typedef struct Hud_label_struct {
+    char text[HUD_MAX_TEXT_CHARS];
+    SDL_Texture *p_tex;
+    int width_px;
+    int height_px;
+} Hud_label;
+
+
+typedef struct Hud_struct {
+    TTF_Font *p_font;
+    SDL_Color color;
+
+    SDL_Texture *p_glyphs;
+    int glyph_x_px[HUD_NUM_GLYPHS + 1];
+    int glyph_height_px;
+
+    Hud_label status;
+    Hud_label rule;
+} Hud;
+
+
+/* Live metrics, smoothed with Hud_smooth */
+typedef struct Hud_metrics_struct {
+    double gens_per_s;
+    double step_ms;
+    double render_ms;
+    double frame_ms;
+    int population;
+} Hud_metrics;
+
+
+/* p_glyphs is left NULL on failure */
+extern Hud Hud_create(SDL_Renderer *p_renderer, TTF_Font *p_font, SDL_Color color);
+
+extern void Hud_setLabel(Hud *p_hud, Hud_label *p_label, SDL_Renderer *p_renderer, const char *p_text);
+
+extern void Hud_drawLabel(Hud_label *p_label, SDL_Renderer *p_renderer, int x_px, int y_px);
+
+/* Draws through the glyph strip, so nothing is rasterised per frame */
+extern void Hud_drawText(Hud *p_hud, SDL_Renderer *p_renderer, const char *p_text, int x_px, int y_px);
+
+extern void Hud_drawMetrics(Hud *p_hud, SDL_Renderer *p_renderer, const Hud_metrics *p_metrics, int x_px, int y_px);
+
+extern void Hud_smooth(double *p_average, double sample);
+
+extern void Hud_destroy(Hud *p_hud);
+
+
+#endif /* H_HEXLIFE_HUD_H */
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 
 #include <SDL.h>
@@ -8,43 +9,81 @@
 #include <SDL_ttf.h>
 
 #include "grid.h"
+#include "cycle.h"
+#include "sim.h"
+#include "snapshot.h"
+#include "render.h"
+#include "hud.h"
+#include "profile.h"
+#include "timer.h"
 #include "bool.h"
 
 #define SCREEN_WIDTH_PX   (1000)
 #define SCREEN_HEIGHT_PX  (1000)
 
-#define GRID_WIDTH_CELLS   (100)
-#define GRID_HEIGHT_CELLS  (100)
+/* Overridden by -w and -h */
+#define GRID_DEFAULT_WIDTH_CELLS   (100)
+#define GRID_DEFAULT_HEIGHT_CELLS  (100)
 
-#define GRID_MIN_NEIGHBOURS_SURVIVE  (2)
-#define GRID_MAX_NEIGHBOURS_SURVIVE  (4)
-#define GRID_MIN_NEIGHBOURS_CREATE   (3)
-#define GRID_MAX_NEIGHBOURS_CREATE   (3)
+/* Survive with 2-4 neighbours, create with 3, overridden by the first argument */
+#define GRID_DEFAULT_RULE  "B3/S234"
 
 #define GRID_UPDATE_RATE_MS  (100)
 
+/* History scrub bar along the bottom edge */
+#define TIMELINE_Y_PX       (SCREEN_HEIGHT_PX - 14)
+#define TIMELINE_HEIGHT_PX  (6)
+#define TIMELINE_GRAB_PX    (6)
 
-SDL_Texture *loadTexture(char *pathToSprite, SDL_Renderer *p_renderer)
+/* Camera. Below GRID_MIN_SPRITE_STEP_PX per column cells are drawn one
+ * texel each, then from the density pyramid once under a pixel. */
+#define GRID_ZOOM_STEP           (1.25)
+#define GRID_MIN_SPRITE_STEP_PX  (4)
+#define GRID_MAX_SPRITES \
+    ((GRID_VIEWPORT_WIDTH_PX / GRID_MIN_SPRITE_STEP_PX + 3) * (GRID_VIEWPORT_HEIGHT_PX / GRID_MIN_SPRITE_STEP_PX + 3))
+
+/* Where 'G' runs to unless -g says otherwise */
+#define GRID_DEFAULT_TARGET_GENERATION  (1000000)
+
+
+/* Clamps before converting, the camera can be panned far off the grid */
+static int clampToInt(double value, int min, int max)
 {
-    SDL_Surface *p_miscSurf = IMG_Load(pathToSprite);
-    if (p_miscSurf == NULL)
+    if (value < min)
     {
-        printf("Could not load %s\n", pathToSprite);
-        return NULL;
+        return min;
     }
-
-    SDL_Texture *p_tex = SDL_CreateTextureFromSurface(p_renderer, p_miscSurf);
-    if (p_tex == NULL)
+    if (value > max)
     {
-        printf("Could not convert %s into texture\n", pathToSprite);
-        return NULL;
+        return max;
     }
+    return (int) value;
+}
 
-    SDL_FreeSurface(p_miscSurf);
 
-    return p_tex;
+static void printUsage(char *progName)
+{
+    printf("Usage: %s [rule] [options]\n", progName);
+    printf("  rule           B/S rule such as %s (the default)\n", GRID_DEFAULT_RULE);
+    printf("  -w <cells>     grid width (default %d)\n", GRID_DEFAULT_WIDTH_CELLS);
+    printf("  -h <cells>     grid height (default %d)\n", GRID_DEFAULT_HEIGHT_CELLS);
+    printf("  -B <ms>        time spent stepping per frame when fast forwarding\n");
+    printf("                 (default %d)\n", SIM_DEFAULT_FRAME_BUDGET_MS);
+    printf("  -g <gen>       run to this generation at start up, and whenever 'G'\n");
+    printf("                 is pressed (default %d)\n", GRID_DEFAULT_TARGET_GENERATION);
+    printf("  -u             run until stationary or periodic at start up\n");
+    printf("  -m <MiB>       memory the rewind history may use (default %d)\n", HISTORY_DEFAULT_MAX_BYTES / (1024 * 1024));
+    printf("  -l <file>      snapshot 'S' saves to and Shift+'S' restores from,\n");
+    printf("                 started from with its size and rule (default %s)\n", SIM_DEFAULT_SNAPSHOT_PATH);
+    printf("  -s <seed>      seed of the first random soup, each 'R' takes the next\n");
+    printf("                 (default the current time)\n");
+    printf("  -e <boundary>  what lies beyond the edges: torus, dead or reflect\n");
+    printf("                 (default torus)\n");
+    printf("  -P <file>      time each phase of every frame, print a summary on exit\n");
+    printf("                 and write a Chrome trace there, or CSV if it ends in .csv\n");
 }
 
+
 int main(int argc, char *argv[])
 {
     /* ------ DECLARATION ------ */
@@ -58,52 +97,198 @@ int main(int argc, char *argv[])
     SDL_Window *p_window = NULL;
     SDL_Renderer *p_renderer = NULL;
 
-    SDL_Texture *p_hexTex = NULL;
-    SDL_Texture *p_sikTex = NULL;
-    SDL_Texture *p_fixTex = NULL;
-    SDL_Surface *p_miscSurf = NULL;
+    /* Sprites in GRID_ALIVE, GRID_SICK, GRID_FIXED order */
+    const char *p_spritePaths[RENDER_NUM_SPRITES] =
+        { "assets/hex.png", "assets/hex_sick.png", "assets/hex_fix.png" };
+    Render_batch cellBatch;
+    Render_layer cellLayer;
 
-    SDL_Rect renderRect;
-    renderRect.w = GRID_CELL_WIDTH;
-    renderRect.h = GRID_CELL_HEIGHT;
+    float cell_xpos_px, cell_ypos_px;
+
+    /* Camera, and the blocks of the grid it shows */
+    SDL_Rect viewportRect = { GRID_X_POSITION_PX, GRID_Y_POSITION_PX, GRID_VIEWPORT_WIDTH_PX, GRID_VIEWPORT_HEIGHT_PX };
+    SDL_Rect layerRect;
+    double blockStepX_px, blockStepY_px;
+    int firstRow, endRow, firstCol, endCol;
+    int level;
+    const uint8_t *p_layerValues;
+    int layerStride;
 
     TTF_Font *p_font = NULL;
-    SDL_Texture *p_pausedTex = NULL;
-    SDL_Texture *p_rulesTex = NULL;
-    SDL_Rect pausedRect = { GRID_X_POSITION_PX, SCREEN_HEIGHT_PX - 40, 0, 0 };
-    SDL_Rect rulesRect =  { 0, SCREEN_HEIGHT_PX - 40, 0, 0 };
+    Hud hud;
+    Hud_metrics metrics = { 0.0, 0.0, 0.0, 0.0, 0 };
+    int showMetrics = FALSE;
 
     SDL_Color textColor = { 0xF7, 0xF7, 0xF7, 0xFF };
 
-    char rulesString[32];
+    char rulesString[HUD_MAX_TEXT_CHARS];
+    char ruleName[RULE_MAX_STRING_CHARS];
+    char *p_ruleString = GRID_DEFAULT_RULE;
+    int isRuleGiven = FALSE;
+    char statusString[HUD_MAX_TEXT_CHARS];
+    char progressString[HUD_MAX_TEXT_CHARS];
+
+    /* Performance overlay */
+    uint64_t frameStart_ns;
+    uint64_t lastFrame_ns;
+    uint64_t renderStart_ns;
+    uint64_t rateStart_ns;
+    uint64_t rateStartSteps = 0;
+    uint64_t lastFrameSteps = 0;
+
+    /* Profiling */
+    char *p_profilePath = NULL;
+    uint64_t frameProfile_ns;
+    uint64_t profile_ns;
 
     /* App control */
     SDL_Event event;
-    Uint64 currTime_ms;
-    Uint64 ellapsedTime_ms;
-    Uint64 lastRenderTime_ms;
 
     int quit = FALSE;
     int paused = TRUE;
     int mousePressed = FALSE;
+    int scrubbing = FALSE;
+    int panning = FALSE;
+    int mouse_xpos_px = 0, mouse_ypos_px = 0;
+    int panLastX_px = 0, panLastY_px = 0;
     uint8_t mouseCurrCellState = GRID_DEAD;
     uint8_t mouseNewCellState = GRID_DEAD;
     int mouse_xpos_pnt, mouse_ypos_pnt;
-
-    int gridUpdate = FALSE;
-    int isStationary = FALSE;
-    int prevStationary = FALSE;
+    int mouseRow, mouseCol;
 
     int shiftDown = FALSE;
     int ctrlDown = FALSE;
 
-    /* Grid */
-    Grid grid;
-    uint8_t savedGrid[GRID_WIDTH_CELLS * GRID_HEIGHT_CELLS];
+    /* Fast forward */
+    int frameBudget_ms = SIM_DEFAULT_FRAME_BUDGET_MS;
+    uint64_t targetGeneration = GRID_DEFAULT_TARGET_GENERATION;
+    int startMode = SIM_MODE_PACED;
+
+    /* Snapshot */
+    char *p_snapshotPath = NULL;
+    Grid snapshotGrid;
+    Rule snapshotRule;
+    int isSnapshotLoaded = FALSE;
+
+    /* History */
+    long historyLimit_mib = HISTORY_DEFAULT_MAX_BYTES / (1024 * 1024);
+    SDL_Rect timelineRect;
+    int scrubEntry;
+
+    /* Grid, stepped on its own thread and drawn from its latest frame */
+    uint64_t seed = (uint64_t) time(NULL);
+    int boundary = GRID_BOUNDARY_TORUS;
+    int width_cells = GRID_DEFAULT_WIDTH_CELLS;
+    int height_cells = GRID_DEFAULT_HEIGHT_CELLS;
+    Grid_view view;
+    Rule rule;
+    Sim *p_sim = NULL;
+    const Sim_frame *p_frame;
 
     int iRow, iCol;
+    int iArg;
+
+    /* ------ ARGUMENTS ------ */
+    for (iArg = 1; iArg < argc; iArg++)
+    {
+        if (argv[iArg][0] != '-')
+        {
+            p_ruleString = argv[iArg];
+            isRuleGiven = TRUE;
+            continue;
+        }
+        if (strcmp(argv[iArg], "-u") == 0)
+        {
+            startMode = SIM_MODE_SETTLE;
+            continue;
+        }
+
+        if (iArg + 1 >= argc || argv[iArg][1] == '\0' || argv[iArg][2] != '\0')
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        switch (argv[iArg][1])
+        {
+            case 'B':
+                frameBudget_ms = atoi(argv[++iArg]);
+                break;
+            case 'w':
+                width_cells = atoi(argv[++iArg]);
+                break;
+            case 'h':
+                height_cells = atoi(argv[++iArg]);
+                break;
+            case 'g':
+                targetGeneration = strtoull(argv[++iArg], NULL, 0);
+                startMode = SIM_MODE_TO_GEN;
+                break;
+            case 'l':
+                p_snapshotPath = argv[++iArg];
+                break;
+            case 'm':
+                historyLimit_mib = atol(argv[++iArg]);
+                break;
+            case 'P':
+                p_profilePath = argv[++iArg];
+                break;
+            case 's':
+                seed = strtoull(argv[++iArg], NULL, 0);
+                break;
+            case 'e':
+                if (Grid_parseBoundary(argv[++iArg], &boundary) != TRUE)
+                {
+                    return 1;
+                }
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (frameBudget_ms <= 0 || historyLimit_mib <= 0 || width_cells <= 0 || height_cells <= 0)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
 
     /* ------ INITIALISATION ------ */
+    /* Before any thread starts, so they are all timed and named */
+    if (p_profilePath != NULL)
+    {
+        Profile_enable();
+        Profile_nameThread("main");
+    }
+
+    /* Rules */
+    if (Rule_parse(p_ruleString, &rule) != TRUE)
+    {
+        return 1;
+    }
+
+    /* Start from the snapshot with its size and, unless one was given, its
+     * rule. One that cannot be loaded may just not have been saved yet. */
+    if (p_snapshotPath != NULL)
+    {
+        isSnapshotLoaded = Snapshot_load(p_snapshotPath, &snapshotGrid, &snapshotRule);
+        if (isSnapshotLoaded == TRUE)
+        {
+            width_cells = snapshotGrid.width_cells;
+            height_cells = snapshotGrid.height_cells;
+            if (isRuleGiven == FALSE)
+            {
+                rule = snapshotRule;
+            }
+        }
+        else
+        {
+            printf("Starting from a random soup instead\n");
+        }
+    }
+    Rule_toString(&rule, ruleName, RULE_MAX_STRING_CHARS);
+
     /* Initialise systems */
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
     {
@@ -154,34 +339,52 @@ int main(int argc, char *argv[])
     }
     SDL_SetRenderDrawColor(p_renderer, 0x0D, 0x0D, 0x0D, 0xFF);
 
-    /* Load Hex */
-    p_hexTex = loadTexture("assets/hex.png", p_renderer);
-    if (p_hexTex == NULL)
+    /* Load the cell sprites into one atlas, at most one quad per visible cell */
+    view = Grid_viewFor(width_cells, height_cells);
+    cellBatch = Render_createBatch(p_renderer, p_spritePaths, GRID_MAX_SPRITES);
+    if (cellBatch.p_atlas == NULL)
     {
-        printf("Could not load hex\n");
+        printf("Could not load hex sprites\n");
         return 1;
     }
 
-    p_sikTex = loadTexture("assets/hex_sick.png", p_renderer);
-    if (p_sikTex == NULL)
+    /* Zoomed out, at most one texel per viewport pixel plus partial edges */
+    cellLayer = Render_createLayer(p_renderer, GRID_VIEWPORT_WIDTH_PX + 2, GRID_VIEWPORT_HEIGHT_PX + 2);
+    if (cellLayer.p_texture == NULL)
     {
-        printf("Could not load sick hex\n");
         return 1;
     }
 
-    p_fixTex = loadTexture("assets/hex_fix.png", p_renderer);
-    if (p_fixTex == NULL)
+    /* Start grid, from a seed that is printed so the soup can be had again */
+    printf("Seed %llu\n", (unsigned long long) seed);
+    if (isSnapshotLoaded == TRUE)
+    {
+        printf("Loaded generation %llu from %s\n", (unsigned long long) snapshotGrid.generation, p_snapshotPath);
+        p_sim = Sim_createFromGrid(&snapshotGrid, &rule, seed, CYCLE_DEFAULT_MAX_PERIOD, GRID_UPDATE_RATE_MS);
+    }
+    else
+    {
+        p_sim = Sim_create(width_cells, height_cells, &rule, seed, CYCLE_DEFAULT_MAX_PERIOD, GRID_UPDATE_RATE_MS);
+    }
+    if (p_sim == NULL)
+    {
+        return 1;
+    }
+    Sim_setFrameBudget(p_sim, frameBudget_ms);
+    Sim_setHistoryLimit(p_sim, (size_t) historyLimit_mib * 1024 * 1024);
+    Sim_setBoundary(p_sim, boundary);
+    if (p_snapshotPath != NULL)
+    {
+        Sim_setSnapshotPath(p_sim, p_snapshotPath);
+    }
+    if (startMode != SIM_MODE_PACED)
+    {
+        Sim_setMode(p_sim, startMode, targetGeneration);
+    }
+    if (Sim_start(p_sim) != TRUE)
     {
-        printf("Could not load fix hex\n");
         return 1;
     }
-
-    /* Start grid */
-    srand(time(NULL));
-
-    grid = Grid_create(GRID_WIDTH_CELLS, GRID_HEIGHT_CELLS);
-    Grid_resetGrid(&grid);
-    memcpy(savedGrid, grid.p_disp, GRID_WIDTH_CELLS * GRID_HEIGHT_CELLS * sizeof(uint8_t));
 
     /* Load font */
     p_font = TTF_OpenFont("assets/monaco.ttf", 18);
@@ -191,12 +394,28 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    hud = Hud_create(p_renderer, p_font, textColor);
+    if (hud.p_glyphs == NULL)
+    {
+        return 1;
+    }
+
     /* ------ MAIN LOOP ------ */
-    lastRenderTime_ms = SDL_GetTicks();
-    ellapsedTime_ms = 0;
+    lastFrame_ns = Timer_nowNs();
+    rateStart_ns = lastFrame_ns;
     while (quit != TRUE)
     {
+        frameProfile_ns = Profile_begin();
+        frameStart_ns = Timer_nowNs();
+        Hud_smooth(&metrics.frame_ms, (frameStart_ns - lastFrame_ns) * 1e-6);
+        lastFrame_ns = frameStart_ns;
+
+        /* Newest finished generation, edits below are checked against it */
+        p_frame = Sim_latestFrame(p_sim);
+        paused = p_frame->running == TRUE ? FALSE : TRUE;
+
         /* Read input */
+        profile_ns = Profile_begin();
         while (SDL_PollEvent(&event))
         {
             if (event.type == SDL_QUIT)
@@ -213,6 +432,58 @@ int main(int argc, char *argv[])
 
                     case SDLK_SPACE:
                         paused = !paused;
+                        Sim_pushCommand(p_sim, SIM_CMD_RUN, 0, 0, paused == TRUE ? FALSE : TRUE);
+                        break;
+
+                    case SDLK_p:
+                        showMetrics = !showMetrics;
+                        break;
+
+                    case SDLK_HOME:
+                        view = Grid_viewFit(width_cells, height_cells);
+                        break;
+
+                    case SDLK_1:
+                        view = Grid_viewFor(width_cells, height_cells);
+                        break;
+
+                    case SDLK_EQUALS:
+                    case SDLK_PLUS:
+                    case SDLK_KP_PLUS:
+                        Grid_zoomView
+                           (&view, width_cells, height_cells, GRID_ZOOM_STEP,
+                            viewportRect.x + viewportRect.w / 2, viewportRect.y + viewportRect.h / 2);
+                        break;
+
+                    case SDLK_MINUS:
+                    case SDLK_KP_MINUS:
+                        Grid_zoomView
+                           (&view, width_cells, height_cells, 1.0 / GRID_ZOOM_STEP,
+                            viewportRect.x + viewportRect.w / 2, viewportRect.y + viewportRect.h / 2);
+                        break;
+
+                    case SDLK_LEFT:
+                        Sim_pushCommand(p_sim, SIM_CMD_STEP_BACK, 0, 0, 0);
+                        paused = TRUE;
+                        break;
+
+                    case SDLK_RIGHT:
+                        Sim_pushCommand(p_sim, SIM_CMD_STEP_FORWARD, 0, 0, 0);
+                        paused = TRUE;
+                        break;
+
+                    case SDLK_TAB:
+                        Sim_setMode(p_sim, p_frame->mode == SIM_MODE_PACED ? SIM_MODE_FAST : SIM_MODE_PACED, 0);
+                        break;
+
+                    case SDLK_u:
+                        Sim_setMode(p_sim, SIM_MODE_SETTLE, 0);
+                        paused = FALSE;
+                        break;
+
+                    case SDLK_g:
+                        Sim_setMode(p_sim, SIM_MODE_TO_GEN, targetGeneration);
+                        paused = FALSE;
                         break;
 
                     case SDLK_LSHIFT:
@@ -226,29 +497,29 @@ int main(int argc, char *argv[])
                         break;
 
                     case SDLK_r:
-                        Grid_resetGrid(&grid);
+                        Sim_pushCommand(p_sim, SIM_CMD_RESET, 0, 0, 0);
                         paused = TRUE;
                         break;
 
                     case SDLK_c:
-                        Grid_clearGrid(&grid);
+                        Sim_pushCommand(p_sim, SIM_CMD_CLEAR, 0, 0, 0);
                         paused = TRUE;
                         break;
 
                     case SDLK_f:
-                        Grid_fillGrid(&grid);
+                        Sim_pushCommand(p_sim, SIM_CMD_FILL, 0, 0, 0);
                         paused = TRUE;
                         break;
 
                     case SDLK_s:
                         if (shiftDown == TRUE)
                         {
-                            memcpy(grid.p_disp, savedGrid, GRID_WIDTH_CELLS * GRID_HEIGHT_CELLS * sizeof(uint8_t));
+                            Sim_pushCommand(p_sim, SIM_CMD_RESTORE, 0, 0, 0);
                             paused = TRUE;
                         }
                         else
                         {
-                            memcpy(savedGrid, grid.p_disp, GRID_WIDTH_CELLS * GRID_HEIGHT_CELLS * sizeof(uint8_t));
+                            Sim_pushCommand(p_sim, SIM_CMD_SAVE, 0, 0, 0);
                         }
                 }
             }
@@ -270,14 +541,48 @@ int main(int argc, char *argv[])
             else if (event.type == SDL_MOUSEMOTION)
             {
                 SDL_GetMouseState(&mouse_xpos_pnt, &mouse_ypos_pnt);
+                mouse_xpos_px = scaleFactor_width_pntToPx * mouse_xpos_pnt;
+                mouse_ypos_px = scaleFactor_height_pntToPx * mouse_ypos_pnt;
+
+                /* Right button drags the grid around */
+                if (panning == TRUE)
+                {
+                    view.origin_x_px += mouse_xpos_px - panLastX_px;
+                    view.origin_y_px += mouse_ypos_px - panLastY_px;
+                    panLastX_px = mouse_xpos_px;
+                    panLastY_px = mouse_ypos_px;
+                }
+            }
+            else if (event.type == SDL_MOUSEWHEEL && event.wheel.y != 0)
+            {
+                Grid_zoomView
+                   (&view, width_cells, height_cells, event.wheel.y > 0 ? GRID_ZOOM_STEP : 1.0 / GRID_ZOOM_STEP,
+                    mouse_xpos_px, mouse_ypos_px);
+            }
+            else if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_RIGHT)
+            {
+                panning = TRUE;
+                panLastX_px = mouse_xpos_px;
+                panLastY_px = mouse_ypos_px;
+            }
+            else if (event.type == SDL_MOUSEBUTTONDOWN
+                  && abs(mouse_ypos_px - (TIMELINE_Y_PX + TIMELINE_HEIGHT_PX / 2)) <= TIMELINE_GRAB_PX
+                  && p_frame->history_count > 1)
+            {
+                scrubbing = TRUE;
             }
-            else if (event.type == SDL_MOUSEBUTTONDOWN)
+            else if (event.type == SDL_MOUSEBUTTONDOWN
+                  && mouse_xpos_px >= viewportRect.x && mouse_xpos_px < viewportRect.x + viewportRect.w
+                  && mouse_ypos_px >= viewportRect.y && mouse_ypos_px < viewportRect.y + viewportRect.h)
             {
                 mousePressed = TRUE;
-                mouseCurrCellState = Grid_getDispValueFromMouse
-                   (&grid,
-                    scaleFactor_width_pntToPx * mouse_xpos_pnt,
-                    scaleFactor_height_pntToPx * mouse_ypos_pnt);
+                Grid_mouseToCell(&view, mouse_xpos_px, mouse_ypos_px, &mouseRow, &mouseCol);
+                mouseCurrCellState = GRID_DEAD;
+                if (mouseRow >= 0 && mouseRow < p_frame->height_cells
+                 && mouseCol >= 0 && mouseCol < p_frame->width_cells)
+                {
+                    mouseCurrCellState = Sim_frameValue(p_frame, mouseRow, mouseCol);
+                }
 
                 switch (mouseCurrCellState)
                 {
@@ -320,147 +625,204 @@ int main(int argc, char *argv[])
             else if (event.type == SDL_MOUSEBUTTONUP)
             {
                 mousePressed = FALSE;
+                scrubbing = FALSE;
+                panning = FALSE;
             }
         }
+        Profile_end(PROFILE_ZONE_EVENTS, profile_ns);
 
+        /* Edits are applied by the simulation thread before its next step */
         if (mousePressed == TRUE)
         {
-            Grid_changeCell
-                (&grid,
-                scaleFactor_width_pntToPx * mouse_xpos_pnt,
-                scaleFactor_height_pntToPx * mouse_ypos_pnt,
-                mouseNewCellState);
+            Grid_mouseToCell(&view, mouse_xpos_px, mouse_ypos_px, &mouseRow, &mouseCol);
+            Sim_pushCommand(p_sim, SIM_CMD_SET_CELL, mouseRow, mouseCol, mouseNewCellState);
         }
 
-        /* Handle pause */
-        if (paused == TRUE)
+        /* Dragging along the timeline seeks through the history */
+        timelineRect.x = GRID_X_POSITION_PX;
+        timelineRect.y = TIMELINE_Y_PX;
+        timelineRect.w = SCREEN_WIDTH_PX - 2 * GRID_X_POSITION_PX;
+        timelineRect.h = TIMELINE_HEIGHT_PX;
+        if (scrubbing == TRUE)
         {
-            gridUpdate = FALSE;
+            scrubEntry = (int) ((double) (mouse_xpos_px - timelineRect.x)
+                                * (p_frame->history_count - 1) / timelineRect.w + 0.5);
+            if (scrubEntry != p_frame->history_pos)
+            {
+                Sim_seekHistory(p_sim, scrubEntry);
+            }
+            paused = TRUE;
         }
 
-        /* Update grid */
-        if (gridUpdate == TRUE)
+        if (p_frame->num_steps != lastFrameSteps)
         {
-            isStationary = Grid_hexGridNextWithRange
-               (&grid,
-                GRID_MIN_NEIGHBOURS_SURVIVE, GRID_MAX_NEIGHBOURS_SURVIVE,
-                GRID_MIN_NEIGHBOURS_CREATE, GRID_MAX_NEIGHBOURS_CREATE);
+            Hud_smooth(&metrics.step_ms, p_frame->step_ms);
+            lastFrameSteps = p_frame->num_steps;
+        }
 
-            if (isStationary == TRUE && prevStationary == FALSE)
-            {
-                printf("Stationary achieved\n");
-            }
-            prevStationary = isStationary;
+        /* Generations per second over roughly the last second */
+        if (Timer_secondsSince(rateStart_ns) >= 1.0)
+        {
+            metrics.gens_per_s = (p_frame->num_steps - rateStartSteps) / Timer_secondsSince(rateStart_ns);
+            rateStartSteps = p_frame->num_steps;
+            rateStart_ns = Timer_nowNs();
         }
+        metrics.population = p_frame->population;
 
         /* ------ RENDER ------ */
         /* Render grid */
+        renderStart_ns = Timer_nowNs();
+        profile_ns = Profile_begin();
         SDL_RenderClear(p_renderer);
 
-        /* Render texture to screen */
-        renderRect.x = GRID_X_POSITION_PX;
-        renderRect.y = GRID_Y_POSITION_PX;
-        for (iRow = GRID_Y_RENDER_OFFSET_CELLS; iRow < (GRID_Y_RENDER_OFFSET_CELLS + GRID_Y_RENDER_NUM_CELLS); iRow++)
+        SDL_RenderSetClipRect(p_renderer, &viewportRect);
+        if (view.zoom * GRID_X_STEP_PX >= GRID_MIN_SPRITE_STEP_PX)
         {
-            for (iCol = GRID_X_RENDER_OFFSET_CELLS; iCol < (GRID_X_RENDER_OFFSET_CELLS + GRID_X_RENDER_NUM_CELLS); iCol++)
+            /* Queue every visible cell, then draw them all in one call */
+            firstCol = clampToInt((viewportRect.x - view.origin_x_px) / (view.zoom * GRID_X_STEP_PX) - 1, 0, width_cells);
+            endCol = clampToInt((viewportRect.x + viewportRect.w - view.origin_x_px) / (view.zoom * GRID_X_STEP_PX) + 1, 0, width_cells);
+            firstRow = clampToInt((viewportRect.y - view.origin_y_px) / (view.zoom * GRID_Y_STEP_PX) - 1, 0, height_cells);
+            endRow = clampToInt((viewportRect.y + viewportRect.h - view.origin_y_px) / (view.zoom * GRID_Y_STEP_PX) + 1, 0, height_cells);
+
+            for (iRow = firstRow; iRow < endRow; iRow++)
             {
-                switch (Grid_getDispValue(&grid, iRow, iCol))
+                for (iCol = firstCol; iCol < endCol; iCol++)
                 {
-                    case GRID_ALIVE:
-                        SDL_RenderCopy(p_renderer, p_hexTex, NULL, &renderRect);
-                        break;
-                    case GRID_SICK:
-                        SDL_RenderCopy(p_renderer, p_sikTex, NULL, &renderRect);
-                        break;
-                    case GRID_FIXED:
-                        SDL_RenderCopy(p_renderer, p_fixTex, NULL, &renderRect);
-                        break;
+                    cell_xpos_px = view.origin_x_px + view.zoom * iCol * GRID_X_STEP_PX;
+                    cell_ypos_px = view.origin_y_px
+                        + view.zoom * (iRow * GRID_Y_STEP_PX + (iCol % 2 == 0 ? GRID_Y_OFFSET_ROW_PX : 0));
+                    Render_addCell
+                       (&cellBatch, Sim_frameValue(p_frame, iRow, iCol),
+                        cell_xpos_px, cell_ypos_px, view.zoom * GRID_CELL_WIDTH, view.zoom * GRID_CELL_HEIGHT);
                 }
+            }
+            Render_flush(&cellBatch, p_renderer);
+        }
+        else
+        {
+            /* Coarsest level whose blocks are still at least a pixel across,
+             * level 0 being the cells themselves */
+            level = 0;
+            while (level < p_frame->density.num_levels && (double) ((int64_t) 1 << level) * view.zoom * GRID_X_STEP_PX < 1.0)
+            {
+                level++;
+            }
+            blockStepX_px = (double) ((int64_t) 1 << level) * view.zoom * GRID_X_STEP_PX;
+            blockStepY_px = (double) ((int64_t) 1 << level) * view.zoom * GRID_Y_STEP_PX;
 
-                renderRect.x += GRID_X_STEP_PX;
-                if (iCol % 2 == 0)
-                {
-                    renderRect.y -= GRID_Y_OFFSET_ROW_PX;
-                }
-                else
-                {
-                    renderRect.y += GRID_Y_OFFSET_ROW_PX;
-                }
+            firstCol = clampToInt((viewportRect.x - view.origin_x_px) / blockStepX_px, 0, p_frame->density.width_blocks[level]);
+            endCol = clampToInt((viewportRect.x + viewportRect.w - view.origin_x_px) / blockStepX_px + 1, 0, p_frame->density.width_blocks[level]);
+            firstRow = clampToInt((viewportRect.y - view.origin_y_px) / blockStepY_px, 0, p_frame->density.height_blocks[level]);
+            endRow = clampToInt((viewportRect.y + viewportRect.h - view.origin_y_px) / blockStepY_px + 1, 0, p_frame->density.height_blocks[level]);
+
+            if (level == 0)
+            {
+                layerStride = p_frame->stride_cells;
+                p_layerValues = p_frame->p_cells + (size_t) firstRow * layerStride + firstCol;
+            }
+            else
+            {
+                layerStride = p_frame->density.width_blocks[level];
+                p_layerValues = p_frame->density.p_levels[level] + (size_t) firstRow * layerStride + firstCol;
             }
 
-            renderRect.x = GRID_X_POSITION_PX;
-            renderRect.y += GRID_Y_STEP_PX;
+            layerRect.x = (int) (view.origin_x_px + firstCol * blockStepX_px);
+            layerRect.y = (int) (view.origin_y_px + firstRow * blockStepY_px);
+            layerRect.w = (int) (view.origin_x_px + endCol * blockStepX_px) - layerRect.x;
+            layerRect.h = (int) (view.origin_y_px + endRow * blockStepY_px) - layerRect.y;
+            Render_drawLayer
+               (&cellLayer, p_renderer, p_layerValues, layerStride,
+                endRow - firstRow, endCol - firstCol, level > 0 ? TRUE : FALSE, &layerRect);
         }
+        SDL_RenderSetClipRect(p_renderer, NULL);
 
-        /* Render text */
-        p_miscSurf = NULL;
-        if (paused)
+        /* Timeline, filled up to the entry shown */
+        if (p_frame->history_count > 1)
         {
-            p_miscSurf = TTF_RenderText_Solid(p_font, "Paused", textColor);
+            SDL_SetRenderDrawColor(p_renderer, 0x30, 0x30, 0x30, 0xFF);
+            SDL_RenderFillRect(p_renderer, &timelineRect);
+            timelineRect.w = timelineRect.w * p_frame->history_pos / (p_frame->history_count - 1);
+            SDL_SetRenderDrawColor(p_renderer, 0xF7, 0xF7, 0xF7, 0xFF);
+            SDL_RenderFillRect(p_renderer, &timelineRect);
+            SDL_SetRenderDrawColor(p_renderer, 0x0D, 0x0D, 0x0D, 0xFF);
         }
-        else
+        Profile_end(PROFILE_ZONE_GRID_DRAW, profile_ns);
+
+        /* Render text, labels are only rasterised again when they change */
+        profile_ns = Profile_begin();
+        switch (p_frame->mode)
         {
-            p_miscSurf = TTF_RenderText_Solid(p_font, "Running", textColor);
+            case SIM_MODE_FAST:
+                snprintf(statusString, HUD_MAX_TEXT_CHARS, "Fast forward");
+                break;
+
+            case SIM_MODE_SETTLE:
+                snprintf(statusString, HUD_MAX_TEXT_CHARS, "Running until settled");
+                break;
+
+            case SIM_MODE_TO_GEN:
+                snprintf(statusString, HUD_MAX_TEXT_CHARS, "Running to generation %llu",
+                         (unsigned long long) p_frame->target_generation);
+                break;
+
+            default:
+                snprintf(statusString, HUD_MAX_TEXT_CHARS, "Running");
+                break;
         }
+        Hud_setLabel(&hud, &hud.status, p_renderer, paused == TRUE ? "Paused" : statusString);
+        Hud_drawLabel(&hud.status, p_renderer, GRID_X_POSITION_PX, SCREEN_HEIGHT_PX - 40);
 
-        if (p_miscSurf != NULL)
+        /* Fast modes skip most generations on screen, so show how far they got */
+        if (paused == FALSE && p_frame->mode != SIM_MODE_PACED)
         {
-            p_pausedTex = SDL_CreateTextureFromSurface(p_renderer, p_miscSurf);
-            if (p_pausedTex != NULL)
-            {
-                pausedRect.w = p_miscSurf->w;
-                pausedRect.h = p_miscSurf->h;
-                SDL_RenderCopy(p_renderer, p_pausedTex, NULL, &pausedRect);
-            }
+            snprintf(progressString, HUD_MAX_TEXT_CHARS, "Gen %llu  %.0f gen/s",
+                     (unsigned long long) p_frame->generation, metrics.gens_per_s);
+            Hud_drawText(&hud, p_renderer, progressString, GRID_X_POSITION_PX, SCREEN_HEIGHT_PX - 40 - hud.glyph_height_px);
         }
-        SDL_FreeSurface(p_miscSurf);
+        else if (p_frame->history_pos < p_frame->history_count - 1)
+        {
+            snprintf(progressString, HUD_MAX_TEXT_CHARS, "Gen %llu  %d back",
+                     (unsigned long long) p_frame->generation, p_frame->history_count - 1 - p_frame->history_pos);
+            Hud_drawText(&hud, p_renderer, progressString, GRID_X_POSITION_PX, SCREEN_HEIGHT_PX - 40 - hud.glyph_height_px);
+        }
+        snprintf(rulesString, HUD_MAX_TEXT_CHARS, "Seed: %llu  Rule: %s", (unsigned long long) p_frame->seed, ruleName);
+        Hud_setLabel(&hud, &hud.rule, p_renderer, rulesString);
+        Hud_drawLabel(&hud.rule, p_renderer, SCREEN_WIDTH_PX - GRID_X_POSITION_PX - hud.rule.width_px, SCREEN_HEIGHT_PX - 40);
 
-        snprintf(rulesString, 32, "Live: %d-%d, Birth: %d-%d",
-                 GRID_MIN_NEIGHBOURS_SURVIVE, GRID_MAX_NEIGHBOURS_SURVIVE,
-                 GRID_MIN_NEIGHBOURS_CREATE, GRID_MAX_NEIGHBOURS_CREATE);
-        p_miscSurf = TTF_RenderText_Solid(p_font, rulesString, textColor);
-        if (p_miscSurf != NULL)
+        if (showMetrics == TRUE)
         {
-            p_rulesTex = SDL_CreateTextureFromSurface(p_renderer, p_miscSurf);
-            if (p_rulesTex != NULL)
-            {
-                rulesRect.w = p_miscSurf->w;
-                rulesRect.h = p_miscSurf->h;
-                rulesRect.x = SCREEN_WIDTH_PX - GRID_X_POSITION_PX - rulesRect.w;
-                SDL_RenderCopy(p_renderer, p_rulesTex, NULL, &rulesRect);
-            }
+            Hud_drawMetrics(&hud, p_renderer, &metrics, 8, 8);
         }
-        SDL_FreeSurface(p_miscSurf);
+        Profile_end(PROFILE_ZONE_TEXT, profile_ns);
+        Hud_smooth(&metrics.render_ms, Timer_secondsSince(renderStart_ns) * 1e3);
 
         /* Update screen */
+        profile_ns = Profile_begin();
         SDL_RenderPresent(p_renderer);
-
-        /* Time */
-        currTime_ms = SDL_GetTicks();
-        ellapsedTime_ms = ellapsedTime_ms + currTime_ms - lastRenderTime_ms;
-        lastRenderTime_ms = currTime_ms;
-
-        if (ellapsedTime_ms > GRID_UPDATE_RATE_MS)
-        {
-            ellapsedTime_ms -= GRID_UPDATE_RATE_MS;
-            gridUpdate = TRUE;
-        }
-        else
-        {
-            gridUpdate = FALSE;
-        }
+        Profile_end(PROFILE_ZONE_PRESENT, profile_ns);
+        Profile_end(PROFILE_ZONE_FRAME, frameProfile_ns);
     }
 
     /* ------ CLEAN UP ----- */
-    /* Destroy grid */
-    Grid_destroy(&grid);
+    /* Stop the simulation thread and destroy the grid */
+    Sim_destroy(p_sim);
+
+    /* Every timed thread has stopped by now */
+    if (p_profilePath != NULL)
+    {
+        Profile_printSummary();
+        Profile_write(p_profilePath);
+    }
 
     /* Destroy window */
+    Render_destroyBatch(&cellBatch);
+    Render_destroyLayer(&cellLayer);
+    Hud_destroy(&hud);
+    TTF_CloseFont(p_font);
+
     SDL_DestroyWindow(p_window);
     p_window = NULL;
 
-    SDL_DestroyTexture(p_hexTex);
-
     /* Quit SDL subsystems */
     SDL_Quit();
 
@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pool.h"
+#include "profile.h"
+#include "bool.h"
+
+
+typedef struct Pool_worker_struct {
+    Pool *p_pool;
+    int iThread;
+} Pool_worker;
+
+
+static void runShare(Pool *p_pool, int iThread)
+{
+    int iTask;
+
+    for (iTask = iThread; iTask < p_pool->num_tasks; iTask += p_pool->num_threads)
+    {
+        p_pool->taskFn(p_pool->p_ctx, iTask);
+    }
+}
+
+
+static void *workerMain(void *p_arg)
+{
+    Pool_worker *p_worker = p_arg;
+    Pool *p_pool = p_worker->p_pool;
+    unsigned long lastJobId = 0;
+    char name[16];
+
+    snprintf(name, sizeof(name), "worker %d", p_worker->iThread);
+    Profile_nameThread(name);
+
+    pthread_mutex_lock(&p_pool->lock);
+    while (TRUE)
+    {
+        while (p_pool->quit == FALSE && p_pool->jobId == lastJobId)
+        {
+            pthread_cond_wait(&p_pool->startCond, &p_pool->lock);
+        }
+        if (p_pool->quit == TRUE)
+        {
+            break;
+        }
+        lastJobId = p_pool->jobId;
+        pthread_mutex_unlock(&p_pool->lock);
+
+        runShare(p_pool, p_worker->iThread);
+
+        pthread_mutex_lock(&p_pool->lock);
+        p_pool->busyWorkers--;
+        if (p_pool->busyWorkers == 0)
+        {
+            pthread_cond_signal(&p_pool->doneCond);
+        }
+    }
+    pthread_mutex_unlock(&p_pool->lock);
+
+    free(p_worker);
+
+    return NULL;
+}
+
+
+int Pool_numCores(void)
+{
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return numCores > 0 ? (int) numCores : 1;
+}
+
+
+Pool *Pool_create(int numThreads)
+{
+    Pool *p_pool;
+    Pool_worker *p_worker;
+    int iThread;
+
+    if (numThreads <= 0)
+    {
+        numThreads = Pool_numCores();
+    }
+
+    p_pool = calloc(1, sizeof(Pool));
+    if (p_pool == NULL)
+    {
+        printf("[ERR] Could not create pool\n");
+        return NULL;
+    }
+
+    p_pool->p_threads = calloc(numThreads, sizeof(pthread_t));
+    if (p_pool->p_threads == NULL)
+    {
+        printf("[ERR] Could not create pool\n");
+        free(p_pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&p_pool->lock, NULL);
+    pthread_cond_init(&p_pool->startCond, NULL);
+    pthread_cond_init(&p_pool->doneCond, NULL);
+
+    /* Thread 0 is whoever calls Pool_run */
+    p_pool->num_threads = 1;
+    for (iThread = 1; iThread < numThreads; iThread++)
+    {
+        p_worker = malloc(sizeof(Pool_worker));
+        if (p_worker == NULL)
+        {
+            break;
+        }
+        p_worker->p_pool = p_pool;
+        p_worker->iThread = iThread;
+
+        if (pthread_create(&p_pool->p_threads[iThread], NULL, workerMain, p_worker) != 0)
+        {
+            free(p_worker);
+            break;
+        }
+        p_pool->num_threads++;
+    }
+
+    if (p_pool->num_threads < numThreads)
+    {
+        printf("[ERR] Could only start %d of %d threads\n", p_pool->num_threads, numThreads);
+    }
+
+    return p_pool;
+}
+
+
+void Pool_run(Pool *p_pool, Pool_taskFn taskFn, void *p_ctx, int numTasks)
+{
+    pthread_mutex_lock(&p_pool->lock);
+    p_pool->taskFn = taskFn;
+    p_pool->p_ctx = p_ctx;
+    p_pool->num_tasks = numTasks;
+    p_pool->busyWorkers = p_pool->num_threads - 1;
+    p_pool->jobId++;
+    pthread_cond_broadcast(&p_pool->startCond);
+    pthread_mutex_unlock(&p_pool->lock);
+
+    runShare(p_pool, 0);
+
+    pthread_mutex_lock(&p_pool->lock);
+    while (p_pool->busyWorkers > 0)
+    {
+        pthread_cond_wait(&p_pool->doneCond, &p_pool->lock);
+    }
+    pthread_mutex_unlock(&p_pool->lock);
+}
+
+
+void Pool_destroy(Pool *p_pool)
+{
+    int iThread;
+
+    if (p_pool == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&p_pool->lock);
+    p_pool->quit = TRUE;
+    pthread_cond_broadcast(&p_pool->startCond);
+    pthread_mutex_unlock(&p_pool->lock);
+
+    for (iThread = 1; iThread < p_pool->num_threads; iThread++)
+    {
+        pthread_join(p_pool->p_threads[iThread], NULL);
+    }
+
+    pthread_mutex_destroy(&p_pool->lock);
+    pthread_cond_destroy(&p_pool->startCond);
+    pthread_cond_destroy(&p_pool->doneCond);
+
+    free(p_pool->p_threads);
+    free(p_pool);
+}
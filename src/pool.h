@@ -0,0 +1,42 @@
+#ifndef H_HEXLIFE_POOL_H
+#define H_HEXLIFE_POOL_H
+
+
+#include <pthread.h>
+
+
+typedef void (*Pool_taskFn)(void *p_ctx, int iTask);
+
+
+/* Persistent worker pool. The thread calling Pool_run works as thread 0, so a
+ * pool of one thread runs everything inline. */
+typedef struct Pool_struct {
+    pthread_t *p_threads;
+    int num_threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t startCond;
+    pthread_cond_t doneCond;
+
+    /* Current job */
+    Pool_taskFn taskFn;
+    void *p_ctx;
+    int num_tasks;
+
+    unsigned long jobId;
+    int busyWorkers;
+    int quit;
+} Pool;
+
+
+extern int Pool_numCores(void);
+
+extern Pool *Pool_create(int numThreads);
+
+/* Runs taskFn(p_ctx, i) for every i in [0, numTasks) and waits for them all */
+extern void Pool_run(Pool *p_pool, Pool_taskFn taskFn, void *p_ctx, int numTasks);
+
+extern void Pool_destroy(Pool *p_pool);
+
+
+#endif /* H_HEXLIFE_POOL_H */
@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "profile.h"
+
+
+#define PROFILE_MAX_NAME_CHARS  (32)
+
+/* Histogram bars from empty to the fullest bucket */
+#define PROFILE_BAR_LEVELS  " .:-=+*#%@"
+
+
+typedef struct Profile_event_struct {
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    int zone;
+} Profile_event;
+
+
+/* Written only by its own thread, read once they have all stopped */
+typedef struct Profile_thread_struct {
+    Profile_event *p_events;
+    uint64_t num_recorded;
+    char name[PROFILE_MAX_NAME_CHARS];
+} Profile_thread;
+
+
+int Profile_enabled = FALSE;
+
+static Profile_thread threads[PROFILE_MAX_THREADS];
+static int numThreads = 0;
+static pthread_mutex_t threadsLock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t enabled_ns = 0;
+
+static __thread Profile_thread *p_currentThread = NULL;
+/* Set when there was no slot or memory left, so the thread stops asking */
+static __thread int isUntracked = FALSE;
+
+
+static const char *zoneNames[PROFILE_NUM_ZONES] =
+    { "frame", "events", "edit", "step", "step band", "history", "publish", "grid draw", "text", "present", "export" };
+
+
+static Profile_thread *currentThread(void)
+{
+    Profile_thread *p_thread = NULL;
+    Profile_event *p_events;
+
+    if (p_currentThread != NULL || isUntracked == TRUE)
+    {
+        return p_currentThread;
+    }
+
+    p_events = malloc(PROFILE_MAX_EVENTS * sizeof(Profile_event));
+
+    pthread_mutex_lock(&threadsLock);
+    if (p_events != NULL && numThreads < PROFILE_MAX_THREADS)
+    {
+        p_thread = &threads[numThreads];
+        p_thread->p_events = p_events;
+        p_thread->num_recorded = 0;
+        snprintf(p_thread->name, PROFILE_MAX_NAME_CHARS, "thread %d", numThreads);
+        numThreads++;
+    }
+    pthread_mutex_unlock(&threadsLock);
+
+    if (p_thread == NULL)
+    {
+        free(p_events);
+        isUntracked = TRUE;
+    }
+    p_currentThread = p_thread;
+
+    return p_thread;
+}
+
+
+/* Events oldest first, the ring having wrapped or not */
+static uint64_t numKept(const Profile_thread *p_thread)
+{
+    return p_thread->num_recorded < PROFILE_MAX_EVENTS ? p_thread->num_recorded : PROFILE_MAX_EVENTS;
+}
+
+
+static const Profile_event *keptEvent(const Profile_thread *p_thread, uint64_t iEvent)
+{
+    uint64_t first = p_thread->num_recorded - numKept(p_thread);
+
+    return &p_thread->p_events[(first + iEvent) % PROFILE_MAX_EVENTS];
+}
+
+
+static int bucketOf(uint64_t duration_ns)
+{
+    int bucket = 0;
+
+    while (duration_ns > 1 && bucket < PROFILE_NUM_BUCKETS - 1)
+    {
+        duration_ns >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+
+static int compareU64(const void *p_a, const void *p_b)
+{
+    uint64_t a = *(const uint64_t *) p_a;
+    uint64_t b = *(const uint64_t *) p_b;
+
+    return (a > b) - (a < b);
+}
+
+
+void Profile_enable(void)
+{
+    enabled_ns = Timer_nowNs();
+    Profile_enabled = TRUE;
+}
+
+
+void Profile_nameThread(const char *p_name)
+{
+    Profile_thread *p_thread;
+
+    /* Threads only get a ring once profiling is on */
+    if (Profile_enabled == FALSE)
+    {
+        return;
+    }
+
+    p_thread = currentThread();
+    if (p_thread != NULL)
+    {
+        snprintf(p_thread->name, PROFILE_MAX_NAME_CHARS, "%s", p_name);
+    }
+}
+
+
+void Profile_record(int zone, uint64_t start_ns, uint64_t end_ns)
+{
+    Profile_thread *p_thread = currentThread();
+    Profile_event *p_event;
+
+    if (p_thread == NULL)
+    {
+        return;
+    }
+
+    p_event = &p_thread->p_events[p_thread->num_recorded % PROFILE_MAX_EVENTS];
+    p_event->start_ns = start_ns;
+    p_event->duration_ns = end_ns - start_ns;
+    p_event->zone = zone;
+    p_thread->num_recorded++;
+}
+
+
+const char *Profile_zoneName(int zone)
+{
+    if (zone < 0 || zone >= PROFILE_NUM_ZONES)
+    {
+        return "unknown";
+    }
+
+    return zoneNames[zone];
+}
+
+
+uint64_t Profile_histogram(int zone, uint64_t counts[PROFILE_NUM_BUCKETS])
+{
+    const Profile_event *p_event;
+    uint64_t total = 0;
+    uint64_t iEvent;
+    int iThread;
+
+    memset(counts, 0, PROFILE_NUM_BUCKETS * sizeof(uint64_t));
+
+    pthread_mutex_lock(&threadsLock);
+    for (iThread = 0; iThread < numThreads; iThread++)
+    {
+        for (iEvent = 0; iEvent < numKept(&threads[iThread]); iEvent++)
+        {
+            p_event = keptEvent(&threads[iThread], iEvent);
+            if (p_event->zone == zone)
+            {
+                counts[bucketOf(p_event->duration_ns)]++;
+                total++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&threadsLock);
+
+    return total;
+}
+
+
+static void printHistogram(const uint64_t counts[PROFILE_NUM_BUCKETS])
+{
+    const char *p_levels = PROFILE_BAR_LEVELS;
+    int numLevels = (int) strlen(PROFILE_BAR_LEVELS);
+    uint64_t most = 0;
+    int first = PROFILE_NUM_BUCKETS;
+    int last = 0;
+    int iBucket;
+
+    for (iBucket = 0; iBucket < PROFILE_NUM_BUCKETS; iBucket++)
+    {
+        if (counts[iBucket] > 0)
+        {
+            first = iBucket < first ? iBucket : first;
+            last = iBucket;
+            most = counts[iBucket] > most ? counts[iBucket] : most;
+        }
+    }
+    if (most == 0)
+    {
+        return;
+    }
+
+    /* One character per doubling, starting at 2^first ns */
+    printf("  2^%-2d ns |", first);
+    for (iBucket = first; iBucket <= last; iBucket++)
+    {
+        putchar(p_levels[counts[iBucket] == 0 ? 0 : 1 + (int) ((counts[iBucket] - 1) * (numLevels - 1) / most)]);
+    }
+    printf("|\n");
+}
+
+
+void Profile_printSummary(void)
+{
+    uint64_t counts[PROFILE_NUM_BUCKETS];
+    uint64_t *p_durations;
+    uint64_t numDurations;
+    uint64_t totalEvents = 0;
+    uint64_t iEvent;
+    double sum_ns;
+    int iThread;
+    int zone;
+
+    for (iThread = 0; iThread < numThreads; iThread++)
+    {
+        totalEvents += numKept(&threads[iThread]);
+    }
+    if (totalEvents == 0)
+    {
+        return;
+    }
+
+    p_durations = malloc(totalEvents * sizeof(uint64_t));
+    if (p_durations == NULL)
+    {
+        return;
+    }
+
+    printf("%-10s %9s %10s %10s %10s %10s\n", "Zone", "Count", "Mean ms", "p50 ms", "p99 ms", "Max ms");
+    for (zone = 0; zone < PROFILE_NUM_ZONES; zone++)
+    {
+        numDurations = 0;
+        sum_ns = 0.0;
+        for (iThread = 0; iThread < numThreads; iThread++)
+        {
+            for (iEvent = 0; iEvent < numKept(&threads[iThread]); iEvent++)
+            {
+                if (keptEvent(&threads[iThread], iEvent)->zone == zone)
+                {
+                    p_durations[numDurations] = keptEvent(&threads[iThread], iEvent)->duration_ns;
+                    sum_ns += p_durations[numDurations];
+                    numDurations++;
+                }
+            }
+        }
+        if (numDurations == 0)
+        {
+            continue;
+        }
+
+        qsort(p_durations, numDurations, sizeof(uint64_t), compareU64);
+        printf("%-10s %9llu %10.4f %10.4f %10.4f %10.4f",
+               zoneNames[zone], (unsigned long long) numDurations,
+               sum_ns / numDurations * 1e-6,
+               p_durations[numDurations / 2] * 1e-6,
+               p_durations[(numDurations - 1) * 99 / 100] * 1e-6,
+               p_durations[numDurations - 1] * 1e-6);
+
+        Profile_histogram(zone, counts);
+        printHistogram(counts);
+    }
+
+    free(p_durations);
+}
+
+
+static void writeCsv(FILE *p_file)
+{
+    const Profile_event *p_event;
+    uint64_t iEvent;
+    int iThread;
+
+    fprintf(p_file, "thread,zone,start_us,duration_us\n");
+    for (iThread = 0; iThread < numThreads; iThread++)
+    {
+        for (iEvent = 0; iEvent < numKept(&threads[iThread]); iEvent++)
+        {
+            p_event = keptEvent(&threads[iThread], iEvent);
+            fprintf(p_file, "%s,%s,%.3f,%.3f\n",
+                    threads[iThread].name, zoneNames[p_event->zone],
+                    (p_event->start_ns - enabled_ns) * 1e-3, p_event->duration_ns * 1e-3);
+        }
+    }
+}
+
+
+/* Complete ("X") events in microseconds, with a metadata event naming each thread */
+static void writeTrace(FILE *p_file)
+{
+    const Profile_event *p_event;
+    uint64_t iEvent;
+    int iThread;
+
+    fprintf(p_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (iThread = 0; iThread < numThreads; iThread++)
+    {
+        fprintf(p_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                iThread == 0 ? "" : ",\n", iThread, threads[iThread].name);
+    }
+    for (iThread = 0; iThread < numThreads; iThread++)
+    {
+        for (iEvent = 0; iEvent < numKept(&threads[iThread]); iEvent++)
+        {
+            p_event = keptEvent(&threads[iThread], iEvent);
+            fprintf(p_file, ",\n{\"name\":\"%s\",\"cat\":\"hexlife\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    zoneNames[p_event->zone], iThread,
+                    (p_event->start_ns - enabled_ns) * 1e-3, p_event->duration_ns * 1e-3);
+        }
+    }
+    fprintf(p_file, "\n]}\n");
+}
+
+
+int Profile_write(const char *p_path)
+{
+    FILE *p_file;
+    size_t pathLen = strlen(p_path);
+    int isWritten = TRUE;
+
+    p_file = fopen(p_path, "w");
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", p_path);
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&threadsLock);
+    if (pathLen >= 4 && strcmp(p_path + pathLen - 4, ".csv") == 0)
+    {
+        writeCsv(p_file);
+    }
+    else
+    {
+        writeTrace(p_file);
+    }
+    pthread_mutex_unlock(&threadsLock);
+
+    if (ferror(p_file))
+    {
+        isWritten = FALSE;
+    }
+    if (fclose(p_file) != 0)
+    {
+        isWritten = FALSE;
+    }
+    if (isWritten == FALSE)
+    {
+        printf("[ERR] Could not write %s\n", p_path);
+    }
+
+    return isWritten;
+}
@@ -0,0 +1,88 @@
+#ifndef H_HEXLIFE_PROFILE_H
+#define H_HEXLIFE_PROFILE_H
+
+
+#include <stdint.h>
+
+#include "timer.h"
+#include "bool.h"
+
+
+/* Timed phases. Zones can nest and may be timed on any thread. */
+#define PROFILE_ZONE_FRAME      (0)
+#define PROFILE_ZONE_EVENTS     (1)
+#define PROFILE_ZONE_EDIT       (2)
+#define PROFILE_ZONE_STEP       (3)
+/* One band of tile rows, on whichever pool thread ran it */
+#define PROFILE_ZONE_STEP_BAND  (4)
+#define PROFILE_ZONE_HISTORY    (5)
+#define PROFILE_ZONE_PUBLISH    (6)
+#define PROFILE_ZONE_GRID_DRAW  (7)
+#define PROFILE_ZONE_TEXT       (8)
+#define PROFILE_ZONE_PRESENT    (9)
+/* Drawing and encoding one exported frame */
+#define PROFILE_ZONE_EXPORT     (10)
+#define PROFILE_NUM_ZONES       (11)
+
+/* Each thread keeps its latest events in a ring this long, which is also
+ * the window the histograms cover */
+#define PROFILE_MAX_EVENTS   (65536)
+#define PROFILE_MAX_THREADS  (64)
+
+/* Log2 buckets of the duration in nanoseconds */
+#define PROFILE_NUM_BUCKETS  (40)
+
+
+/* Set by Profile_enable. Read without locking, so only change it while no
+ * other thread is timing anything. */
+extern int Profile_enabled;
+
+
+extern void Profile_enable(void);
+
+/* Names the calling thread in exported traces, ignored until enabled */
+extern void Profile_nameThread(const char *p_name);
+
+extern void Profile_record(int zone, uint64_t start_ns, uint64_t end_ns);
+
+extern const char *Profile_zoneName(int zone);
+
+/* Counts of the zone's recent durations by log2 of nanoseconds, over every
+ * thread. Returns how many there were. */
+extern uint64_t Profile_histogram(int zone, uint64_t counts[PROFILE_NUM_BUCKETS]);
+
+/* Count, mean, median, 99th percentile and worst of every zone seen */
+extern void Profile_printSummary(void);
+
+/* Chrome trace event JSON, for chrome://tracing or Perfetto, or CSV when
+ * p_path ends in .csv. Only call once every timed thread has stopped. */
+extern int Profile_write(const char *p_path);
+
+
+/* Scoped timing is compiled out entirely unless HEXLIFE_PROFILE is defined,
+ * and costs one branch until Profile_enable is called */
+static inline uint64_t Profile_begin(void)
+{
+#ifdef HEXLIFE_PROFILE
+    return Profile_enabled == TRUE ? Timer_nowNs() : 0;
+#else
+    return 0;
+#endif
+}
+
+
+static inline void Profile_end(int zone, uint64_t start_ns)
+{
+#ifdef HEXLIFE_PROFILE
+    if (start_ns != 0)
+    {
+        Profile_record(zone, start_ns, Timer_nowNs());
+    }
+#else
+    (void) zone;
+    (void) start_ns;
+#endif
+}
+
+
+#endif /* H_HEXLIFE_PROFILE_H */
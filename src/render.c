@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL_image.h>
+
+#include "render.h"
+
+
+#define RENDER_VERTICES_PER_QUAD  (4)
+#define RENDER_INDICES_PER_QUAD   (6)
+
+/* Layer colours, the background matches the renderer's clear colour */
+#define RENDER_BACKGROUND_GREY  (0x0D)
+#define RENDER_ALIVE_GREY       (0xF7)
+
+
+static int loadSprites(const char *p_spritePaths[RENDER_NUM_SPRITES], SDL_Surface *p_sprites[RENDER_NUM_SPRITES])
+{
+    SDL_Surface *p_loaded;
+    int iSprite;
+
+    for (iSprite = 0; iSprite < RENDER_NUM_SPRITES; iSprite++)
+    {
+        p_loaded = IMG_Load(p_spritePaths[iSprite]);
+        if (p_loaded == NULL)
+        {
+            printf("Could not load %s\n", p_spritePaths[iSprite]);
+            return FALSE;
+        }
+
+        p_sprites[iSprite] = SDL_ConvertSurfaceFormat(p_loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(p_loaded);
+        if (p_sprites[iSprite] == NULL)
+        {
+            printf("Could not convert %s\n", p_spritePaths[iSprite]);
+            return FALSE;
+        }
+
+        if (p_sprites[iSprite]->w != p_sprites[0]->w || p_sprites[iSprite]->h != p_sprites[0]->h)
+        {
+            printf("%s does not match the size of %s\n", p_spritePaths[iSprite], p_spritePaths[0]);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+static SDL_Texture *loadAtlas(SDL_Renderer *p_renderer, const char *p_spritePaths[RENDER_NUM_SPRITES], int *p_spriteWidth, int *p_spriteHeight)
+{
+    SDL_Surface *p_sprites[RENDER_NUM_SPRITES] = { NULL };
+    SDL_Surface *p_atlasSurf = NULL;
+    SDL_Texture *p_atlas = NULL;
+    SDL_Rect dstRect;
+    int iSprite;
+
+    if (loadSprites(p_spritePaths, p_sprites) == TRUE)
+    {
+        *p_spriteWidth = p_sprites[0]->w;
+        *p_spriteHeight = p_sprites[0]->h;
+
+        p_atlasSurf = SDL_CreateRGBSurfaceWithFormat
+           (0, RENDER_NUM_SPRITES * p_sprites[0]->w, p_sprites[0]->h, 32, SDL_PIXELFORMAT_RGBA32);
+        if (p_atlasSurf == NULL)
+        {
+            printf("Could not create atlas surface\n");
+        }
+    }
+
+    if (p_atlasSurf != NULL)
+    {
+        /* Copy alpha as is rather than blending it onto the empty atlas */
+        dstRect.x = 0;
+        dstRect.y = 0;
+        for (iSprite = 0; iSprite < RENDER_NUM_SPRITES; iSprite++)
+        {
+            SDL_SetSurfaceBlendMode(p_sprites[iSprite], SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(p_sprites[iSprite], NULL, p_atlasSurf, &dstRect);
+            dstRect.x += p_sprites[0]->w;
+        }
+
+        p_atlas = SDL_CreateTextureFromSurface(p_renderer, p_atlasSurf);
+        if (p_atlas == NULL)
+        {
+            printf("Could not convert atlas into texture\n");
+        }
+        SDL_FreeSurface(p_atlasSurf);
+    }
+
+    for (iSprite = 0; iSprite < RENDER_NUM_SPRITES; iSprite++)
+    {
+        SDL_FreeSurface(p_sprites[iSprite]);
+    }
+
+    return p_atlas;
+}
+
+
+Render_batch Render_createBatch(SDL_Renderer *p_renderer, const char *p_spritePaths[RENDER_NUM_SPRITES], int maxQuads)
+{
+    Render_batch batch;
+    int iQuad;
+    int *p_quadIndices;
+
+    memset(&batch, 0, sizeof(Render_batch));
+
+    batch.p_vertices = malloc(maxQuads * RENDER_VERTICES_PER_QUAD * sizeof(SDL_Vertex));
+    batch.p_indices = malloc(maxQuads * RENDER_INDICES_PER_QUAD * sizeof(int));
+    if (batch.p_vertices == NULL || batch.p_indices == NULL)
+    {
+        printf("[ERR] Failed to allocate a batch of %d quads\n", maxQuads);
+        Render_destroyBatch(&batch);
+        return batch;
+    }
+    batch.max_quads = maxQuads;
+
+    /* Every quad is two triangles over its own four vertices, so the index
+     * buffer never changes */
+    for (iQuad = 0; iQuad < maxQuads; iQuad++)
+    {
+        p_quadIndices = &batch.p_indices[iQuad * RENDER_INDICES_PER_QUAD];
+        p_quadIndices[0] = iQuad * RENDER_VERTICES_PER_QUAD + 0;
+        p_quadIndices[1] = iQuad * RENDER_VERTICES_PER_QUAD + 1;
+        p_quadIndices[2] = iQuad * RENDER_VERTICES_PER_QUAD + 2;
+        p_quadIndices[3] = iQuad * RENDER_VERTICES_PER_QUAD + 2;
+        p_quadIndices[4] = iQuad * RENDER_VERTICES_PER_QUAD + 3;
+        p_quadIndices[5] = iQuad * RENDER_VERTICES_PER_QUAD + 0;
+    }
+
+    batch.p_atlas = loadAtlas(p_renderer, p_spritePaths, &batch.sprite_width_px, &batch.sprite_height_px);
+    if (batch.p_atlas == NULL)
+    {
+        Render_destroyBatch(&batch);
+    }
+
+    return batch;
+}
+
+
+void Render_addCell(Render_batch *p_batch, uint8_t cellState, float x_px, float y_px, float width_px, float height_px)
+{
+    SDL_Vertex *p_quad;
+    float u0, u1;
+    int iVertex;
+
+    if (cellState == GRID_DEAD || cellState > RENDER_NUM_SPRITES)
+    {
+        return;
+    }
+
+    if (p_batch->num_quads == p_batch->max_quads)
+    {
+        return;
+    }
+
+    u0 = (float) (cellState - 1) / RENDER_NUM_SPRITES;
+    u1 = (float) cellState / RENDER_NUM_SPRITES;
+
+    p_quad = &p_batch->p_vertices[p_batch->num_quads * RENDER_VERTICES_PER_QUAD];
+    p_quad[0].position.x = x_px;
+    p_quad[0].position.y = y_px;
+    p_quad[0].tex_coord.x = u0;
+    p_quad[0].tex_coord.y = 0.0f;
+    p_quad[1].position.x = x_px + width_px;
+    p_quad[1].position.y = y_px;
+    p_quad[1].tex_coord.x = u1;
+    p_quad[1].tex_coord.y = 0.0f;
+    p_quad[2].position.x = x_px + width_px;
+    p_quad[2].position.y = y_px + height_px;
+    p_quad[2].tex_coord.x = u1;
+    p_quad[2].tex_coord.y = 1.0f;
+    p_quad[3].position.x = x_px;
+    p_quad[3].position.y = y_px + height_px;
+    p_quad[3].tex_coord.x = u0;
+    p_quad[3].tex_coord.y = 1.0f;
+
+    for (iVertex = 0; iVertex < RENDER_VERTICES_PER_QUAD; iVertex++)
+    {
+        p_quad[iVertex].color.r = 0xFF;
+        p_quad[iVertex].color.g = 0xFF;
+        p_quad[iVertex].color.b = 0xFF;
+        p_quad[iVertex].color.a = 0xFF;
+    }
+
+    p_batch->num_quads++;
+}
+
+
+void Render_flush(Render_batch *p_batch, SDL_Renderer *p_renderer)
+{
+    if (p_batch->num_quads > 0)
+    {
+        SDL_RenderGeometry
+           (p_renderer, p_batch->p_atlas,
+            p_batch->p_vertices, p_batch->num_quads * RENDER_VERTICES_PER_QUAD,
+            p_batch->p_indices, p_batch->num_quads * RENDER_INDICES_PER_QUAD);
+    }
+
+    p_batch->num_quads = 0;
+}
+
+
+void Render_destroyBatch(Render_batch *p_batch)
+{
+    if (p_batch->p_atlas != NULL)
+    {
+        SDL_DestroyTexture(p_batch->p_atlas);
+    }
+    free(p_batch->p_vertices);
+    free(p_batch->p_indices);
+
+    p_batch->p_atlas = NULL;
+    p_batch->p_vertices = NULL;
+    p_batch->p_indices = NULL;
+    p_batch->num_quads = 0;
+    p_batch->max_quads = 0;
+}
+
+
+Render_layer Render_createLayer(SDL_Renderer *p_renderer, int widthTexels, int heightTexels)
+{
+    Render_layer layer;
+
+    layer.width_texels = widthTexels;
+    layer.height_texels = heightTexels;
+    layer.p_texture = SDL_CreateTexture
+       (p_renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, widthTexels, heightTexels);
+    if (layer.p_texture == NULL)
+    {
+        printf("[ERR] Could not create a %dx%d layer texture\n", widthTexels, heightTexels);
+    }
+
+    return layer;
+}
+
+
+void Render_drawLayer
+   (Render_layer *p_layer, SDL_Renderer *p_renderer,
+    const uint8_t *p_values, int rowStride, int numRows, int numCols,
+    int isDensity, const SDL_Rect *p_dstRect)
+{
+    /* Sprite colours in cell state order, GRID_DEAD first */
+    static const uint8_t cellColours[4][3] =
+        { { RENDER_BACKGROUND_GREY, RENDER_BACKGROUND_GREY, RENDER_BACKGROUND_GREY },
+          { RENDER_ALIVE_GREY, RENDER_ALIVE_GREY, RENDER_ALIVE_GREY },
+          { 0xD8, 0x6A, 0x4A },
+          { 0x5A, 0x8C, 0xD8 } };
+    SDL_Rect srcRect;
+    uint8_t *p_pixels;
+    uint8_t *p_texel;
+    uint8_t grey;
+    int pitch;
+    int iRow, iCol;
+
+    if (numCols > p_layer->width_texels)
+    {
+        numCols = p_layer->width_texels;
+    }
+    if (numRows > p_layer->height_texels)
+    {
+        numRows = p_layer->height_texels;
+    }
+    if (numRows <= 0 || numCols <= 0)
+    {
+        return;
+    }
+
+    srcRect.x = 0;
+    srcRect.y = 0;
+    srcRect.w = numCols;
+    srcRect.h = numRows;
+    if (SDL_LockTexture(p_layer->p_texture, &srcRect, (void **) &p_pixels, &pitch) != 0)
+    {
+        return;
+    }
+
+    for (iRow = 0; iRow < numRows; iRow++)
+    {
+        p_texel = p_pixels + (size_t) iRow * pitch;
+        for (iCol = 0; iCol < numCols; iCol++)
+        {
+            if (isDensity == TRUE)
+            {
+                grey = (uint8_t) (RENDER_BACKGROUND_GREY
+                    + (RENDER_ALIVE_GREY - RENDER_BACKGROUND_GREY) * p_values[iCol] / DENSITY_FULL);
+                p_texel[0] = grey;
+                p_texel[1] = grey;
+                p_texel[2] = grey;
+            }
+            else
+            {
+                memcpy(p_texel, cellColours[p_values[iCol] & 0x03], 3);
+            }
+            p_texel[3] = 0xFF;
+            p_texel += 4;
+        }
+        p_values += rowStride;
+    }
+
+    SDL_UnlockTexture(p_layer->p_texture);
+    SDL_RenderCopy(p_renderer, p_layer->p_texture, &srcRect, p_dstRect);
+}
+
+
+void Render_destroyLayer(Render_layer *p_layer)
+{
+    if (p_layer->p_texture != NULL)
+    {
+        SDL_DestroyTexture(p_layer->p_texture);
+    }
+
+    p_layer->p_texture = NULL;
+}
@@ -0,0 +1,65 @@
+#ifndef H_HEXLIFE_RENDER_H
+#define H_HEXLIFE_RENDER_H
+
+
+#include <SDL.h>
+
+#include "grid.h"
+#include "density.h"
+#include "bool.h"
+
+
+/* One sprite per non-dead cell state, packed side by side in the atlas */
+#define RENDER_NUM_SPRITES  (3)
+
+
+/* Textured quads sharing one atlas, drawn with a single SDL_RenderGeometry
+ * call per flush */
+typedef struct Render_batch_struct {
+    SDL_Texture *p_atlas;
+    int sprite_width_px;
+    int sprite_height_px;
+
+    SDL_Vertex *p_vertices;
+    int *p_indices;
+    int num_quads;
+    int max_quads;
+} Render_batch;
+
+
+/* Loads the sprites for GRID_ALIVE, GRID_SICK and GRID_FIXED, in that order,
+ * into one atlas. p_atlas is left NULL on failure. */
+extern Render_batch Render_createBatch(SDL_Renderer *p_renderer, const char *p_spritePaths[RENDER_NUM_SPRITES], int maxQuads);
+
+extern void Render_addCell(Render_batch *p_batch, uint8_t cellState, float x_px, float y_px, float width_px, float height_px);
+
+/* Draws every queued quad and empties the batch */
+extern void Render_flush(Render_batch *p_batch, SDL_Renderer *p_renderer);
+
+extern void Render_destroyBatch(Render_batch *p_batch);
+
+
+/* Streaming texture drawn one texel per cell or per density block, for views
+ * too far out for sprites to be worth drawing */
+typedef struct Render_layer_struct {
+    SDL_Texture *p_texture;
+    int width_texels;
+    int height_texels;
+} Render_layer;
+
+
+/* p_texture is left NULL on failure */
+extern Render_layer Render_createLayer(SDL_Renderer *p_renderer, int widthTexels, int heightTexels);
+
+/* Draws numRows x numCols values, rowStride apart, stretched over p_dstRect.
+ * Values are cell states, or with isDensity densities from DENSITY_EMPTY to
+ * DENSITY_FULL. They must fit in the layer, anything more is cut off. */
+extern void Render_drawLayer
+   (Render_layer *p_layer, SDL_Renderer *p_renderer,
+    const uint8_t *p_values, int rowStride, int numRows, int numCols,
+    int isDensity, const SDL_Rect *p_dstRect);
+
+extern void Render_destroyLayer(Render_layer *p_layer);
+
+
+#endif /* H_HEXLIFE_RENDER_H */
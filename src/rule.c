@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <ctype.h>
+
+#include "rule.h"
+#include "grid.h"
+
+
+const uint8_t Rule_neighbourWeight[RULE_NUM_STATES] =
+{
+    0,                              /* GRID_DEAD */
+    1,                              /* GRID_ALIVE */
+    1 + (1 << RULE_SUM_SICK_SHIFT), /* GRID_SICK */
+    1                               /* GRID_FIXED */
+};
+
+
+Rule Rule_fromMasks(uint8_t surviveMask, uint8_t createMask)
+{
+    Rule rule;
+    int iState, iSum;
+    int aliveNeighbours, anySick;
+    uint8_t next;
+
+    rule.surviveMask = surviveMask;
+    rule.createMask = createMask;
+
+    for (iState = 0; iState < RULE_NUM_STATES; iState++)
+    {
+        for (iSum = 0; iSum < RULE_NUM_SUMS; iSum++)
+        {
+            aliveNeighbours = iSum & RULE_SUM_COUNT_MASK;
+            anySick = (iSum >> RULE_SUM_SICK_SHIFT) != 0;
+
+            next = iState;
+            if (iState == GRID_ALIVE || iState == GRID_SICK)
+            {
+                if ((surviveMask & (1 << aliveNeighbours)) == 0)
+                {
+                    next = GRID_DEAD;
+                }
+            }
+            else if (iState == GRID_DEAD)
+            {
+                if ((createMask & (1 << aliveNeighbours)) != 0)
+                {
+                    next = anySick ? GRID_SICK : GRID_ALIVE;
+                }
+            }
+
+            rule.table[iState * RULE_NUM_SUMS + iSum] = next;
+        }
+    }
+
+    return rule;
+}
+
+
+static uint8_t rangeToMask(int min, int max)
+{
+    int iCount;
+    uint8_t mask = 0;
+
+    for (iCount = 0; iCount <= GRID_HEX_NUM_NEIGHBOURS; iCount++)
+    {
+        if (iCount >= min && iCount <= max)
+        {
+            mask |= 1 << iCount;
+        }
+    }
+
+    return mask;
+}
+
+
+Rule Rule_fromRange(int minAlive, int maxAlive, int minCreate, int maxCreate)
+{
+    return Rule_fromMasks(rangeToMask(minAlive, maxAlive), rangeToMask(minCreate, maxCreate));
+}
+
+
+int Rule_parse(const char *p_string, Rule *p_rule)
+{
+    uint8_t surviveMask = 0;
+    uint8_t createMask = 0;
+    uint8_t *p_mask = NULL;
+    int seenSurvive = FALSE;
+    int seenCreate = FALSE;
+    const char *p_char;
+
+    for (p_char = p_string; *p_char != '\0'; p_char++)
+    {
+        if (toupper((unsigned char) *p_char) == 'B' && seenCreate == FALSE)
+        {
+            p_mask = &createMask;
+            seenCreate = TRUE;
+        }
+        else if (toupper((unsigned char) *p_char) == 'S' && seenSurvive == FALSE)
+        {
+            p_mask = &surviveMask;
+            seenSurvive = TRUE;
+        }
+        else if (*p_char >= '0' && *p_char <= '0' + GRID_HEX_NUM_NEIGHBOURS && p_mask != NULL)
+        {
+            *p_mask |= 1 << (*p_char - '0');
+        }
+        else if (*p_char != '/' || p_mask == NULL)
+        {
+            printf("[ERR] Invalid rule %s\n", p_string);
+            return FALSE;
+        }
+    }
+
+    if (seenSurvive == FALSE || seenCreate == FALSE)
+    {
+        printf("[ERR] Invalid rule %s, expected B<digits>/S<digits>\n", p_string);
+        return FALSE;
+    }
+
+    *p_rule = Rule_fromMasks(surviveMask, createMask);
+
+    return TRUE;
+}
+
+
+void Rule_toString(const Rule *p_rule, char *p_string, int maxChars)
+{
+    char createDigits[GRID_HEX_NUM_NEIGHBOURS + 2];
+    char surviveDigits[GRID_HEX_NUM_NEIGHBOURS + 2];
+    int numCreate = 0;
+    int numSurvive = 0;
+    int iCount;
+
+    for (iCount = 0; iCount <= GRID_HEX_NUM_NEIGHBOURS; iCount++)
+    {
+        if (p_rule->createMask & (1 << iCount))
+        {
+            createDigits[numCreate++] = '0' + iCount;
+        }
+        if (p_rule->surviveMask & (1 << iCount))
+        {
+            surviveDigits[numSurvive++] = '0' + iCount;
+        }
+    }
+    createDigits[numCreate] = '\0';
+    surviveDigits[numSurvive] = '\0';
+
+    snprintf(p_string, maxChars, "B%s/S%s", createDigits, surviveDigits);
+}
@@ -0,0 +1,43 @@
+#ifndef H_HEXLIFE_RULE_H
+#define H_HEXLIFE_RULE_H
+
+
+#include <stdint.h>
+
+#include "bool.h"
+
+
+#define RULE_NUM_STATES       (4)
+#define RULE_NUM_SUMS         (64)
+#define RULE_MAX_STRING_CHARS (32)
+
+/* Each neighbour adds its weight to a 6 bit sum: non-dead neighbours count
+ * in the low 3 bits and sick ones in the high 3 bits */
+#define RULE_SUM_COUNT_MASK   (0x07)
+#define RULE_SUM_SICK_SHIFT   (3)
+
+
+typedef struct Rule_struct {
+    /* Bit n set when n alive neighbours let a cell survive or be created */
+    uint8_t surviveMask;
+    uint8_t createMask;
+
+    /* Next state indexed by state * RULE_NUM_SUMS + neighbour sum */
+    uint8_t table[RULE_NUM_STATES * RULE_NUM_SUMS];
+} Rule;
+
+
+/* Neighbour weight per state, added up to index Rule.table */
+extern const uint8_t Rule_neighbourWeight[RULE_NUM_STATES];
+
+extern Rule Rule_fromMasks(uint8_t surviveMask, uint8_t createMask);
+
+extern Rule Rule_fromRange(int minAlive, int maxAlive, int minCreate, int maxCreate);
+
+/* Parses "B3/S234" style strings, in either order and either case */
+extern int Rule_parse(const char *p_string, Rule *p_rule);
+
+extern void Rule_toString(const Rule *p_rule, char *p_string, int maxChars);
+
+
+#endif /* H_HEXLIFE_RULE_H */
@@ -0,0 +1,728 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "bitgrid.h"
+#include "cycle.h"
+#include "hashlife.h"
+#include "sparse.h"
+#include "snapshot.h"
+#include "pool.h"
+#include "domain.h"
+#include "export.h"
+#include "profile.h"
+#include "timer.h"
+#include "bool.h"
+
+#define RUN_DEFAULT_WIDTH_CELLS   (100)
+#define RUN_DEFAULT_HEIGHT_CELLS  (100)
+#define RUN_DEFAULT_GENERATIONS   (1000)
+
+#define RUN_MAX_LINE_CHARS  (65536)
+
+
+static void printUsage(char *progName)
+{
+    printf("Usage: %s [options]\n", progName);
+    printf("  -w <cells>     grid width (default %d)\n", RUN_DEFAULT_WIDTH_CELLS);
+    printf("  -h <cells>     grid height (default %d)\n", RUN_DEFAULT_HEIGHT_CELLS);
+    printf("  -n <gens>      generations to run (default %d)\n", RUN_DEFAULT_GENERATIONS);
+    printf("  -s <seed>      random seed for the initial soup, the same seed always\n");
+    printf("                 gives the same soup (default 1)\n");
+    printf("  -d <fraction>  fraction of the soup alive (default %.2f)\n", GRID_DEFAULT_DENSITY);
+    printf("  -i <file>      load the initial grid from a text file\n");
+    printf("  -l <file>      load the initial grid, generation and rule from a\n");
+    printf("                 snapshot, raw ones are mapped rather than read\n");
+    printf("  -o <file>      save the final grid as a snapshot (byte and\n");
+    printf("                 bit-packed kernels)\n");
+    printf("  -z <encoding>  snapshot encoding for -o: raw, rle, packed or auto\n");
+    printf("                 (default auto)\n");
+    printf("  -r <rule>      B/S rule such as B3/S234, or a,b,c,d to survive with\n");
+    printf("                 a-b and create with c-d neighbours (default B3/S234)\n");
+    printf("  -q             stop as soon as the grid is stationary or, with the\n");
+    printf("                 byte kernel, periodic\n");
+    printf("  -p <gens>      longest period -q looks for (default %d)\n", CYCLE_DEFAULT_MAX_PERIOD);
+    printf("  -e <boundary>  what lies beyond the edges: torus, dead or reflect\n");
+    printf("                 (default torus, other kernels only wrap)\n");
+    printf("  -b             use the bit-packed kernel\n");
+    printf("  -H <log2>      use the hashlife engine, stepping up to 2^log2\n");
+    printf("                 generations at a time on an unbounded plane\n");
+    printf("  -U             use the unbounded sparse universe\n");
+    printf("  -t <threads>   worker threads, 0 for one per core (default 1)\n");
+    printf("  -D <workers>   split the grid into slabs of rows stepped by this many\n");
+    printf("                 worker processes (byte kernel, one thread each)\n");
+    printf("  -T <transport> how -D workers swap halo rows: shm or socket\n");
+    printf("                 (default shm)\n");
+    printf("  -P <file>      time every step, print a summary and write a Chrome\n");
+    printf("                 trace there, or CSV if it ends in .csv\n");
+    printf("  -S <file>      write each generation's state counts, births, deaths\n");
+    printf("                 and bounding box as CSV (byte kernel)\n");
+    printf("  -v <file>      export frames (byte kernel): name.gif for an animated\n");
+    printf("                 GIF, a name with %%d and .png for numbered PNGs,\n");
+    printf("                 \"|command\" to pipe raw RGB24 video into an encoder,\n");
+    printf("                 or any other name for a raw RGB24 file\n");
+    printf("  -k <gens>      generations per exported frame (default 1)\n");
+    printf("  -c <px>        exported cell size (default %d)\n", EXPORT_DEFAULT_CELL_PX);
+    printf("  -f <fps>       exported frame rate, for GIF delays (default %d)\n", EXPORT_DEFAULT_FPS);
+}
+
+
+static void writeStatsRow(FILE *p_file, Grid *p_grid)
+{
+    const Grid_stats *p_stats = &p_grid->stats;
+
+    fprintf(p_file, "%llu,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+            (unsigned long long) p_grid->generation,
+            p_stats->counts[GRID_DEAD], p_stats->counts[GRID_ALIVE],
+            p_stats->counts[GRID_SICK], p_stats->counts[GRID_FIXED],
+            p_stats->births, p_stats->deaths, p_stats->infections,
+            p_stats->min_row, p_stats->max_row, p_stats->min_col, p_stats->max_col);
+}
+
+
+/* Call once the pool has stopped, so no thread is still timing */
+static int finishProfile(const char *p_path)
+{
+    if (p_path == NULL)
+    {
+        return TRUE;
+    }
+
+    Profile_printSummary();
+
+    return Profile_write(p_path);
+}
+
+
+/* Text grids have one line per row and one digit (GRID_DEAD..GRID_FIXED) per cell */
+static int loadTextGrid(char *path, Grid *p_grid)
+{
+    FILE *p_file;
+    char *p_line;
+    int width_cells = 0;
+    int height_cells = 0;
+    int lineLen;
+    int iRow, iCol;
+
+    p_file = fopen(path, "r");
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", path);
+        return FALSE;
+    }
+
+    p_line = malloc(RUN_MAX_LINE_CHARS);
+    if (p_line == NULL)
+    {
+        fclose(p_file);
+        return FALSE;
+    }
+
+    /* First pass gets the size */
+    while (fgets(p_line, RUN_MAX_LINE_CHARS, p_file) != NULL)
+    {
+        lineLen = strcspn(p_line, "\r\n");
+        if (lineLen == 0)
+        {
+            continue;
+        }
+        if (lineLen > width_cells)
+        {
+            width_cells = lineLen;
+        }
+        height_cells++;
+    }
+
+    if (width_cells == 0 || height_cells == 0)
+    {
+        printf("[ERR] %s holds no cells\n", path);
+        free(p_line);
+        fclose(p_file);
+        return FALSE;
+    }
+
+    *p_grid = Grid_create(width_cells, height_cells);
+    if (p_grid->p_data1 == NULL || p_grid->p_data2 == NULL)
+    {
+        free(p_line);
+        fclose(p_file);
+        return FALSE;
+    }
+    Grid_clearGrid(p_grid);
+
+    /* Second pass fills the cells */
+    rewind(p_file);
+    iRow = 0;
+    while (iRow < height_cells && fgets(p_line, RUN_MAX_LINE_CHARS, p_file) != NULL)
+    {
+        lineLen = strcspn(p_line, "\r\n");
+        if (lineLen == 0)
+        {
+            continue;
+        }
+        for (iCol = 0; iCol < lineLen; iCol++)
+        {
+            if (p_line[iCol] >= '0' + GRID_DEAD && p_line[iCol] <= '0' + GRID_FIXED)
+            {
+                Grid_setDispValue(p_grid, iRow, iCol, p_line[iCol] - '0');
+            }
+        }
+        iRow++;
+    }
+
+    free(p_line);
+    fclose(p_file);
+
+    return TRUE;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int width_cells = RUN_DEFAULT_WIDTH_CELLS;
+    int height_cells = RUN_DEFAULT_HEIGHT_CELLS;
+    long numGenerations = RUN_DEFAULT_GENERATIONS;
+    uint64_t seed = 1;
+    double density = GRID_DEFAULT_DENSITY;
+    char *p_inputPath = NULL;
+    char *p_snapshotPath = NULL;
+    char *p_outputPath = NULL;
+    int encoding = SNAPSHOT_ENCODING_AUTO;
+    int isRuleGiven = FALSE;
+    Rule snapshotRule;
+    int minAlive, maxAlive, minCreate, maxCreate;
+    Rule rule = Rule_fromRange(2, 4, 3, 3);
+    char ruleString[RULE_MAX_STRING_CHARS];
+    int stopWhenStationary = FALSE;
+    int maxPeriod = CYCLE_DEFAULT_MAX_PERIOD;
+    int useBitGrid = FALSE;
+    int numThreads = 1;
+    int hashLifeLog2Step = -1;
+    int useSparse = FALSE;
+    char *p_profilePath = NULL;
+    uint64_t profile_ns;
+    char *p_statsPath = NULL;
+    FILE *p_statsFile = NULL;
+    int boundary = GRID_BOUNDARY_TORUS;
+    char *p_exportPath = NULL;
+    Export *p_export = NULL;
+    long gensPerFrame = 1;
+    int cellPx = EXPORT_DEFAULT_CELL_PX;
+    int fps = EXPORT_DEFAULT_FPS;
+    int numWorkers = 0;
+    int findsCycles;
+    int isLost = FALSE;
+    int isFailed = FALSE;
+    int transport = DOMAIN_TRANSPORT_SHM;
+    Domain *p_domain = NULL;
+
+    Grid grid;
+    BitGrid bitGrid;
+    HashLife hashLife;
+    Sparse sparse;
+    Cycle cycle;
+    int isPeriodic = FALSE;
+    int log2Step;
+    Pool *p_pool = NULL;
+    long iGen;
+    int isStationary = FALSE;
+    int iArg;
+
+    uint64_t start_ns;
+    double runTime_s;
+
+    /* ------ ARGUMENTS ------ */
+    for (iArg = 1; iArg < argc; iArg++)
+    {
+        if (strcmp(argv[iArg], "-q") == 0)
+        {
+            stopWhenStationary = TRUE;
+            continue;
+        }
+        if (strcmp(argv[iArg], "-U") == 0)
+        {
+            useSparse = TRUE;
+            continue;
+        }
+        if (strcmp(argv[iArg], "-b") == 0)
+        {
+            useBitGrid = TRUE;
+            continue;
+        }
+
+        if (iArg + 1 >= argc || argv[iArg][0] != '-' || argv[iArg][1] == '\0' || argv[iArg][2] != '\0')
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        switch (argv[iArg][1])
+        {
+            case 'w':
+                width_cells = atoi(argv[++iArg]);
+                break;
+            case 'h':
+                height_cells = atoi(argv[++iArg]);
+                break;
+            case 'n':
+                numGenerations = atol(argv[++iArg]);
+                break;
+            case 's':
+                seed = strtoull(argv[++iArg], NULL, 0);
+                break;
+            case 'd':
+                density = atof(argv[++iArg]);
+                break;
+            case 'i':
+                p_inputPath = argv[++iArg];
+                break;
+            case 'l':
+                p_snapshotPath = argv[++iArg];
+                break;
+            case 'o':
+                p_outputPath = argv[++iArg];
+                break;
+            case 'z':
+                if (Snapshot_parseEncoding(argv[++iArg], &encoding) != TRUE)
+                {
+                    return 1;
+                }
+                break;
+            case 'H':
+                hashLifeLog2Step = atoi(argv[++iArg]);
+                break;
+            case 't':
+                numThreads = atoi(argv[++iArg]);
+                break;
+            case 'p':
+                maxPeriod = atoi(argv[++iArg]);
+                break;
+            case 'P':
+                p_profilePath = argv[++iArg];
+                break;
+            case 'S':
+                p_statsPath = argv[++iArg];
+                break;
+            case 'v':
+                p_exportPath = argv[++iArg];
+                break;
+            case 'k':
+                gensPerFrame = atol(argv[++iArg]);
+                break;
+            case 'c':
+                cellPx = atoi(argv[++iArg]);
+                break;
+            case 'f':
+                fps = atoi(argv[++iArg]);
+                break;
+            case 'D':
+                numWorkers = atoi(argv[++iArg]);
+                break;
+            case 'T':
+                if (Domain_parseTransport(argv[++iArg], &transport) != TRUE)
+                {
+                    return 1;
+                }
+                break;
+            case 'e':
+                if (Grid_parseBoundary(argv[++iArg], &boundary) != TRUE)
+                {
+                    return 1;
+                }
+                break;
+            case 'r':
+                iArg++;
+                if (sscanf(argv[iArg], "%d,%d,%d,%d", &minAlive, &maxAlive, &minCreate, &maxCreate) == 4)
+                {
+                    rule = Rule_fromRange(minAlive, maxAlive, minCreate, maxCreate);
+                }
+                else if (Rule_parse(argv[iArg], &rule) != TRUE)
+                {
+                    return 1;
+                }
+                isRuleGiven = TRUE;
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (width_cells <= 0 || height_cells <= 0 || numGenerations < 0 || numThreads < 0 || maxPeriod <= 0
+     || density < 0.0 || density > 1.0 || gensPerFrame <= 0 || cellPx <= 0 || fps <= 0 || numWorkers < 0)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    /* ------ INITIALISATION ------ */
+    /* Before the pool starts, so its workers are named */
+    if (p_profilePath != NULL)
+    {
+        Profile_enable();
+        Profile_nameThread("main");
+    }
+
+    if (p_snapshotPath != NULL)
+    {
+        if (Snapshot_load(p_snapshotPath, &grid, &snapshotRule) != TRUE)
+        {
+            return 1;
+        }
+        /* -r wins over the rule saved with the grid */
+        if (isRuleGiven == FALSE)
+        {
+            rule = snapshotRule;
+        }
+    }
+    else if (p_inputPath != NULL)
+    {
+        if (loadTextGrid(p_inputPath, &grid) != TRUE)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        grid = Grid_create(width_cells, height_cells);
+        if (grid.p_data1 == NULL || grid.p_data2 == NULL)
+        {
+            return 1;
+        }
+        Grid_resetGrid(&grid, seed, density);
+    }
+
+    if (numWorkers > 0 && (useBitGrid == TRUE || hashLifeLog2Step >= 0 || useSparse == TRUE || numThreads != 1))
+    {
+        printf("[ERR] Only the byte kernel runs in worker processes, each on one thread\n");
+        return 1;
+    }
+
+    if (p_exportPath != NULL && (useBitGrid == TRUE || hashLifeLog2Step >= 0 || useSparse == TRUE))
+    {
+        printf("[ERR] Only the byte kernel exports frames\n");
+        return 1;
+    }
+
+    if (boundary != GRID_BOUNDARY_TORUS)
+    {
+        if (useBitGrid == TRUE || hashLifeLog2Step >= 0 || useSparse == TRUE)
+        {
+            printf("[ERR] Only the byte kernel has a %s boundary\n", Grid_boundaryName(boundary));
+            return 1;
+        }
+        Grid_setBoundary(&grid, boundary);
+    }
+
+    /* Birth on zero neighbours would fill the unbounded plane */
+    if ((rule.createMask & 1) && (hashLifeLog2Step >= 0 || useSparse == TRUE))
+    {
+        printf("[ERR] Hashlife and the sparse universe cannot run rules with B0\n");
+        return 1;
+    }
+
+    Rule_toString(&rule, ruleString, RULE_MAX_STRING_CHARS);
+    printf("Grid %dx%d, rule %s, initial population %d\n",
+           grid.width_cells, grid.height_cells, ruleString,
+           Grid_countPopulation(&grid));
+
+    if (useBitGrid == TRUE)
+    {
+        bitGrid = BitGrid_create(grid.width_cells, grid.height_cells);
+        if (bitGrid.p_data1 == NULL || bitGrid.p_data2 == NULL || bitGrid.p_scratch == NULL)
+        {
+            return 1;
+        }
+        BitGrid_fromGrid(&bitGrid, &grid);
+    }
+
+    if (numThreads != 1)
+    {
+        if (useBitGrid == TRUE)
+        {
+            printf("[ERR] The bit-packed kernel is single threaded\n");
+            return 1;
+        }
+        p_pool = Pool_create(numThreads);
+        if (p_pool == NULL)
+        {
+            return 1;
+        }
+        printf("Stepping with %d threads\n", p_pool->num_threads);
+    }
+
+    /* Hashlife has its own loop, it cannot tell whether the grid is stationary */
+    if (hashLifeLog2Step >= 0)
+    {
+        hashLife = HashLife_create(&rule);
+        if (hashLife.p_table == NULL)
+        {
+            return 1;
+        }
+        if (HashLife_fromGrid(&hashLife, &grid) != TRUE)
+        {
+            return 1;
+        }
+
+        start_ns = Timer_nowNs();
+        while ((long) hashLife.generation < numGenerations)
+        {
+            log2Step = hashLifeLog2Step;
+            while (log2Step > 0 && (1L << log2Step) > numGenerations - (long) hashLife.generation)
+            {
+                log2Step--;
+            }
+            profile_ns = Profile_begin();
+            if (HashLife_step(&hashLife, log2Step) != TRUE)
+            {
+                isFailed = TRUE;
+                break;
+            }
+            Profile_end(PROFILE_ZONE_STEP, profile_ns);
+        }
+        runTime_s = Timer_secondsSince(start_ns);
+
+        printf("Generations:      %ld\n", (long) hashLife.generation);
+        printf("Time:             %.3f s\n", runTime_s);
+        if (runTime_s > 0.0)
+        {
+            printf("Generations/sec:  %.1f\n", hashLife.generation / runTime_s);
+        }
+        printf("Final population: %llu\n", (unsigned long long) HashLife_countPopulation(&hashLife));
+        printf("Hashlife nodes:   %lu\n", (unsigned long) hashLife.num_nodes);
+
+        HashLife_destroy(&hashLife);
+        Pool_destroy(p_pool);
+        Grid_destroy(&grid);
+
+        if (finishProfile(p_profilePath) != TRUE || isFailed == TRUE)
+        {
+            return 1;
+        }
+        return 0;
+    }
+
+    /* The sparse universe also has its own loop, the grid only seeds it */
+    if (useSparse == TRUE)
+    {
+        sparse = Sparse_create();
+        if (Sparse_fromGrid(&sparse, &grid) != TRUE)
+        {
+            return 1;
+        }
+
+        start_ns = Timer_nowNs();
+        for (iGen = 0; iGen < numGenerations; iGen++)
+        {
+            profile_ns = Profile_begin();
+            if (Sparse_hexGridNextWithRule(&sparse, &rule, &isStationary) != TRUE)
+            {
+                isFailed = TRUE;
+                break;
+            }
+            Profile_end(PROFILE_ZONE_STEP, profile_ns);
+            if (isStationary == TRUE && stopWhenStationary == TRUE)
+            {
+                iGen++;
+                break;
+            }
+        }
+        runTime_s = Timer_secondsSince(start_ns);
+
+        printf("Generations:      %ld%s\n", iGen, isStationary == TRUE ? " (stationary)" : "");
+        printf("Time:             %.3f s\n", runTime_s);
+        if (runTime_s > 0.0)
+        {
+            printf("Generations/sec:  %.1f\n", iGen / runTime_s);
+        }
+        printf("Final population: %llu\n", (unsigned long long) Sparse_countPopulation(&sparse));
+        printf("Live chunks:      %lu\n", (unsigned long) sparse.live.count);
+
+        Sparse_destroy(&sparse);
+        Pool_destroy(p_pool);
+        Grid_destroy(&grid);
+
+        if (finishProfile(p_profilePath) != TRUE || isFailed == TRUE)
+        {
+            return 1;
+        }
+        return 0;
+    }
+
+    /* The bit-packed kernel and the workers keep no hash of the whole grid,
+     * so they only stop when stationary */
+    findsCycles = stopWhenStationary == TRUE && useBitGrid == FALSE && numWorkers == 0;
+    if (findsCycles == TRUE)
+    {
+        cycle = Cycle_create(maxPeriod);
+        if (cycle.p_ring == NULL)
+        {
+            return 1;
+        }
+        Cycle_update(&cycle, &grid);
+    }
+
+    if (p_statsPath != NULL)
+    {
+        if (useBitGrid == TRUE)
+        {
+            printf("[ERR] Only the byte kernel gathers stats\n");
+            return 1;
+        }
+        p_statsFile = fopen(p_statsPath, "w");
+        if (p_statsFile == NULL)
+        {
+            printf("[ERR] Could not open %s\n", p_statsPath);
+            return 1;
+        }
+        fprintf(p_statsFile, "generation,dead,alive,sick,fixed,births,deaths,infections,min_row,max_row,min_col,max_col\n");
+        writeStatsRow(p_statsFile, &grid);
+    }
+
+    /* Before the export thread starts, so the workers fork from one thread */
+    if (numWorkers > 0)
+    {
+        p_domain = Domain_create(&grid, &rule, numWorkers, transport);
+        if (p_domain == NULL)
+        {
+            return 1;
+        }
+        printf("Stepping %d slabs in worker processes over %s\n", numWorkers, Domain_transportName(transport));
+    }
+
+    if (p_exportPath != NULL)
+    {
+        p_export = Export_create(p_exportPath, grid.width_cells, grid.height_cells, cellPx, fps);
+        if (p_export == NULL)
+        {
+            return 1;
+        }
+        printf("Exporting %dx%d px frames every %ld generations\n",
+               p_export->width_px, p_export->height_px, gensPerFrame);
+        Export_pushFrame(p_export, &grid);
+    }
+
+    /* ------ MAIN LOOP ------ */
+    start_ns = Timer_nowNs();
+    for (iGen = 0; iGen < numGenerations; iGen++)
+    {
+        if (useBitGrid == TRUE)
+        {
+            isStationary = BitGrid_hexGridNextWithRule(&bitGrid, &rule);
+        }
+        else if (p_domain != NULL)
+        {
+            if (Domain_step(p_domain, &isStationary) != TRUE)
+            {
+                isLost = TRUE;
+                break;
+            }
+        }
+        else if (p_pool != NULL)
+        {
+            isStationary = Grid_hexGridNextWithRuleParallel(&grid, p_pool, &rule);
+        }
+        else
+        {
+            isStationary = Grid_hexGridNextWithRule(&grid, &rule);
+        }
+        if (p_statsFile != NULL)
+        {
+            writeStatsRow(p_statsFile, &grid);
+        }
+        /* The workers' cells are only brought back for the frames */
+        if (p_export != NULL && (iGen + 1) % gensPerFrame == 0
+         && ((p_domain != NULL && Domain_gather(p_domain) != TRUE) || Export_pushFrame(p_export, &grid) != TRUE))
+        {
+            iGen++;
+            break;
+        }
+        if (isStationary == TRUE && stopWhenStationary == TRUE)
+        {
+            iGen++;
+            break;
+        }
+        if (findsCycles == TRUE)
+        {
+            isPeriodic = Cycle_update(&cycle, &grid);
+            if (isPeriodic == TRUE)
+            {
+                iGen++;
+                break;
+            }
+        }
+    }
+    runTime_s = Timer_secondsSince(start_ns);
+
+    if (findsCycles == TRUE)
+    {
+        Cycle_destroy(&cycle);
+    }
+    if (p_domain != NULL)
+    {
+        if (isLost == FALSE && Domain_gather(p_domain) != TRUE)
+        {
+            isLost = TRUE;
+        }
+        if (Domain_destroy(p_domain) != TRUE || isLost == TRUE)
+        {
+            return 1;
+        }
+    }
+    if (p_statsFile != NULL)
+    {
+        fclose(p_statsFile);
+    }
+
+    if (useBitGrid == TRUE)
+    {
+        BitGrid_toGrid(&bitGrid, &grid);
+        BitGrid_destroy(&bitGrid);
+        grid.generation += iGen;
+    }
+
+    if (p_outputPath != NULL)
+    {
+        if (Snapshot_save(p_outputPath, &grid, &rule, encoding) != TRUE)
+        {
+            return 1;
+        }
+    }
+
+    /* ------ REPORT ------ */
+    printf("Generations:      %ld%s\n", iGen, isStationary == TRUE ? " (stationary)" : "");
+    printf("Time:             %.3f s\n", runTime_s);
+    if (runTime_s > 0.0)
+    {
+        printf("Generations/sec:  %.1f\n", iGen / runTime_s);
+        printf("Cells/sec:        %.3e\n", (double) iGen * grid.width_cells * grid.height_cells / runTime_s);
+    }
+    if (isPeriodic == TRUE)
+    {
+        printf("Period:           %d, since generation %llu\n",
+               cycle.period, (unsigned long long) cycle.start_generation);
+    }
+    printf("Final population: %d\n", Grid_countPopulation(&grid));
+    if (useBitGrid == FALSE)
+    {
+        printf("Last step tiles:  %d active, %d skipped\n", grid.active_tiles, grid.skipped_tiles);
+    }
+
+    if (p_export != NULL)
+    {
+        /* The wait shows how often encoding held up the stepping */
+        printf("Frames exported:  %d, stepping waited %.1f ms\n",
+               p_export->num_pushed, p_export->wait_ns / 1e6);
+        if (Export_destroy(p_export) != TRUE)
+        {
+            return 1;
+        }
+    }
+
+    Pool_destroy(p_pool);
+    Grid_destroy(&grid);
+
+    return finishProfile(p_profilePath) == TRUE ? 0 : 1;
+}
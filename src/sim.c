@@ -0,0 +1,580 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "snapshot.h"
+#include "profile.h"
+#include "timer.h"
+
+
+/* How long the simulation thread naps when it has nothing to do */
+#define SIM_IDLE_SLEEP_NS  (1000000)
+
+
+static void sleepNs(long duration_ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = duration_ns / 1000000000L;
+    ts.tv_nsec = duration_ns % 1000000000L;
+    nanosleep(&ts, NULL);
+}
+
+
+/* Copies the grid into the frame the simulation thread owns and swaps it
+ * with the shared one, leaving whatever frame was shared to be written next */
+static void publishFrame(Sim *p_sim)
+{
+    Sim_frame *p_frame = &p_sim->frames[p_sim->writeFrame];
+    int prevShared;
+    uint64_t profile_ns = Profile_begin();
+
+    memcpy(p_frame->p_cells, p_sim->grid.p_disp, (size_t) p_sim->grid.stride_cells * p_sim->grid.height_cells * sizeof(uint8_t));
+    Density_markChanged(&p_sim->density, &p_sim->grid);
+    Density_update(&p_sim->density, &p_sim->grid);
+    Density_copy(&p_frame->density, &p_sim->density);
+    p_frame->generation = p_sim->grid.generation;
+    p_frame->num_steps = p_sim->num_steps;
+    p_frame->population = Grid_countPopulation(&p_sim->grid);
+    p_frame->step_ms = p_sim->step_ms;
+    p_frame->running = p_sim->running;
+    p_frame->mode = p_sim->mode;
+    p_frame->target_generation = p_sim->target_generation;
+    p_frame->seed = p_sim->seed;
+    p_frame->history_pos = p_sim->historyPos;
+    p_frame->history_count = p_sim->history.count;
+
+    prevShared = __atomic_exchange_n(&p_sim->sharedFrame, p_sim->writeFrame | SIM_FRAME_FRESH, __ATOMIC_ACQ_REL);
+    p_sim->writeFrame = prevShared & ~SIM_FRAME_FRESH;
+    Profile_end(PROFILE_ZONE_PUBLISH, profile_ns);
+}
+
+
+static void recordHistory(Sim *p_sim)
+{
+    uint64_t profile_ns = Profile_begin();
+
+    /* Carrying on from an earlier entry forgets the ones after it */
+    History_truncate(&p_sim->history, p_sim->historyPos);
+    History_record(&p_sim->history, &p_sim->grid);
+    p_sim->historyPos = p_sim->history.count - 1;
+    p_sim->isEdited = FALSE;
+    Profile_end(PROFILE_ZONE_HISTORY, profile_ns);
+}
+
+
+/* Batched modes pass isRecorded FALSE and record once the batch is over,
+ * as a history encode per generation would cost as much as the step */
+static void stepGrid(Sim *p_sim, int isRecorded)
+{
+    Grid *p_grid = &p_sim->grid;
+    uint64_t stepStart_ns;
+    int wasStationary = p_sim->isStationary;
+
+    /* Any edit since the last step starts a new history */
+    if (p_grid->hash != p_sim->steppedHash)
+    {
+        Cycle_reset(&p_sim->cycle);
+        Cycle_update(&p_sim->cycle, p_grid);
+        p_sim->isPeriodic = FALSE;
+    }
+
+    /* The step replaces the tile flags, edits included, with its own */
+    Density_markChanged(&p_sim->density, p_grid);
+
+    stepStart_ns = Timer_nowNs();
+    p_sim->isStationary = Grid_hexGridNextWithRule(p_grid, &p_sim->rule);
+    p_sim->step_ms = Timer_secondsSince(stepStart_ns) * 1e3;
+    Density_markChanged(&p_sim->density, p_grid);
+    p_sim->num_steps++;
+    p_sim->steppedHash = p_grid->hash;
+    if (isRecorded == TRUE)
+    {
+        recordHistory(p_sim);
+    }
+
+    if (p_sim->isStationary == TRUE && wasStationary == FALSE)
+    {
+        printf("Stationary achieved\n");
+    }
+
+    if (p_sim->isStationary == FALSE && p_sim->isPeriodic == FALSE)
+    {
+        p_sim->isPeriodic = Cycle_update(&p_sim->cycle, p_grid);
+        if (p_sim->isPeriodic == TRUE)
+        {
+            printf("Oscillator of period %d since generation %llu\n",
+                   p_sim->cycle.period, (unsigned long long) p_sim->cycle.start_generation);
+        }
+    }
+}
+
+
+static void seekHistory(Sim *p_sim, int iEntry)
+{
+    /* The grid must hold historyPos before walking from it */
+    if (p_sim->isEdited == TRUE)
+    {
+        recordHistory(p_sim);
+    }
+
+    if (iEntry < 0)
+    {
+        iEntry = 0;
+    }
+    if (iEntry >= p_sim->history.count)
+    {
+        iEntry = p_sim->history.count - 1;
+    }
+
+    if (iEntry != p_sim->historyPos
+     && History_seek(&p_sim->history, &p_sim->grid, p_sim->historyPos, iEntry) == TRUE)
+    {
+        p_sim->historyPos = iEntry;
+    }
+    p_sim->running = FALSE;
+}
+
+
+static void applyCommand(Sim *p_sim, const Sim_command *p_command)
+{
+    Grid *p_grid = &p_sim->grid;
+
+    switch (p_command->type)
+    {
+        case SIM_CMD_SET_CELL:
+            if (p_command->row >= 0 && p_command->row < p_grid->height_cells
+             && p_command->col >= 0 && p_command->col < p_grid->width_cells
+             && Grid_getDispValue(p_grid, p_command->row, p_command->col) != p_command->value)
+            {
+                Grid_setDispValue(p_grid, p_command->row, p_command->col, p_command->value);
+                p_sim->isEdited = TRUE;
+            }
+            break;
+
+        case SIM_CMD_RESET:
+            p_sim->seed++;
+            Grid_resetGrid(p_grid, p_sim->seed, GRID_DEFAULT_DENSITY);
+            p_sim->running = FALSE;
+            p_sim->isEdited = TRUE;
+            break;
+
+        case SIM_CMD_CLEAR:
+            Grid_clearGrid(p_grid);
+            p_sim->running = FALSE;
+            p_sim->isEdited = TRUE;
+            break;
+
+        case SIM_CMD_FILL:
+            Grid_fillGrid(p_grid);
+            p_sim->running = FALSE;
+            p_sim->isEdited = TRUE;
+            break;
+
+        case SIM_CMD_SAVE:
+            if (Snapshot_save(p_sim->snapshotPath, p_grid, &p_sim->rule, SNAPSHOT_ENCODING_AUTO) == TRUE)
+            {
+                printf("Saved generation %llu to %s\n", (unsigned long long) p_grid->generation, p_sim->snapshotPath);
+            }
+            break;
+
+        case SIM_CMD_RESTORE:
+            if (Snapshot_restore(p_sim->snapshotPath, p_grid) == TRUE)
+            {
+                p_sim->running = FALSE;
+                p_sim->isEdited = TRUE;
+            }
+            break;
+
+        case SIM_CMD_RUN:
+            p_sim->running = p_command->value ? TRUE : FALSE;
+            break;
+
+        case SIM_CMD_MODE:
+            p_sim->mode = p_command->value;
+            p_sim->target_generation = p_command->generation;
+            if (p_sim->mode == SIM_MODE_SETTLE || p_sim->mode == SIM_MODE_TO_GEN)
+            {
+                p_sim->running = TRUE;
+            }
+            /* Settling is judged from here on, not by what was seen before */
+            if (p_sim->mode == SIM_MODE_SETTLE)
+            {
+                p_sim->isStationary = FALSE;
+                p_sim->isPeriodic = FALSE;
+                p_sim->steppedHash = ~p_grid->hash;
+            }
+            break;
+
+        case SIM_CMD_STEP_BACK:
+            seekHistory(p_sim, p_sim->historyPos - 1);
+            break;
+
+        case SIM_CMD_STEP_FORWARD:
+            if (p_sim->isEdited == FALSE && p_sim->historyPos < p_sim->history.count - 1)
+            {
+                seekHistory(p_sim, p_sim->historyPos + 1);
+            }
+            else
+            {
+                if (p_sim->isEdited == TRUE)
+                {
+                    recordHistory(p_sim);
+                }
+                stepGrid(p_sim, TRUE);
+                p_sim->running = FALSE;
+            }
+            break;
+
+        case SIM_CMD_SEEK:
+            seekHistory(p_sim, (int) p_command->generation);
+            break;
+    }
+}
+
+
+/* Drains the queue, returns TRUE if anything was applied */
+static int applyCommands(Sim *p_sim)
+{
+    unsigned int head = __atomic_load_n(&p_sim->commandHead, __ATOMIC_ACQUIRE);
+    unsigned int tail = p_sim->commandTail;
+    uint64_t profile_ns;
+
+    if (tail == head)
+    {
+        return FALSE;
+    }
+
+    profile_ns = Profile_begin();
+    while (tail != head)
+    {
+        applyCommand(p_sim, &p_sim->commands[tail & (SIM_MAX_COMMANDS - 1)]);
+        tail++;
+    }
+    __atomic_store_n(&p_sim->commandTail, tail, __ATOMIC_RELEASE);
+    Profile_end(PROFILE_ZONE_EDIT, profile_ns);
+
+    if (p_sim->isEdited == TRUE)
+    {
+        recordHistory(p_sim);
+    }
+
+    return TRUE;
+}
+
+
+/* TRUE once a goal driven mode has got where it was going */
+static int isGoalReached(Sim *p_sim)
+{
+    switch (p_sim->mode)
+    {
+        case SIM_MODE_SETTLE:
+            return p_sim->isStationary == TRUE || p_sim->isPeriodic == TRUE;
+
+        case SIM_MODE_TO_GEN:
+            return p_sim->grid.generation >= p_sim->target_generation;
+    }
+
+    return FALSE;
+}
+
+
+/* Steps for up to one frame budget, stopping early at the goal. Only the
+ * generation it ends on, the one published, goes into the history. */
+static void stepBatch(Sim *p_sim)
+{
+    uint64_t batchStart_ns = Timer_nowNs();
+    int isStepped = FALSE;
+
+    do
+    {
+        if (isGoalReached(p_sim) == TRUE)
+        {
+            p_sim->running = FALSE;
+            p_sim->mode = SIM_MODE_PACED;
+            break;
+        }
+        stepGrid(p_sim, FALSE);
+        isStepped = TRUE;
+    } while (Timer_nowNs() - batchStart_ns < p_sim->frame_budget_ns);
+
+    if (isStepped == TRUE)
+    {
+        recordHistory(p_sim);
+    }
+}
+
+
+static void *simMain(void *p_arg)
+{
+    Sim *p_sim = p_arg;
+    uint64_t lastStep_ns = Timer_nowNs();
+    uint64_t now_ns;
+    int changed;
+
+    Profile_nameThread("sim");
+
+    while (__atomic_load_n(&p_sim->quit, __ATOMIC_ACQUIRE) == FALSE)
+    {
+        changed = applyCommands(p_sim);
+
+        now_ns = Timer_nowNs();
+        if (p_sim->running == FALSE)
+        {
+            lastStep_ns = now_ns;
+        }
+        else if (p_sim->mode != SIM_MODE_PACED)
+        {
+            stepBatch(p_sim);
+            lastStep_ns = Timer_nowNs();
+            changed = TRUE;
+        }
+        else if (now_ns - lastStep_ns >= p_sim->step_interval_ns)
+        {
+            /* Keep the pace, but do not try to catch up after a stall */
+            lastStep_ns += p_sim->step_interval_ns;
+            if (now_ns - lastStep_ns >= p_sim->step_interval_ns)
+            {
+                lastStep_ns = now_ns;
+            }
+
+            stepGrid(p_sim, TRUE);
+            changed = TRUE;
+        }
+
+        if (changed == TRUE)
+        {
+            publishFrame(p_sim);
+        }
+        else
+        {
+            sleepNs(SIM_IDLE_SLEEP_NS);
+        }
+    }
+
+    return NULL;
+}
+
+
+Sim *Sim_create(int width_cells, int height_cells, const Rule *p_rule, uint64_t seed, int maxPeriod, int stepInterval_ms)
+{
+    Grid grid;
+
+    grid = Grid_create(width_cells, height_cells);
+    if (grid.p_data1 == NULL || grid.p_data2 == NULL)
+    {
+        printf("[ERR] Could not create simulation\n");
+        Grid_destroy(&grid);
+        return NULL;
+    }
+    Grid_resetGrid(&grid, seed, GRID_DEFAULT_DENSITY);
+
+    return Sim_createFromGrid(&grid, p_rule, seed, maxPeriod, stepInterval_ms);
+}
+
+
+Sim *Sim_createFromGrid(Grid *p_grid, const Rule *p_rule, uint64_t seed, int maxPeriod, int stepInterval_ms)
+{
+    Sim *p_sim;
+    int width_cells = p_grid->width_cells;
+    int height_cells = p_grid->height_cells;
+    int iFrame;
+
+    p_sim = calloc(1, sizeof(Sim));
+    if (p_sim == NULL)
+    {
+        printf("[ERR] Could not create simulation\n");
+        Grid_destroy(p_grid);
+        return NULL;
+    }
+
+    p_sim->grid = *p_grid;
+    p_sim->cycle = Cycle_create(maxPeriod);
+    p_sim->history = History_create(width_cells, height_cells, HISTORY_DEFAULT_MAX_BYTES, HISTORY_DEFAULT_KEYFRAME_INTERVAL);
+    p_sim->density = Density_create(width_cells, height_cells);
+    for (iFrame = 0; iFrame < SIM_NUM_FRAMES; iFrame++)
+    {
+        p_sim->frames[iFrame].p_cells = calloc((size_t) p_sim->grid.stride_cells * height_cells, sizeof(uint8_t));
+        p_sim->frames[iFrame].width_cells = width_cells;
+        p_sim->frames[iFrame].height_cells = height_cells;
+        p_sim->frames[iFrame].stride_cells = p_sim->grid.stride_cells;
+        p_sim->frames[iFrame].density = Density_create(width_cells, height_cells);
+    }
+
+    if (p_sim->cycle.p_ring == NULL || p_sim->history.p_tip == NULL || p_sim->density.p_data == NULL
+     || p_sim->frames[0].p_cells == NULL || p_sim->frames[0].density.p_data == NULL
+     || p_sim->frames[1].p_cells == NULL || p_sim->frames[1].density.p_data == NULL
+     || p_sim->frames[2].p_cells == NULL || p_sim->frames[2].density.p_data == NULL)
+    {
+        printf("[ERR] Could not create simulation\n");
+        Sim_destroy(p_sim);
+        return NULL;
+    }
+
+    p_sim->rule = *p_rule;
+    p_sim->step_interval_ns = (uint64_t) stepInterval_ms * 1000000ULL;
+    p_sim->running = FALSE;
+    p_sim->mode = SIM_MODE_PACED;
+    p_sim->frame_budget_ns = (uint64_t) SIM_DEFAULT_FRAME_BUDGET_MS * 1000000ULL;
+
+    Sim_setSnapshotPath(p_sim, SIM_DEFAULT_SNAPSHOT_PATH);
+
+    p_sim->seed = seed;
+    p_sim->historyPos = -1;
+    recordHistory(p_sim);
+    p_sim->steppedHash = ~p_sim->grid.hash;
+
+    p_sim->writeFrame = 0;
+    p_sim->sharedFrame = 1;
+    p_sim->readFrame = 2;
+    publishFrame(p_sim);
+
+    return p_sim;
+}
+
+
+int Sim_start(Sim *p_sim)
+{
+    if (pthread_create(&p_sim->thread, NULL, simMain, p_sim) != 0)
+    {
+        printf("[ERR] Could not start simulation thread\n");
+        return FALSE;
+    }
+    p_sim->started = TRUE;
+
+    return TRUE;
+}
+
+
+static int pushCommand(Sim *p_sim, const Sim_command *p_command)
+{
+    unsigned int head = p_sim->commandHead;
+    unsigned int tail = __atomic_load_n(&p_sim->commandTail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= SIM_MAX_COMMANDS)
+    {
+        return FALSE;
+    }
+
+    p_sim->commands[head & (SIM_MAX_COMMANDS - 1)] = *p_command;
+    __atomic_store_n(&p_sim->commandHead, head + 1, __ATOMIC_RELEASE);
+
+    return TRUE;
+}
+
+
+int Sim_pushCommand(Sim *p_sim, int type, int row, int col, uint8_t value)
+{
+    Sim_command command;
+
+    command.type = type;
+    command.row = row;
+    command.col = col;
+    command.value = value;
+    command.generation = 0;
+
+    return pushCommand(p_sim, &command);
+}
+
+
+int Sim_setMode(Sim *p_sim, int mode, uint64_t targetGeneration)
+{
+    Sim_command command;
+
+    command.type = SIM_CMD_MODE;
+    command.row = 0;
+    command.col = 0;
+    command.value = mode;
+    command.generation = targetGeneration;
+
+    return pushCommand(p_sim, &command);
+}
+
+
+int Sim_seekHistory(Sim *p_sim, int iEntry)
+{
+    Sim_command command;
+
+    command.type = SIM_CMD_SEEK;
+    command.row = 0;
+    command.col = 0;
+    command.value = 0;
+    command.generation = iEntry >= 0 ? (uint64_t) iEntry : 0;
+
+    return pushCommand(p_sim, &command);
+}
+
+
+void Sim_setHistoryLimit(Sim *p_sim, size_t maxBytes)
+{
+    p_sim->history.max_bytes = maxBytes;
+}
+
+
+void Sim_setFrameBudget(Sim *p_sim, int frameBudget_ms)
+{
+    p_sim->frame_budget_ns = (uint64_t) frameBudget_ms * 1000000ULL;
+}
+
+
+void Sim_setSnapshotPath(Sim *p_sim, const char *p_path)
+{
+    snprintf(p_sim->snapshotPath, SIM_MAX_PATH_CHARS, "%s", p_path);
+}
+
+
+void Sim_setBoundary(Sim *p_sim, int boundary)
+{
+    Grid_setBoundary(&p_sim->grid, boundary);
+}
+
+
+const Sim_frame *Sim_latestFrame(Sim *p_sim)
+{
+    int prevShared;
+
+    if ((__atomic_load_n(&p_sim->sharedFrame, __ATOMIC_ACQUIRE) & SIM_FRAME_FRESH) != 0)
+    {
+        prevShared = __atomic_exchange_n(&p_sim->sharedFrame, p_sim->readFrame, __ATOMIC_ACQ_REL);
+        p_sim->readFrame = prevShared & ~SIM_FRAME_FRESH;
+    }
+
+    return &p_sim->frames[p_sim->readFrame];
+}
+
+
+uint8_t Sim_frameValue(const Sim_frame *p_frame, int row, int col)
+{
+    return p_frame->p_cells[row * p_frame->stride_cells + col];
+}
+
+
+void Sim_destroy(Sim *p_sim)
+{
+    int iFrame;
+
+    if (p_sim == NULL)
+    {
+        return;
+    }
+
+    if (p_sim->started == TRUE)
+    {
+        __atomic_store_n(&p_sim->quit, TRUE, __ATOMIC_RELEASE);
+        pthread_join(p_sim->thread, NULL);
+    }
+
+    Grid_destroy(&p_sim->grid);
+    Cycle_destroy(&p_sim->cycle);
+    History_destroy(&p_sim->history);
+    Density_destroy(&p_sim->density);
+    for (iFrame = 0; iFrame < SIM_NUM_FRAMES; iFrame++)
+    {
+        free(p_sim->frames[iFrame].p_cells);
+        Density_destroy(&p_sim->frames[iFrame].density);
+    }
+
+    free(p_sim);
+}
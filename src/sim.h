@@ -0,0 +1,185 @@
+#ifndef H_HEXLIFE_SIM_H
+#define H_HEXLIFE_SIM_H
+
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "grid.h"
+#include "cycle.h"
+#include "history.h"
+#include "density.h"
+#include "rule.h"
+#include "bool.h"
+
+
+/* One frame being written, one being drawn and one waiting in between */
+#define SIM_NUM_FRAMES  (3)
+
+/* Set on the shared frame index while the reader has not picked it up yet */
+#define SIM_FRAME_FRESH  (4)
+
+/* Must be a power of two */
+#define SIM_MAX_COMMANDS  (4096)
+
+#define SIM_CMD_SET_CELL  (0)
+#define SIM_CMD_RESET     (1)
+#define SIM_CMD_CLEAR     (2)
+#define SIM_CMD_FILL      (3)
+#define SIM_CMD_SAVE      (4)
+#define SIM_CMD_RESTORE   (5)
+#define SIM_CMD_RUN       (6)
+#define SIM_CMD_MODE      (7)
+#define SIM_CMD_STEP_BACK (8)
+/* Forward through the history, or one new generation from its newest entry */
+#define SIM_CMD_STEP_FORWARD  (9)
+#define SIM_CMD_SEEK      (10)
+
+/* One generation per step interval */
+#define SIM_MODE_PACED       (0)
+/* As many generations as fit in the frame budget, publishing only the last */
+#define SIM_MODE_FAST        (1)
+/* Fast until the grid is stationary or periodic, then pause */
+#define SIM_MODE_SETTLE      (2)
+/* Fast until target_generation, then pause */
+#define SIM_MODE_TO_GEN      (3)
+
+#define SIM_DEFAULT_FRAME_BUDGET_MS  (16)
+
+/* Where SIM_CMD_SAVE and SIM_CMD_RESTORE keep the grid */
+#define SIM_DEFAULT_SNAPSHOT_PATH  "hexlife.snap"
+#define SIM_MAX_PATH_CHARS         (256)
+
+
+/* A finished generation as handed to the renderer */
+typedef struct Sim_frame_struct {
+    /* Laid out like the grid, rows stride_cells apart */
+    uint8_t *p_cells;
+    int width_cells;
+    int height_cells;
+    int stride_cells;
+    /* Kept in step with the cells, for drawing the grid zoomed out */
+    Density density;
+
+    uint64_t generation;
+    /* Generations stepped since Sim_create, never reset */
+    uint64_t num_steps;
+    int population;
+    double step_ms;
+    int running;
+    int mode;
+    uint64_t target_generation;
+    /* Seed of the last random soup, which Grid_resetGrid turns back into it */
+    uint64_t seed;
+
+    /* Entry of the history shown, and how many there are to scrub through */
+    int history_pos;
+    int history_count;
+} Sim_frame;
+
+
+typedef struct Sim_command_struct {
+    int type;
+    int row;
+    int col;
+    uint8_t value;
+    uint64_t generation;
+} Sim_command;
+
+
+/* Steps a grid on its own thread. The owner talks to it only through the
+ * command queue and reads it only through the published frames, neither of
+ * which takes a lock. */
+typedef struct Sim_struct {
+    /* Owned by the simulation thread once started */
+    Grid grid;
+    Rule rule;
+    Cycle cycle;
+    char snapshotPath[SIM_MAX_PATH_CHARS];
+    uint64_t num_steps;
+    uint64_t steppedHash;
+    double step_ms;
+    int running;
+    int isStationary;
+    int isPeriodic;
+    uint64_t step_interval_ns;
+    int mode;
+    uint64_t target_generation;
+    uint64_t frame_budget_ns;
+    /* SIM_CMD_RESET moves on to the next seed */
+    uint64_t seed;
+
+    /* Every step and edit, historyPos is the entry the grid holds */
+    History history;
+    int historyPos;
+    int isEdited;
+
+    /* Updated from the tiles each step changes and copied into every frame */
+    Density density;
+
+    /* Triple buffer. writeFrame belongs to the simulation thread, readFrame
+     * to the reader and sharedFrame, plus SIM_FRAME_FRESH, is swapped
+     * between them atomically. */
+    Sim_frame frames[SIM_NUM_FRAMES];
+    int writeFrame;
+    int readFrame;
+    int sharedFrame;
+
+    /* Single producer, single consumer ring */
+    Sim_command commands[SIM_MAX_COMMANDS];
+    unsigned int commandHead;
+    unsigned int commandTail;
+
+    pthread_t thread;
+    int started;
+    int quit;
+} Sim;
+
+
+/* Seeds the grid with Grid_resetGrid from seed and publishes it, paused.
+ * Returns NULL on failure. */
+extern Sim *Sim_create(int width_cells, int height_cells, const Rule *p_rule, uint64_t seed, int maxPeriod, int stepInterval_ms);
+
+/* As Sim_create, but starts from *p_grid, which the simulation takes over
+ * even on failure. seed is only where SIM_CMD_RESET carries on from. */
+extern Sim *Sim_createFromGrid(Grid *p_grid, const Rule *p_rule, uint64_t seed, int maxPeriod, int stepInterval_ms);
+
+extern int Sim_start(Sim *p_sim);
+
+/* Queues a command for the simulation thread. Only one thread may push.
+ * Returns FALSE when the queue is full and the command was dropped. */
+extern int Sim_pushCommand(Sim *p_sim, int type, int row, int col, uint8_t value);
+
+/* Switches to mode and starts running, except for SIM_MODE_PACED and
+ * SIM_MODE_FAST which keep the current run state. target_generation is only
+ * used by SIM_MODE_TO_GEN. */
+extern int Sim_setMode(Sim *p_sim, int mode, uint64_t targetGeneration);
+
+/* Shows history entry iEntry, pausing the simulation */
+extern int Sim_seekHistory(Sim *p_sim, int iEntry);
+
+/* Memory the history may use, HISTORY_DEFAULT_MAX_BYTES unless set before
+ * Sim_start */
+extern void Sim_setHistoryLimit(Sim *p_sim, size_t maxBytes);
+
+/* Time the simulation thread steps for between frames in the fast modes,
+ * SIM_DEFAULT_FRAME_BUDGET_MS unless set before Sim_start */
+extern void Sim_setFrameBudget(Sim *p_sim, int frameBudget_ms);
+
+/* File SIM_CMD_SAVE writes and SIM_CMD_RESTORE reads, SIM_DEFAULT_SNAPSHOT_PATH
+ * unless set before Sim_start */
+extern void Sim_setSnapshotPath(Sim *p_sim, const char *p_path);
+
+/* One of GRID_BOUNDARY_*, a torus unless set before Sim_start */
+extern void Sim_setBoundary(Sim *p_sim, int boundary);
+
+/* Latest generation the simulation thread has finished. Never blocks, and the
+ * frame stays untouched until the next call. */
+extern const Sim_frame *Sim_latestFrame(Sim *p_sim);
+
+extern uint8_t Sim_frameValue(const Sim_frame *p_frame, int row, int col);
+
+extern void Sim_destroy(Sim *p_sim);
+
+
+#endif /* H_HEXLIFE_SIM_H */
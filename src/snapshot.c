@@ -0,0 +1,615 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+
+#define SNAPSHOT_MAGIC       "HEXLSNAP"
+#define SNAPSHOT_MAGIC_BYTES (8)
+
+/* Bytes of the header actually used, the rest up to SNAPSHOT_HEADER_BYTES is zero */
+#define SNAPSHOT_FIELDS_BYTES  (56)
+
+#define SNAPSHOT_IO_BUFFER_BYTES  (65536)
+
+#define SNAPSHOT_RLE_MAX_RUN  (64)
+
+
+/* Header fields are little endian whatever the host */
+static void putU32(uint8_t *p_bytes, uint32_t value)
+{
+    int iByte;
+
+    for (iByte = 0; iByte < 4; iByte++)
+    {
+        p_bytes[iByte] = (uint8_t) (value >> (8 * iByte));
+    }
+}
+
+
+static void putU64(uint8_t *p_bytes, uint64_t value)
+{
+    int iByte;
+
+    for (iByte = 0; iByte < 8; iByte++)
+    {
+        p_bytes[iByte] = (uint8_t) (value >> (8 * iByte));
+    }
+}
+
+
+static uint32_t getU32(const uint8_t *p_bytes)
+{
+    uint32_t value = 0;
+    int iByte;
+
+    for (iByte = 0; iByte < 4; iByte++)
+    {
+        value |= (uint32_t) p_bytes[iByte] << (8 * iByte);
+    }
+
+    return value;
+}
+
+
+static uint64_t getU64(const uint8_t *p_bytes)
+{
+    uint64_t value = 0;
+    int iByte;
+
+    for (iByte = 0; iByte < 8; iByte++)
+    {
+        value |= (uint64_t) p_bytes[iByte] << (8 * iByte);
+    }
+
+    return value;
+}
+
+
+static uint64_t rleBytes(const uint8_t *p_cells, size_t numCells)
+{
+    uint64_t numBytes = 0;
+    size_t iCell = 0;
+    size_t runEnd;
+
+    while (iCell < numCells)
+    {
+        runEnd = iCell + 1;
+        while (runEnd < numCells && runEnd - iCell < SNAPSHOT_RLE_MAX_RUN && p_cells[runEnd] == p_cells[iCell])
+        {
+            runEnd++;
+        }
+        numBytes++;
+        iCell = runEnd;
+    }
+
+    return numBytes;
+}
+
+
+static uint64_t payloadBytes(int encoding, const uint8_t *p_cells, size_t numCells)
+{
+    switch (encoding)
+    {
+        case SNAPSHOT_ENCODING_RAW:
+            return numCells;
+
+        case SNAPSHOT_ENCODING_RLE:
+            return rleBytes(p_cells, numCells);
+
+        case SNAPSHOT_ENCODING_PACKED:
+            return (numCells + 3) / 4;
+    }
+
+    return 0;
+}
+
+
+static int writeRle(FILE *p_file, const uint8_t *p_cells, size_t numCells, uint8_t *p_buffer)
+{
+    size_t numBuffered = 0;
+    size_t iCell = 0;
+    size_t runEnd;
+
+    while (iCell < numCells)
+    {
+        runEnd = iCell + 1;
+        while (runEnd < numCells && runEnd - iCell < SNAPSHOT_RLE_MAX_RUN && p_cells[runEnd] == p_cells[iCell])
+        {
+            runEnd++;
+        }
+        p_buffer[numBuffered++] = (uint8_t) (((runEnd - iCell - 1) << 2) | (p_cells[iCell] & 0x03));
+        iCell = runEnd;
+
+        if (numBuffered == SNAPSHOT_IO_BUFFER_BYTES)
+        {
+            if (fwrite(p_buffer, 1, numBuffered, p_file) != numBuffered)
+            {
+                return FALSE;
+            }
+            numBuffered = 0;
+        }
+    }
+
+    return fwrite(p_buffer, 1, numBuffered, p_file) == numBuffered ? TRUE : FALSE;
+}
+
+
+static int writePacked(FILE *p_file, const uint8_t *p_cells, size_t numCells, uint8_t *p_buffer)
+{
+    size_t numBuffered = 0;
+    size_t iCell;
+    uint8_t packed = 0;
+
+    for (iCell = 0; iCell < numCells; iCell++)
+    {
+        packed |= (uint8_t) ((p_cells[iCell] & 0x03) << (2 * (iCell % 4)));
+        if (iCell % 4 == 3 || iCell == numCells - 1)
+        {
+            p_buffer[numBuffered++] = packed;
+            packed = 0;
+        }
+
+        if (numBuffered == SNAPSHOT_IO_BUFFER_BYTES)
+        {
+            if (fwrite(p_buffer, 1, numBuffered, p_file) != numBuffered)
+            {
+                return FALSE;
+            }
+            numBuffered = 0;
+        }
+    }
+
+    return fwrite(p_buffer, 1, numBuffered, p_file) == numBuffered ? TRUE : FALSE;
+}
+
+
+int Snapshot_save(const char *p_path, Grid *p_grid, const Rule *p_rule, int encoding)
+{
+    FILE *p_file;
+    uint8_t *p_buffer;
+    uint8_t header[SNAPSHOT_HEADER_BYTES];
+    /* The whole buffer goes out, row padding and all, so a raw file can be
+     * mapped straight back in as a grid */
+    size_t numCells = (size_t) p_grid->stride_cells * p_grid->height_cells;
+    uint64_t numPayloadBytes;
+    uint64_t packedBytes;
+    int isWritten;
+
+    if (encoding == SNAPSHOT_ENCODING_AUTO)
+    {
+        numPayloadBytes = rleBytes(p_grid->p_disp, numCells);
+        packedBytes = payloadBytes(SNAPSHOT_ENCODING_PACKED, p_grid->p_disp, numCells);
+        encoding = SNAPSHOT_ENCODING_RLE;
+        if (packedBytes < numPayloadBytes)
+        {
+            numPayloadBytes = packedBytes;
+            encoding = SNAPSHOT_ENCODING_PACKED;
+        }
+    }
+    else if (encoding >= SNAPSHOT_ENCODING_RAW && encoding <= SNAPSHOT_ENCODING_PACKED)
+    {
+        numPayloadBytes = payloadBytes(encoding, p_grid->p_disp, numCells);
+    }
+    else
+    {
+        printf("[ERR] Unknown snapshot encoding %d\n", encoding);
+        return FALSE;
+    }
+
+    memset(header, 0, SNAPSHOT_HEADER_BYTES);
+    memcpy(header, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_BYTES);
+    putU32(header + 8, SNAPSHOT_VERSION);
+    putU32(header + 12, (uint32_t) encoding);
+    putU32(header + 16, (uint32_t) p_grid->width_cells);
+    putU32(header + 20, (uint32_t) p_grid->height_cells);
+    putU64(header + 24, p_grid->generation);
+    putU64(header + 32, p_grid->hash);
+    putU64(header + 40, numPayloadBytes);
+    header[48] = p_rule->surviveMask;
+    header[49] = p_rule->createMask;
+    putU32(header + 52, (uint32_t) p_grid->stride_cells);
+
+    p_buffer = malloc(SNAPSHOT_IO_BUFFER_BYTES);
+    if (p_buffer == NULL)
+    {
+        printf("[ERR] Could not save snapshot\n");
+        return FALSE;
+    }
+
+    p_file = fopen(p_path, "wb");
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", p_path);
+        free(p_buffer);
+        return FALSE;
+    }
+
+    isWritten = fwrite(header, 1, SNAPSHOT_HEADER_BYTES, p_file) == SNAPSHOT_HEADER_BYTES ? TRUE : FALSE;
+    if (isWritten == TRUE)
+    {
+        switch (encoding)
+        {
+            case SNAPSHOT_ENCODING_RAW:
+                isWritten = fwrite(p_grid->p_disp, 1, numCells, p_file) == numCells ? TRUE : FALSE;
+                break;
+
+            case SNAPSHOT_ENCODING_RLE:
+                isWritten = writeRle(p_file, p_grid->p_disp, numCells, p_buffer);
+                break;
+
+            case SNAPSHOT_ENCODING_PACKED:
+                isWritten = writePacked(p_file, p_grid->p_disp, numCells, p_buffer);
+                break;
+        }
+    }
+    if (fclose(p_file) != 0)
+    {
+        isWritten = FALSE;
+    }
+    free(p_buffer);
+
+    if (isWritten == FALSE)
+    {
+        printf("[ERR] Could not write %s\n", p_path);
+    }
+
+    return isWritten;
+}
+
+
+/* Rows were only padded to a cache line before grids kept a halo, which
+ * leaves no padding at all in some widths */
+static int legacyStride(int width_cells)
+{
+    return (width_cells + GRID_ROW_ALIGN_CELLS - 1) / GRID_ROW_ALIGN_CELLS * GRID_ROW_ALIGN_CELLS;
+}
+
+
+static int readHeader(FILE *p_file, const char *p_path, Snapshot_info *p_info)
+{
+    uint8_t header[SNAPSHOT_FIELDS_BYTES];
+    uint64_t numCells;
+
+    if (fread(header, 1, SNAPSHOT_FIELDS_BYTES, p_file) != SNAPSHOT_FIELDS_BYTES
+     || memcmp(header, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_BYTES) != 0)
+    {
+        printf("[ERR] %s is not a snapshot\n", p_path);
+        return FALSE;
+    }
+    if (getU32(header + 8) != SNAPSHOT_VERSION)
+    {
+        printf("[ERR] %s has unsupported snapshot version %u\n", p_path, getU32(header + 8));
+        return FALSE;
+    }
+
+    p_info->encoding = (int) getU32(header + 12);
+    p_info->width_cells = (int) getU32(header + 16);
+    p_info->height_cells = (int) getU32(header + 20);
+    p_info->generation = getU64(header + 24);
+    p_info->hash = getU64(header + 32);
+    p_info->payload_bytes = getU64(header + 40);
+    p_info->rule = Rule_fromMasks(header[48], header[49]);
+    p_info->stride_cells = (int) getU32(header + 52);
+
+    numCells = (uint64_t) p_info->stride_cells * p_info->height_cells;
+    if (p_info->width_cells <= 0 || p_info->height_cells <= 0
+     || (p_info->stride_cells != Grid_strideFor(p_info->width_cells)
+      && p_info->stride_cells != legacyStride(p_info->width_cells))
+     || p_info->encoding < SNAPSHOT_ENCODING_RAW || p_info->encoding > SNAPSHOT_ENCODING_PACKED
+     || (p_info->encoding == SNAPSHOT_ENCODING_RAW && p_info->payload_bytes != numCells)
+     || (p_info->encoding == SNAPSHOT_ENCODING_PACKED && p_info->payload_bytes != (numCells + 3) / 4))
+    {
+        printf("[ERR] %s has a corrupt snapshot header\n", p_path);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/* Reads the payload that follows the header into p_cells */
+static int readCells(FILE *p_file, const Snapshot_info *p_info, uint8_t *p_cells)
+{
+    uint8_t *p_buffer;
+    size_t numCells = (size_t) p_info->stride_cells * p_info->height_cells;
+    size_t iCell = 0;
+    size_t numRead;
+    size_t iByte;
+    size_t runLength;
+    uint64_t bytesLeft = p_info->payload_bytes;
+    int iShift;
+
+    if (fseek(p_file, SNAPSHOT_HEADER_BYTES, SEEK_SET) != 0)
+    {
+        return FALSE;
+    }
+
+    if (p_info->encoding == SNAPSHOT_ENCODING_RAW)
+    {
+        return fread(p_cells, 1, numCells, p_file) == numCells ? TRUE : FALSE;
+    }
+
+    p_buffer = malloc(SNAPSHOT_IO_BUFFER_BYTES);
+    if (p_buffer == NULL)
+    {
+        return FALSE;
+    }
+
+    while (bytesLeft > 0)
+    {
+        numRead = bytesLeft < SNAPSHOT_IO_BUFFER_BYTES ? (size_t) bytesLeft : SNAPSHOT_IO_BUFFER_BYTES;
+        if (fread(p_buffer, 1, numRead, p_file) != numRead)
+        {
+            free(p_buffer);
+            return FALSE;
+        }
+        bytesLeft -= numRead;
+
+        for (iByte = 0; iByte < numRead; iByte++)
+        {
+            if (p_info->encoding == SNAPSHOT_ENCODING_RLE)
+            {
+                runLength = (p_buffer[iByte] >> 2) + 1;
+                if (runLength > numCells - iCell)
+                {
+                    free(p_buffer);
+                    return FALSE;
+                }
+                memset(p_cells + iCell, p_buffer[iByte] & 0x03, runLength);
+                iCell += runLength;
+            }
+            else
+            {
+                for (iShift = 0; iShift < 8 && iCell < numCells; iShift += 2)
+                {
+                    p_cells[iCell++] = (p_buffer[iByte] >> iShift) & 0x03;
+                }
+            }
+        }
+    }
+
+    free(p_buffer);
+
+    return iCell == numCells ? TRUE : FALSE;
+}
+
+
+/* Spreads rows read at the snapshot's stride out to the grid's, last row
+ * first so none is overwritten before it moves. finishLoad clears the gaps. */
+static void widenRows(Grid *p_grid, const Snapshot_info *p_info, uint8_t *p_cells)
+{
+    int iRow;
+
+    if (p_info->stride_cells == p_grid->stride_cells)
+    {
+        return;
+    }
+
+    for (iRow = p_grid->height_cells - 1; iRow > 0; iRow--)
+    {
+        memmove(p_cells + (size_t) iRow * p_grid->stride_cells,
+                p_cells + (size_t) iRow * p_info->stride_cells,
+                (size_t) p_grid->width_cells);
+    }
+}
+
+
+static void finishLoad(Grid *p_grid, const Snapshot_info *p_info)
+{
+    int iRow, iCol;
+    uint8_t *p_row;
+
+    /* A damaged file must not leave live cells in the row padding. Only
+     * written when wrong, so a mapped file's pages are not copied. */
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        p_row = p_grid->p_disp + (size_t) iRow * p_grid->stride_cells;
+        for (iCol = p_grid->width_cells; iCol < p_grid->stride_cells; iCol++)
+        {
+            if (p_row[iCol] != GRID_DEAD)
+            {
+                p_row[iCol] = GRID_DEAD;
+            }
+        }
+    }
+
+    p_grid->generation = p_info->generation;
+    p_grid->hash = p_info->hash;
+    Grid_markAllTilesChanged(p_grid);
+    Grid_computeStats(p_grid);
+}
+
+
+int Snapshot_readInfo(const char *p_path, Snapshot_info *p_info)
+{
+    FILE *p_file;
+    int isRead;
+
+    p_file = fopen(p_path, "rb");
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", p_path);
+        return FALSE;
+    }
+
+    isRead = readHeader(p_file, p_path, p_info);
+    fclose(p_file);
+
+    return isRead;
+}
+
+
+/* Maps the whole file, header included, so the offset is always page aligned */
+static int mapRaw(const char *p_path, const Snapshot_info *p_info, Grid *p_grid)
+{
+    struct stat fileStat;
+    size_t mappingBytes = SNAPSHOT_HEADER_BYTES + (size_t) p_info->payload_bytes;
+    void *p_mapping;
+    int fd;
+
+    fd = open(p_path, O_RDONLY);
+    if (fd < 0)
+    {
+        return FALSE;
+    }
+    if (fstat(fd, &fileStat) != 0 || (size_t) fileStat.st_size < mappingBytes)
+    {
+        close(fd);
+        return FALSE;
+    }
+
+    /* Private and writable, edits and resets copy the pages they touch */
+    p_mapping = mmap(NULL, mappingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p_mapping == MAP_FAILED)
+    {
+        return FALSE;
+    }
+
+    *p_grid = Grid_createMapped
+       (p_info->width_cells, p_info->height_cells,
+        (uint8_t *) p_mapping + SNAPSHOT_HEADER_BYTES, p_mapping, mappingBytes);
+
+    return TRUE;
+}
+
+
+int Snapshot_load(const char *p_path, Grid *p_grid, Rule *p_rule)
+{
+    FILE *p_file;
+    Snapshot_info info;
+
+    p_file = fopen(p_path, "rb");
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", p_path);
+        return FALSE;
+    }
+    if (readHeader(p_file, p_path, &info) != TRUE)
+    {
+        fclose(p_file);
+        return FALSE;
+    }
+
+    /* Older snapshots with narrower rows have to be read and widened */
+    if (info.encoding == SNAPSHOT_ENCODING_RAW && info.stride_cells == Grid_strideFor(info.width_cells)
+     && mapRaw(p_path, &info, p_grid) == TRUE)
+    {
+        fclose(p_file);
+    }
+    else
+    {
+        *p_grid = Grid_create(info.width_cells, info.height_cells);
+        if (p_grid->p_data1 == NULL || p_grid->p_data2 == NULL)
+        {
+            fclose(p_file);
+            Grid_destroy(p_grid);
+            return FALSE;
+        }
+        if (readCells(p_file, &info, p_grid->p_disp) != TRUE)
+        {
+            printf("[ERR] %s has corrupt or truncated cells\n", p_path);
+            fclose(p_file);
+            Grid_destroy(p_grid);
+            return FALSE;
+        }
+        fclose(p_file);
+        widenRows(p_grid, &info, p_grid->p_disp);
+    }
+
+    if (p_grid->p_data1 == NULL || p_grid->p_data2 == NULL)
+    {
+        Grid_destroy(p_grid);
+        return FALSE;
+    }
+
+    finishLoad(p_grid, &info);
+    *p_rule = info.rule;
+
+    return TRUE;
+}
+
+
+int Snapshot_restore(const char *p_path, Grid *p_grid)
+{
+    FILE *p_file;
+    Snapshot_info info;
+
+    p_file = fopen(p_path, "rb");
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", p_path);
+        return FALSE;
+    }
+    if (readHeader(p_file, p_path, &info) != TRUE)
+    {
+        fclose(p_file);
+        return FALSE;
+    }
+
+    if (info.width_cells != p_grid->width_cells || info.height_cells != p_grid->height_cells)
+    {
+        printf("[ERR] %s holds a %dx%d grid, not %dx%d\n", p_path,
+               info.width_cells, info.height_cells, p_grid->width_cells, p_grid->height_cells);
+        fclose(p_file);
+        return FALSE;
+    }
+
+    /* Decode into p_next so a bad file leaves the grid as it was */
+    if (readCells(p_file, &info, p_grid->p_next) != TRUE)
+    {
+        printf("[ERR] %s has corrupt or truncated cells\n", p_path);
+        fclose(p_file);
+        return FALSE;
+    }
+    fclose(p_file);
+    widenRows(p_grid, &info, p_grid->p_next);
+
+    memcpy(p_grid->p_disp, p_grid->p_next, (size_t) p_grid->stride_cells * p_grid->height_cells * sizeof(uint8_t));
+    finishLoad(p_grid, &info);
+
+    return TRUE;
+}
+
+
+const char *Snapshot_encodingName(int encoding)
+{
+    switch (encoding)
+    {
+        case SNAPSHOT_ENCODING_RAW:
+            return "raw";
+
+        case SNAPSHOT_ENCODING_RLE:
+            return "rle";
+
+        case SNAPSHOT_ENCODING_PACKED:
+            return "packed";
+    }
+
+    return "auto";
+}
+
+
+int Snapshot_parseEncoding(const char *p_name, int *p_encoding)
+{
+    int encoding;
+
+    for (encoding = SNAPSHOT_ENCODING_AUTO; encoding <= SNAPSHOT_ENCODING_PACKED; encoding++)
+    {
+        if (strcmp(p_name, Snapshot_encodingName(encoding)) == 0)
+        {
+            *p_encoding = encoding;
+            return TRUE;
+        }
+    }
+
+    printf("[ERR] Unknown snapshot encoding %s\n", p_name);
+
+    return FALSE;
+}
@@ -0,0 +1,59 @@
+#ifndef H_HEXLIFE_SNAPSHOT_H
+#define H_HEXLIFE_SNAPSHOT_H
+
+
+#include <stdint.h>
+
+#include "grid.h"
+#include "rule.h"
+#include "bool.h"
+
+
+/* The header is padded so the cells of a raw snapshot start on a page */
+#define SNAPSHOT_HEADER_BYTES  (4096)
+#define SNAPSHOT_VERSION       (2)
+
+/* Every encoding covers the grid's padded rows, stride_cells apart */
+
+/* One byte per cell, loaded by mapping the file */
+#define SNAPSHOT_ENCODING_RAW     (0)
+/* One byte per run of up to 64 equal cells, state in the low 2 bits */
+#define SNAPSHOT_ENCODING_RLE     (1)
+/* Four cells per byte, first cell in the low 2 bits */
+#define SNAPSHOT_ENCODING_PACKED  (2)
+/* Whichever of RLE and packed comes out smaller */
+#define SNAPSHOT_ENCODING_AUTO    (-1)
+
+
+typedef struct Snapshot_info_struct {
+    int width_cells;
+    int height_cells;
+    int stride_cells;
+    uint64_t generation;
+    uint64_t hash;
+    Rule rule;
+    int encoding;
+    uint64_t payload_bytes;
+} Snapshot_info;
+
+
+/* Writes the displayed generation of the grid. Returns FALSE on failure. */
+extern int Snapshot_save(const char *p_path, Grid *p_grid, const Rule *p_rule, int encoding);
+
+extern int Snapshot_readInfo(const char *p_path, Snapshot_info *p_info);
+
+/* Creates *p_grid from a snapshot. Raw snapshots are mapped copy-on-write
+ * instead of read, so nothing is copied until a cell is written. */
+extern int Snapshot_load(const char *p_path, Grid *p_grid, Rule *p_rule);
+
+/* Replaces the cells and generation of an existing grid, which must have the
+ * snapshot's size. The grid's rule is left alone. */
+extern int Snapshot_restore(const char *p_path, Grid *p_grid);
+
+extern const char *Snapshot_encodingName(int encoding);
+
+/* Accepts the names Snapshot_encodingName gives and "auto" */
+extern int Snapshot_parseEncoding(const char *p_name, int *p_encoding);
+
+
+#endif /* H_HEXLIFE_SNAPSHOT_H */
@@ -0,0 +1,587 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sparse.h"
+
+
+#define SPARSE_INITIAL_MAP_CAPACITY  (256)
+
+/* Free chunks kept beyond the live count, the rest go back to malloc */
+#define SPARSE_SPARE_CHUNKS  (64)
+
+/* Chunk cells plus a one cell border copied from the neighbouring chunks */
+#define SPARSE_PAD_STRIDE  (SPARSE_CHUNK_SIZE_CELLS + 2)
+#define SPARSE_PAD_CELLS   (SPARSE_PAD_STRIDE * SPARSE_PAD_STRIDE)
+
+
+struct Sparse_chunk_struct {
+    uint8_t cells[SPARSE_CHUNK_SIZE_CELLS * SPARSE_CHUNK_SIZE_CELLS];
+    Sparse_chunk *p_nextFree;
+};
+
+
+static int64_t packKey(int32_t chunkRow, int32_t chunkCol)
+{
+    return (int64_t) (((uint64_t) (uint32_t) chunkRow << 32) | (uint32_t) chunkCol);
+}
+
+
+static int32_t keyRow(int64_t key)
+{
+    return (int32_t) (uint32_t) ((uint64_t) key >> 32);
+}
+
+
+static int32_t keyCol(int64_t key)
+{
+    return (int32_t) (uint32_t) key;
+}
+
+
+/* Floor division, so cell -1 lands in chunk -1 */
+static int32_t cellToChunk(int64_t cell)
+{
+    if (cell < 0)
+    {
+        return (int32_t) ((cell - SPARSE_CHUNK_SIZE_CELLS + 1) / SPARSE_CHUNK_SIZE_CELLS);
+    }
+
+    return (int32_t) (cell / SPARSE_CHUNK_SIZE_CELLS);
+}
+
+
+static size_t hashKey(int64_t key)
+{
+    uint64_t hash = (uint64_t) key * 0x9E3779B97F4A7C15ULL;
+
+    return (size_t) (hash ^ (hash >> 32));
+}
+
+
+static int mapInit(Sparse_map *p_map, size_t capacity)
+{
+    p_map->capacity = capacity;
+    p_map->count = 0;
+    p_map->p_keys = malloc(capacity * sizeof(int64_t));
+    p_map->p_chunks = malloc(capacity * sizeof(Sparse_chunk *));
+    p_map->p_used = calloc(capacity, sizeof(uint8_t));
+
+    if (p_map->p_keys == NULL || p_map->p_chunks == NULL || p_map->p_used == NULL)
+    {
+        printf("[ERR] Could not allocate sparse map\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+static void mapFree(Sparse_map *p_map)
+{
+    free(p_map->p_keys);
+    free(p_map->p_chunks);
+    free(p_map->p_used);
+
+    p_map->p_keys = NULL;
+    p_map->p_chunks = NULL;
+    p_map->p_used = NULL;
+    p_map->capacity = 0;
+    p_map->count = 0;
+}
+
+
+/* Empties the map, first shrinking it if it was used at under an eighth of
+ * its capacity, so clearing and scanning it follow what it last held rather
+ * than the most it ever held */
+static void mapClear(Sparse_map *p_map)
+{
+    Sparse_map shrunk;
+    size_t capacity = SPARSE_INITIAL_MAP_CAPACITY;
+
+    if (8 * p_map->count < p_map->capacity && p_map->capacity > SPARSE_INITIAL_MAP_CAPACITY)
+    {
+        while (capacity < 2 * p_map->count)
+        {
+            capacity *= 2;
+        }
+        if (mapInit(&shrunk, capacity) == TRUE)
+        {
+            mapFree(p_map);
+            *p_map = shrunk;
+            return;
+        }
+        /* Keep the larger map, still correct */
+        mapFree(&shrunk);
+    }
+
+    memset(p_map->p_used, 0, p_map->capacity);
+    p_map->count = 0;
+}
+
+
+static size_t mapSlot(Sparse_map *p_map, int64_t key)
+{
+    size_t slot = hashKey(key) & (p_map->capacity - 1);
+
+    while (p_map->p_used[slot] && p_map->p_keys[slot] != key)
+    {
+        slot = (slot + 1) & (p_map->capacity - 1);
+    }
+
+    return slot;
+}
+
+
+static Sparse_chunk *mapFind(Sparse_map *p_map, int64_t key)
+{
+    size_t slot = mapSlot(p_map, key);
+
+    return p_map->p_used[slot] ? p_map->p_chunks[slot] : NULL;
+}
+
+
+static int mapInsert(Sparse_map *p_map, int64_t key, Sparse_chunk *p_chunk)
+{
+    Sparse_map grown;
+    size_t slot, iSlot;
+
+    /* Keep the load under a half */
+    if (2 * (p_map->count + 1) > p_map->capacity)
+    {
+        if (mapInit(&grown, 2 * p_map->capacity) != TRUE)
+        {
+            mapFree(&grown);
+            return FALSE;
+        }
+        for (iSlot = 0; iSlot < p_map->capacity; iSlot++)
+        {
+            if (p_map->p_used[iSlot])
+            {
+                slot = mapSlot(&grown, p_map->p_keys[iSlot]);
+                grown.p_used[slot] = TRUE;
+                grown.p_keys[slot] = p_map->p_keys[iSlot];
+                grown.p_chunks[slot] = p_map->p_chunks[iSlot];
+                grown.count++;
+            }
+        }
+        mapFree(p_map);
+        *p_map = grown;
+    }
+
+    slot = mapSlot(p_map, key);
+    if (p_map->p_used[slot] == FALSE)
+    {
+        p_map->p_used[slot] = TRUE;
+        p_map->p_keys[slot] = key;
+        p_map->count++;
+    }
+    p_map->p_chunks[slot] = p_chunk;
+
+    return TRUE;
+}
+
+
+static Sparse_chunk *allocChunk(Sparse *p_sparse)
+{
+    Sparse_chunk *p_chunk = p_sparse->p_freeChunks;
+
+    if (p_chunk != NULL)
+    {
+        p_sparse->p_freeChunks = p_chunk->p_nextFree;
+        p_sparse->num_freeChunks--;
+        return p_chunk;
+    }
+
+    p_chunk = malloc(sizeof(Sparse_chunk));
+    if (p_chunk == NULL)
+    {
+        printf("[ERR] Could not allocate sparse chunk\n");
+    }
+
+    return p_chunk;
+}
+
+
+static void releaseChunk(Sparse *p_sparse, Sparse_chunk *p_chunk)
+{
+    p_chunk->p_nextFree = p_sparse->p_freeChunks;
+    p_sparse->p_freeChunks = p_chunk;
+    p_sparse->num_freeChunks++;
+}
+
+
+/* Frees the spare chunks a shrinking universe no longer needs */
+static void trimFreeChunks(Sparse *p_sparse)
+{
+    Sparse_chunk *p_chunk;
+
+    while (p_sparse->num_freeChunks > p_sparse->live.count + SPARSE_SPARE_CHUNKS)
+    {
+        p_chunk = p_sparse->p_freeChunks;
+        p_sparse->p_freeChunks = p_chunk->p_nextFree;
+        p_sparse->num_freeChunks--;
+        free(p_chunk);
+    }
+}
+
+
+Sparse Sparse_create(void)
+{
+    Sparse sparse;
+
+    sparse.p_freeChunks = NULL;
+    sparse.num_freeChunks = 0;
+    sparse.generation = 0;
+
+    if (mapInit(&sparse.live, SPARSE_INITIAL_MAP_CAPACITY) != TRUE
+     || mapInit(&sparse.next, SPARSE_INITIAL_MAP_CAPACITY) != TRUE
+     || mapInit(&sparse.candidates, SPARSE_INITIAL_MAP_CAPACITY) != TRUE)
+    {
+        printf("[ERR] Could not create sparse universe\n");
+    }
+
+    return sparse;
+}
+
+
+uint8_t Sparse_getValue(Sparse *p_sparse, int64_t row, int64_t col)
+{
+    int32_t chunkRow = cellToChunk(row);
+    int32_t chunkCol = cellToChunk(col);
+    Sparse_chunk *p_chunk = mapFind(&p_sparse->live, packKey(chunkRow, chunkCol));
+
+    if (p_chunk == NULL)
+    {
+        return GRID_DEAD;
+    }
+
+    return p_chunk->cells[(row - (int64_t) chunkRow * SPARSE_CHUNK_SIZE_CELLS) * SPARSE_CHUNK_SIZE_CELLS
+                        + (col - (int64_t) chunkCol * SPARSE_CHUNK_SIZE_CELLS)];
+}
+
+
+int Sparse_setValue(Sparse *p_sparse, int64_t row, int64_t col, uint8_t value)
+{
+    int32_t chunkRow = cellToChunk(row);
+    int32_t chunkCol = cellToChunk(col);
+    int64_t key = packKey(chunkRow, chunkCol);
+    Sparse_chunk *p_chunk = mapFind(&p_sparse->live, key);
+
+    if (p_chunk == NULL)
+    {
+        /* Dead cells never need a chunk, empty chunks go at the next step */
+        if (value == GRID_DEAD)
+        {
+            return TRUE;
+        }
+
+        p_chunk = allocChunk(p_sparse);
+        if (p_chunk == NULL)
+        {
+            return FALSE;
+        }
+        memset(p_chunk->cells, GRID_DEAD, sizeof(p_chunk->cells));
+        if (mapInsert(&p_sparse->live, key, p_chunk) != TRUE)
+        {
+            releaseChunk(p_sparse, p_chunk);
+            return FALSE;
+        }
+    }
+
+    p_chunk->cells[(row - (int64_t) chunkRow * SPARSE_CHUNK_SIZE_CELLS) * SPARSE_CHUNK_SIZE_CELLS
+                 + (col - (int64_t) chunkCol * SPARSE_CHUNK_SIZE_CELLS)] = value;
+
+    return TRUE;
+}
+
+
+int Sparse_fromGrid(Sparse *p_sparse, Grid *p_grid)
+{
+    int iRow, iCol;
+    uint8_t value;
+
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_grid->width_cells; iCol++)
+        {
+            value = Grid_getDispValue(p_grid, iRow, iCol);
+            if (value != GRID_DEAD && Sparse_setValue(p_sparse, iRow, iCol, value) != TRUE)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+
+void Sparse_toGrid(Sparse *p_sparse, Grid *p_grid, int64_t rowOffset, int64_t colOffset)
+{
+    int iRow, iCol;
+
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_grid->width_cells; iCol++)
+        {
+            Grid_setDispValue(p_grid, iRow, iCol, Sparse_getValue(p_sparse, rowOffset + iRow, colOffset + iCol));
+        }
+    }
+}
+
+
+/* Copies the chunk at (chunkRow, chunkCol) and a one cell border from its
+ * eight neighbours into p_pad, with dead cells where there is no chunk */
+static void fillPad(Sparse *p_sparse, int32_t chunkRow, int32_t chunkCol, uint8_t *p_pad)
+{
+    const int size = SPARSE_CHUNK_SIZE_CELLS;
+    Sparse_chunk *p_chunk;
+    int rowOffset, colOffset;
+    int srcRow, srcCol, numRows, numCols, padRow, padCol;
+    int iRow;
+
+    memset(p_pad, GRID_DEAD, SPARSE_PAD_CELLS);
+
+    for (rowOffset = -1; rowOffset <= 1; rowOffset++)
+    {
+        for (colOffset = -1; colOffset <= 1; colOffset++)
+        {
+            p_chunk = mapFind(&p_sparse->live, packKey(chunkRow + rowOffset, chunkCol + colOffset));
+            if (p_chunk == NULL)
+            {
+                continue;
+            }
+
+            /* Last row/col of the chunk above/left, all of the centre one,
+             * first row/col of the chunk below/right */
+            srcRow = (rowOffset < 0) ? size - 1 : 0;
+            numRows = (rowOffset == 0) ? size : 1;
+            padRow = (rowOffset < 0) ? 0 : (rowOffset == 0 ? 1 : size + 1);
+            srcCol = (colOffset < 0) ? size - 1 : 0;
+            numCols = (colOffset == 0) ? size : 1;
+            padCol = (colOffset < 0) ? 0 : (colOffset == 0 ? 1 : size + 1);
+
+            for (iRow = 0; iRow < numRows; iRow++)
+            {
+                memcpy(&p_pad[(padRow + iRow) * SPARSE_PAD_STRIDE + padCol],
+                       &p_chunk->cells[(srcRow + iRow) * size + srcCol],
+                       numCols);
+            }
+        }
+    }
+}
+
+
+/* Steps the padded chunk into p_cells, returns TRUE if any cell is non-dead
+ * and sets *p_changed if any cell changed */
+static int stepPad(const uint8_t *p_pad, const Rule *p_rule, uint8_t *p_cells, int *p_changed)
+{
+    static const int evenOffsets[GRID_HEX_NUM_NEIGHBOURS] =
+    {
+        -1, -SPARSE_PAD_STRIDE, 1, SPARSE_PAD_STRIDE - 1, SPARSE_PAD_STRIDE, SPARSE_PAD_STRIDE + 1
+    };
+    static const int oddOffsets[GRID_HEX_NUM_NEIGHBOURS] =
+    {
+        -SPARSE_PAD_STRIDE - 1, -SPARSE_PAD_STRIDE, -SPARSE_PAD_STRIDE + 1, -1, SPARSE_PAD_STRIDE, 1
+    };
+
+    const int *p_offsets;
+    const uint8_t *p_centre;
+    int iRow, iCol, iNeigh;
+    int neighbourSum;
+    uint8_t nextValue;
+    uint8_t anyAlive = 0;
+    uint8_t changed = 0;
+
+    for (iRow = 0; iRow < SPARSE_CHUNK_SIZE_CELLS; iRow++)
+    {
+        for (iCol = 0; iCol < SPARSE_CHUNK_SIZE_CELLS; iCol++)
+        {
+            p_centre = &p_pad[(iRow + 1) * SPARSE_PAD_STRIDE + iCol + 1];
+            p_offsets = (iCol % 2 == 0) ? evenOffsets : oddOffsets;
+
+            neighbourSum = 0;
+            for (iNeigh = 0; iNeigh < GRID_HEX_NUM_NEIGHBOURS; iNeigh++)
+            {
+                neighbourSum += Rule_neighbourWeight[p_centre[p_offsets[iNeigh]]];
+            }
+
+            nextValue = p_rule->table[*p_centre * RULE_NUM_SUMS + neighbourSum];
+            p_cells[iRow * SPARSE_CHUNK_SIZE_CELLS + iCol] = nextValue;
+            anyAlive |= nextValue;
+            changed |= nextValue ^ *p_centre;
+        }
+    }
+
+    if (changed != 0)
+    {
+        *p_changed = TRUE;
+    }
+
+    return anyAlive != 0;
+}
+
+
+/* Returns the chunks of a half built next generation to the free list */
+static void abandonNext(Sparse *p_sparse)
+{
+    size_t iSlot;
+
+    for (iSlot = 0; iSlot < p_sparse->next.capacity; iSlot++)
+    {
+        if (p_sparse->next.p_used[iSlot])
+        {
+            releaseChunk(p_sparse, p_sparse->next.p_chunks[iSlot]);
+        }
+    }
+    mapClear(&p_sparse->next);
+}
+
+
+int Sparse_hexGridNextWithRule(Sparse *p_sparse, const Rule *p_rule, int *p_isStationary)
+{
+    uint8_t pad[SPARSE_PAD_CELLS];
+    Sparse_map swap;
+    Sparse_chunk *p_chunk;
+    int64_t key;
+    int32_t chunkRow, chunkCol;
+    int rowOffset, colOffset;
+    int changed = FALSE;
+    size_t iSlot;
+
+    /* Birth on zero neighbours would fill the whole plane */
+    if (p_rule->createMask & 1)
+    {
+        printf("[ERR] Sparse universes cannot run rules with B0\n");
+        return FALSE;
+    }
+
+    /* Every live chunk and its neighbours may hold cells next generation */
+    mapClear(&p_sparse->candidates);
+    for (iSlot = 0; iSlot < p_sparse->live.capacity; iSlot++)
+    {
+        if (p_sparse->live.p_used[iSlot] == FALSE)
+        {
+            continue;
+        }
+        chunkRow = keyRow(p_sparse->live.p_keys[iSlot]);
+        chunkCol = keyCol(p_sparse->live.p_keys[iSlot]);
+        for (rowOffset = -1; rowOffset <= 1; rowOffset++)
+        {
+            for (colOffset = -1; colOffset <= 1; colOffset++)
+            {
+                if (mapInsert(&p_sparse->candidates, packKey(chunkRow + rowOffset, chunkCol + colOffset), NULL) != TRUE)
+                {
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    /* Step the candidates, keeping the ones left with non-dead cells */
+    mapClear(&p_sparse->next);
+    p_chunk = NULL;
+    for (iSlot = 0; iSlot < p_sparse->candidates.capacity; iSlot++)
+    {
+        if (p_sparse->candidates.p_used[iSlot] == FALSE)
+        {
+            continue;
+        }
+        key = p_sparse->candidates.p_keys[iSlot];
+
+        if (p_chunk == NULL)
+        {
+            p_chunk = allocChunk(p_sparse);
+            if (p_chunk == NULL)
+            {
+                abandonNext(p_sparse);
+                return FALSE;
+            }
+        }
+
+        fillPad(p_sparse, keyRow(key), keyCol(key), pad);
+        if (stepPad(pad, p_rule, p_chunk->cells, &changed) == TRUE)
+        {
+            if (mapInsert(&p_sparse->next, key, p_chunk) != TRUE)
+            {
+                releaseChunk(p_sparse, p_chunk);
+                abandonNext(p_sparse);
+                return FALSE;
+            }
+            p_chunk = NULL;
+        }
+    }
+    if (p_chunk != NULL)
+    {
+        releaseChunk(p_sparse, p_chunk);
+    }
+
+    for (iSlot = 0; iSlot < p_sparse->live.capacity; iSlot++)
+    {
+        if (p_sparse->live.p_used[iSlot])
+        {
+            releaseChunk(p_sparse, p_sparse->live.p_chunks[iSlot]);
+        }
+    }
+
+    swap = p_sparse->live;
+    p_sparse->live = p_sparse->next;
+    p_sparse->next = swap;
+    p_sparse->generation++;
+
+    /* The old live chunks are spares for the next step, as many as needed */
+    trimFreeChunks(p_sparse);
+
+    *p_isStationary = (changed == FALSE);
+
+    return TRUE;
+}
+
+
+uint64_t Sparse_countPopulation(Sparse *p_sparse)
+{
+    uint64_t population = 0;
+    size_t iSlot;
+    int iCell;
+
+    for (iSlot = 0; iSlot < p_sparse->live.capacity; iSlot++)
+    {
+        if (p_sparse->live.p_used[iSlot] == FALSE)
+        {
+            continue;
+        }
+        for (iCell = 0; iCell < SPARSE_CHUNK_SIZE_CELLS * SPARSE_CHUNK_SIZE_CELLS; iCell++)
+        {
+            population += (p_sparse->live.p_chunks[iSlot]->cells[iCell] != GRID_DEAD);
+        }
+    }
+
+    return population;
+}
+
+
+void Sparse_destroy(Sparse *p_sparse)
+{
+    Sparse_chunk *p_chunk, *p_next;
+    size_t iSlot;
+
+    for (iSlot = 0; iSlot < p_sparse->live.capacity; iSlot++)
+    {
+        if (p_sparse->live.p_used[iSlot])
+        {
+            free(p_sparse->live.p_chunks[iSlot]);
+        }
+    }
+    for (p_chunk = p_sparse->p_freeChunks; p_chunk != NULL; p_chunk = p_next)
+    {
+        p_next = p_chunk->p_nextFree;
+        free(p_chunk);
+    }
+    p_sparse->p_freeChunks = NULL;
+    p_sparse->num_freeChunks = 0;
+
+    mapFree(&p_sparse->live);
+    mapFree(&p_sparse->next);
+    mapFree(&p_sparse->candidates);
+}
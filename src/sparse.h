@@ -0,0 +1,66 @@
+#ifndef H_HEXLIFE_SPARSE_H
+#define H_HEXLIFE_SPARSE_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "grid.h"
+#include "rule.h"
+#include "bool.h"
+
+
+/* Must be even so column parity is the same inside a chunk and globally */
+#define SPARSE_CHUNK_SIZE_CELLS  (32)
+
+
+typedef struct Sparse_chunk_struct Sparse_chunk;
+
+
+/* Open addressing map from packed chunk coordinates to chunks */
+typedef struct Sparse_map_struct {
+    int64_t *p_keys;
+    Sparse_chunk **p_chunks;
+    uint8_t *p_used;
+    size_t capacity;
+    size_t count;
+} Sparse_map;
+
+
+/* Unbounded universe using the same offset column layout as Grid. Only
+ * chunks holding non-dead cells are stored, so memory and step cost follow
+ * the live population rather than the bounding box. */
+typedef struct Sparse_struct {
+    Sparse_map live;
+    Sparse_map next;
+    Sparse_map candidates;
+
+    /* Spare chunks, kept to about as many as the next step needs */
+    Sparse_chunk *p_freeChunks;
+    size_t num_freeChunks;
+
+    uint64_t generation;
+} Sparse;
+
+
+extern Sparse Sparse_create(void);
+
+extern int Sparse_fromGrid(Sparse *p_sparse, Grid *p_grid);
+
+/* Writes the window whose top left cell is (rowOffset, colOffset) */
+extern void Sparse_toGrid(Sparse *p_sparse, Grid *p_grid, int64_t rowOffset, int64_t colOffset);
+
+/* One generation, setting *p_isStationary when no cell changed. Returns
+ * FALSE, with the universe as it was, for B0 rules or when out of memory. */
+extern int Sparse_hexGridNextWithRule(Sparse *p_sparse, const Rule *p_rule, int *p_isStationary);
+
+extern uint8_t Sparse_getValue(Sparse *p_sparse, int64_t row, int64_t col);
+
+extern int Sparse_setValue(Sparse *p_sparse, int64_t row, int64_t col, uint8_t value);
+
+extern uint64_t Sparse_countPopulation(Sparse *p_sparse);
+
+extern void Sparse_destroy(Sparse *p_sparse);
+
+
+#endif /* H_HEXLIFE_SPARSE_H */
@@ -0,0 +1,537 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "cycle.h"
+#include "ensemble.h"
+#include "rule.h"
+#include "pool.h"
+#include "timer.h"
+#include "bool.h"
+
+/* A hex cell has six neighbours, so counts run from 0 to 6 */
+#define SWEEP_MAX_NEIGHBOURS  (6)
+
+#define SWEEP_DEFAULT_WIDTH_CELLS   (64)
+#define SWEEP_DEFAULT_HEIGHT_CELLS  (64)
+#define SWEEP_DEFAULT_GENERATIONS   (1000)
+#define SWEEP_DEFAULT_SEEDS         (8)
+#define SWEEP_DEFAULT_MAX_PERIOD    (64)
+#define SWEEP_DEFAULT_OUTPUT_PATH   "sweep.csv"
+
+#define SWEEP_PROGRESS_INTERVAL_S  (1.0)
+
+#define SWEEP_OUTCOME_CAPPED      (0)
+#define SWEEP_OUTCOME_STATIONARY  (1)
+#define SWEEP_OUTCOME_PERIODIC    (2)
+
+
+typedef struct Sweep_range_struct {
+    int lo;
+    int hi;
+} Sweep_range;
+
+
+typedef struct Sweep_result_struct {
+    int minAlive, maxAlive;
+    int minCreate, maxCreate;
+    unsigned int seed;
+
+    int outcome;
+    /* First generation of the final state or cycle, when there is one */
+    long settled_generation;
+    int period;
+    long generations;
+
+    int alive;
+    int sick;
+    int population;
+    double run_ms;
+} Sweep_result;
+
+
+typedef struct Sweep_job_struct {
+    Sweep_result *p_results;
+    int num_runs;
+
+    /* Runs are handed out one at a time, rules settle at very different speeds */
+    int nextRun;
+    int numDone;
+
+    /* One of each per pool thread */
+    Grid *p_grids;
+    Cycle *p_cycles;
+    Ensemble *p_ensembles;
+
+    /* With -E each thread pulls whole rules and steps their seeds together */
+    int useEnsemble;
+    int num_seeds;
+
+    long max_generations;
+    uint64_t start_ns;
+} Sweep_job;
+
+
+static const char *outcomeNames[] = { "capped", "stationary", "periodic" };
+
+
+static void printUsage(char *progName)
+{
+    printf("Usage: %s [options]\n", progName);
+    printf("  -a <lo-hi>     fewest alive neighbours a cell survives with\n");
+    printf("  -A <lo-hi>     most alive neighbours a cell survives with\n");
+    printf("  -c <lo-hi>     fewest alive neighbours that create a cell\n");
+    printf("  -C <lo-hi>     most alive neighbours that create a cell\n");
+    printf("                 each 0-%d by default, a single number for one value.\n", SWEEP_MAX_NEIGHBOURS);
+    printf("                 Pairs whose fewest is above their most are skipped.\n");
+    printf("  -n <seeds>     random soups per rule (default %d)\n", SWEEP_DEFAULT_SEEDS);
+    printf("  -s <seed>      first seed, each rule runs the same soups (default 1)\n");
+    printf("  -w <cells>     grid width (default %d)\n", SWEEP_DEFAULT_WIDTH_CELLS);
+    printf("  -h <cells>     grid height (default %d)\n", SWEEP_DEFAULT_HEIGHT_CELLS);
+    printf("  -g <gens>      generation cap per run (default %d)\n", SWEEP_DEFAULT_GENERATIONS);
+    printf("  -p <gens>      longest period to detect (default %d)\n", SWEEP_DEFAULT_MAX_PERIOD);
+    printf("  -t <threads>   worker threads, 0 for one per core (default 0)\n");
+    printf("  -o <file>      CSV to write (default %s)\n", SWEEP_DEFAULT_OUTPUT_PATH);
+    printf("  -E             step each rule's seeds together as one bit-sliced\n");
+    printf("                 ensemble, only stationary and period two grids settle\n");
+}
+
+
+/* "lo-hi" or a single count */
+static int parseRange(const char *p_string, Sweep_range *p_range)
+{
+    if (sscanf(p_string, "%d-%d", &p_range->lo, &p_range->hi) != 2)
+    {
+        if (sscanf(p_string, "%d", &p_range->lo) != 1)
+        {
+            printf("[ERR] Could not parse range %s\n", p_string);
+            return FALSE;
+        }
+        p_range->hi = p_range->lo;
+    }
+
+    if (p_range->lo < 0 || p_range->hi > SWEEP_MAX_NEIGHBOURS || p_range->lo > p_range->hi)
+    {
+        printf("[ERR] Range %s must be lo-hi with 0 <= lo <= hi <= %d\n", p_string, SWEEP_MAX_NEIGHBOURS);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+static void runOne(Grid *p_grid, Cycle *p_cycle, long maxGenerations, Sweep_result *p_result)
+{
+    Rule rule = Rule_fromRange(p_result->minAlive, p_result->maxAlive, p_result->minCreate, p_result->maxCreate);
+    uint64_t start_ns = Timer_nowNs();
+    long iGen;
+
+    Grid_resetGrid(p_grid, p_result->seed, GRID_DEFAULT_DENSITY);
+    Cycle_reset(p_cycle);
+    Cycle_update(p_cycle, p_grid);
+
+    p_result->outcome = SWEEP_OUTCOME_CAPPED;
+    p_result->settled_generation = -1;
+    p_result->period = 0;
+    for (iGen = 0; iGen < maxGenerations; iGen++)
+    {
+        if (Grid_hexGridNextWithRule(p_grid, &rule) == TRUE)
+        {
+            p_result->outcome = SWEEP_OUTCOME_STATIONARY;
+            p_result->settled_generation = iGen;
+            p_result->period = 1;
+            iGen++;
+            break;
+        }
+        if (Cycle_update(p_cycle, p_grid) == TRUE)
+        {
+            p_result->outcome = SWEEP_OUTCOME_PERIODIC;
+            p_result->settled_generation = (long) p_cycle->start_generation;
+            p_result->period = p_cycle->period;
+            iGen++;
+            break;
+        }
+    }
+    p_result->generations = iGen;
+
+    p_result->alive = p_grid->stats.counts[GRID_ALIVE];
+    p_result->sick = p_grid->stats.counts[GRID_SICK];
+    p_result->population = Grid_countPopulation(p_grid);
+    p_result->run_ms = Timer_secondsSince(start_ns) * 1e3;
+}
+
+
+/* Steps every seed of one rule in lockstep, p_results holding one run per seed */
+static void runEnsemble(Grid *p_grid, Ensemble *p_ensemble, long maxGenerations, Sweep_result *p_results, int numSeeds)
+{
+    Sweep_result *p_result = &p_results[0];
+    Rule rule = Rule_fromRange(p_result->minAlive, p_result->maxAlive, p_result->minCreate, p_result->maxCreate);
+    uint64_t start_ns = Timer_nowNs();
+    double run_ms;
+    int iSeed;
+
+    for (iSeed = 0; iSeed < numSeeds; iSeed++)
+    {
+        Grid_resetGrid(p_grid, p_results[iSeed].seed, GRID_DEFAULT_DENSITY);
+        Ensemble_setMember(p_ensemble, iSeed, p_grid);
+    }
+
+    while ((long) p_ensemble->generation < maxGenerations && p_ensemble->num_active > 0)
+    {
+        Ensemble_hexGridNextWithRule(p_ensemble, &rule);
+    }
+    run_ms = Timer_secondsSince(start_ns) * 1e3;
+
+    for (iSeed = 0; iSeed < numSeeds; iSeed++)
+    {
+        p_result = &p_results[iSeed];
+        p_result->settled_generation = (long) p_ensemble->p_settledGenerations[iSeed];
+        switch (p_ensemble->p_outcomes[iSeed])
+        {
+            case ENSEMBLE_STATIONARY:
+                p_result->outcome = SWEEP_OUTCOME_STATIONARY;
+                p_result->period = 1;
+                p_result->generations = p_result->settled_generation + 1;
+                break;
+
+            case ENSEMBLE_PERIOD_TWO:
+                p_result->outcome = SWEEP_OUTCOME_PERIODIC;
+                p_result->period = 2;
+                p_result->generations = p_result->settled_generation + 2;
+                break;
+
+            default:
+                p_result->outcome = SWEEP_OUTCOME_CAPPED;
+                p_result->period = 0;
+                p_result->settled_generation = -1;
+                p_result->generations = (long) p_ensemble->generation;
+                break;
+        }
+
+        p_result->alive = Ensemble_countState(p_ensemble, iSeed, GRID_ALIVE);
+        p_result->sick = Ensemble_countState(p_ensemble, iSeed, GRID_SICK);
+        p_result->population = p_ensemble->num_cells - Ensemble_countState(p_ensemble, iSeed, GRID_DEAD);
+        /* The seeds share the time */
+        p_result->run_ms = run_ms / numSeeds;
+    }
+}
+
+
+/* One task per pool thread, each pulling runs, or whole rules with -E, until
+ * none are left */
+static void sweepTask(void *p_ctx, int iTask)
+{
+    Sweep_job *p_job = p_ctx;
+    uint64_t lastProgress_ns = Timer_nowNs();
+    int runsPerPull = p_job->useEnsemble == TRUE ? p_job->num_seeds : 1;
+    int iRun;
+    int numDone;
+
+    while ((iRun = __atomic_fetch_add(&p_job->nextRun, runsPerPull, __ATOMIC_RELAXED)) < p_job->num_runs)
+    {
+        if (p_job->useEnsemble == TRUE)
+        {
+            runEnsemble
+               (&p_job->p_grids[iTask], &p_job->p_ensembles[iTask], p_job->max_generations,
+                &p_job->p_results[iRun], p_job->num_seeds);
+        }
+        else
+        {
+            runOne(&p_job->p_grids[iTask], &p_job->p_cycles[iTask], p_job->max_generations, &p_job->p_results[iRun]);
+        }
+        numDone = __atomic_add_fetch(&p_job->numDone, runsPerPull, __ATOMIC_RELAXED);
+
+        /* Task 0 runs on the calling thread, let it report */
+        if (iTask == 0 && Timer_secondsSince(lastProgress_ns) >= SWEEP_PROGRESS_INTERVAL_S)
+        {
+            printf("\r%d/%d runs, %.0f s", numDone, p_job->num_runs, Timer_secondsSince(p_job->start_ns));
+            fflush(stdout);
+            lastProgress_ns = Timer_nowNs();
+        }
+    }
+}
+
+
+static int writeCsv(const char *p_path, const Sweep_result *p_results, int numRuns)
+{
+    const Sweep_result *p_result;
+    char ruleString[RULE_MAX_STRING_CHARS];
+    Rule rule;
+    FILE *p_file;
+    int isWritten = TRUE;
+    int iRun;
+
+    p_file = fopen(p_path, "w");
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", p_path);
+        return FALSE;
+    }
+
+    fprintf(p_file, "min_alive,max_alive,min_create,max_create,rule,seed,outcome,settled_generation,period,"
+                    "generations,population,alive,sick,sick_alive_ratio,run_ms\n");
+    for (iRun = 0; iRun < numRuns; iRun++)
+    {
+        p_result = &p_results[iRun];
+        rule = Rule_fromRange(p_result->minAlive, p_result->maxAlive, p_result->minCreate, p_result->maxCreate);
+        Rule_toString(&rule, ruleString, RULE_MAX_STRING_CHARS);
+
+        fprintf(p_file, "%d,%d,%d,%d,%s,%u,%s,",
+                p_result->minAlive, p_result->maxAlive, p_result->minCreate, p_result->maxCreate,
+                ruleString, p_result->seed, outcomeNames[p_result->outcome]);
+        if (p_result->outcome != SWEEP_OUTCOME_CAPPED)
+        {
+            fprintf(p_file, "%ld,%d", p_result->settled_generation, p_result->period);
+        }
+        else
+        {
+            fprintf(p_file, ",");
+        }
+        fprintf(p_file, ",%ld,%d,%d,%d,", p_result->generations, p_result->population, p_result->alive, p_result->sick);
+        if (p_result->alive > 0)
+        {
+            fprintf(p_file, "%.4f", (double) p_result->sick / p_result->alive);
+        }
+        fprintf(p_file, ",%.3f\n", p_result->run_ms);
+    }
+
+    if (ferror(p_file))
+    {
+        isWritten = FALSE;
+    }
+    if (fclose(p_file) != 0)
+    {
+        isWritten = FALSE;
+    }
+    if (isWritten == FALSE)
+    {
+        printf("[ERR] Could not write %s\n", p_path);
+    }
+
+    return isWritten;
+}
+
+
+int main(int argc, char *argv[])
+{
+    Sweep_range minAlive = { 0, SWEEP_MAX_NEIGHBOURS };
+    Sweep_range maxAlive = { 0, SWEEP_MAX_NEIGHBOURS };
+    Sweep_range minCreate = { 0, SWEEP_MAX_NEIGHBOURS };
+    Sweep_range maxCreate = { 0, SWEEP_MAX_NEIGHBOURS };
+    int width_cells = SWEEP_DEFAULT_WIDTH_CELLS;
+    int height_cells = SWEEP_DEFAULT_HEIGHT_CELLS;
+    long maxGenerations = SWEEP_DEFAULT_GENERATIONS;
+    int numSeeds = SWEEP_DEFAULT_SEEDS;
+    unsigned int firstSeed = 1;
+    int maxPeriod = SWEEP_DEFAULT_MAX_PERIOD;
+    int numThreads = 0;
+    char *p_outputPath = SWEEP_DEFAULT_OUTPUT_PATH;
+    int useEnsemble = FALSE;
+
+    Sweep_job job;
+    Sweep_result *p_result;
+    Pool *p_pool;
+    int a, A, c, C;
+    int iSeed;
+    int iRun;
+    int iThread;
+    int iArg;
+    int isOk = TRUE;
+    uint64_t totalGenerations = 0;
+    double sweepTime_s;
+
+    /* ------ ARGUMENTS ------ */
+    for (iArg = 1; iArg < argc; iArg++)
+    {
+        if (strcmp(argv[iArg], "-E") == 0)
+        {
+            useEnsemble = TRUE;
+            continue;
+        }
+
+        if (iArg + 1 >= argc || argv[iArg][0] != '-' || argv[iArg][1] == '\0' || argv[iArg][2] != '\0')
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        switch (argv[iArg][1])
+        {
+            case 'a':
+                isOk = parseRange(argv[++iArg], &minAlive);
+                break;
+            case 'A':
+                isOk = parseRange(argv[++iArg], &maxAlive);
+                break;
+            case 'c':
+                isOk = parseRange(argv[++iArg], &minCreate);
+                break;
+            case 'C':
+                isOk = parseRange(argv[++iArg], &maxCreate);
+                break;
+            case 'n':
+                numSeeds = atoi(argv[++iArg]);
+                break;
+            case 's':
+                firstSeed = strtoul(argv[++iArg], NULL, 0);
+                break;
+            case 'w':
+                width_cells = atoi(argv[++iArg]);
+                break;
+            case 'h':
+                height_cells = atoi(argv[++iArg]);
+                break;
+            case 'g':
+                maxGenerations = atol(argv[++iArg]);
+                break;
+            case 'p':
+                maxPeriod = atoi(argv[++iArg]);
+                break;
+            case 't':
+                numThreads = atoi(argv[++iArg]);
+                break;
+            case 'o':
+                p_outputPath = argv[++iArg];
+                break;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+        if (isOk != TRUE)
+        {
+            return 1;
+        }
+    }
+
+    if (width_cells <= 0 || height_cells <= 0 || maxGenerations < 0 || numSeeds <= 0 || maxPeriod <= 0 || numThreads < 0)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    /* ------ INITIALISATION ------ */
+    /* Every rule and seed, in the order they are written out */
+    memset(&job, 0, sizeof(Sweep_job));
+    job.p_results = malloc((size_t) (SWEEP_MAX_NEIGHBOURS + 1) * (SWEEP_MAX_NEIGHBOURS + 1)
+                           * (SWEEP_MAX_NEIGHBOURS + 1) * (SWEEP_MAX_NEIGHBOURS + 1) * numSeeds * sizeof(Sweep_result));
+    if (job.p_results == NULL)
+    {
+        printf("[ERR] Could not allocate results for %d seeds\n", numSeeds);
+        return 1;
+    }
+    for (a = minAlive.lo; a <= minAlive.hi; a++)
+    {
+        for (A = (maxAlive.lo > a ? maxAlive.lo : a); A <= maxAlive.hi; A++)
+        {
+            for (c = minCreate.lo; c <= minCreate.hi; c++)
+            {
+                for (C = (maxCreate.lo > c ? maxCreate.lo : c); C <= maxCreate.hi; C++)
+                {
+                    for (iSeed = 0; iSeed < numSeeds; iSeed++)
+                    {
+                        p_result = &job.p_results[job.num_runs++];
+                        p_result->minAlive = a;
+                        p_result->maxAlive = A;
+                        p_result->minCreate = c;
+                        p_result->maxCreate = C;
+                        p_result->seed = firstSeed + iSeed;
+                    }
+                }
+            }
+        }
+    }
+    if (job.num_runs == 0)
+    {
+        printf("[ERR] No rule has its fewest neighbours at or below its most\n");
+        free(job.p_results);
+        return 1;
+    }
+
+    p_pool = Pool_create(numThreads);
+    if (p_pool == NULL)
+    {
+        free(job.p_results);
+        return 1;
+    }
+
+    job.p_grids = calloc(p_pool->num_threads, sizeof(Grid));
+    job.p_cycles = calloc(p_pool->num_threads, sizeof(Cycle));
+    job.p_ensembles = calloc(p_pool->num_threads, sizeof(Ensemble));
+    if (job.p_grids == NULL || job.p_cycles == NULL || job.p_ensembles == NULL)
+    {
+        printf("[ERR] Could not allocate per thread grids\n");
+        return 1;
+    }
+    for (iThread = 0; iThread < p_pool->num_threads; iThread++)
+    {
+        job.p_grids[iThread] = Grid_create(width_cells, height_cells);
+        if (job.p_grids[iThread].p_data1 == NULL || job.p_grids[iThread].p_data2 == NULL)
+        {
+            return 1;
+        }
+        if (useEnsemble == TRUE)
+        {
+            job.p_ensembles[iThread] = Ensemble_create(width_cells, height_cells, numSeeds);
+            if (job.p_ensembles[iThread].p_data1 == NULL)
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            job.p_cycles[iThread] = Cycle_create(maxPeriod);
+            if (job.p_cycles[iThread].p_ring == NULL)
+            {
+                return 1;
+            }
+        }
+    }
+    job.max_generations = maxGenerations;
+    job.useEnsemble = useEnsemble;
+    job.num_seeds = numSeeds;
+
+    printf("Sweeping %d runs (%d rules x %d seeds) on %dx%d grids with %d threads\n",
+           job.num_runs, job.num_runs / numSeeds, numSeeds, width_cells, height_cells, p_pool->num_threads);
+
+    /* ------ SWEEP ------ */
+    job.start_ns = Timer_nowNs();
+    Pool_run(p_pool, sweepTask, &job, p_pool->num_threads);
+    sweepTime_s = Timer_secondsSince(job.start_ns);
+
+    /* ------ REPORT ------ */
+    for (iRun = 0; iRun < job.num_runs; iRun++)
+    {
+        totalGenerations += job.p_results[iRun].generations;
+    }
+    printf("\r%d runs in %.3f s, %.1f runs/s, %.3e cells/s\n",
+           job.num_runs, sweepTime_s, job.num_runs / sweepTime_s,
+           (double) totalGenerations * width_cells * height_cells / sweepTime_s);
+
+    isOk = writeCsv(p_outputPath, job.p_results, job.num_runs);
+    if (isOk == TRUE)
+    {
+        printf("Results written to %s\n", p_outputPath);
+    }
+
+    for (iThread = 0; iThread < p_pool->num_threads; iThread++)
+    {
+        Grid_destroy(&job.p_grids[iThread]);
+        if (useEnsemble == TRUE)
+        {
+            Ensemble_destroy(&job.p_ensembles[iThread]);
+        }
+        else
+        {
+            Cycle_destroy(&job.p_cycles[iThread]);
+        }
+    }
+    free(job.p_grids);
+    free(job.p_cycles);
+    free(job.p_ensembles);
+    free(job.p_results);
+    Pool_destroy(p_pool);
+
+    return isOk == TRUE ? 0 : 1;
+}
@@ -0,0 +1,1996 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "grid.h"
+#include "bitgrid.h"
+#include "hashlife.h"
+#include "sparse.h"
+#include "cycle.h"
+#include "ensemble.h"
+#include "domain.h"
+#include "snapshot.h"
+#include "history.h"
+#include "export.h"
+#include "pool.h"
+#include "rule.h"
+#include "bool.h"
+
+/* Every engine is checked against the byte kernel on the same seeded soups */
+#define TEST_NUM_RULES  (4)
+#define TEST_NUM_SEEDS  (3)
+
+#define TEST_GENERATIONS  (40)
+
+/* Soups for the unbounded engines fill the middle of a grid wide enough that
+ * nothing reaches its edges within TEST_GENERATIONS */
+#define TEST_SOUP_CELLS    (32)
+#define TEST_PLANE_CELLS   (128)
+
+#define TEST_ENSEMBLE_MEMBERS  (70)
+
+#define TEST_SNAPSHOT_PATH  "hexlife-test.snap"
+#define TEST_GIF_PATH       "hexlife-test.gif"
+#define TEST_PNG_PATTERN    "hexlife-test-%d.png"
+
+#define TEST_NUM_BAD_RULES  (9)
+
+/* Longest run checkCycle keeps every state of */
+#define TEST_CYCLE_MAX_GENERATIONS  (400)
+
+/* Small enough that a few dozen dense generations overflow it */
+#define TEST_HISTORY_MAX_BYTES  (16 * 1024)
+#define TEST_HISTORY_STATES     (100)
+
+#define TEST_EXPORT_FRAMES  (3)
+#define TEST_LZW_MAX_CODES  (4096)
+
+
+/* Reads bits least significant first, as GIF and deflate store them */
+typedef struct Test_bits_struct {
+    const uint8_t *p_bytes;
+    size_t numBytes;
+    size_t bitPos;
+} Test_bits;
+
+
+typedef struct Test_case_struct {
+    const char *p_name;
+    int (*testFn)(void);
+} Test_case;
+
+
+static const char *testRules[TEST_NUM_RULES] =
+{
+    "B3/S234", "B2/S34", "B24/S35", "B13/S0246"
+};
+
+
+/* Each lacks a half, has a count past 6, a stray or repeated letter or a
+ * digit before any letter */
+static const char *badRules[TEST_NUM_BAD_RULES] =
+{
+    "", "B3", "S23", "B3/S27", "B3/S23x", "B3 /S23", "B3/S2/B4", "3/S23", "B-3/S23"
+};
+
+
+static Rule parseRule(int iRule)
+{
+    Rule rule;
+
+    Rule_parse(testRules[iRule], &rule);
+
+    return rule;
+}
+
+
+/* Counts the cells where the grids differ, printing the first */
+static int compareGrids(const char *p_what, Grid *p_expected, Grid *p_actual)
+{
+    int iRow, iCol;
+    int numDiffs = 0;
+
+    if (p_expected->width_cells != p_actual->width_cells || p_expected->height_cells != p_actual->height_cells)
+    {
+        printf("[ERR] %s: %dx%d grid, expected %dx%d\n", p_what,
+               p_actual->width_cells, p_actual->height_cells, p_expected->width_cells, p_expected->height_cells);
+        return FALSE;
+    }
+
+    for (iRow = 0; iRow < p_expected->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_expected->width_cells; iCol++)
+        {
+            if (Grid_getDispValue(p_expected, iRow, iCol) != Grid_getDispValue(p_actual, iRow, iCol))
+            {
+                if (numDiffs == 0)
+                {
+                    printf("[ERR] %s: cell (%d, %d) is %d, expected %d\n", p_what, iRow, iCol,
+                           Grid_getDispValue(p_actual, iRow, iCol), Grid_getDispValue(p_expected, iRow, iCol));
+                }
+                numDiffs++;
+            }
+        }
+    }
+    if (numDiffs > 0)
+    {
+        printf("[ERR] %s: %d cells differ\n", p_what, numDiffs);
+        return FALSE;
+    }
+
+    /* The byte kernel keeps its hash up to date as it steps */
+    if (Grid_computeHash(p_actual) != p_expected->hash)
+    {
+        printf("[ERR] %s: hash differs\n", p_what);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+static int compareStats(const char *p_what, const Grid_stats *p_expected, const Grid_stats *p_actual)
+{
+    if (memcmp(p_expected, p_actual, sizeof(Grid_stats)) != 0)
+    {
+        printf("[ERR] %s: stats differ\n", p_what);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/* Soup of TEST_SOUP_CELLS square in the middle of a dead TEST_PLANE_CELLS grid */
+static int createPlane(Grid *p_grid, uint64_t seed)
+{
+    Grid soup;
+    int offset = (TEST_PLANE_CELLS - TEST_SOUP_CELLS) / 2;
+    int iRow, iCol;
+
+    *p_grid = Grid_create(TEST_PLANE_CELLS, TEST_PLANE_CELLS);
+    soup = Grid_create(TEST_SOUP_CELLS, TEST_SOUP_CELLS);
+    if (p_grid->p_data1 == NULL || soup.p_data1 == NULL)
+    {
+        Grid_destroy(p_grid);
+        Grid_destroy(&soup);
+        return FALSE;
+    }
+
+    Grid_resetGrid(&soup, seed, 0.4);
+    for (iRow = 0; iRow < TEST_SOUP_CELLS; iRow++)
+    {
+        for (iCol = 0; iCol < TEST_SOUP_CELLS; iCol++)
+        {
+            Grid_setDispValue(p_grid, offset + iRow, offset + iCol, Grid_getDispValue(&soup, iRow, iCol));
+        }
+    }
+    Grid_syncDisp(p_grid);
+    Grid_setBoundary(p_grid, GRID_BOUNDARY_DEAD);
+    Grid_destroy(&soup);
+
+    return TRUE;
+}
+
+
+/* The branch chain range rules were stepped with before the tables: dead
+ * outside [minAlive, maxAlive], born in [minCreate, maxCreate], sick if any
+ * neighbour is, and fixed cells never change */
+static uint8_t rangeNext(uint8_t state, int aliveNeighbours, int anySick, int minAlive, int maxAlive, int minCreate, int maxCreate)
+{
+    if (state == GRID_ALIVE || state == GRID_SICK)
+    {
+        if (aliveNeighbours < minAlive || aliveNeighbours > maxAlive)
+        {
+            return GRID_DEAD;
+        }
+    }
+    else if (state == GRID_DEAD)
+    {
+        if (aliveNeighbours >= minCreate && aliveNeighbours <= maxCreate)
+        {
+            return anySick ? GRID_SICK : GRID_ALIVE;
+        }
+    }
+
+    return state;
+}
+
+
+/* Table index of a cell with count non-dead neighbours, numSick of them sick */
+static int neighbourSum(int count, int numSick)
+{
+    return count + (numSick << RULE_SUM_SICK_SHIFT);
+}
+
+
+/* What rangeNext gives for every state and mix of neighbours. Only sums
+ * that six neighbours can add up to are filled in. */
+static void fillRangeTable(uint8_t *p_table, int minAlive, int maxAlive, int minCreate, int maxCreate)
+{
+    int state, count, numSick;
+
+    for (state = 0; state < RULE_NUM_STATES; state++)
+    {
+        for (count = 0; count <= GRID_HEX_NUM_NEIGHBOURS; count++)
+        {
+            for (numSick = 0; numSick <= count; numSick++)
+            {
+                p_table[state * RULE_NUM_SUMS + neighbourSum(count, numSick)] =
+                    rangeNext(state, count, numSick > 0, minAlive, maxAlive, minCreate, maxCreate);
+            }
+        }
+    }
+}
+
+
+/* A count in a mask is the range of just that count, one outside it an empty range */
+static void fillMaskTable(uint8_t *p_table, uint8_t surviveMask, uint8_t createMask)
+{
+    int state, count, numSick;
+    int minAlive, minCreate;
+
+    for (count = 0; count <= GRID_HEX_NUM_NEIGHBOURS; count++)
+    {
+        minAlive = ((surviveMask >> count) & 1) ? count : count + 1;
+        minCreate = ((createMask >> count) & 1) ? count : count + 1;
+        for (state = 0; state < RULE_NUM_STATES; state++)
+        {
+            for (numSick = 0; numSick <= count; numSick++)
+            {
+                p_table[state * RULE_NUM_SUMS + neighbourSum(count, numSick)] =
+                    rangeNext(state, count, numSick > 0, minAlive, count, minCreate, count);
+            }
+        }
+    }
+}
+
+
+static int compareTable(const char *p_what, const Rule *p_rule, const uint8_t *p_expected)
+{
+    int state, count, numSick;
+    int iEntry;
+
+    for (state = 0; state < RULE_NUM_STATES; state++)
+    {
+        for (count = 0; count <= GRID_HEX_NUM_NEIGHBOURS; count++)
+        {
+            for (numSick = 0; numSick <= count; numSick++)
+            {
+                iEntry = state * RULE_NUM_SUMS + neighbourSum(count, numSick);
+                if (p_rule->table[iEntry] != p_expected[iEntry])
+                {
+                    printf("[ERR] %s: state %d with %d neighbours, %d sick, goes to %d, expected %d\n", p_what,
+                           state, count, numSick, p_rule->table[iEntry], p_expected[iEntry]);
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+
+static int testRule(void)
+{
+    Rule rule, parsed;
+    char what[64];
+    char string[RULE_MAX_STRING_CHARS];
+    uint8_t expected[RULE_NUM_STATES * RULE_NUM_SUMS];
+    int minAlive, maxAlive, minCreate, maxCreate;
+    int surviveMask, createMask;
+    int iBad;
+    int isPassed = TRUE;
+
+    /* Every range, as the a,b,c,d rules of hexlife-run give them */
+    for (minAlive = 0; minAlive <= GRID_HEX_NUM_NEIGHBOURS; minAlive++)
+    {
+        for (maxAlive = 0; maxAlive <= GRID_HEX_NUM_NEIGHBOURS; maxAlive++)
+        {
+            for (minCreate = 0; minCreate <= GRID_HEX_NUM_NEIGHBOURS; minCreate++)
+            {
+                for (maxCreate = 0; maxCreate <= GRID_HEX_NUM_NEIGHBOURS; maxCreate++)
+                {
+                    snprintf(what, sizeof(what), "range %d,%d,%d,%d", minAlive, maxAlive, minCreate, maxCreate);
+                    rule = Rule_fromRange(minAlive, maxAlive, minCreate, maxCreate);
+                    fillRangeTable(expected, minAlive, maxAlive, minCreate, maxCreate);
+                    isPassed &= compareTable(what, &rule, expected);
+                }
+            }
+        }
+    }
+
+    /* Every B/S string, round tripped through Rule_toString */
+    for (surviveMask = 0; surviveMask < (1 << (GRID_HEX_NUM_NEIGHBOURS + 1)); surviveMask++)
+    {
+        for (createMask = 0; createMask < (1 << (GRID_HEX_NUM_NEIGHBOURS + 1)); createMask++)
+        {
+            rule = Rule_fromMasks(surviveMask, createMask);
+            Rule_toString(&rule, string, sizeof(string));
+            if (Rule_parse(string, &parsed) != TRUE || parsed.surviveMask != surviveMask || parsed.createMask != createMask)
+            {
+                printf("[ERR] %s did not parse back to the rule it came from\n", string);
+                isPassed = FALSE;
+                continue;
+            }
+            fillMaskTable(expected, surviveMask, createMask);
+            isPassed &= compareTable(string, &parsed, expected);
+        }
+    }
+
+    if (Rule_parse("s234/b3", &parsed) != TRUE || parsed.surviveMask != 0x1C || parsed.createMask != 0x08)
+    {
+        printf("[ERR] s234/b3 did not parse as B3/S234\n");
+        isPassed = FALSE;
+    }
+
+    /* Rejections print their own errors */
+    for (iBad = 0; iBad < TEST_NUM_BAD_RULES; iBad++)
+    {
+        if (Rule_parse(badRules[iBad], &parsed) == TRUE)
+        {
+            printf("[ERR] Malformed rule \"%s\" was accepted\n", badRules[iBad]);
+            isPassed = FALSE;
+        }
+    }
+
+    return isPassed;
+}
+
+
+/* Steps the grid, comparing every state with all those before it, and checks
+ * that Cycle reports the first repeat one period after it happens. With
+ * forgeGen >= 0 the hash at that generation is replaced by generation 0's to
+ * fake a collision. Returns the period found, 0 for none, or -1 on failure. */
+static int checkCycle(const char *p_what, Grid *p_grid, const Rule *p_rule, int numGens, int forgeGen)
+{
+    size_t stateBytes = (size_t) p_grid->width_cells * p_grid->height_cells;
+    uint8_t *p_states;
+    uint8_t *p_state;
+    Cycle cycle;
+    uint64_t realHash, firstHash = p_grid->hash;
+    int iGen, iEarlier, iRow;
+    int period = 0, start = 0;
+    int reportGen = -1;
+    int isPassed = TRUE;
+
+    p_states = malloc(stateBytes * (numGens + 1));
+    cycle = Cycle_create(CYCLE_DEFAULT_MAX_PERIOD);
+    if (p_states == NULL || cycle.p_ring == NULL)
+    {
+        free(p_states);
+        Cycle_destroy(&cycle);
+        return -1;
+    }
+
+    for (iGen = 0; iGen <= numGens && reportGen < 0; iGen++)
+    {
+        p_state = p_states + stateBytes * iGen;
+        for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+        {
+            memcpy(p_state + (size_t) iRow * p_grid->width_cells,
+                   p_grid->p_disp + (size_t) iRow * p_grid->stride_cells, p_grid->width_cells);
+        }
+        for (iEarlier = 0; iEarlier < iGen && period == 0; iEarlier++)
+        {
+            if (memcmp(p_states + stateBytes * iEarlier, p_state, stateBytes) == 0)
+            {
+                period = iGen - iEarlier;
+                start = iEarlier;
+            }
+        }
+
+        realHash = p_grid->hash;
+        if (iGen == forgeGen)
+        {
+            p_grid->hash = firstHash;
+        }
+        if (Cycle_update(&cycle, p_grid) == TRUE)
+        {
+            reportGen = iGen;
+        }
+        p_grid->hash = realHash;
+
+        Grid_hexGridNextWithRule(p_grid, p_rule);
+    }
+
+    if (period > 0 && start + 2 * period <= numGens
+     && (reportGen != start + 2 * period || cycle.period != period || (int) cycle.start_generation != start))
+    {
+        printf("[ERR] %s: period %d since %d reported at generation %d, expected period %d since %d at %d\n",
+               p_what, cycle.period, (int) cycle.start_generation, reportGen, period, start, start + 2 * period);
+        isPassed = FALSE;
+    }
+    if (period == 0 && reportGen >= 0)
+    {
+        printf("[ERR] %s: period %d reported at generation %d, but no state repeats\n", p_what, cycle.period, reportGen);
+        isPassed = FALSE;
+    }
+
+    free(p_states);
+    Cycle_destroy(&cycle);
+
+    return isPassed ? period : -1;
+}
+
+
+static int testCycle(void)
+{
+    Grid grid;
+    Rule stillRule = parseRule(0);
+    Rule blinkRule = Rule_fromMasks(0x00, 0x01);
+    Rule soupRule = parseRule(1);
+    char what[64];
+    int period;
+    int seed;
+    int numPeriodic = 0;
+    int isPassed = TRUE;
+
+    grid = Grid_create(30, 30);
+    if (grid.p_data1 == NULL)
+    {
+        return FALSE;
+    }
+
+    /* Fixed cells too far apart to create anything */
+    Grid_clearGrid(&grid);
+    Grid_setDispValue(&grid, 5, 5, GRID_FIXED);
+    Grid_setDispValue(&grid, 15, 20, GRID_FIXED);
+    isPassed &= checkCycle("still life", &grid, &stillRule, 10, -1) == 1;
+
+    /* B0/S: every dead cell is born, then every cell dies */
+    Grid_clearGrid(&grid);
+    isPassed &= checkCycle("blinker", &grid, &blinkRule, 10, -1) == 2;
+
+    /* The full grid takes the empty grid's hash, which must not pass for a
+     * period of 1 once its cells are compared */
+    Grid_clearGrid(&grid);
+    isPassed &= checkCycle("blinker with a hash collision", &grid, &blinkRule, 10, 1) == 2;
+    Grid_destroy(&grid);
+
+    /* Still changing when the run ends, also with a collision in the middle */
+    grid = Grid_create(64, 64);
+    if (grid.p_data1 == NULL)
+    {
+        return FALSE;
+    }
+    Grid_resetGrid(&grid, 9, GRID_DEFAULT_DENSITY);
+    isPassed &= checkCycle("soup", &grid, &stillRule, 40, -1) == 0;
+    Grid_resetGrid(&grid, 9, GRID_DEFAULT_DENSITY);
+    isPassed &= checkCycle("soup with a hash collision", &grid, &stillRule, 40, 10) == 0;
+    Grid_destroy(&grid);
+
+    /* Small soups settle into oscillators a while in */
+    grid = Grid_create(24, 24);
+    if (grid.p_data1 == NULL)
+    {
+        return FALSE;
+    }
+    for (seed = 1; seed <= TEST_NUM_SEEDS; seed++)
+    {
+        snprintf(what, sizeof(what), "soup %d", seed);
+        Grid_resetGrid(&grid, seed, GRID_DEFAULT_DENSITY);
+        period = checkCycle(what, &grid, &soupRule, TEST_CYCLE_MAX_GENERATIONS, -1);
+        isPassed &= period >= 0;
+        numPeriodic += period >= 2;
+    }
+    if (numPeriodic == 0)
+    {
+        printf("[ERR] No soup settled into an oscillator\n");
+        isPassed = FALSE;
+    }
+    Grid_destroy(&grid);
+
+    return isPassed;
+}
+
+
+static int testBitGrid(void)
+{
+    static const int widths[] = { 64, 100, 131, 258 };
+    Grid expected, actual;
+    BitGrid bitGrid;
+    Rule rule;
+    char what[64];
+    int iWidth, iRule, iGen;
+    int isPassed = TRUE;
+
+    for (iWidth = 0; iWidth < (int) (sizeof(widths) / sizeof(widths[0])); iWidth++)
+    {
+        for (iRule = 0; iRule < TEST_NUM_RULES; iRule++)
+        {
+            rule = parseRule(iRule);
+            expected = Grid_create(widths[iWidth], 50);
+            actual = Grid_create(widths[iWidth], 50);
+            bitGrid = BitGrid_create(widths[iWidth], 50);
+            if (expected.p_data1 == NULL || actual.p_data1 == NULL || bitGrid.p_data1 == NULL)
+            {
+                return FALSE;
+            }
+
+            Grid_resetGrid(&expected, iRule + 1, GRID_DEFAULT_DENSITY);
+            BitGrid_fromGrid(&bitGrid, &expected);
+            for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+            {
+                Grid_hexGridNextWithRule(&expected, &rule);
+                BitGrid_hexGridNextWithRule(&bitGrid, &rule);
+            }
+            BitGrid_toGrid(&bitGrid, &actual);
+
+            snprintf(what, sizeof(what), "bit kernel %d wide, %s", widths[iWidth], testRules[iRule]);
+            isPassed &= compareGrids(what, &expected, &actual);
+            if (BitGrid_countPopulation(&bitGrid) != Grid_countPopulation(&expected))
+            {
+                printf("[ERR] %s: population differs\n", what);
+                isPassed = FALSE;
+            }
+
+            Grid_destroy(&expected);
+            Grid_destroy(&actual);
+            BitGrid_destroy(&bitGrid);
+        }
+    }
+
+    return isPassed;
+}
+
+
+static int testPool(void)
+{
+    Grid expected, actual;
+    Pool *p_pool;
+    Rule rule;
+    char what[64];
+    int boundary, iRule, iGen;
+    int isPassed = TRUE;
+
+    /* More threads than the test machine may have, so the bands still split */
+    p_pool = Pool_create(3);
+    if (p_pool == NULL)
+    {
+        return FALSE;
+    }
+
+    for (boundary = 0; boundary < GRID_NUM_BOUNDARIES; boundary++)
+    {
+        for (iRule = 0; iRule < TEST_NUM_RULES; iRule++)
+        {
+            rule = parseRule(iRule);
+            expected = Grid_create(97, 120);
+            actual = Grid_create(97, 120);
+            if (expected.p_data1 == NULL || actual.p_data1 == NULL)
+            {
+                return FALSE;
+            }
+
+            Grid_resetGrid(&expected, iRule + 1, GRID_DEFAULT_DENSITY);
+            Grid_resetGridParallel(&actual, p_pool, iRule + 1, GRID_DEFAULT_DENSITY);
+            Grid_setBoundary(&expected, boundary);
+            Grid_setBoundary(&actual, boundary);
+            for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+            {
+                Grid_hexGridNextWithRule(&expected, &rule);
+                Grid_hexGridNextWithRuleParallel(&actual, p_pool, &rule);
+            }
+
+            snprintf(what, sizeof(what), "pool bands, %s boundary, %s", Grid_boundaryName(boundary), testRules[iRule]);
+            isPassed &= compareGrids(what, &expected, &actual);
+            isPassed &= compareStats(what, &expected.stats, &actual.stats);
+
+            Grid_destroy(&expected);
+            Grid_destroy(&actual);
+        }
+    }
+
+    Pool_destroy(p_pool);
+
+    return isPassed;
+}
+
+
+/* Compares the incrementally kept hash and stats with a recount of the
+ * cells, done on a copy in p_scratch. Births, deaths and infections are
+ * counted from p_prev, the cells before the last step, unless it is NULL.
+ * After edits the bounding box only has to hold every non-dead cell. */
+static int checkStats(const char *p_what, Grid *p_grid, Grid *p_scratch, const uint8_t *p_prev, int isBoxExact)
+{
+    Grid_stats *p_stats = &p_grid->stats;
+    Grid_stats *p_counted = &p_scratch->stats;
+    int births = 0, deaths = 0, infections = 0;
+    int iRow, iCol;
+    uint8_t before, after;
+    int isPassed = TRUE;
+
+    if (Grid_computeHash(p_grid) != p_grid->hash)
+    {
+        printf("[ERR] %s: hash differs from a recount\n", p_what);
+        isPassed = FALSE;
+    }
+
+    memcpy(p_scratch->p_disp, p_grid->p_disp, (size_t) p_grid->stride_cells * p_grid->height_cells);
+    Grid_computeStats(p_scratch);
+    if (memcmp(p_stats->counts, p_counted->counts, sizeof(p_stats->counts)) != 0)
+    {
+        printf("[ERR] %s: %d/%d/%d/%d cells per state, counted %d/%d/%d/%d\n", p_what,
+               p_stats->counts[0], p_stats->counts[1], p_stats->counts[2], p_stats->counts[3],
+               p_counted->counts[0], p_counted->counts[1], p_counted->counts[2], p_counted->counts[3]);
+        isPassed = FALSE;
+    }
+
+    if (isBoxExact == TRUE
+      ? (p_stats->min_row != p_counted->min_row || p_stats->max_row != p_counted->max_row
+      || p_stats->min_col != p_counted->min_col || p_stats->max_col != p_counted->max_col)
+      : (p_counted->min_row <= p_counted->max_row
+      && (p_stats->min_row > p_counted->min_row || p_stats->max_row < p_counted->max_row
+       || p_stats->min_col > p_counted->min_col || p_stats->max_col < p_counted->max_col)))
+    {
+        printf("[ERR] %s: box rows %d-%d cols %d-%d, counted rows %d-%d cols %d-%d\n", p_what,
+               p_stats->min_row, p_stats->max_row, p_stats->min_col, p_stats->max_col,
+               p_counted->min_row, p_counted->max_row, p_counted->min_col, p_counted->max_col);
+        isPassed = FALSE;
+    }
+
+    if (p_prev == NULL)
+    {
+        return isPassed;
+    }
+    for (iRow = 0; iRow < p_grid->height_cells; iRow++)
+    {
+        for (iCol = 0; iCol < p_grid->width_cells; iCol++)
+        {
+            before = p_prev[(size_t) iRow * p_grid->stride_cells + iCol];
+            after = Grid_getDispValue(p_grid, iRow, iCol);
+            births += before == GRID_DEAD && after != GRID_DEAD;
+            deaths += before != GRID_DEAD && after == GRID_DEAD;
+            infections += before == GRID_DEAD && after == GRID_SICK;
+        }
+    }
+    if (p_stats->births != births || p_stats->deaths != deaths || p_stats->infections != infections)
+    {
+        printf("[ERR] %s: %d births, %d deaths, %d infections, counted %d, %d, %d\n", p_what,
+               p_stats->births, p_stats->deaths, p_stats->infections, births, deaths, infections);
+        isPassed = FALSE;
+    }
+
+    return isPassed;
+}
+
+
+/* Steps serially and over the pool in turn, so both ways of merging the
+ * tiles' stats are recounted. Half way through cells are edited all over
+ * the grid, and at the end a snapshot from a quarter of the way through is
+ * restored and stepped on from. */
+static int checkStatsRun(const char *p_start, Grid *p_grid, Pool *p_pool, const Rule *p_rule)
+{
+    Grid scratch;
+    uint8_t *p_prev;
+    size_t numCells = (size_t) p_grid->stride_cells * p_grid->height_cells;
+    char what[96];
+    int iGen, iEdit;
+    int isPassed = TRUE;
+
+    scratch = Grid_create(p_grid->width_cells, p_grid->height_cells);
+    p_prev = malloc(numCells);
+    if (scratch.p_data1 == NULL || p_prev == NULL)
+    {
+        Grid_destroy(&scratch);
+        free(p_prev);
+        return FALSE;
+    }
+
+    snprintf(what, sizeof(what), "%s, start", p_start);
+    isPassed &= checkStats(what, p_grid, &scratch, NULL, TRUE);
+
+    for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+    {
+        /* Every state dropped in, far outside the box of a small soup too */
+        if (iGen == TEST_GENERATIONS / 2)
+        {
+            for (iEdit = 0; iEdit < 60; iEdit++)
+            {
+                Grid_setDispValue(p_grid, (iEdit * 37) % p_grid->height_cells, (iEdit * 53) % p_grid->width_cells,
+                                  (uint8_t) (iEdit % RULE_NUM_STATES));
+            }
+            snprintf(what, sizeof(what), "%s, edits at generation %d", p_start, iGen);
+            isPassed &= checkStats(what, p_grid, &scratch, NULL, FALSE);
+        }
+
+        memcpy(p_prev, p_grid->p_disp, numCells);
+        if (iGen % 2 == 0)
+        {
+            Grid_hexGridNextWithRule(p_grid, p_rule);
+        }
+        else
+        {
+            Grid_hexGridNextWithRuleParallel(p_grid, p_pool, p_rule);
+        }
+        snprintf(what, sizeof(what), "%s, generation %d", p_start, iGen + 1);
+        isPassed &= checkStats(what, p_grid, &scratch, p_prev, TRUE);
+
+        if (iGen == TEST_GENERATIONS / 4)
+        {
+            isPassed &= Snapshot_save(TEST_SNAPSHOT_PATH, p_grid, p_rule, SNAPSHOT_ENCODING_AUTO);
+        }
+    }
+
+    snprintf(what, sizeof(what), "%s, restored", p_start);
+    isPassed &= Snapshot_restore(TEST_SNAPSHOT_PATH, p_grid);
+    isPassed &= checkStats(what, p_grid, &scratch, NULL, TRUE);
+    memcpy(p_prev, p_grid->p_disp, numCells);
+    Grid_hexGridNextWithRuleParallel(p_grid, p_pool, p_rule);
+    snprintf(what, sizeof(what), "%s, stepped after restoring", p_start);
+    isPassed &= checkStats(what, p_grid, &scratch, p_prev, TRUE);
+
+    unlink(TEST_SNAPSHOT_PATH);
+    free(p_prev);
+    Grid_destroy(&scratch);
+
+    return isPassed;
+}
+
+
+static int testStats(void)
+{
+    Grid grid;
+    Pool *p_pool;
+    Rule rule;
+    char what[64];
+    int iRule;
+    int isPassed = TRUE;
+
+    p_pool = Pool_create(3);
+    if (p_pool == NULL)
+    {
+        return FALSE;
+    }
+
+    for (iRule = 0; iRule < TEST_NUM_RULES; iRule++)
+    {
+        rule = parseRule(iRule);
+
+        grid = Grid_create(97, 120);
+        if (grid.p_data1 == NULL)
+        {
+            return FALSE;
+        }
+        Grid_resetGrid(&grid, iRule + 1, GRID_DEFAULT_DENSITY);
+        snprintf(what, sizeof(what), "stats, %s, soup", testRules[iRule]);
+        isPassed &= checkStatsRun(what, &grid, p_pool, &rule);
+        Grid_destroy(&grid);
+
+        if (createPlane(&grid, iRule + 1) != TRUE)
+        {
+            return FALSE;
+        }
+        snprintf(what, sizeof(what), "stats, %s, plane", testRules[iRule]);
+        isPassed &= checkStatsRun(what, &grid, p_pool, &rule);
+        Grid_destroy(&grid);
+    }
+
+    Pool_destroy(p_pool);
+
+    return isPassed;
+}
+
+
+static int testHashLife(void)
+{
+    Grid expected, actual;
+    HashLife hashLife;
+    Rule rule;
+    char what[64];
+    int iRule, iSeed, iGen;
+    int isPassed = TRUE;
+
+    for (iRule = 0; iRule < TEST_NUM_RULES; iRule++)
+    {
+        rule = parseRule(iRule);
+        for (iSeed = 0; iSeed < TEST_NUM_SEEDS; iSeed++)
+        {
+            if (createPlane(&expected, iSeed + 1) != TRUE || createPlane(&actual, iSeed + 1) != TRUE)
+            {
+                return FALSE;
+            }
+            hashLife = HashLife_create(&rule);
+            if (hashLife.p_table == NULL || HashLife_fromGrid(&hashLife, &actual) != TRUE)
+            {
+                return FALSE;
+            }
+
+            for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+            {
+                Grid_hexGridNextWithRule(&expected, &rule);
+            }
+            /* Single generations, then leaps of eight */
+            for (iGen = 0; iGen < 8; iGen++)
+            {
+                isPassed &= HashLife_step(&hashLife, 0);
+            }
+            for (iGen = 8; iGen < TEST_GENERATIONS; iGen += 8)
+            {
+                isPassed &= HashLife_step(&hashLife, 3);
+            }
+            HashLife_toGrid(&hashLife, &actual);
+
+            snprintf(what, sizeof(what), "hashlife, %s, seed %d", testRules[iRule], iSeed + 1);
+            isPassed &= compareGrids(what, &expected, &actual);
+            if (HashLife_countPopulation(&hashLife) != (uint64_t) Grid_countPopulation(&expected))
+            {
+                printf("[ERR] %s: population differs\n", what);
+                isPassed = FALSE;
+            }
+
+            HashLife_destroy(&hashLife);
+            Grid_destroy(&expected);
+            Grid_destroy(&actual);
+        }
+    }
+
+    return isPassed;
+}
+
+
+static int testSparse(void)
+{
+    Grid expected, actual;
+    Sparse sparse;
+    Rule rule;
+    char what[64];
+    int iRule, iSeed, iGen;
+    int isStationary;
+    int isPassed = TRUE;
+
+    for (iRule = 0; iRule < TEST_NUM_RULES; iRule++)
+    {
+        rule = parseRule(iRule);
+        for (iSeed = 0; iSeed < TEST_NUM_SEEDS; iSeed++)
+        {
+            if (createPlane(&expected, iSeed + 1) != TRUE || createPlane(&actual, iSeed + 1) != TRUE)
+            {
+                return FALSE;
+            }
+            sparse = Sparse_create();
+            if (Sparse_fromGrid(&sparse, &actual) != TRUE)
+            {
+                return FALSE;
+            }
+
+            for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+            {
+                Grid_hexGridNextWithRule(&expected, &rule);
+                isPassed &= Sparse_hexGridNextWithRule(&sparse, &rule, &isStationary);
+            }
+            Sparse_toGrid(&sparse, &actual, 0, 0);
+            Grid_syncDisp(&actual);
+
+            snprintf(what, sizeof(what), "sparse, %s, seed %d", testRules[iRule], iSeed + 1);
+            isPassed &= compareGrids(what, &expected, &actual);
+            if (Sparse_countPopulation(&sparse) != (uint64_t) Grid_countPopulation(&expected))
+            {
+                printf("[ERR] %s: population differs\n", what);
+                isPassed = FALSE;
+            }
+
+            Sparse_destroy(&sparse);
+            Grid_destroy(&expected);
+            Grid_destroy(&actual);
+        }
+    }
+
+    return isPassed;
+}
+
+
+static int testEnsemble(void)
+{
+    Grid grid, previous;
+    Ensemble ensemble;
+    Rule rule;
+    int iRule, iMember, iGen, iRow, iCol;
+    uint8_t value;
+    int isSame, isSamePrevious;
+    int isPassed = TRUE;
+
+    for (iRule = 0; iRule < TEST_NUM_RULES; iRule++)
+    {
+        rule = parseRule(iRule);
+        grid = Grid_create(40, 30);
+        previous = Grid_create(40, 30);
+        ensemble = Ensemble_create(40, 30, TEST_ENSEMBLE_MEMBERS);
+        if (grid.p_data1 == NULL || previous.p_data1 == NULL || ensemble.p_data1 == NULL)
+        {
+            return FALSE;
+        }
+
+        for (iMember = 0; iMember < TEST_ENSEMBLE_MEMBERS; iMember++)
+        {
+            Grid_resetGrid(&grid, iMember + 1, GRID_DEFAULT_DENSITY);
+            Ensemble_setMember(&ensemble, iMember, &grid);
+        }
+        for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+        {
+            Ensemble_hexGridNextWithRule(&ensemble, &rule);
+        }
+
+        for (iMember = 0; iMember < TEST_ENSEMBLE_MEMBERS; iMember++)
+        {
+            Grid_resetGrid(&grid, iMember + 1, GRID_DEFAULT_DENSITY);
+            for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+            {
+                memcpy(previous.p_disp, grid.p_disp, (size_t) grid.stride_cells * grid.height_cells);
+                Grid_hexGridNextWithRule(&grid, &rule);
+            }
+
+            /* Members flipping between two states are frozen in either */
+            isSame = TRUE;
+            isSamePrevious = TRUE;
+            for (iRow = 0; iRow < grid.height_cells; iRow++)
+            {
+                for (iCol = 0; iCol < grid.width_cells; iCol++)
+                {
+                    value = Ensemble_getDispValue(&ensemble, iMember, iRow, iCol);
+                    isSame &= (value == Grid_getDispValue(&grid, iRow, iCol));
+                    isSamePrevious &= (value == Grid_getDispValue(&previous, iRow, iCol));
+                }
+            }
+            if (isSame == FALSE && (ensemble.p_outcomes[iMember] != ENSEMBLE_PERIOD_TWO || isSamePrevious == FALSE))
+            {
+                printf("[ERR] ensemble, %s, member %d differs\n", testRules[iRule], iMember);
+                isPassed = FALSE;
+            }
+        }
+
+        Ensemble_destroy(&ensemble);
+        Grid_destroy(&grid);
+        Grid_destroy(&previous);
+    }
+
+    return isPassed;
+}
+
+
+static int testDomain(void)
+{
+    Grid expected, actual;
+    Domain *p_domain;
+    Rule rule = parseRule(0);
+    char what[96];
+    int transport, boundary, numWorkers, iGen;
+    int isStationary;
+    int isPassed = TRUE;
+
+    for (transport = 0; transport < DOMAIN_NUM_TRANSPORTS; transport++)
+    {
+        for (boundary = 0; boundary < GRID_NUM_BOUNDARIES; boundary++)
+        {
+            for (numWorkers = 1; numWorkers <= 3; numWorkers++)
+            {
+                expected = Grid_create(90, 61);
+                actual = Grid_create(90, 61);
+                if (expected.p_data1 == NULL || actual.p_data1 == NULL)
+                {
+                    return FALSE;
+                }
+                Grid_resetGrid(&expected, numWorkers, GRID_DEFAULT_DENSITY);
+                Grid_resetGrid(&actual, numWorkers, GRID_DEFAULT_DENSITY);
+                Grid_setBoundary(&expected, boundary);
+                Grid_setBoundary(&actual, boundary);
+
+                p_domain = Domain_create(&actual, &rule, numWorkers, transport);
+                if (p_domain == NULL)
+                {
+                    return FALSE;
+                }
+                for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+                {
+                    Grid_hexGridNextWithRule(&expected, &rule);
+                    isPassed &= Domain_step(p_domain, &isStationary);
+                }
+                isPassed &= Domain_gather(p_domain);
+                isPassed &= Domain_destroy(p_domain);
+
+                snprintf(what, sizeof(what), "%d %s workers, %s boundary",
+                         numWorkers, Domain_transportName(transport), Grid_boundaryName(boundary));
+                isPassed &= compareGrids(what, &expected, &actual);
+                isPassed &= compareStats(what, &expected.stats, &actual.stats);
+                if (actual.generation != expected.generation)
+                {
+                    printf("[ERR] %s: generation differs\n", what);
+                    isPassed = FALSE;
+                }
+
+                Grid_destroy(&expected);
+                Grid_destroy(&actual);
+            }
+        }
+    }
+
+    return isPassed;
+}
+
+
+static int testSnapshot(void)
+{
+    static const int encodings[] =
+    {
+        SNAPSHOT_ENCODING_RAW, SNAPSHOT_ENCODING_RLE, SNAPSHOT_ENCODING_PACKED, SNAPSHOT_ENCODING_AUTO
+    };
+    Grid expected, loaded, restored;
+    Rule rule = parseRule(1);
+    Rule loadedRule;
+    char what[64];
+    int iEncoding, iGen;
+    int isPassed = TRUE;
+
+    expected = Grid_create(77, 45);
+    restored = Grid_create(77, 45);
+    if (expected.p_data1 == NULL || restored.p_data1 == NULL)
+    {
+        return FALSE;
+    }
+    Grid_resetGrid(&expected, 5, GRID_DEFAULT_DENSITY);
+    for (iGen = 0; iGen < TEST_GENERATIONS; iGen++)
+    {
+        Grid_hexGridNextWithRule(&expected, &rule);
+    }
+
+    for (iEncoding = 0; iEncoding < (int) (sizeof(encodings) / sizeof(encodings[0])); iEncoding++)
+    {
+        snprintf(what, sizeof(what), "snapshot, %s encoding", Snapshot_encodingName(encodings[iEncoding]));
+        if (Snapshot_save(TEST_SNAPSHOT_PATH, &expected, &rule, encodings[iEncoding]) != TRUE
+         || Snapshot_load(TEST_SNAPSHOT_PATH, &loaded, &loadedRule) != TRUE)
+        {
+            printf("[ERR] %s: could not save and load\n", what);
+            isPassed = FALSE;
+            continue;
+        }
+        isPassed &= compareGrids(what, &expected, &loaded);
+        if (loaded.generation != expected.generation || memcmp(&loadedRule, &rule, sizeof(Rule)) != 0)
+        {
+            printf("[ERR] %s: generation or rule differs\n", what);
+            isPassed = FALSE;
+        }
+        Grid_destroy(&loaded);
+
+        Grid_clearGrid(&restored);
+        if (Snapshot_restore(TEST_SNAPSHOT_PATH, &restored) != TRUE)
+        {
+            printf("[ERR] %s: could not restore\n", what);
+            isPassed = FALSE;
+            continue;
+        }
+        isPassed &= compareGrids(what, &expected, &restored);
+    }
+    unlink(TEST_SNAPSHOT_PATH);
+
+    Grid_destroy(&expected);
+    Grid_destroy(&restored);
+
+    return isPassed;
+}
+
+
+/* Copies the grid's cells as the next directly stepped state */
+static int pushState(Grid *p_states, int *p_numStates, Grid *p_grid)
+{
+    Grid *p_state = &p_states[*p_numStates];
+
+    *p_state = Grid_create(p_grid->width_cells, p_grid->height_cells);
+    if (p_state->p_data1 == NULL)
+    {
+        return FALSE;
+    }
+    memcpy(p_state->p_disp, p_grid->p_disp, (size_t) p_grid->stride_cells * p_grid->height_cells);
+    Grid_syncDisp(p_state);
+    p_state->generation = p_grid->generation;
+    (*p_numStates)++;
+
+    return TRUE;
+}
+
+
+/* Seeks every entry from a keyframe, then walks back and forth a step at a
+ * time. The entries hold the last history.count of the states. */
+static int checkSeeks(const char *p_stage, History *p_history, Grid *p_grid, Grid *p_states, int numStates)
+{
+    Grid *p_oldest = &p_states[numStates - p_history->count];
+    char what[96];
+    int iEntry;
+    int isPassed = TRUE;
+
+    for (iEntry = 0; iEntry < p_history->count; iEntry++)
+    {
+        snprintf(what, sizeof(what), "%s: history entry %d from a keyframe", p_stage, iEntry);
+        isPassed &= History_seek(p_history, p_grid, -1, iEntry);
+        isPassed &= compareGrids(what, &p_oldest[iEntry], p_grid);
+        if (p_grid->generation != p_oldest[iEntry].generation)
+        {
+            printf("[ERR] %s: generation %llu, expected %llu\n", what,
+                   (unsigned long long) p_grid->generation, (unsigned long long) p_oldest[iEntry].generation);
+            isPassed = FALSE;
+        }
+    }
+    for (iEntry = p_history->count - 2; iEntry >= 0; iEntry--)
+    {
+        snprintf(what, sizeof(what), "%s: history entry %d walking back", p_stage, iEntry);
+        isPassed &= History_seek(p_history, p_grid, iEntry + 1, iEntry);
+        isPassed &= compareGrids(what, &p_oldest[iEntry], p_grid);
+    }
+    for (iEntry = 1; iEntry < p_history->count; iEntry++)
+    {
+        snprintf(what, sizeof(what), "%s: history entry %d walking forward", p_stage, iEntry);
+        isPassed &= History_seek(p_history, p_grid, iEntry - 1, iEntry);
+        isPassed &= compareGrids(what, &p_oldest[iEntry], p_grid);
+    }
+
+    return isPassed;
+}
+
+
+static int testHistory(void)
+{
+    Grid grid, expected[TEST_GENERATIONS + 1];
+    History history;
+    Rule rule = parseRule(0);
+    int numStates = 0;
+    int iGen;
+    int isPassed = TRUE;
+
+    grid = Grid_create(70, 40);
+    history = History_create(70, 40, (size_t) 16 << 20, 8);
+    if (grid.p_data1 == NULL || history.p_tip == NULL)
+    {
+        return FALSE;
+    }
+
+    /* Sparse and dense soups, so both delta encodings turn up */
+    Grid_resetGrid(&grid, 9, 0.05);
+    for (iGen = 0; iGen <= TEST_GENERATIONS; iGen++)
+    {
+        if (iGen == TEST_GENERATIONS / 2)
+        {
+            Grid_resetGrid(&grid, 10, 0.5);
+        }
+        if (pushState(expected, &numStates, &grid) != TRUE)
+        {
+            return FALSE;
+        }
+        isPassed &= History_record(&history, &grid);
+        Grid_hexGridNextWithRule(&grid, &rule);
+    }
+
+    isPassed &= checkSeeks("uncapped", &history, &grid, expected, numStates);
+
+    for (iGen = 0; iGen < numStates; iGen++)
+    {
+        Grid_destroy(&expected[iGen]);
+    }
+    History_destroy(&history);
+    Grid_destroy(&grid);
+
+    return isPassed;
+}
+
+
+/* used_bytes must add up to what the entries hold, and the oldest one has
+ * nothing left to undo, so holds no delta */
+static int checkAccounting(const char *p_stage, History *p_history)
+{
+    History_entry *p_entry;
+    size_t numBytes = 0;
+    int iEntry;
+
+    for (iEntry = 0; iEntry < p_history->count; iEntry++)
+    {
+        p_entry = &p_history->p_entries[(p_history->head + iEntry) % p_history->capacity];
+        numBytes += sizeof(History_entry) + p_entry->delta_bytes + p_entry->keyframe_bytes;
+    }
+    if (numBytes != p_history->used_bytes)
+    {
+        printf("[ERR] %s: history counts %zu bytes, its entries hold %zu\n", p_stage, p_history->used_bytes, numBytes);
+        return FALSE;
+    }
+    if (p_history->count > 0 && p_history->p_entries[p_history->head].p_delta != NULL)
+    {
+        printf("[ERR] %s: the oldest history entry kept its delta\n", p_stage);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/* Records past the memory limit, so the oldest entries and keyframes are
+ * dropped, then truncates in the middle of the wrapped ring and records a
+ * different future from there */
+static int testHistoryCap(void)
+{
+    Grid grid, states[TEST_HISTORY_STATES];
+    History history;
+    Rule rule = parseRule(0);
+    Rule otherRule = parseRule(1);
+    int numStates = 0;
+    int iGen, iEntry, iKept;
+    int isPassed = TRUE;
+
+    grid = Grid_create(70, 40);
+    history = History_create(70, 40, TEST_HISTORY_MAX_BYTES, 8);
+    if (grid.p_data1 == NULL || history.p_tip == NULL)
+    {
+        return FALSE;
+    }
+
+    Grid_resetGrid(&grid, 11, 0.5);
+    for (iGen = 0; iGen < TEST_HISTORY_STATES / 2; iGen++)
+    {
+        if (pushState(states, &numStates, &grid) != TRUE)
+        {
+            return FALSE;
+        }
+        isPassed &= History_record(&history, &grid);
+        Grid_hexGridNextWithRule(&grid, &rule);
+    }
+    if (history.count >= numStates || history.used_bytes > history.max_bytes)
+    {
+        printf("[ERR] %d of %d entries kept in %zu bytes, the limit did not drop any\n",
+               history.count, numStates, history.used_bytes);
+        isPassed = FALSE;
+    }
+    isPassed &= checkAccounting("capped", &history);
+    isPassed &= checkSeeks("capped", &history, &grid, states, numStates);
+
+    /* The grid must hold the entry the new future starts from */
+    iEntry = history.count / 2;
+    iKept = numStates - history.count + iEntry;
+    History_truncate(&history, iEntry);
+    for (iGen = iKept + 1; iGen < numStates; iGen++)
+    {
+        Grid_destroy(&states[iGen]);
+    }
+    numStates = iKept + 1;
+    if (history.count != iEntry + 1)
+    {
+        printf("[ERR] %d entries left truncating after entry %d\n", history.count, iEntry);
+        isPassed = FALSE;
+    }
+    isPassed &= checkAccounting("truncated", &history);
+    isPassed &= checkSeeks("truncated", &history, &grid, states, numStates);
+    isPassed &= History_seek(&history, &grid, -1, iEntry);
+
+    /* An edit, then steps under another rule, dropping more entries */
+    Grid_setDispValue(&grid, 20, 35, Grid_getDispValue(&grid, 20, 35) == GRID_DEAD ? GRID_ALIVE : GRID_DEAD);
+    while (numStates < TEST_HISTORY_STATES)
+    {
+        if (pushState(states, &numStates, &grid) != TRUE)
+        {
+            return FALSE;
+        }
+        isPassed &= History_record(&history, &grid);
+        Grid_hexGridNextWithRule(&grid, &otherRule);
+    }
+    if (history.used_bytes > history.max_bytes)
+    {
+        printf("[ERR] History holds %zu bytes, over its %zu limit\n", history.used_bytes, history.max_bytes);
+        isPassed = FALSE;
+    }
+    isPassed &= checkAccounting("recorded after truncating", &history);
+    isPassed &= checkSeeks("recorded after truncating", &history, &grid, states, numStates);
+
+    for (iGen = 0; iGen < numStates; iGen++)
+    {
+        Grid_destroy(&states[iGen]);
+    }
+    History_destroy(&history);
+    Grid_destroy(&grid);
+
+    return isPassed;
+}
+
+
+static uint8_t *readFile(const char *p_path, size_t *p_numBytes)
+{
+    FILE *p_file = fopen(p_path, "rb");
+    uint8_t *p_bytes;
+    long numBytes;
+
+    if (p_file == NULL)
+    {
+        printf("[ERR] Could not open %s\n", p_path);
+        return NULL;
+    }
+    fseek(p_file, 0, SEEK_END);
+    numBytes = ftell(p_file);
+    fseek(p_file, 0, SEEK_SET);
+    p_bytes = malloc(numBytes > 0 ? numBytes : 1);
+    if (p_bytes == NULL || fread(p_bytes, 1, numBytes, p_file) != (size_t) numBytes)
+    {
+        printf("[ERR] Could not read %s\n", p_path);
+        free(p_bytes);
+        fclose(p_file);
+        return NULL;
+    }
+    fclose(p_file);
+    *p_numBytes = (size_t) numBytes;
+
+    return p_bytes;
+}
+
+
+static int readBits(Test_bits *p_bits, int numBits, uint32_t *p_value)
+{
+    int iBit;
+
+    *p_value = 0;
+    for (iBit = 0; iBit < numBits; iBit++)
+    {
+        if (p_bits->bitPos >= 8 * p_bits->numBytes)
+        {
+            return FALSE;
+        }
+        *p_value |= (uint32_t) ((p_bits->p_bytes[p_bits->bitPos / 8] >> (p_bits->bitPos % 8)) & 1) << iBit;
+        p_bits->bitPos++;
+    }
+
+    return TRUE;
+}
+
+
+static uint16_t getU16(const uint8_t *p_bytes)
+{
+    return (uint16_t) (p_bytes[0] | (p_bytes[1] << 8));
+}
+
+
+static uint32_t getU32BigEndian(const uint8_t *p_bytes)
+{
+    return ((uint32_t) p_bytes[0] << 24) | ((uint32_t) p_bytes[1] << 16) | ((uint32_t) p_bytes[2] << 8) | p_bytes[3];
+}
+
+
+/* Palette index of every pixel of a frame, worked out from the cells rather
+ * than by the exporter's drawing code */
+static void drawExpected(Grid *p_grid, int cellPx, int widthPx, int heightPx, uint8_t *p_pixels)
+{
+    int x, y, col, cellY;
+
+    for (y = 0; y < heightPx; y++)
+    {
+        for (x = 0; x < widthPx; x++)
+        {
+            col = x / cellPx;
+            cellY = y - (col % 2 == 0 ? cellPx / 2 : 0);
+            if (cellY < 0 || cellY / cellPx >= p_grid->height_cells)
+            {
+                p_pixels[(size_t) y * widthPx + x] = GRID_DEAD;
+            }
+            else
+            {
+                p_pixels[(size_t) y * widthPx + x] = Grid_getDispValue(p_grid, cellY / cellPx, col);
+            }
+        }
+    }
+}
+
+
+/* Decodes an LZW image of numPixels pixels */
+static int decodeLzw(Test_bits *p_bits, int minCodeBits, uint8_t *p_pixels, size_t numPixels)
+{
+    static uint16_t prefix[TEST_LZW_MAX_CODES];
+    static uint8_t suffix[TEST_LZW_MAX_CODES];
+    static uint8_t first[TEST_LZW_MAX_CODES];
+    static uint8_t stack[TEST_LZW_MAX_CODES];
+    int clearCode = 1 << minCodeBits;
+    int endCode = clearCode + 1;
+    int codeBits = minCodeBits + 1;
+    int nextCode = endCode + 1;
+    int previous = -1;
+    int code, walk, numStack;
+    uint32_t value;
+    size_t numDone = 0;
+
+    for (code = 0; code < clearCode; code++)
+    {
+        suffix[code] = (uint8_t) code;
+        first[code] = (uint8_t) code;
+    }
+
+    for (;;)
+    {
+        if (readBits(p_bits, codeBits, &value) != TRUE)
+        {
+            printf("[ERR] LZW stream ends without an end code\n");
+            return FALSE;
+        }
+        code = (int) value;
+
+        if (code == clearCode)
+        {
+            codeBits = minCodeBits + 1;
+            nextCode = endCode + 1;
+            previous = -1;
+            continue;
+        }
+        if (code == endCode)
+        {
+            break;
+        }
+        if (code > nextCode || (code == nextCode && previous < 0))
+        {
+            printf("[ERR] LZW code %d out of range\n", code);
+            return FALSE;
+        }
+
+        /* A code not yet in the table is the previous string plus its own first index */
+        if (previous >= 0 && nextCode < TEST_LZW_MAX_CODES)
+        {
+            prefix[nextCode] = (uint16_t) previous;
+            suffix[nextCode] = (code == nextCode) ? first[previous] : first[code];
+            first[nextCode] = first[previous];
+            nextCode++;
+        }
+
+        numStack = 0;
+        for (walk = code; walk >= clearCode; walk = prefix[walk])
+        {
+            stack[numStack++] = suffix[walk];
+        }
+        stack[numStack++] = (uint8_t) walk;
+        if (numDone + numStack > numPixels)
+        {
+            printf("[ERR] LZW image has too many pixels\n");
+            return FALSE;
+        }
+        while (numStack > 0)
+        {
+            p_pixels[numDone++] = stack[--numStack];
+        }
+
+        previous = code;
+        if (nextCode == (1 << codeBits) && codeBits < 12)
+        {
+            codeBits++;
+        }
+    }
+
+    if (numDone != numPixels)
+    {
+        printf("[ERR] LZW image has %lu pixels, expected %lu\n", (unsigned long) numDone, (unsigned long) numPixels);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/* Decodes frame iFrame of a GIF, checking the sizes in both headers */
+static int decodeGif(const uint8_t *p_gif, size_t numBytes, int iFrame, int widthPx, int heightPx, uint8_t *p_pixels)
+{
+    uint8_t *p_data;
+    size_t pos, dataBytes;
+    Test_bits bits;
+    int iImage = 0;
+    int minCodeBits;
+    int isDecoded;
+
+    if (numBytes < 13 || memcmp(p_gif, "GIF89a", 6) != 0
+     || getU16(p_gif + 6) != widthPx || getU16(p_gif + 8) != heightPx)
+    {
+        printf("[ERR] GIF header does not match a %dx%d image\n", widthPx, heightPx);
+        return FALSE;
+    }
+    pos = 13;
+    if (p_gif[10] & 0x80)
+    {
+        pos += 3 * ((size_t) 2 << (p_gif[10] & 0x07));
+    }
+
+    p_data = malloc(numBytes);
+    if (p_data == NULL)
+    {
+        return FALSE;
+    }
+
+    while (pos < numBytes && p_gif[pos] != 0x3B)
+    {
+        if (p_gif[pos] == 0x21)
+        {
+            /* Extensions are a label then sub-blocks */
+            pos += 2;
+            while (pos < numBytes && p_gif[pos] != 0)
+            {
+                pos += p_gif[pos] + 1;
+            }
+            pos++;
+            continue;
+        }
+        if (p_gif[pos] != 0x2C || pos + 11 > numBytes)
+        {
+            printf("[ERR] Unexpected GIF block 0x%02X\n", p_gif[pos]);
+            free(p_data);
+            return FALSE;
+        }
+        if (getU16(p_gif + pos + 1) != 0 || getU16(p_gif + pos + 3) != 0
+         || getU16(p_gif + pos + 5) != widthPx || getU16(p_gif + pos + 7) != heightPx || (p_gif[pos + 9] & 0x80))
+        {
+            printf("[ERR] GIF image descriptor %d does not cover the %dx%d screen\n", iImage, widthPx, heightPx);
+            free(p_data);
+            return FALSE;
+        }
+
+        /* Gather the sub-blocks after the minimum code size */
+        minCodeBits = p_gif[pos + 10];
+        bits.p_bytes = p_data;
+        bits.bitPos = 0;
+        dataBytes = 0;
+        pos += 11;
+        while (pos < numBytes && p_gif[pos] != 0)
+        {
+            memcpy(p_data + dataBytes, p_gif + pos + 1, p_gif[pos]);
+            dataBytes += p_gif[pos];
+            pos += p_gif[pos] + 1;
+        }
+        pos++;
+        bits.numBytes = dataBytes;
+
+        if (iImage == iFrame)
+        {
+            isDecoded = decodeLzw(&bits, minCodeBits, p_pixels, (size_t) widthPx * heightPx);
+            free(p_data);
+            return isDecoded;
+        }
+        iImage++;
+    }
+
+    printf("[ERR] GIF has no frame %d\n", iFrame);
+    free(p_data);
+
+    return FALSE;
+}
+
+
+static uint32_t crc32(const uint8_t *p_bytes, size_t numBytes)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t iByte;
+    int iBit;
+
+    for (iByte = 0; iByte < numBytes; iByte++)
+    {
+        crc ^= p_bytes[iByte];
+        for (iBit = 0; iBit < 8; iBit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+
+    return crc ^ 0xFFFFFFFFu;
+}
+
+
+/* Symbol of the fixed literal/length code, whose codes are stored most
+ * significant bit first */
+static int readFixedSymbol(Test_bits *p_bits)
+{
+    uint32_t bit;
+    int code = 0;
+    int numBits;
+
+    for (numBits = 1; numBits <= 9; numBits++)
+    {
+        if (readBits(p_bits, 1, &bit) != TRUE)
+        {
+            return -1;
+        }
+        code = (code << 1) | (int) bit;
+        if (numBits == 7 && code <= 0x17)
+        {
+            return 256 + code;
+        }
+        if (numBits == 8 && code >= 0x30 && code <= 0xBF)
+        {
+            return code - 0x30;
+        }
+        if (numBits == 8 && code >= 0xC0 && code <= 0xC7)
+        {
+            return 280 + code - 0xC0;
+        }
+        if (numBits == 9 && code >= 0x190)
+        {
+            return 144 + code - 0x190;
+        }
+    }
+
+    return -1;
+}
+
+
+/* Inflates a zlib stream of stored and fixed Huffman blocks, the only kinds
+ * the exporter writes, and checks its Adler-32 */
+static int inflateZlib(const uint8_t *p_stream, size_t streamBytes, uint8_t *p_out, size_t outBytes)
+{
+    static const int lengthBase[29] =
+        { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const int lengthExtra[29] =
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const int distanceBase[30] =
+        { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+          4097, 6145, 8193, 12289, 16385, 24577 };
+    static const int distanceExtra[30] =
+        { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    Test_bits bits;
+    uint32_t isFinal, blockType, value, code;
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t numDone = 0;
+    size_t length, distance, iByte;
+    int symbol, iBit;
+
+    if (streamBytes < 6 || (p_stream[0] & 0x0F) != 8 || ((p_stream[0] << 8) | p_stream[1]) % 31 != 0)
+    {
+        printf("[ERR] Bad zlib header\n");
+        return FALSE;
+    }
+    bits.p_bytes = p_stream + 2;
+    bits.numBytes = streamBytes - 6;
+    bits.bitPos = 0;
+
+    do
+    {
+        if (readBits(&bits, 1, &isFinal) != TRUE || readBits(&bits, 2, &blockType) != TRUE)
+        {
+            return FALSE;
+        }
+
+        if (blockType == 0)
+        {
+            bits.bitPos = (bits.bitPos + 7) & ~(size_t) 7;
+            if (readBits(&bits, 16, &value) != TRUE || readBits(&bits, 16, &code) != TRUE
+             || (value ^ code) != 0xFFFF || numDone + value > outBytes || bits.bitPos / 8 + value > bits.numBytes)
+            {
+                printf("[ERR] Bad stored block\n");
+                return FALSE;
+            }
+            memcpy(p_out + numDone, bits.p_bytes + bits.bitPos / 8, value);
+            numDone += value;
+            bits.bitPos += 8 * (size_t) value;
+            continue;
+        }
+        if (blockType != 1)
+        {
+            printf("[ERR] Unexpected deflate block type %u\n", blockType);
+            return FALSE;
+        }
+
+        for (;;)
+        {
+            symbol = readFixedSymbol(&bits);
+            if (symbol < 0 || symbol > 285)
+            {
+                printf("[ERR] Bad deflate symbol\n");
+                return FALSE;
+            }
+            if (symbol == 256)
+            {
+                break;
+            }
+            if (symbol < 256)
+            {
+                if (numDone >= outBytes)
+                {
+                    printf("[ERR] Deflate stream too long\n");
+                    return FALSE;
+                }
+                p_out[numDone++] = (uint8_t) symbol;
+                continue;
+            }
+
+            if (readBits(&bits, lengthExtra[symbol - 257], &value) != TRUE)
+            {
+                return FALSE;
+            }
+            length = lengthBase[symbol - 257] + value;
+
+            /* Distance codes are five bits, most significant first */
+            code = 0;
+            for (iBit = 0; iBit < 5; iBit++)
+            {
+                if (readBits(&bits, 1, &value) != TRUE)
+                {
+                    return FALSE;
+                }
+                code = (code << 1) | value;
+            }
+            if (code >= 30 || readBits(&bits, distanceExtra[code], &value) != TRUE)
+            {
+                printf("[ERR] Bad deflate distance\n");
+                return FALSE;
+            }
+            distance = distanceBase[code] + value;
+            if (distance > numDone || numDone + length > outBytes)
+            {
+                printf("[ERR] Deflate match out of range\n");
+                return FALSE;
+            }
+            for (iByte = 0; iByte < length; iByte++)
+            {
+                p_out[numDone] = p_out[numDone - distance];
+                numDone++;
+            }
+        }
+    } while (isFinal == 0);
+
+    if (numDone != outBytes)
+    {
+        printf("[ERR] Deflate stream has %lu bytes, expected %lu\n", (unsigned long) numDone, (unsigned long) outBytes);
+        return FALSE;
+    }
+
+    for (iByte = 0; iByte < outBytes; iByte++)
+    {
+        adlerA = (adlerA + p_out[iByte]) % 65521;
+        adlerB = (adlerB + adlerA) % 65521;
+    }
+    if (getU32BigEndian(p_stream + streamBytes - 4) != ((adlerB << 16) | adlerA))
+    {
+        printf("[ERR] Adler-32 differs\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/* Decodes a palette PNG with no filtering, checking every chunk's CRC */
+static int decodePng(const uint8_t *p_png, size_t numBytes, int widthPx, int heightPx, uint8_t *p_pixels)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    size_t lineBytes = (size_t) widthPx + 1;
+    size_t pos = sizeof(signature);
+    size_t chunkBytes, streamBytes = 0;
+    uint8_t *p_stream, *p_raw;
+    int iLine;
+    int isHeaderSeen = FALSE;
+    int isDecoded = TRUE;
+
+    if (numBytes < sizeof(signature) || memcmp(p_png, signature, sizeof(signature)) != 0)
+    {
+        printf("[ERR] Not a PNG\n");
+        return FALSE;
+    }
+
+    p_stream = malloc(numBytes);
+    p_raw = malloc(lineBytes * heightPx);
+    if (p_stream == NULL || p_raw == NULL)
+    {
+        free(p_stream);
+        free(p_raw);
+        return FALSE;
+    }
+
+    while (isDecoded == TRUE && pos + 12 <= numBytes)
+    {
+        chunkBytes = getU32BigEndian(p_png + pos);
+        if (pos + 12 + chunkBytes > numBytes
+         || crc32(p_png + pos + 4, chunkBytes + 4) != getU32BigEndian(p_png + pos + 8 + chunkBytes))
+        {
+            printf("[ERR] PNG chunk at %lu is cut short or fails its CRC\n", (unsigned long) pos);
+            isDecoded = FALSE;
+            break;
+        }
+        if (memcmp(p_png + pos + 4, "IHDR", 4) == 0)
+        {
+            /* 8 bit palette indices, no interlacing */
+            isHeaderSeen = (chunkBytes == 13
+                         && getU32BigEndian(p_png + pos + 8) == (uint32_t) widthPx
+                         && getU32BigEndian(p_png + pos + 12) == (uint32_t) heightPx
+                         && p_png[pos + 16] == 8 && p_png[pos + 17] == 3 && p_png[pos + 20] == 0);
+        }
+        else if (memcmp(p_png + pos + 4, "IDAT", 4) == 0)
+        {
+            memcpy(p_stream + streamBytes, p_png + pos + 8, chunkBytes);
+            streamBytes += chunkBytes;
+        }
+        else if (memcmp(p_png + pos + 4, "IEND", 4) == 0)
+        {
+            break;
+        }
+        pos += 12 + chunkBytes;
+    }
+
+    if (isDecoded == TRUE && isHeaderSeen == FALSE)
+    {
+        printf("[ERR] PNG header does not match a %dx%d palette image\n", widthPx, heightPx);
+        isDecoded = FALSE;
+    }
+    if (isDecoded == TRUE)
+    {
+        isDecoded = inflateZlib(p_stream, streamBytes, p_raw, lineBytes * heightPx);
+    }
+    for (iLine = 0; isDecoded == TRUE && iLine < heightPx; iLine++)
+    {
+        if (p_raw[iLine * lineBytes] != 0)
+        {
+            printf("[ERR] PNG line %d is filtered\n", iLine);
+            isDecoded = FALSE;
+            break;
+        }
+        memcpy(p_pixels + (size_t) iLine * widthPx, p_raw + iLine * lineBytes + 1, widthPx);
+    }
+
+    free(p_stream);
+    free(p_raw);
+
+    return isDecoded;
+}
+
+
+static int testExport(void)
+{
+    /* Odd sizes, so the half cell offset and the bottom strip both show, and
+     * one large enough to fill the LZW table */
+    static const int sizes[][3] =
+    {
+        { 37, 23, 1 }, { 37, 23, 2 }, { 37, 23, 3 }, { 301, 200, 1 }
+    };
+    Grid grids[TEST_EXPORT_FRAMES];
+    Export *p_export;
+    Rule rule = parseRule(0);
+    char path[64];
+    char what[64];
+    uint8_t *p_file, *p_expected, *p_decoded;
+    size_t numBytes, numPixels;
+    int iSize, iFormat, iFrame;
+    int widthCells, heightCells, cellPx, widthPx, heightPx;
+    int isPassed = TRUE;
+
+    for (iSize = 0; iSize < (int) (sizeof(sizes) / sizeof(sizes[0])); iSize++)
+    {
+        widthCells = sizes[iSize][0];
+        heightCells = sizes[iSize][1];
+        cellPx = sizes[iSize][2];
+        widthPx = widthCells * cellPx;
+        heightPx = heightCells * cellPx + cellPx / 2;
+        numPixels = (size_t) widthPx * heightPx;
+
+        /* Consecutive generations with every state in them */
+        for (iFrame = 0; iFrame < TEST_EXPORT_FRAMES; iFrame++)
+        {
+            grids[iFrame] = Grid_create(widthCells, heightCells);
+            if (grids[iFrame].p_data1 == NULL)
+            {
+                return FALSE;
+            }
+            if (iFrame == 0)
+            {
+                Grid_resetGrid(&grids[iFrame], 3, 0.5);
+                Grid_setDispValue(&grids[iFrame], 0, 0, GRID_SICK);
+                Grid_setDispValue(&grids[iFrame], heightCells - 1, widthCells - 1, GRID_FIXED);
+            }
+            else
+            {
+                memcpy(grids[iFrame].p_disp, grids[iFrame - 1].p_disp, (size_t) grids[iFrame].stride_cells * heightCells);
+                Grid_syncDisp(&grids[iFrame]);
+                Grid_hexGridNextWithRule(&grids[iFrame], &rule);
+            }
+        }
+
+        p_expected = malloc(numPixels);
+        p_decoded = malloc(numPixels);
+        if (p_expected == NULL || p_decoded == NULL)
+        {
+            return FALSE;
+        }
+
+        for (iFormat = EXPORT_FORMAT_GIF; iFormat <= EXPORT_FORMAT_PNG; iFormat++)
+        {
+            p_export = Export_create(iFormat == EXPORT_FORMAT_GIF ? TEST_GIF_PATH : TEST_PNG_PATTERN,
+                                     widthCells, heightCells, cellPx, EXPORT_DEFAULT_FPS);
+            if (p_export == NULL)
+            {
+                return FALSE;
+            }
+            for (iFrame = 0; iFrame < TEST_EXPORT_FRAMES; iFrame++)
+            {
+                isPassed &= Export_pushFrame(p_export, &grids[iFrame]);
+            }
+            isPassed &= Export_destroy(p_export);
+
+            for (iFrame = 0; iFrame < TEST_EXPORT_FRAMES; iFrame++)
+            {
+                snprintf(path, sizeof(path), iFormat == EXPORT_FORMAT_GIF ? TEST_GIF_PATH : TEST_PNG_PATTERN, iFrame);
+                snprintf(what, sizeof(what), "%s frame %d, %dx%d cells of %d px",
+                         iFormat == EXPORT_FORMAT_GIF ? "GIF" : "PNG", iFrame, widthCells, heightCells, cellPx);
+                p_file = readFile(path, &numBytes);
+                if (p_file == NULL)
+                {
+                    isPassed = FALSE;
+                    continue;
+                }
+
+                drawExpected(&grids[iFrame], cellPx, widthPx, heightPx, p_expected);
+                memset(p_decoded, 0xFF, numPixels);
+                if (iFormat == EXPORT_FORMAT_GIF)
+                {
+                    isPassed &= decodeGif(p_file, numBytes, iFrame, widthPx, heightPx, p_decoded);
+                }
+                else
+                {
+                    isPassed &= decodePng(p_file, numBytes, widthPx, heightPx, p_decoded);
+                    unlink(path);
+                }
+                if (memcmp(p_expected, p_decoded, numPixels) != 0)
+                {
+                    printf("[ERR] %s: pixels differ from the grid\n", what);
+                    isPassed = FALSE;
+                }
+                free(p_file);
+            }
+        }
+        unlink(TEST_GIF_PATH);
+
+        free(p_expected);
+        free(p_decoded);
+        for (iFrame = 0; iFrame < TEST_EXPORT_FRAMES; iFrame++)
+        {
+            Grid_destroy(&grids[iFrame]);
+        }
+    }
+
+    return isPassed;
+}
+
+
+static const Test_case testCases[] =
+{
+    { "rule",     testRule },
+    { "cycle",    testCycle },
+    { "bitgrid",  testBitGrid },
+    { "pool",     testPool },
+    { "stats",    testStats },
+    { "hashlife", testHashLife },
+    { "sparse",   testSparse },
+    { "ensemble", testEnsemble },
+    { "domain",   testDomain },
+    { "snapshot", testSnapshot },
+    { "history",  testHistory },
+    { "history-cap", testHistoryCap },
+    { "export",   testExport },
+};
+
+
+/* Runs the named tests, or all of them, exiting 1 if any fails */
+int main(int argc, char *argv[])
+{
+    int numCases = (int) (sizeof(testCases) / sizeof(testCases[0]));
+    int iCase, iArg;
+    int isSelected;
+    int numFailed = 0;
+
+    for (iCase = 0; iCase < numCases; iCase++)
+    {
+        isSelected = (argc < 2);
+        for (iArg = 1; iArg < argc; iArg++)
+        {
+            isSelected |= (strcmp(argv[iArg], testCases[iCase].p_name) == 0);
+        }
+        if (isSelected == FALSE)
+        {
+            continue;
+        }
+
+        if (testCases[iCase].testFn() == TRUE)
+        {
+            printf("%-12s passed\n", testCases[iCase].p_name);
+        }
+        else
+        {
+            printf("%-12s FAILED\n", testCases[iCase].p_name);
+            numFailed++;
+        }
+        fflush(stdout);
+    }
+
+    return numFailed > 0 ? 1 : 0;
+}
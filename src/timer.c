@@ -0,0 +1,19 @@
+#include <time.h>
+
+#include "timer.h"
+
+
+uint64_t Timer_nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+
+double Timer_secondsSince(uint64_t start_ns)
+{
+    return (double) (Timer_nowNs() - start_ns) / 1e9;
+}
@@ -0,0 +1,14 @@
+#ifndef H_HEXLIFE_TIMER_H
+#define H_HEXLIFE_TIMER_H
+
+
+#include <stdint.h>
+
+
+/* Monotonic time in nanoseconds, only meaningful as a difference */
+extern uint64_t Timer_nowNs(void);
+
+extern double Timer_secondsSince(uint64_t start_ns);
+
+
+#endif /* H_HEXLIFE_TIMER_H */